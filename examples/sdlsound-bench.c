@@ -0,0 +1,1868 @@
+/**
+ * SDL_sound; An abstract sound format decoding API.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+/*
+ * This is a benchmark for SDL_sound's decoders, meant to be run between
+ *  releases to catch performance regressions.
+ *
+ * It writes its own test corpus first: the same few seconds of synthetic
+ *  stereo audio encoded as WAV (PCM and MS-ADPCM), AIFF, AU (mu-law), VOC,
+ *  RAW, Shorten, FLAC (fixed and LPC prediction) and MP3, plus a small MOD
+ *  tune. All of it is generated from fixed formulas, so every run on every
+ *  machine decodes exactly the same bytes. There's no Ogg Vorbis encoder in
+ *  here, so ten seconds of the same signal in Vorbis are bundled in
+ *  examples/fixtures instead. Pass real files (of any format) on the
+ *  command line to add them to the run.
+ *
+ * For each file it reports how long Sound_NewSampleFromFile() takes, how
+ *  many sample frames per second Sound_Decode() gets through, how long a
+ *  seek (and the decode after it) takes, and the most heap SDL_sound had in
+ *  use at once while doing all that. After that come the resampler, the
+ *  parallel decoder, read-ahead, and seeking around a 6 gigabyte RF64 WAV.
+ *  It all goes out as JSON.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+#define SDL_MAIN_HANDLED 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir_one(dir) _mkdir(dir)
+#else
+#include <sys/stat.h>
+#define mkdir_one(dir) mkdir(dir, 0777)
+#endif
+
+#include "SDL.h"
+#include "SDL_sound.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define BENCH_RATE 44100
+#define BENCH_CHANNELS 2
+#define BENCH_BUFFER_SIZE (16 * 1024)
+
+#ifndef SDLSOUND_BENCH_FIXTURES  /* the build points this at examples/fixtures. */
+#define SDLSOUND_BENCH_FIXTURES "fixtures"
+#endif
+
+static const char *corpus_dir = "sdlsound-bench-corpus";
+static const char *fixture_dir = SDLSOUND_BENCH_FIXTURES;
+static Uint32 seconds = 10;
+static int iterations = 5;
+static int seek_count = 64;
+static FILE *out = NULL;
+
+
+/* Memory accounting: SDL_sound allocates through these, so we can see its peak. */
+
+#define MEM_HEADER_SIZE 16
+
+static SDL_SpinLock mem_lock = 0;
+static size_t mem_live = 0;
+static size_t mem_peak = 0;
+
+static void mem_adjust(size_t add, size_t sub)
+{
+    SDL_AtomicLock(&mem_lock);
+    mem_live = (mem_live + add) - sub;
+    if (mem_live > mem_peak)
+        mem_peak = mem_live;
+    SDL_AtomicUnlock(&mem_lock);
+} /* mem_adjust */
+
+static void *SDLCALL counting_malloc(size_t size)
+{
+    Uint8 *ptr = (Uint8 *) malloc(size + MEM_HEADER_SIZE);
+    if (ptr == NULL)
+        return NULL;
+    *((size_t *) ptr) = size;
+    mem_adjust(size, 0);
+    return ptr + MEM_HEADER_SIZE;
+} /* counting_malloc */
+
+static void *SDLCALL counting_calloc(size_t nmemb, size_t size)
+{
+    Uint8 *ptr;
+    if ((size != 0) && (nmemb > (((size_t) -1) - MEM_HEADER_SIZE) / size))
+        return NULL;
+    ptr = (Uint8 *) calloc(1, (nmemb * size) + MEM_HEADER_SIZE);
+    if (ptr == NULL)
+        return NULL;
+    *((size_t *) ptr) = nmemb * size;
+    mem_adjust(nmemb * size, 0);
+    return ptr + MEM_HEADER_SIZE;
+} /* counting_calloc */
+
+static void *SDLCALL counting_realloc(void *mem, size_t size)
+{
+    Uint8 *ptr;
+    size_t oldsize;
+
+    if (mem == NULL)
+        return counting_malloc(size);
+
+    ptr = ((Uint8 *) mem) - MEM_HEADER_SIZE;
+    oldsize = *((size_t *) ptr);
+    ptr = (Uint8 *) realloc(ptr, size + MEM_HEADER_SIZE);
+    if (ptr == NULL)
+        return NULL;
+    *((size_t *) ptr) = size;
+    mem_adjust(size, oldsize);
+    return ptr + MEM_HEADER_SIZE;
+} /* counting_realloc */
+
+static void SDLCALL counting_free(void *mem)
+{
+    if (mem != NULL)
+    {
+        Uint8 *ptr = ((Uint8 *) mem) - MEM_HEADER_SIZE;
+        mem_adjust(0, *((size_t *) ptr));
+        free(ptr);
+    } /* if */
+} /* counting_free */
+
+/* start a new high-water mark; returns the baseline to subtract later. */
+static size_t mem_reset_peak(void)
+{
+    size_t retval;
+    SDL_AtomicLock(&mem_lock);
+    mem_peak = mem_live;
+    retval = mem_live;
+    SDL_AtomicUnlock(&mem_lock);
+    return retval;
+} /* mem_reset_peak */
+
+static size_t mem_peak_since(size_t baseline)
+{
+    size_t retval;
+    SDL_AtomicLock(&mem_lock);
+    retval = mem_peak - baseline;
+    SDL_AtomicUnlock(&mem_lock);
+    return retval;
+} /* mem_peak_since */
+
+
+static double now(void)
+{
+    return ((double) SDL_GetPerformanceCounter()) /
+           ((double) SDL_GetPerformanceFrequency());
+} /* now */
+
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double x = *((const double *) a);
+    const double y = *((const double *) b);
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+} /* cmp_double */
+
+static double median(double *values, int count)
+{
+    qsort(values, count, sizeof (double), cmp_double);
+    if (count & 1)
+        return values[count / 2];
+    return (values[(count / 2) - 1] + values[count / 2]) / 2.0;
+} /* median */
+
+
+/* The corpus... */
+
+/* the signal everything is made from: two tones, a sweep and some noise. */
+static Sint16 signal_at(Uint32 frame, int channel, Uint32 rate)
+{
+    const double t = ((double) frame) / ((double) rate);
+    const double tone = (channel == 0) ? 440.0 : 554.37;
+    Uint32 noise = (frame * 1103515245u) + 12345u + (Uint32) channel;
+    double v;
+
+    noise ^= noise >> 16;
+    v = 0.35 * sin(2.0 * M_PI * tone * t);
+    v += 0.2 * sin(2.0 * M_PI * (200.0 + (400.0 * fmod(t, 2.0))) * t);
+    v += 0.05 * ((((double) (noise & 0xFFFF)) / 32768.0) - 1.0);
+    return (Sint16) (v * 32767.0);
+} /* signal_at */
+
+
+typedef struct
+{
+    Uint8 *data;
+    size_t len;
+    size_t cap;
+    Uint32 bitbuf;  /* for the bitstream formats, MSB first. */
+    int bits;
+} Blob;
+
+static void put_bytes(Blob *b, const void *ptr, size_t len)
+{
+    if (b->len + len > b->cap)
+    {
+        size_t newcap = b->cap ? b->cap * 2 : 64 * 1024;
+        while (newcap < b->len + len)
+            newcap *= 2;
+        b->data = (Uint8 *) realloc(b->data, newcap);
+        if (b->data == NULL)
+        {
+            fprintf(stderr, "sdlsound-bench: out of memory\n");
+            exit(1);
+        } /* if */
+        b->cap = newcap;
+    } /* if */
+    memcpy(b->data + b->len, ptr, len);
+    b->len += len;
+} /* put_bytes */
+
+static void put8(Blob *b, Uint8 v) { put_bytes(b, &v, 1); }
+static void put_str(Blob *b, const char *str) { put_bytes(b, str, strlen(str)); }
+
+static void put_le16(Blob *b, Uint16 v)
+{
+    put8(b, (Uint8) (v & 0xFF));
+    put8(b, (Uint8) (v >> 8));
+} /* put_le16 */
+
+static void put_le32(Blob *b, Uint32 v)
+{
+    put_le16(b, (Uint16) (v & 0xFFFF));
+    put_le16(b, (Uint16) (v >> 16));
+} /* put_le32 */
+
+static void put_be16(Blob *b, Uint16 v)
+{
+    put8(b, (Uint8) (v >> 8));
+    put8(b, (Uint8) (v & 0xFF));
+} /* put_be16 */
+
+static void put_be32(Blob *b, Uint32 v)
+{
+    put_be16(b, (Uint16) (v >> 16));
+    put_be16(b, (Uint16) (v & 0xFFFF));
+} /* put_be32 */
+
+static void set_le32(Blob *b, size_t pos, Uint32 v)
+{
+    b->data[pos] = (Uint8) v;
+    b->data[pos + 1] = (Uint8) (v >> 8);
+    b->data[pos + 2] = (Uint8) (v >> 16);
+    b->data[pos + 3] = (Uint8) (v >> 24);
+} /* set_le32 */
+
+static void put_bits(Blob *b, Uint32 value, int count)
+{
+    while (count > 0)
+    {
+        const int take = (count > 8) ? 8 : count;
+        const Uint32 chunk = (value >> (count - take)) & ((1u << take) - 1);
+        b->bitbuf = (b->bitbuf << take) | chunk;
+        b->bits += take;
+        count -= take;
+        while (b->bits >= 8)
+        {
+            b->bits -= 8;
+            put8(b, (Uint8) (b->bitbuf >> b->bits));
+        } /* while */
+    } /* while */
+} /* put_bits */
+
+static void put_zero_bits(Blob *b, Uint32 count)
+{
+    for (; count >= 16; count -= 16)
+        put_bits(b, 0, 16);
+    put_bits(b, 0, (int) count);
+} /* put_zero_bits */
+
+static void flush_bits(Blob *b)
+{
+    if (b->bits > 0)
+        put_bits(b, 0, 8 - b->bits);
+} /* flush_bits */
+
+
+static int write_blob(Blob *b, const char *name)
+{
+    char path[1024];
+    FILE *io;
+    int ok;
+
+    snprintf(path, sizeof (path), "%s/%s", corpus_dir, name);
+    io = fopen(path, "wb");
+    if (io == NULL)
+    {
+        fprintf(stderr, "sdlsound-bench: can't write '%s'\n", path);
+        free(b->data);
+        return 0;
+    } /* if */
+
+    ok = (fwrite(b->data, b->len, 1, io) == 1);
+    ok = (fclose(io) == 0) && ok;
+    free(b->data);
+    memset(b, '\0', sizeof (Blob));
+    return ok;
+} /* write_blob */
+
+
+static void put_wav_header(Blob *b, Uint16 format, Uint32 rate, Uint16 bits,
+                           Uint16 blockalign, Uint32 byterate,
+                           const Blob *extra)
+{
+    put_str(b, "RIFF");
+    put_le32(b, 0);  /* patched in finish_wav(). */
+    put_str(b, "WAVE");
+    put_str(b, "fmt ");
+    put_le32(b, 16 + (extra ? (Uint32) extra->len : 0));
+    put_le16(b, format);
+    put_le16(b, BENCH_CHANNELS);
+    put_le32(b, rate);
+    put_le32(b, byterate);
+    put_le16(b, blockalign);
+    put_le16(b, bits);
+    if (extra)
+        put_bytes(b, extra->data, extra->len);
+    put_str(b, "data");
+    put_le32(b, 0);  /* patched in finish_wav(). */
+} /* put_wav_header */
+
+static void finish_wav(Blob *b)
+{
+    set_le32(b, 4, (Uint32) (b->len - 8));
+} /* finish_wav */
+
+static int make_wav_pcm(const char *name, Uint32 rate)
+{
+    const Uint32 frames = seconds * rate;
+    Blob b;
+    size_t datapos;
+    Uint32 i;
+    int ch;
+
+    memset(&b, '\0', sizeof (b));
+    put_wav_header(&b, 1, rate, 16, 2 * BENCH_CHANNELS,
+                   rate * 2 * BENCH_CHANNELS, NULL);
+    datapos = b.len;
+    for (i = 0; i < frames; i++)
+    {
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            put_le16(&b, (Uint16) signal_at(i, ch, rate));
+    } /* for */
+    set_le32(&b, datapos - 4, (Uint32) (b.len - datapos));
+    finish_wav(&b);
+    return write_blob(&b, name);
+} /* make_wav_pcm */
+
+
+/* MS-ADPCM, using the second standard predictor for the whole file. */
+#define ADPCM_BLOCK_ALIGN 1024
+#define ADPCM_SAMPLES_PER_BLOCK (((ADPCM_BLOCK_ALIGN - (7 * BENCH_CHANNELS)) * 2 / BENCH_CHANNELS) + 2)
+
+static const Sint16 adpcm_coef[7][2] =
+{
+    { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 },
+    { 240, 0 }, { 460, -208 }, { 392, -232 }
+};
+
+static const Sint32 adpcm_adapt[16] =
+{
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+
+static Uint8 adpcm_encode(Sint32 *samp1, Sint32 *samp2, Sint32 *delta, Sint32 x)
+{
+    const Sint32 pred = ((*samp1 * adpcm_coef[1][0]) + (*samp2 * adpcm_coef[1][1])) / 256;
+    Sint32 nib = (x - pred) / *delta;
+    Sint32 val;
+
+    if (nib < -8)
+        nib = -8;
+    else if (nib > 7)
+        nib = 7;
+
+    val = pred + (nib * *delta);  /* track exactly what the decoder sees. */
+    if (val < -32768)
+        val = -32768;
+    else if (val > 32767)
+        val = 32767;
+
+    *samp2 = *samp1;
+    *samp1 = val;
+    *delta = (*delta * adpcm_adapt[nib & 0xF]) / 256;
+    if (*delta < 16)
+        *delta = 16;
+    return (Uint8) (nib & 0xF);
+} /* adpcm_encode */
+
+static int make_wav_adpcm(const char *name)
+{
+    const Uint32 frames = seconds * BENCH_RATE;
+    const Uint32 spb = ADPCM_SAMPLES_PER_BLOCK;
+    const Uint32 blocks = (frames + spb - 1) / spb;
+    Blob extra, b;
+    size_t datapos;
+    Uint32 block, i;
+    int ch;
+
+    memset(&extra, '\0', sizeof (extra));
+    put_le16(&extra, 32);  /* cbSize */
+    put_le16(&extra, (Uint16) spb);
+    put_le16(&extra, 7);
+    for (i = 0; i < 7; i++)
+    {
+        put_le16(&extra, (Uint16) adpcm_coef[i][0]);
+        put_le16(&extra, (Uint16) adpcm_coef[i][1]);
+    } /* for */
+
+    memset(&b, '\0', sizeof (b));
+    put_wav_header(&b, 2, BENCH_RATE, 4, ADPCM_BLOCK_ALIGN,
+                   (BENCH_RATE / spb) * ADPCM_BLOCK_ALIGN, &extra);
+    free(extra.data);
+    datapos = b.len;
+
+    for (block = 0; block < blocks; block++)
+    {
+        const Uint32 start = block * spb;
+        Sint32 samp1[BENCH_CHANNELS], samp2[BENCH_CHANNELS], delta[BENCH_CHANNELS];
+        Uint8 byte = 0;
+        int nibbles = 0;
+
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+        {
+            samp2[ch] = signal_at(start, ch, BENCH_RATE);
+            samp1[ch] = signal_at(start + 1, ch, BENCH_RATE);
+            delta[ch] = 64;
+        } /* for */
+
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            put8(&b, 1);
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            put_le16(&b, (Uint16) delta[ch]);
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            put_le16(&b, (Uint16) samp1[ch]);
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            put_le16(&b, (Uint16) samp2[ch]);
+
+        for (i = 2; i < spb; i++)
+        {
+            for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            {
+                const Sint32 x = (start + i < frames) ? signal_at(start + i, ch, BENCH_RATE) : 0;
+                const Uint8 nib = adpcm_encode(&samp1[ch], &samp2[ch], &delta[ch], x);
+                byte = (Uint8) ((byte << 4) | nib);
+                if (++nibbles == 2)
+                {
+                    put8(&b, byte);
+                    nibbles = 0;
+                    byte = 0;
+                } /* if */
+            } /* for */
+        } /* for */
+    } /* for */
+
+    set_le32(&b, datapos - 4, (Uint32) (b.len - datapos));
+    finish_wav(&b);
+    return write_blob(&b, name);
+} /* make_wav_adpcm */
+
+
+static int make_aiff(const char *name)
+{
+    const Uint32 frames = seconds * BENCH_RATE;
+    const Uint32 datalen = frames * 2 * BENCH_CHANNELS;
+    Uint32 rate = BENCH_RATE;
+    int exponent = 0;
+    Blob b;
+    Uint32 i;
+    int ch;
+
+    while ((rate >> exponent) > 1)
+        exponent++;
+
+    memset(&b, '\0', sizeof (b));
+    put_str(&b, "FORM");
+    put_be32(&b, 4 + 8 + 18 + 8 + 8 + datalen);
+    put_str(&b, "AIFF");
+    put_str(&b, "COMM");
+    put_be32(&b, 18);
+    put_be16(&b, BENCH_CHANNELS);
+    put_be32(&b, frames);
+    put_be16(&b, 16);
+    put_be16(&b, (Uint16) (16383 + exponent));  /* 80-bit float rate. */
+    put_be32(&b, rate << (31 - exponent));
+    put_be32(&b, 0);
+    put_str(&b, "SSND");
+    put_be32(&b, 8 + datalen);
+    put_be32(&b, 0);
+    put_be32(&b, 0);
+    for (i = 0; i < frames; i++)
+    {
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            put_be16(&b, (Uint16) signal_at(i, ch, BENCH_RATE));
+    } /* for */
+
+    return write_blob(&b, name);
+} /* make_aiff */
+
+
+static Uint8 linear_to_ulaw(Sint32 sample)
+{
+    const Sint32 sign = (sample < 0) ? 0x80 : 0;
+    Sint32 exponent = 7;
+    Sint32 mantissa;
+
+    if (sample < 0)
+        sample = -sample;
+    if (sample > 32635)
+        sample = 32635;
+    sample += 0x84;
+
+    while ((exponent > 0) && ((sample & (0x4000 >> (7 - exponent))) == 0))
+        exponent--;
+
+    mantissa = (sample >> (exponent + 3)) & 0x0F;
+    return (Uint8) ~(sign | (exponent << 4) | mantissa);
+} /* linear_to_ulaw */
+
+static int make_au(const char *name)
+{
+    const Uint32 frames = seconds * BENCH_RATE;
+    Blob b;
+    Uint32 i;
+    int ch;
+
+    memset(&b, '\0', sizeof (b));
+    put_str(&b, ".snd");
+    put_be32(&b, 24);
+    put_be32(&b, frames * BENCH_CHANNELS);
+    put_be32(&b, 1);  /* 8-bit mu-law. */
+    put_be32(&b, BENCH_RATE);
+    put_be32(&b, BENCH_CHANNELS);
+    for (i = 0; i < frames; i++)
+    {
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            put8(&b, linear_to_ulaw(signal_at(i, ch, BENCH_RATE)));
+    } /* for */
+
+    return write_blob(&b, name);
+} /* make_au */
+
+
+static int make_voc(const char *name)
+{
+    const Uint32 frames = seconds * BENCH_RATE;
+    const Uint32 maxblock = 0xFFFFF0;  /* block lengths are 24 bits. */
+    Uint32 remaining = frames * 2 * BENCH_CHANNELS;
+    Uint32 frame = 0;
+    int first = 1;
+    Blob b;
+    int ch;
+
+    memset(&b, '\0', sizeof (b));
+    put_bytes(&b, "Creative Voice File\032", 20);
+    put_le16(&b, 26);
+    put_le16(&b, 0x0114);
+    put_le16(&b, (Uint16) (~0x0114 + 0x1234));
+
+    while (remaining > 0)
+    {
+        Uint32 len = (remaining > maxblock) ? maxblock : remaining;
+        Uint32 i;
+
+        len -= len % (2 * BENCH_CHANNELS);
+        if (first)
+        {
+            put8(&b, 9);  /* sound data, new format. */
+            put8(&b, (Uint8) ((len + 12) & 0xFF));
+            put8(&b, (Uint8) (((len + 12) >> 8) & 0xFF));
+            put8(&b, (Uint8) ((len + 12) >> 16));
+            put_le32(&b, BENCH_RATE);
+            put8(&b, 16);
+            put8(&b, BENCH_CHANNELS);
+            put_le16(&b, 4);  /* signed 16-bit PCM. */
+            put_le32(&b, 0);
+            first = 0;
+        } /* if */
+        else
+        {
+            put8(&b, 2);  /* continuation. */
+            put8(&b, (Uint8) (len & 0xFF));
+            put8(&b, (Uint8) ((len >> 8) & 0xFF));
+            put8(&b, (Uint8) (len >> 16));
+        } /* else */
+
+        for (i = 0; i < len; i += 2 * BENCH_CHANNELS, frame++)
+        {
+            for (ch = 0; ch < BENCH_CHANNELS; ch++)
+                put_le16(&b, (Uint16) signal_at(frame, ch, BENCH_RATE));
+        } /* for */
+        remaining -= len;
+    } /* while */
+
+    put8(&b, 0);  /* terminator. */
+    return write_blob(&b, name);
+} /* make_voc */
+
+
+static int make_raw(const char *name)
+{
+    const Uint32 frames = seconds * BENCH_RATE;
+    Blob b;
+    Uint32 i;
+    int ch;
+
+    memset(&b, '\0', sizeof (b));
+    for (i = 0; i < frames; i++)
+    {
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+            put_le16(&b, (Uint16) signal_at(i, ch, BENCH_RATE));
+    } /* for */
+
+    return write_blob(&b, name);
+} /* make_raw */
+
+
+/* Shorten, version 2: second-order differences, one Rice code per block. */
+#define SHN_BLOCK_SIZE 256
+
+static int bit_length(Uint32 v)
+{
+    int retval = 0;
+    while (v != 0)
+    {
+        retval++;
+        v >>= 1;
+    } /* while */
+    return retval;
+} /* bit_length */
+
+static void shn_uvar(Blob *b, int nbits, Uint32 v)
+{
+    put_zero_bits(b, v >> nbits);
+    put_bits(b, 1, 1);
+    if (nbits > 0)
+        put_bits(b, v & ((1u << nbits) - 1), nbits);
+} /* shn_uvar */
+
+static void shn_var(Blob *b, int nbits, Sint32 v)
+{
+    const Uint32 u = (v < 0) ? ((((Uint32) ~v) << 1) | 1) : (((Uint32) v) << 1);
+    shn_uvar(b, nbits + 1, u);
+} /* shn_var */
+
+static void shn_ulong(Blob *b, Uint32 v)
+{
+    const int nbits = bit_length(v);
+    shn_uvar(b, 2, (Uint32) nbits);
+    shn_uvar(b, nbits, v);
+} /* shn_ulong */
+
+static int make_shn(const char *name)
+{
+    const Uint32 frames = ((seconds * BENCH_RATE) / SHN_BLOCK_SIZE) * SHN_BLOCK_SIZE;
+    Sint32 hist[BENCH_CHANNELS][2];
+    Sint32 resid[SHN_BLOCK_SIZE];
+    Blob hdr, b;
+    Uint32 start, i;
+    int ch;
+
+    memset(&hdr, '\0', sizeof (hdr));  /* the RIFF header, stored verbatim. */
+    put_wav_header(&hdr, 1, BENCH_RATE, 16, 2 * BENCH_CHANNELS,
+                   BENCH_RATE * 2 * BENCH_CHANNELS, NULL);
+    set_le32(&hdr, hdr.len - 4, frames * 2 * BENCH_CHANNELS);
+    set_le32(&hdr, 4, (Uint32) (hdr.len - 8) + (frames * 2 * BENCH_CHANNELS));
+
+    memset(&b, '\0', sizeof (b));
+    put_str(&b, "ajkg");
+    put8(&b, 2);
+    shn_ulong(&b, 5);  /* signed 16-bit, little endian. */
+    shn_ulong(&b, BENCH_CHANNELS);
+    shn_ulong(&b, SHN_BLOCK_SIZE);
+    shn_ulong(&b, 0);  /* maxnlpc */
+    shn_ulong(&b, 0);  /* nmean */
+    shn_ulong(&b, 0);  /* nskip */
+
+    shn_uvar(&b, 2, 9);  /* verbatim */
+    shn_uvar(&b, 5, (Uint32) hdr.len);
+    for (i = 0; i < hdr.len; i++)
+        shn_uvar(&b, 8, hdr.data[i]);
+    free(hdr.data);
+
+    memset(hist, '\0', sizeof (hist));
+    for (start = 0; start < frames; start += SHN_BLOCK_SIZE)
+    {
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+        {
+            Uint32 sum = 0;
+            int energy = 0;
+
+            for (i = 0; i < SHN_BLOCK_SIZE; i++)
+            {
+                const Sint32 x = signal_at(start + i, ch, BENCH_RATE);
+                resid[i] = x - ((2 * hist[ch][1]) - hist[ch][0]);
+                sum += (Uint32) abs(resid[i]);
+                hist[ch][0] = hist[ch][1];
+                hist[ch][1] = x;
+            } /* for */
+
+            sum /= SHN_BLOCK_SIZE;
+            while ((energy < 20) && ((2u << energy) <= sum))
+                energy++;
+
+            shn_uvar(&b, 2, 2);  /* diff2 */
+            shn_uvar(&b, 3, (Uint32) energy);
+            for (i = 0; i < SHN_BLOCK_SIZE; i++)
+                shn_var(&b, energy, resid[i]);
+        } /* for */
+    } /* for */
+
+    shn_uvar(&b, 2, 4);  /* quit */
+    flush_bits(&b);
+    put_be32(&b, 0);     /* the decoder reads whole words. */
+    put_be32(&b, 0);
+    return write_blob(&b, name);
+} /* make_shn */
+
+
+/*
+ * FLAC: one file with FIXED second-order prediction, and one with 8th-order
+ *  LPC, which is what a real encoder picks for music and what the decoder's
+ *  SIMD restoration kernels are for. Both are Rice-coded in 16 partitions.
+ */
+#define FLAC_BLOCK_SIZE 4096
+#define FLAC_PARTITION_ORDER 4
+#define FLAC_LPC_ORDER 8
+#define FLAC_LPC_PRECISION 14
+
+static Uint8 crc8(const Uint8 *data, size_t len)
+{
+    Uint8 crc = 0;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (bit = 0; bit < 8; bit++)
+            crc = (Uint8) ((crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1));
+    } /* for */
+    return crc;
+} /* crc8 */
+
+static Uint16 crc16(const Uint8 *data, size_t len)
+{
+    Uint16 crc = 0;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < len; i++)
+    {
+        crc ^= (Uint16) (data[i] << 8);
+        for (bit = 0; bit < 8; bit++)
+            crc = (Uint16) ((crc & 0x8000) ? ((crc << 1) ^ 0x8005) : (crc << 1));
+    } /* for */
+    return crc;
+} /* crc16 */
+
+static void flac_utf8(Blob *b, Uint32 v)
+{
+    if (v < 0x80)
+        put_bits(b, v, 8);
+    else if (v < 0x800)
+    {
+        put_bits(b, 0xC0 | (v >> 6), 8);
+        put_bits(b, 0x80 | (v & 0x3F), 8);
+    } /* else if */
+    else if (v < 0x10000)
+    {
+        put_bits(b, 0xE0 | (v >> 12), 8);
+        put_bits(b, 0x80 | ((v >> 6) & 0x3F), 8);
+        put_bits(b, 0x80 | (v & 0x3F), 8);
+    } /* else if */
+    else
+    {
+        put_bits(b, 0xF0 | (v >> 18), 8);
+        put_bits(b, 0x80 | ((v >> 12) & 0x3F), 8);
+        put_bits(b, 0x80 | ((v >> 6) & 0x3F), 8);
+        put_bits(b, 0x80 | (v & 0x3F), 8);
+    } /* else */
+} /* flac_utf8 */
+
+/* quantized LPC coefficients for (x), by Levinson-Durbin. Returns the shift. */
+static int flac_lpc_coefficients(const Sint32 *x, Uint32 count, Sint32 *qlp)
+{
+    double r[FLAC_LPC_ORDER + 1];
+    double lpc[FLAC_LPC_ORDER + 1];
+    double tmp[FLAC_LPC_ORDER + 1];
+    double err, cmax = 0.0;
+    int shift, exponent;
+    Uint32 i, j, m;
+
+    for (j = 0; j <= FLAC_LPC_ORDER; j++)
+    {
+        r[j] = 0.0;
+        for (i = j; i < count; i++)
+        {
+            /* Welch window, so the block's edges don't skew the fit. */
+            const double wi = 1.0 - pow((2.0 * i / (count - 1)) - 1.0, 2.0);
+            const double wj = 1.0 - pow((2.0 * (i - j) / (count - 1)) - 1.0, 2.0);
+            r[j] += (wi * x[i]) * (wj * x[i - j]);
+        } /* for */
+    } /* for */
+
+    memset(lpc, '\0', sizeof (lpc));
+    err = r[0];
+    for (m = 1; (m <= FLAC_LPC_ORDER) && (err > 0.0); m++)
+    {
+        double k = r[m];
+        for (j = 1; j < m; j++)
+            k -= lpc[j] * r[m - j];
+        k /= err;
+        memcpy(tmp, lpc, sizeof (lpc));
+        for (j = 1; j < m; j++)
+            lpc[j] = tmp[j] - (k * tmp[m - j]);
+        lpc[m] = k;
+        err *= 1.0 - (k * k);
+    } /* for */
+
+    for (j = 1; j <= FLAC_LPC_ORDER; j++)
+        cmax = (fabs(lpc[j]) > cmax) ? fabs(lpc[j]) : cmax;
+
+    frexp(cmax, &exponent);
+    shift = (FLAC_LPC_PRECISION - 1) - exponent;
+    shift = (shift < 0) ? 0 : ((shift > 15) ? 15 : shift);
+
+    for (j = 0; j < FLAC_LPC_ORDER; j++)
+    {
+        const Sint32 qmax = (1 << (FLAC_LPC_PRECISION - 1)) - 1;
+        Sint32 q = (Sint32) floor((lpc[j + 1] * (double) (1 << shift)) + 0.5);
+        qlp[j] = (q > qmax) ? qmax : ((q < -qmax - 1) ? (-qmax - 1) : q);
+    } /* for */
+
+    return shift;
+} /* flac_lpc_coefficients */
+
+/* (lpc) nonzero for an LPC subframe, zero for FIXED order 2. */
+static void flac_subframe(Blob *b, const Sint32 *x, Uint32 count, int lpc)
+{
+    const int porder = (count == FLAC_BLOCK_SIZE) ? FLAC_PARTITION_ORDER : 0;
+    const Uint32 psize = count >> porder;
+    Sint32 qlp[FLAC_LPC_ORDER] = { 2, -1 };  /* FIXED order 2, as LPC. */
+    Sint32 res[FLAC_BLOCK_SIZE];
+    Uint32 order = 2;
+    int shift = 0;
+    Uint32 p, i, j;
+
+    if ((lpc) && (count > FLAC_LPC_ORDER * 2))
+    {
+        order = FLAC_LPC_ORDER;
+        shift = flac_lpc_coefficients(x, count, qlp);
+        put_bits(b, (0x20 | (order - 1)) << 1, 8);  /* pad, LPC, no wasted bits. */
+    } /* if */
+    else
+    {
+        put_bits(b, (0x08 | order) << 1, 8);  /* pad, FIXED, no wasted bits. */
+    } /* else */
+
+    for (i = 0; i < order; i++)
+        put_bits(b, (Uint32) x[i] & 0xFFFF, 16);
+
+    if (order == FLAC_LPC_ORDER)
+    {
+        put_bits(b, FLAC_LPC_PRECISION - 1, 4);
+        put_bits(b, (Uint32) shift, 5);
+        for (j = 0; j < order; j++)
+            put_bits(b, (Uint32) qlp[j] & ((1u << FLAC_LPC_PRECISION) - 1), FLAC_LPC_PRECISION);
+    } /* if */
+
+    for (i = order; i < count; i++)
+    {
+        Sint64 prediction = 0;
+        for (j = 0; j < order; j++)
+            prediction += ((Sint64) qlp[j]) * x[i - 1 - j];
+        res[i] = x[i] - (Sint32) (prediction >> shift);
+    } /* for */
+
+    put_bits(b, 0, 2);  /* 4-bit Rice parameters */
+    put_bits(b, (Uint32) porder, 4);
+
+    for (p = 0; p < (1u << porder); p++)
+    {
+        const Uint32 first = (p == 0) ? order : p * psize;
+        const Uint32 last = (p + 1) * psize;
+        Uint64 sum = 0;
+        int k = 0;
+
+        for (i = first; i < last; i++)
+            sum += (Uint32) ((res[i] << 1) ^ (res[i] >> 31));
+
+        if (last > first)
+            sum /= (last - first);
+        while ((k < 14) && ((2ull << k) <= sum))
+            k++;
+
+        put_bits(b, (Uint32) k, 4);
+        for (i = first; i < last; i++)
+        {
+            const Uint32 u = (Uint32) ((res[i] << 1) ^ (res[i] >> 31));
+            put_zero_bits(b, u >> k);
+            put_bits(b, 1, 1);
+            if (k > 0)
+                put_bits(b, u & ((1u << k) - 1), k);
+        } /* for */
+    } /* for */
+} /* flac_subframe */
+
+static int write_flac(const char *name, int lpc)
+{
+    const Uint32 frames = seconds * BENCH_RATE;
+    Sint32 x[FLAC_BLOCK_SIZE];
+    Uint32 start, frameno = 0;
+    Blob b;
+    int ch;
+
+    memset(&b, '\0', sizeof (b));
+    put_str(&b, "fLaC");
+    put_bits(&b, 0x80, 8);  /* last metadata block, STREAMINFO. */
+    put_bits(&b, 34, 24);
+    put_bits(&b, FLAC_BLOCK_SIZE, 16);
+    put_bits(&b, FLAC_BLOCK_SIZE, 16);
+    put_bits(&b, 0, 24);  /* frame sizes unknown. */
+    put_bits(&b, 0, 24);
+    put_bits(&b, BENCH_RATE, 20);
+    put_bits(&b, BENCH_CHANNELS - 1, 3);
+    put_bits(&b, 15, 5);
+    put_bits(&b, 0, 4);  /* top bits of the 36-bit frame count. */
+    put_bits(&b, frames, 32);
+    put_zero_bits(&b, 128);  /* no MD5. */
+
+    for (start = 0; start < frames; start += FLAC_BLOCK_SIZE, frameno++)
+    {
+        const Uint32 count = ((frames - start) < FLAC_BLOCK_SIZE) ? (frames - start) : FLAC_BLOCK_SIZE;
+        const size_t framepos = b.len;
+        Uint16 crc;
+
+        put_bits(&b, 0xFFF8, 16);
+        put_bits(&b, (count == FLAC_BLOCK_SIZE) ? 0xC : 0x7, 4);
+        put_bits(&b, 0x9, 4);  /* 44.1kHz */
+        put_bits(&b, BENCH_CHANNELS - 1, 4);  /* independent channels. */
+        put_bits(&b, 0x4 << 1, 4);  /* 16 bits, reserved bit. */
+        flac_utf8(&b, frameno);
+        if (count != FLAC_BLOCK_SIZE)
+            put_bits(&b, count - 1, 16);
+        put8(&b, crc8(b.data + framepos, b.len - framepos));
+
+        for (ch = 0; ch < BENCH_CHANNELS; ch++)
+        {
+            Uint32 i;
+            for (i = 0; i < count; i++)
+                x[i] = signal_at(start + i, ch, BENCH_RATE);
+            flac_subframe(&b, x, count, lpc);
+        } /* for */
+
+        flush_bits(&b);
+        crc = crc16(b.data + framepos, b.len - framepos);
+        put_be16(&b, crc);
+    } /* for */
+
+    return write_blob(&b, name);
+} /* write_flac */
+
+static int make_flac(const char *name) { return write_flac(name, 0); }
+static int make_flac_lpc(const char *name) { return write_flac(name, 1); }
+
+
+/*
+ * MP3: MPEG-1 Layer III, 128kbps, with random small spectral values coded
+ *  in Huffman table 1. It doesn't sound like the rest of the corpus, but it
+ *  keeps the decoder's Huffman, requantization and synthesis busy.
+ */
+#define MP3_FRAME_SIZE 417
+#define MP3_PAIRS 64
+
+static int make_mp3(const char *name)
+{
+    const Uint32 nframes = (seconds * BENCH_RATE) / 1152;
+    Uint32 seed = 0x5EED;
+    Uint32 f;
+    Blob b;
+
+    memset(&b, '\0', sizeof (b));
+    for (f = 0; f < nframes; f++)
+    {
+        const size_t framepos = b.len;
+        Uint32 pairs[2][2][MP3_PAIRS];
+        Uint32 lengths[2][2];
+        int gr, ch, i;
+
+        for (gr = 0; gr < 2; gr++)
+        {
+            for (ch = 0; ch < 2; ch++)
+            {
+                lengths[gr][ch] = 0;
+                for (i = 0; i < MP3_PAIRS; i++)
+                {
+                    Uint32 xy, bits;
+                    seed = (seed * 1664525u) + 1013904223u;
+                    xy = (seed >> 28) & 3;  /* x in bit 1, y in bit 0. */
+                    pairs[gr][ch][i] = xy;
+                    bits = (xy == 0) ? 1 : ((xy == 2) ? 2 : 3);
+                    bits += ((xy >> 1) & 1) + (xy & 1);  /* sign bits. */
+                    lengths[gr][ch] += bits;
+                } /* for */
+            } /* for */
+        } /* for */
+
+        put_bits(&b, 0xFFFB, 16);  /* MPEG-1 Layer III, no CRC. */
+        put_bits(&b, 0x90, 8);     /* 128kbps, 44.1kHz, no padding. */
+        put_bits(&b, 0x04, 8);     /* stereo, original. */
+
+        put_bits(&b, 0, 9);  /* main_data_begin: no bit reservoir. */
+        put_bits(&b, 0, 3);
+        put_bits(&b, 0, 8);  /* scfsi */
+        for (gr = 0; gr < 2; gr++)
+        {
+            for (ch = 0; ch < 2; ch++)
+            {
+                put_bits(&b, lengths[gr][ch], 12);
+                put_bits(&b, MP3_PAIRS, 9);
+                put_bits(&b, 190, 8);  /* global gain */
+                put_bits(&b, 0, 4);    /* no scalefactors */
+                put_bits(&b, 0, 1);    /* long blocks */
+                put_bits(&b, 1, 5);    /* table_select: 1, 1, 1 */
+                put_bits(&b, 1, 5);
+                put_bits(&b, 1, 5);
+                put_bits(&b, 7, 4);    /* region0_count */
+                put_bits(&b, 7, 3);    /* region1_count */
+                put_bits(&b, 0, 3);    /* preflag, scalefac_scale, count1 table */
+            } /* for */
+        } /* for */
+
+        for (gr = 0; gr < 2; gr++)
+        {
+            for (ch = 0; ch < 2; ch++)
+            {
+                for (i = 0; i < MP3_PAIRS; i++)
+                {
+                    const Uint32 xy = pairs[gr][ch][i];
+                    switch (xy)
+                    {
+                        case 0: put_bits(&b, 1, 1); break;     /* 0,0: 1 */
+                        case 1: put_bits(&b, 1, 3); break;     /* 0,1: 001 */
+                        case 2: put_bits(&b, 1, 2); break;     /* 1,0: 01 */
+                        default: put_bits(&b, 0, 3); break;    /* 1,1: 000 */
+                    } /* switch */
+                    if (xy & 2)
+                        put_bits(&b, (seed >> (i & 15)) & 1, 1);
+                    if (xy & 1)
+                        put_bits(&b, (seed >> ((i + 7) & 15)) & 1, 1);
+                } /* for */
+            } /* for */
+        } /* for */
+
+        flush_bits(&b);
+        while (b.len - framepos < MP3_FRAME_SIZE)
+            put8(&b, 0);
+    } /* for */
+
+    return write_blob(&b, name);
+} /* make_mp3 */
+
+
+/* MOD: four channels of a looped waveform playing a scale, two patterns. */
+static int make_mod(const char *name)
+{
+    static const Uint16 periods[8] = { 428, 381, 339, 320, 285, 254, 226, 214 };
+    char title[20];
+    Blob b;
+    int i, pattern, row, ch;
+
+    memset(&b, '\0', sizeof (b));
+    memset(title, '\0', sizeof (title));
+    strcpy(title, "sdlsound-bench");
+    put_bytes(&b, title, sizeof (title));
+
+    for (i = 0; i < 31; i++)
+    {
+        char sname[22];
+        memset(sname, '\0', sizeof (sname));
+        put_bytes(&b, sname, sizeof (sname));
+        put_be16(&b, (i == 0) ? 32 : 0);  /* length, in words. */
+        put8(&b, 0);                      /* finetune */
+        put8(&b, (i == 0) ? 64 : 0);      /* volume */
+        put_be16(&b, 0);                  /* loop start */
+        put_be16(&b, (i == 0) ? 32 : 1);  /* loop length */
+    } /* for */
+
+    put8(&b, 2);     /* song length */
+    put8(&b, 127);
+    for (i = 0; i < 128; i++)
+        put8(&b, (Uint8) ((i < 2) ? i : 0));
+    put_str(&b, "M.K.");
+
+    for (pattern = 0; pattern < 2; pattern++)
+    {
+        for (row = 0; row < 64; row++)
+        {
+            for (ch = 0; ch < 4; ch++)
+            {
+                if ((row % 4) == (ch % 4))
+                {
+                    const Uint16 period = periods[((row / 4) + (ch * 2) + pattern) % 8];
+                    put8(&b, (Uint8) (period >> 8));  /* sample 1's high bits are 0. */
+                    put8(&b, (Uint8) (period & 0xFF));
+                    put8(&b, 0x10);                   /* sample 1, no effect. */
+                    put8(&b, 0);
+                } /* if */
+                else
+                {
+                    put_be32(&b, 0);
+                } /* else */
+            } /* for */
+        } /* for */
+    } /* for */
+
+    for (i = 0; i < 64; i++)
+    {
+        const double t = ((double) i) / 64.0;
+        put8(&b, (Uint8) (Sint8) (100.0 * sin(2.0 * M_PI * t) * (1.0 - (0.5 * t))));
+    } /* for */
+
+    return write_blob(&b, name);
+} /* make_mod */
+
+
+typedef struct
+{
+    const char *name;     /* what it's called in the report. */
+    const char *file;     /* in the corpus directory. */
+    int (*make)(const char *file);  /* NULL if it's a bundled fixture. */
+    int raw;              /* needs a desired format to open. */
+} CorpusEntry;
+
+static int make_wav_pcm_native(const char *file) { return make_wav_pcm(file, BENCH_RATE); }
+
+static const CorpusEntry corpus[] =
+{
+    { "wav-pcm16", "pcm16.wav", make_wav_pcm_native, 0 },
+    { "wav-msadpcm", "msadpcm.wav", make_wav_adpcm, 0 },
+    { "aiff-pcm16", "pcm16.aiff", make_aiff, 0 },
+    { "au-ulaw", "ulaw.au", make_au, 0 },
+    { "voc-pcm16", "pcm16.voc", make_voc, 0 },
+    { "raw-pcm16", "pcm16.raw", make_raw, 1 },
+    { "shn", "pcm16.shn", make_shn, 0 },
+    { "flac", "pcm16.flac", make_flac, 0 },
+    { "flac-lpc8", "lpc8.flac", make_flac_lpc, 0 },
+    { "mp3-cbr128", "cbr128.mp3", make_mp3, 0 },
+    { "mod", "tune.mod", make_mod, 0 },
+    { "ogg-vorbis", "vorbis.ogg", NULL, 0 },
+};
+
+static int make_rate_source(const char *file)
+{
+    const Uint32 rate = (Uint32) strtoul(file + 6, NULL, 10);  /* "pcm16-XXXXX.wav" */
+    return make_wav_pcm(file, rate);
+} /* make_rate_source */
+
+static const char *rate_sources[] = { "pcm16-44100.wav", "pcm16-48000.wav", "pcm16-22050.wav" };
+
+
+static int make_corpus(void)
+{
+    size_t i;
+
+    mkdir_one(corpus_dir);  /* (fails harmlessly if it's there.) */
+
+    for (i = 0; i < SDL_arraysize(corpus); i++)
+    {
+        if ((corpus[i].make != NULL) && (!corpus[i].make(corpus[i].file)))
+            return 0;
+    } /* for */
+
+    for (i = 0; i < SDL_arraysize(rate_sources); i++)
+    {
+        if (!make_rate_source(rate_sources[i]))
+            return 0;
+    } /* for */
+
+    return 1;
+} /* make_corpus */
+
+
+/* The benchmarks... */
+
+static const Sound_AudioInfo raw_info = { AUDIO_S16LSB, BENCH_CHANNELS, BENCH_RATE };
+
+static Sound_Sample *open_sample(const char *path, int raw, Sound_AudioInfo *desired)
+{
+    Sound_AudioInfo info;
+    if ((raw) && (desired == NULL))
+    {
+        info = raw_info;
+        desired = &info;
+    } /* if */
+    return Sound_NewSampleFromFile(path, desired, BENCH_BUFFER_SIZE);
+} /* open_sample */
+
+static Uint64 decode_to_end(Sound_Sample *sample)
+{
+    const Uint32 framesize = ((sample->desired.format & 0xFF) / 8) * sample->desired.channels;
+    Uint64 frames = 0;
+
+    while ((sample->flags & (SOUND_SAMPLEFLAG_EOF | SOUND_SAMPLEFLAG_ERROR)) == 0)
+        frames += Sound_Decode(sample) / framesize;
+
+    return frames;
+} /* decode_to_end */
+
+
+static void json_string(const char *str)
+{
+    fputc('"', out);
+    for (; *str; str++)
+    {
+        if ((*str == '"') || (*str == '\\'))
+            fprintf(out, "\\%c", *str);
+        else if (((unsigned char) *str) < 0x20)
+            fprintf(out, "\\u%04x", (unsigned int) (unsigned char) *str);
+        else
+            fputc(*str, out);
+    } /* for */
+    fputc('"', out);
+} /* json_string */
+
+
+static void bench_file(const char *name, const char *path, int raw, int first)
+{
+    double *times = (double *) malloc(sizeof (double) * (iterations > 1 ? iterations : 1));
+    double open_us, decode_s, seek_us = -1.0;
+    Uint64 frames = 0;
+    Sound_Stats stats;
+    Sound_Sample *sample;
+    size_t baseline;
+    size_t peak;
+    int i;
+
+    fprintf(out, "%s\n    { \"name\": ", first ? "" : ",");
+    json_string(name);
+    fprintf(out, ", \"file\": ");
+    json_string(path);
+
+    baseline = mem_reset_peak();
+
+    for (i = 0; i < iterations; i++)
+    {
+        const double start = now();
+        sample = open_sample(path, raw, NULL);
+        times[i] = now() - start;
+        if (sample == NULL)
+        {
+            fprintf(out, ", \"error\": ");
+            json_string(Sound_GetError());
+            fprintf(out, " }");
+            free(times);
+            return;
+        } /* if */
+        Sound_FreeSample(sample);
+    } /* for */
+    open_us = median(times, iterations) * 1000000.0;
+
+    for (i = 0; i < iterations; i++)
+    {
+        double start;
+        sample = open_sample(path, raw, NULL);
+        if (sample == NULL)
+            break;
+        start = now();
+        frames = decode_to_end(sample);
+        times[i] = now() - start;
+
+        if (i == iterations - 1)  /* report the last run's I/O. */
+        {
+            fprintf(out, ", \"decoder\": ");
+            json_string(sample->decoder->extensions[0]);
+            fprintf(out, ", \"rate\": %u, \"channels\": %u",
+                    (unsigned int) sample->actual.rate,
+                    (unsigned int) sample->actual.channels);
+            if (Sound_GetSampleStats(sample, &stats))
+            {
+                fprintf(out, ", \"bytes_read\": %llu, \"rw_reads\": %llu, \"rw_seeks\": %llu",
+                        (unsigned long long) stats.bytes_read,
+                        (unsigned long long) stats.rw_reads,
+                        (unsigned long long) stats.rw_seeks);
+            } /* if */
+        } /* if */
+        Sound_FreeSample(sample);
+    } /* for */
+    decode_s = median(times, iterations);
+
+    sample = open_sample(path, raw, NULL);
+    if ((sample != NULL) && (sample->flags & SOUND_SAMPLEFLAG_CANSEEK) && (frames > 0))
+    {
+        Uint32 seed = 0xC0FFEE;
+        double total = 0.0;
+        int done = 0;
+
+        for (i = 0; i < seek_count; i++)
+        {
+            double start;
+            Uint64 target;
+            seed = (seed * 1664525u) + 1013904223u;
+            target = (((Uint64) (seed >> 8)) * frames) >> 24;
+            start = now();
+            if (!Sound_SeekFrames(sample, target))
+                break;
+            Sound_Decode(sample);
+            total += now() - start;
+            done++;
+        } /* for */
+
+        if (done > 0)
+            seek_us = (total / done) * 1000000.0;
+    } /* if */
+
+    if (sample != NULL)
+        Sound_FreeSample(sample);
+
+    peak = mem_peak_since(baseline);
+
+    fprintf(out, ", \"frames\": %llu, \"open_us\": %.1f, \"decode_frames_per_sec\": %.0f",
+            (unsigned long long) frames, open_us,
+            (decode_s > 0.0) ? (((double) frames) / decode_s) : 0.0);
+    if (seek_us >= 0.0)
+        fprintf(out, ", \"seek_us\": %.1f", seek_us);
+    else
+        fprintf(out, ", \"seek_us\": null");
+    fprintf(out, ", \"peak_heap_bytes\": %llu }", (unsigned long long) peak);
+    free(times);
+} /* bench_file */
+
+
+static void bench_resample(void)
+{
+    static const struct { Sound_ResampleQuality quality; const char *name; } qualities[] =
+    {
+        { SOUND_RESAMPLE_SDL, "sdl" },
+        { SOUND_RESAMPLE_FAST, "fast" },
+        { SOUND_RESAMPLE_MEDIUM, "medium" },
+        { SOUND_RESAMPLE_BEST, "best" }
+    };
+    static const struct { int source; Uint32 rate; } conversions[] =
+    {
+        { 0, 48000 },  /* 44.1k -> 48k */
+        { 1, 44100 },  /* 48k -> 44.1k */
+        { 2, 48000 }   /* 22.05k -> 48k */
+    };
+    const Sound_ResampleQuality original = Sound_GetResampleQuality();
+    int first = 1;
+    size_t c, q;
+
+    fprintf(out, ",\n  \"resample\": [");
+    for (c = 0; c < SDL_arraysize(conversions); c++)
+    {
+        char path[1024];
+        snprintf(path, sizeof (path), "%s/%s", corpus_dir, rate_sources[conversions[c].source]);
+
+        for (q = 0; q < SDL_arraysize(qualities); q++)
+        {
+            Sound_AudioInfo desired = { AUDIO_S16SYS, BENCH_CHANNELS, conversions[c].rate };
+            double best = 0.0;
+            Uint64 frames = 0;
+            Uint32 from = 0;
+            int i;
+
+            Sound_SetResampleQuality(qualities[q].quality);
+            for (i = 0; i < iterations; i++)
+            {
+                Sound_Sample *sample = Sound_NewSampleFromFile(path, &desired, BENCH_BUFFER_SIZE);
+                double start, elapsed;
+                if (sample == NULL)
+                    break;
+                from = sample->actual.rate;
+                start = now();
+                frames = decode_to_end(sample);
+                elapsed = now() - start;
+                if ((i == 0) || (elapsed < best))
+                    best = elapsed;
+                Sound_FreeSample(sample);
+            } /* for */
+
+            fprintf(out, "%s\n    { \"quality\": \"%s\", \"from\": %u, \"to\": %u, \"output_frames_per_sec\": %.0f }",
+                    first ? "" : ",", qualities[q].name, (unsigned int) from,
+                    (unsigned int) conversions[c].rate,
+                    (best > 0.0) ? (((double) frames) / best) : 0.0);
+            first = 0;
+        } /* for */
+    } /* for */
+    fprintf(out, "\n  ]");
+
+    Sound_SetResampleQuality(original);
+} /* bench_resample */
+
+
+static void bench_parallel(void)
+{
+    static const char *files[] = { "pcm16.wav", "msadpcm.wav", "pcm16.flac" };
+    static const int threads[] = { 1, 2, 4, 8 };
+    int first = 1;
+    size_t f, t;
+
+    fprintf(out, ",\n  \"parallel\": [");
+    for (f = 0; f < SDL_arraysize(files); f++)
+    {
+        char path[1024];
+        double serial = 0.0;
+        snprintf(path, sizeof (path), "%s/%s", corpus_dir, files[f]);
+
+        for (t = 0; t < SDL_arraysize(threads); t++)
+        {
+            double best = 0.0;
+            int i;
+
+            for (i = 0; i < iterations; i++)
+            {
+                Sound_Sample *sample = Sound_NewSampleFromFile(path, NULL, BENCH_BUFFER_SIZE);
+                double start, elapsed;
+                if (sample == NULL)
+                    break;
+                start = now();
+                Sound_DecodeAllParallel(sample, threads[t]);
+                elapsed = now() - start;
+                if ((i == 0) || (elapsed < best))
+                    best = elapsed;
+                Sound_FreeSample(sample);
+            } /* for */
+
+            if (t == 0)
+                serial = best;
+
+            fprintf(out, "%s\n    { \"file\": \"%s\", \"threads\": %d, \"seconds\": %.6f, \"speedup\": %.2f }",
+                    first ? "" : ",", files[f], threads[t], best,
+                    (best > 0.0) ? (serial / best) : 0.0);
+            first = 0;
+        } /* for */
+    } /* for */
+    fprintf(out, "\n  ]");
+} /* bench_parallel */
+
+
+/*
+ * Read-ahead: how much time the caller spends in Sound_Decode() with and
+ *  without a worker thread decoding ahead. When the worker falls behind, we
+ *  wait a moment, like an audio callback would have to, but that time isn't
+ *  counted.
+ */
+static void bench_prefetch(void)
+{
+    static const char *files[] = { "pcm16.flac", "cbr128.mp3" };
+    Sound_AudioInfo desired = { AUDIO_S16SYS, BENCH_CHANNELS, 48000 };
+    int first = 1;
+    size_t f;
+    int ahead;
+
+    fprintf(out, ",\n  \"prefetch\": [");
+    for (f = 0; f < SDL_arraysize(files); f++)
+    {
+        char path[1024];
+        snprintf(path, sizeof (path), "%s/%s", corpus_dir, files[f]);
+
+        for (ahead = 0; ahead <= 1; ahead++)
+        {
+            Sound_Sample *sample = Sound_NewSampleFromFile(path, &desired, 4096);
+            Sound_PrefetchStats pstats;
+            double caller = 0.0;
+            Uint32 calls = 0;
+            Uint32 underruns = 0;
+
+            if (sample == NULL)
+                continue;
+
+            if (ahead)
+                Sound_EnablePrefetch(sample, 250);
+
+            while ((sample->flags & (SOUND_SAMPLEFLAG_EOF | SOUND_SAMPLEFLAG_ERROR)) == 0)
+            {
+                const double start = now();
+                Sound_Decode(sample);
+                caller += now() - start;
+                calls++;
+                if (sample->flags & SOUND_SAMPLEFLAG_EAGAIN)
+                    SDL_Delay(1);
+            } /* while */
+
+            if ((ahead) && (Sound_GetPrefetchStats(sample, &pstats)))
+                underruns = pstats.underruns;
+
+            fprintf(out, "%s\n    { \"file\": \"%s\", \"read_ahead_ms\": %d, \"decode_calls\": %u, \"caller_us_per_call\": %.2f, \"underruns\": %u }",
+                    first ? "" : ",", files[f], ahead ? 250 : 0, (unsigned int) calls,
+                    calls ? ((caller / calls) * 1000000.0) : 0.0, (unsigned int) underruns);
+            first = 0;
+            Sound_FreeSample(sample);
+        } /* for */
+    } /* for */
+    fprintf(out, "\n  ]");
+} /* bench_prefetch */
+
+
+/*
+ * A 6 gigabyte RF64 WAV (about ten hours of 44.1kHz stereo), made up as
+ *  it's read, so we don't need that much disk. Every sample is a hash of
+ *  its position, so we can check that a seek lands where it should. A seek
+ *  near the end has to cost the same as one near the start.
+ */
+#define LONG_FILE_BYTES (((Sint64) 6) * 1024 * 1024 * 1024)
+#define LONG_FILE_HEADER_SIZE 80
+#define LONG_FILE_FRAMES ((LONG_FILE_BYTES - LONG_FILE_HEADER_SIZE) / 4)
+
+static Uint8 long_file_header[LONG_FILE_HEADER_SIZE];
+
+static Sint16 long_file_sample(Uint64 frame, int channel)
+{
+    const Uint32 hash = ((Uint32) frame) * 2654435761u;
+    return (Sint16) ((hash >> 16) ^ (Uint32) (frame >> 32) ^ (Uint32) channel);
+} /* long_file_sample */
+
+static void long_file_make_header(void)
+{
+    Blob b;
+    const Uint64 datasize = LONG_FILE_FRAMES * 4;
+    const Uint64 riffsize = datasize + LONG_FILE_HEADER_SIZE - 8;
+
+    memset(&b, '\0', sizeof (b));
+    put_str(&b, "RF64");
+    put_le32(&b, 0xFFFFFFFF);
+    put_str(&b, "WAVE");
+    put_str(&b, "ds64");
+    put_le32(&b, 28);
+    put_le32(&b, (Uint32) riffsize);
+    put_le32(&b, (Uint32) (riffsize >> 32));
+    put_le32(&b, (Uint32) datasize);
+    put_le32(&b, (Uint32) (datasize >> 32));
+    put_le32(&b, (Uint32) LONG_FILE_FRAMES);
+    put_le32(&b, (Uint32) (((Uint64) LONG_FILE_FRAMES) >> 32));
+    put_le32(&b, 0);  /* no table. */
+    put_str(&b, "fmt ");
+    put_le32(&b, 16);
+    put_le16(&b, 1);  /* PCM */
+    put_le16(&b, BENCH_CHANNELS);
+    put_le32(&b, BENCH_RATE);
+    put_le32(&b, BENCH_RATE * 4);
+    put_le16(&b, 4);
+    put_le16(&b, 16);
+    put_str(&b, "data");
+    put_le32(&b, 0xFFFFFFFF);
+    SDL_assert(b.len == LONG_FILE_HEADER_SIZE);
+    memcpy(long_file_header, b.data, LONG_FILE_HEADER_SIZE);
+    free(b.data);
+} /* long_file_make_header */
+
+static Sint64 SDLCALL long_file_size(SDL_RWops *rw)
+{
+    return LONG_FILE_BYTES;
+} /* long_file_size */
+
+static Sint64 SDLCALL long_file_seek(SDL_RWops *rw, Sint64 offset, int whence)
+{
+    Sint64 *pos = (Sint64 *) rw->hidden.unknown.data1;
+    Sint64 newpos = offset;
+    if (whence == RW_SEEK_CUR)
+        newpos += *pos;
+    else if (whence == RW_SEEK_END)
+        newpos += LONG_FILE_BYTES;
+    if ((newpos < 0) || (newpos > LONG_FILE_BYTES))
+        return -1;
+    *pos = newpos;
+    return newpos;
+} /* long_file_seek */
+
+static size_t SDLCALL long_file_read(SDL_RWops *rw, void *ptr, size_t size, size_t maxnum)
+{
+    Sint64 *pos = (Sint64 *) rw->hidden.unknown.data1;
+    Uint8 *dst = (Uint8 *) ptr;
+    size_t avail, len, i;
+
+    if (size == 0)
+        return 0;
+    avail = (size_t) ((LONG_FILE_BYTES - *pos) / size);
+    len = ((maxnum < avail) ? maxnum : avail) * size;
+
+    for (i = 0; i < len; i++)
+    {
+        const Sint64 at = *pos + (Sint64) i;
+        if (at < LONG_FILE_HEADER_SIZE)
+            dst[i] = long_file_header[at];
+        else
+        {
+            const Uint64 byte = (Uint64) (at - LONG_FILE_HEADER_SIZE);
+            const Sint16 val = long_file_sample(byte / 4, (int) ((byte / 2) & 1));
+            dst[i] = (Uint8) ((byte & 1) ? (((Uint16) val) >> 8) : (((Uint16) val) & 0xFF));
+        } /* else */
+    } /* for */
+
+    *pos += (Sint64) len;
+    return len / size;
+} /* long_file_read */
+
+static size_t SDLCALL long_file_write(SDL_RWops *rw, const void *ptr, size_t size, size_t num)
+{
+    return 0;
+} /* long_file_write */
+
+static int SDLCALL long_file_close(SDL_RWops *rw)
+{
+    free(rw->hidden.unknown.data1);
+    SDL_FreeRW(rw);
+    return 0;
+} /* long_file_close */
+
+static SDL_RWops *long_file_open(void)
+{
+    SDL_RWops *rw = SDL_AllocRW();
+    Sint64 *pos = (Sint64 *) calloc(1, sizeof (Sint64));
+    if ((rw == NULL) || (pos == NULL))
+    {
+        free(pos);
+        if (rw != NULL)
+            SDL_FreeRW(rw);
+        return NULL;
+    } /* if */
+
+    rw->size = long_file_size;
+    rw->seek = long_file_seek;
+    rw->read = long_file_read;
+    rw->write = long_file_write;
+    rw->close = long_file_close;
+    rw->type = SDL_RWOPS_UNKNOWN;
+    rw->hidden.unknown.data1 = pos;
+    return rw;
+} /* long_file_open */
+
+/* seek to each target, decode a buffer, and check we got the right frames. */
+static double long_file_seeks(Sound_Sample *sample, Uint64 base, Uint64 span,
+                              int *exact, Uint64 *bytes_read)
+{
+    Uint32 seed = 0xBADC0DE;
+    Sound_Stats before, after;
+    double total = 0.0;
+    int i;
+
+    Sound_GetSampleStats(sample, &before);
+    for (i = 0; i < seek_count; i++)
+    {
+        const Sint16 *samples = (const Sint16 *) sample->buffer;
+        Uint64 target;
+        Uint32 got, j;
+        double start;
+
+        seed = (seed * 1664525u) + 1013904223u;
+        target = base + ((((Uint64) (seed >> 8)) * span) >> 24);
+        start = now();
+        if (!Sound_SeekFrames(sample, target))
+        {
+            *exact = 0;
+            break;
+        } /* if */
+        got = Sound_Decode(sample) / (BENCH_CHANNELS * sizeof (Sint16));
+        total += now() - start;
+
+        if (got == 0)
+            *exact = 0;
+        for (j = 0; j < got; j++)
+        {
+            if ( (samples[j * 2] != long_file_sample(target + j, 0)) ||
+                 (samples[(j * 2) + 1] != long_file_sample(target + j, 1)) )
+            {
+                *exact = 0;
+                break;
+            } /* if */
+        } /* for */
+    } /* for */
+    Sound_GetSampleStats(sample, &after);
+
+    *bytes_read = (seek_count > 0) ? ((after.bytes_read - before.bytes_read) / seek_count) : 0;
+    return (seek_count > 0) ? ((total / seek_count) * 1000000.0) : 0.0;
+} /* long_file_seeks */
+
+static void bench_long_file(void)
+{
+    const Uint64 span = BENCH_RATE * 60;  /* seek around within a minute. */
+    Sound_AudioInfo desired = { AUDIO_S16LSB, BENCH_CHANNELS, BENCH_RATE };
+    Uint64 start_bytes = 0, end_bytes = 0;
+    double start_us, end_us, open_us, start;
+    Sound_Sample *sample;
+    SDL_RWops *rw;
+    int exact = 1;
+
+    long_file_make_header();
+
+    fprintf(out, ",\n  \"long_file\": { \"bytes\": %llu, \"frames\": %llu",
+            (unsigned long long) LONG_FILE_BYTES, (unsigned long long) LONG_FILE_FRAMES);
+
+    rw = long_file_open();
+    start = now();
+    sample = (rw != NULL) ? Sound_NewSample(rw, "WAV", &desired, BENCH_BUFFER_SIZE) : NULL;
+    open_us = (now() - start) * 1000000.0;
+    if (sample == NULL)
+    {
+        fprintf(out, ", \"error\": ");
+        json_string((rw != NULL) ? Sound_GetError() : "out of memory");
+        fprintf(out, " }");
+        return;
+    } /* if */
+
+    start_us = long_file_seeks(sample, 0, span, &exact, &start_bytes);
+    end_us = long_file_seeks(sample, LONG_FILE_FRAMES - span, span, &exact, &end_bytes);
+
+    fprintf(out, ", \"open_us\": %.1f, \"duration_ms\": %ld", open_us, (long) Sound_GetDuration(sample));
+    fprintf(out, ", \"seek_near_start_us\": %.1f, \"seek_near_end_us\": %.1f", start_us, end_us);
+    fprintf(out, ", \"bytes_read_per_seek_near_start\": %llu, \"bytes_read_per_seek_near_end\": %llu",
+            (unsigned long long) start_bytes, (unsigned long long) end_bytes);
+    fprintf(out, ", \"seeks_exact\": %s }", exact ? "true" : "false");
+
+    Sound_FreeSample(sample);
+} /* bench_long_file */
+
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "USAGE: %s [options] [extra files...]\n"
+        "  --corpus DIR      where to write the generated corpus (%s)\n"
+        "  --no-generate     use the corpus that's already in DIR\n"
+        "  --fixtures DIR    where the bundled files are (%s)\n"
+        "  --seconds N       length of the generated audio (%u)\n"
+        "  --iterations N    runs per measurement (%d)\n"
+        "  --seeks N         seeks per file (%d)\n"
+        "  --output FILE     write the JSON here instead of stdout\n",
+        argv0, corpus_dir, fixture_dir, (unsigned int) seconds, iterations, seek_count);
+} /* usage */
+
+
+int main(int argc, char **argv)
+{
+    const char *outname = NULL;
+    int generate = 1;
+    int first = 1;
+    Sound_Version linked;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0)
+            continue;  /* a file; handled later. */
+        else if ((strcmp(arg, "--corpus") == 0) && (i + 1 < argc))
+            corpus_dir = argv[++i];
+        else if (strcmp(arg, "--no-generate") == 0)
+            generate = 0;
+        else if ((strcmp(arg, "--fixtures") == 0) && (i + 1 < argc))
+            fixture_dir = argv[++i];
+        else if ((strcmp(arg, "--seconds") == 0) && (i + 1 < argc))
+            seconds = (Uint32) atoi(argv[++i]);
+        else if ((strcmp(arg, "--iterations") == 0) && (i + 1 < argc))
+            iterations = atoi(argv[++i]);
+        else if ((strcmp(arg, "--seeks") == 0) && (i + 1 < argc))
+            seek_count = atoi(argv[++i]);
+        else if ((strcmp(arg, "--output") == 0) && (i + 1 < argc))
+            outname = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        } /* else */
+    } /* for */
+
+    if ((seconds < 1) || (iterations < 1) || (seek_count < 0))
+    {
+        usage(argv[0]);
+        return 1;
+    } /* if */
+
+    SDL_SetMainReady();
+
+    if (!Sound_SetAllocator(counting_malloc, counting_calloc, counting_realloc, counting_free))
+    {
+        fprintf(stderr, "Sound_SetAllocator() failed: %s\n", Sound_GetError());
+        return 1;
+    } /* if */
+
+    if (!Sound_Init())
+    {
+        fprintf(stderr, "Sound_Init() failed: %s\n", Sound_GetError());
+        return 1;
+    } /* if */
+
+    Sound_SetDecodeCacheBudget(0);  /* we want to see the decoders work. */
+
+    if ((generate) && (!make_corpus()))
+    {
+        Sound_Quit();
+        return 1;
+    } /* if */
+
+    out = stdout;
+    if (outname != NULL)
+    {
+        out = fopen(outname, "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "sdlsound-bench: can't write '%s'\n", outname);
+            Sound_Quit();
+            return 1;
+        } /* if */
+    } /* if */
+
+    Sound_GetLinkedVersion(&linked);
+    fprintf(out, "{\n  \"version\": \"%d.%d.%d\",\n", linked.major, linked.minor, linked.patch);
+    fprintf(out, "  \"cpus\": %d,\n", SDL_GetCPUCount());
+    fprintf(out, "  \"seconds\": %u, \"iterations\": %d, \"seeks\": %d,\n",
+            (unsigned int) seconds, iterations, seek_count);
+    fprintf(out, "  \"file_mapping\": %s,\n", Sound_GetFileMapping() ? "true" : "false");
+    fprintf(out, "  \"formats\": [");
+
+    for (i = 0; i < (int) SDL_arraysize(corpus); i++)
+    {
+        const char *dir = (corpus[i].make != NULL) ? corpus_dir : fixture_dir;
+        char path[1024];
+        snprintf(path, sizeof (path), "%s/%s", dir, corpus[i].file);
+        bench_file(corpus[i].name, path, corpus[i].raw, first);
+        first = 0;
+    } /* for */
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--", 2) == 0)
+        {
+            if (strcmp(argv[i], "--no-generate") != 0)
+                i++;  /* skip the option's value, too. */
+            continue;
+        } /* if */
+        bench_file(argv[i], argv[i], 0, 0);
+    } /* for */
+
+    fprintf(out, "\n  ]");
+
+    bench_resample();
+    bench_parallel();
+    bench_prefetch();
+    bench_long_file();
+
+    fprintf(out, "\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+
+    Sound_Quit();
+    return 0;
+} /* main */
+
+/* end of sdlsound-bench.c ... */
+
@@ -36,6 +36,9 @@ typedef struct
 {
     int available;
     const Sound_DecoderFunctions *funcs;
+#if SOUND_STATS
+    Sound_Stats stats;  /* every sample's, added up. Guarded by stats_lock. */
+#endif
 } decoder_element;
 
 static decoder_element decoders[] =
@@ -81,22 +84,169 @@ static decoder_element decoders[] =
 
 /* General SDL_sound state ... */
 
-typedef struct __SOUND_ERRMSGTYPE__
+typedef struct
 {
-    Uint32 tid;
     int error_available;
+    Uint32 generation;  /* error is stale unless this is error_generation. */
     char error_string[128];
-    struct __SOUND_ERRMSGTYPE__ *next;
 } ErrMsg;
 
-static ErrMsg *error_msgs = NULL;
-static SDL_mutex *errorlist_mutex = NULL;
+/*
+ * Each thread gets its own error state. If the compiler can do thread-local
+ *  variables, that's just a static, which costs nothing to find and goes
+ *  away with the thread. Otherwise, we hang a heap allocation off SDL's TLS,
+ *  which frees it when an SDL-created thread exits.
+ */
+#ifdef SOUND_THREAD_LOCAL
+static SOUND_THREAD_LOCAL ErrMsg error_msg;
+#else
+static SDL_TLSID error_tls = 0;
+#endif
+
+/* bumped by Sound_Init(), so errors from before a Sound_Quit() vanish. */
+static Uint32 error_generation = 0;
 
 static Sound_Sample *sample_list = NULL;  /* this is a linked list. */
 static SDL_mutex *samplelist_mutex = NULL;
 
 static const Sound_DecoderInfo **available_decoders = NULL;
 static int initialized = 0;
+static SDL_atomic_t live_pools;  /* sample pools that haven't been freed. */
+
+
+/*
+ * Statistics. Each decode or seek runs between stats_begin() and
+ *  stats_end(); in between, the STATS_* macros count into the sample's
+ *  stats_pending, which only the thread doing the work touches. stats_end()
+ *  adds that to the totals under a lock, so Sound_GetSampleStats() can run
+ *  on any thread. Without SOUND_STATS, all of it compiles to nothing.
+ */
+#if SOUND_STATS
+
+static SDL_SpinLock stats_lock = 0;
+
+#ifdef SOUND_THREAD_LOCAL
+static SOUND_THREAD_LOCAL Sound_Stats *current_stats = NULL;
+
+size_t __Sound_StatsRWread(SDL_RWops *rw, void *ptr, size_t size, size_t n)
+{
+    const size_t retval = rw->read(rw, ptr, size, n);
+    Sound_Stats *stats = current_stats;
+    if (stats != NULL)
+    {
+        stats->rw_reads++;
+        stats->bytes_read += retval * size;
+    } /* if */
+    return retval;
+} /* __Sound_StatsRWread */
+
+
+Sint64 __Sound_StatsRWseek(SDL_RWops *rw, Sint64 offset, int whence)
+{
+    Sound_Stats *stats = current_stats;
+
+        /* older SDLs do SDL_RWtell() as a seek to here; that's not a seek. */
+    if ((stats != NULL) && ((offset != 0) || (whence != RW_SEEK_CUR)))
+        stats->rw_seeks++;
+    return rw->seek(rw, offset, whence);
+} /* __Sound_StatsRWseek */
+#endif
+
+
+static void add_stats(Sound_Stats *total, const Sound_Stats *add)
+{
+    total->bytes_read += add->bytes_read;
+    total->rw_reads += add->rw_reads;
+    total->rw_seeks += add->rw_seeks;
+    total->frames_decoded += add->frames_decoded;
+    total->decode_ns += add->decode_ns;
+    total->convert_ns += add->convert_ns;
+    total->seeks += add->seeks;
+    total->eagains += add->eagains;
+    if (add->peak_buffer_size > total->peak_buffer_size)
+        total->peak_buffer_size = add->peak_buffer_size;
+} /* add_stats */
+
+
+static void stats_begin(Sound_Sample *sample)
+{
+#ifdef SOUND_THREAD_LOCAL
+    current_stats = &((Sound_SampleInternal *) sample->opaque)->stats_pending;
+#else
+    (void) sample;
+#endif
+} /* stats_begin */
+
+
+static void stats_end(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Sound_Stats *total = internal->stats_owner;
+    decoder_element *decoder;
+
+#ifdef SOUND_THREAD_LOCAL
+    current_stats = NULL;
+#endif
+
+    if (total == NULL)
+        total = &internal->stats;
+
+        /* cached samples aren't any decoder's doing. */
+    for (decoder = decoders; decoder->funcs != NULL; decoder++)
+    {
+        if (decoder->funcs == internal->funcs)
+            break;
+    } /* for */
+
+    SDL_AtomicLock(&stats_lock);
+    add_stats(total, &internal->stats_pending);
+    if (decoder->funcs != NULL)
+        add_stats(&decoder->stats, &internal->stats_pending);
+    SDL_AtomicUnlock(&stats_lock);
+
+    SDL_zero(internal->stats_pending);
+} /* stats_end */
+
+
+static Uint64 ticks_to_ns(Uint64 ticks, Uint64 freq)
+{
+        /* split up so this doesn't overflow after a few seconds' worth. */
+    return ((ticks / freq) * 1000000000) + (((ticks % freq) * 1000000000) / freq);
+} /* ticks_to_ns */
+
+
+static void report_stats(Sound_Stats *stats, const Sound_Stats *totals)
+{
+    const Uint64 freq = SDL_GetPerformanceFrequency();
+    SDL_memcpy(stats, totals, sizeof (Sound_Stats));
+    stats->decode_ns = ticks_to_ns(totals->decode_ns, freq);
+    stats->convert_ns = ticks_to_ns(totals->convert_ns, freq);
+} /* report_stats */
+
+#define STATS_ADD(internal, field, n) ((internal)->stats_pending.field += (n))
+#define STATS_PEAK(internal, n) \
+    ((internal)->stats_pending.peak_buffer_size = \
+        SDL_max((internal)->stats_pending.peak_buffer_size, (n)))
+#define STATS_START(internal) \
+    ((internal)->stats_clock = SDL_GetPerformanceCounter())
+#define STATS_STOP(internal, field) \
+    ((internal)->stats_pending.field += \
+        SDL_GetPerformanceCounter() - (internal)->stats_clock)
+
+#else
+
+#define stats_begin(sample) ((void) 0)
+#define stats_end(sample) ((void) 0)
+#define STATS_ADD(internal, field, n) ((void) 0)
+#define STATS_PEAK(internal, n) ((void) 0)
+#define STATS_START(internal) ((void) 0)
+#define STATS_STOP(internal, field) ((void) 0)
+
+#endif
+
+static Sound_ResampleQuality resample_quality = SOUND_RESAMPLE_MEDIUM;
+static int file_mapping = 1;
+static Uint32 seek_index_granularity = 0;
 
 
 /* functions ... */
@@ -120,19 +270,36 @@ int Sound_Init(void)
     BAIL_IF_MACRO(initialized, ERR_IS_INITIALIZED, 0);
 
     sample_list = NULL;
-    error_msgs = NULL;
+    error_generation++;
+
+#ifndef SOUND_THREAD_LOCAL
+    if (error_tls == 0)  /* SDL can't free these, so we keep it forever. */
+    {
+        error_tls = SDL_TLSCreate();
+        BAIL_IF_MACRO(error_tls == 0, SDL_GetError(), 0);
+    } /* if */
+#endif
 
     available_decoders = (const Sound_DecoderInfo **)
-                            SDL_calloc(total, sizeof (Sound_DecoderInfo *));
+                            __Sound_calloc(total, sizeof (Sound_DecoderInfo *));
     BAIL_IF_MACRO(available_decoders == NULL, ERR_OUT_OF_MEMORY, 0);
 
+    if (!__Sound_CacheInit())
+    {
+        __Sound_free((void *) available_decoders);
+        available_decoders = NULL;
+        return 0;
+    } /* if */
+
     SDL_InitSubSystem(SDL_INIT_AUDIO);
 
-    errorlist_mutex = SDL_CreateMutex();
     samplelist_mutex = SDL_CreateMutex();
 
     for (i = 0; decoders[i].funcs != NULL; i++)
     {
+#if SOUND_STATS
+        SDL_zero(decoders[i].stats);
+#endif
         decoders[i].available = decoders[i].funcs->init();
         if (decoders[i].available)
         {
@@ -146,10 +313,20 @@ int Sound_Init(void)
 } /* Sound_Init */
 
 
+int __Sound_IsInitialized(void)
+{
+    return initialized;
+} /* __Sound_IsInitialized */
+
+
+int __Sound_LiveSamplePools(void)
+{
+    return SDL_AtomicGet(&live_pools);
+} /* __Sound_LiveSamplePools */
+
+
 int Sound_Quit(void)
 {
-    ErrMsg *err;
-    ErrMsg *nexterr = NULL;
     size_t i;
 
     BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
@@ -159,6 +336,8 @@ int Sound_Quit(void)
 
     initialized = 0;
 
+    __Sound_CacheQuit();  /* nothing's using it now. */
+
     SDL_DestroyMutex(samplelist_mutex);
     samplelist_mutex = NULL;
     sample_list = NULL;
@@ -173,21 +352,9 @@ int Sound_Quit(void)
     } /* for */
 
     if (available_decoders != NULL)
-        SDL_free((void *) available_decoders);
+        __Sound_free((void *) available_decoders);
     available_decoders = NULL;
 
-    /* clean up error state for each thread... */
-    SDL_LockMutex(errorlist_mutex);
-    for (err = error_msgs; err != NULL; err = nexterr)
-    {
-        nexterr = err->next;
-        SDL_free(err);
-    } /* for */
-    error_msgs = NULL;
-    SDL_UnlockMutex(errorlist_mutex);
-    SDL_DestroyMutex(errorlist_mutex);
-    errorlist_mutex = NULL;
-
     return 1;
 } /* Sound_Quit */
 
@@ -198,28 +365,27 @@ const Sound_DecoderInfo **Sound_AvailableDecoders(void)
 } /* Sound_AvailableDecoders */
 
 
-static ErrMsg *findErrorForCurrentThread(void)
+static ErrMsg *findErrorForCurrentThread(int create)
 {
-    ErrMsg *i;
-    Uint32 tid;
-
-    if (error_msgs != NULL)
+#ifdef SOUND_THREAD_LOCAL
+    return &error_msg;
+#else
+    ErrMsg *err = (ErrMsg *) SDL_TLSGet(error_tls);
+    if ((err == NULL) && (create))
     {
-        tid = SDL_ThreadID();
+        err = (ErrMsg *) SDL_calloc(1, sizeof (ErrMsg));
+        if (err == NULL)
+            return NULL;   /* uhh...? */
 
-        SDL_LockMutex(errorlist_mutex);
-        for (i = error_msgs; i != NULL; i = i->next)
+        if (SDL_TLSSet(error_tls, err, SDL_free) == -1)
         {
-            if (i->tid == tid)
-            {
-                SDL_UnlockMutex(errorlist_mutex);
-                return i;
-            } /* if */
-        } /* for */
-        SDL_UnlockMutex(errorlist_mutex);
+            SDL_free(err);
+            return NULL;
+        } /* if */
     } /* if */
 
-    return NULL;   /* no error available. */
+    return err;
+#endif
 } /* findErrorForCurrentThread */
 
 
@@ -231,8 +397,9 @@ const char *Sound_GetError(void)
     if (!initialized)
         return ERR_NOT_INITIALIZED;
 
-    err = findErrorForCurrentThread();
-    if ((err != NULL) && (err->error_available))
+    err = findErrorForCurrentThread(0);
+    if ((err != NULL) && (err->error_available) &&
+        (err->generation == error_generation))
     {
         retval = err->error_string;
         err->error_available = 0;
@@ -249,7 +416,7 @@ void Sound_ClearError(void)
     if (!initialized)
         return;
 
-    err = findErrorForCurrentThread();
+    err = findErrorForCurrentThread(0);
     if (err != NULL)
         err->error_available = 0;
 } /* Sound_ClearError */
@@ -271,22 +438,12 @@ void __Sound_SetError(const char *str)
     if (!initialized)
         return;
 
-    err = findErrorForCurrentThread();
+    err = findErrorForCurrentThread(1);
     if (err == NULL)
-    {
-        err = (ErrMsg *) SDL_calloc(1, sizeof (ErrMsg));
-        if (err == NULL)
-            return;   /* uhh...? */
-
-        err->tid = SDL_ThreadID();
-
-        SDL_LockMutex(errorlist_mutex);
-        err->next = error_msgs;
-        error_msgs = err;
-        SDL_UnlockMutex(errorlist_mutex);
-    } /* if */
+        return;   /* uhh...? */
 
     err->error_available = 1;
+    err->generation = error_generation;
     SDL_strlcpy(err->error_string, str, sizeof (err->error_string));
 } /* __Sound_SetError */
 
@@ -294,57 +451,373 @@ void __Sound_SetError(const char *str)
 Uint32 __Sound_convertMsToBytePos(Sound_AudioInfo *info, Uint32 ms)
 {
     /* "frames" == "sample frames" */
-    float frames_per_ms = ((float) info->rate) / 1000.0f;
-    Uint32 frame_offset = (Uint32) (frames_per_ms * ((float) ms));
-    Uint32 frame_size = (Uint32) ((info->format & 0xFF) / 8) * info->channels;
-    return frame_offset * frame_size;
+    const Uint64 frame_offset = __Sound_convertMsToFrames(info, ms);
+    const Uint32 frame_size = (Uint32) ((info->format & 0xFF) / 8) * info->channels;
+    return (Uint32) (frame_offset * frame_size);
 } /* __Sound_convertMsToBytePos */
 
 
+Uint64 __Sound_convertMsToFrames(const Sound_AudioInfo *info, Uint32 ms)
+{
+    return (((Uint64) ms) * info->rate) / 1000;
+} /* __Sound_convertMsToFrames */
+
+
+/*
+ * Sample pools. A pool keeps Sound_Sample/Sound_SampleInternal pairs and
+ *  decode buffers around after Sound_FreeSample(), so the next
+ *  Sound_NewSampleFromPool() can reuse them instead of going back to the
+ *  heap. Buffers are kept in power-of-two size classes: a buffer lives in
+ *  the largest class that it can completely satisfy, and requests are
+ *  rounded up to the next class, so anything in the right list is big
+ *  enough. Free buffers store the list's "next" pointer in their first bytes.
+ */
+#define SAMPLEPOOL_MIN_CLASS 10  /* 1 kilobyte. */
+#define SAMPLEPOOL_MAX_CLASS 22  /* 4 megabytes. */
+#define SAMPLEPOOL_CLASSES (SAMPLEPOOL_MAX_CLASS - SAMPLEPOOL_MIN_CLASS + 1)
+#define SAMPLEPOOL_CLASS_SLACK 3  /* will hand out buffers up to 8x too big. */
+
+struct Sound_SamplePool
+{
+    SDL_mutex *mutex;
+    Uint32 max_cached;
+    Sound_Sample *free_samples;  /* linked through internal->next. */
+    Uint32 free_sample_count;
+    void *free_buffers[SAMPLEPOOL_CLASSES];
+    Uint32 free_buffer_count[SAMPLEPOOL_CLASSES];
+    Uint32 outstanding;  /* samples handed out and not yet returned. */
+    int destroyed;
+    Sound_SamplePoolStats stats;
+};
+
+
+/* smallest class that holds (size) bytes, or -1 if it's too big to pool. */
+static int pool_class_for_request(Uint32 size)
+{
+    int i;
+    for (i = 0; i < SAMPLEPOOL_CLASSES; i++)
+    {
+        if (size <= (((Uint32) 1) << (i + SAMPLEPOOL_MIN_CLASS)))
+            return i;
+    } /* for */
+    return -1;
+} /* pool_class_for_request */
+
+
+/* largest class that (capacity) bytes can satisfy, or -1 if none fits. */
+static int pool_class_for_capacity(Uint32 capacity)
+{
+    int i;
+    for (i = SAMPLEPOOL_CLASSES - 1; i >= 0; i--)
+    {
+        const Uint32 classsize = ((Uint32) 1) << (i + SAMPLEPOOL_MIN_CLASS);
+        if (capacity >= classsize)
+            return (capacity >= (classsize << 1)) ? -1 : i;
+    } /* for */
+    return -1;
+} /* pool_class_for_capacity */
+
+
+static void free_sample_pool(Sound_SamplePool *pool)
+{
+    int i;
+
+    while (pool->free_samples != NULL)
+    {
+        Sound_Sample *sample = pool->free_samples;
+        Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+        pool->free_samples = internal->next;
+        __Sound_free(internal);
+        __Sound_free(sample);
+    } /* while */
+
+    for (i = 0; i < SAMPLEPOOL_CLASSES; i++)
+    {
+        while (pool->free_buffers[i] != NULL)
+        {
+            void *buf = pool->free_buffers[i];
+            pool->free_buffers[i] = *((void **) buf);
+            __Sound_free(buf);
+        } /* while */
+    } /* for */
+
+    SDL_DestroyMutex(pool->mutex);
+    __Sound_free(pool);
+    SDL_AtomicAdd(&live_pools, -1);
+} /* free_sample_pool */
+
+
+Sound_SamplePool *Sound_CreateSamplePool(Uint32 max_cached)
+{
+    Sound_SamplePool *pool = (Sound_SamplePool *) __Sound_calloc(1, sizeof (*pool));
+    BAIL_IF_MACRO(pool == NULL, ERR_OUT_OF_MEMORY, NULL);
+
+    pool->mutex = SDL_CreateMutex();
+    if (pool->mutex == NULL)
+    {
+        __Sound_free(pool);
+        BAIL_MACRO(SDL_GetError(), NULL);
+    } /* if */
+
+    pool->max_cached = max_cached;
+    SDL_AtomicAdd(&live_pools, 1);
+    return pool;
+} /* Sound_CreateSamplePool */
+
+
+void Sound_DestroySamplePool(Sound_SamplePool *pool)
+{
+    int nuke_it;
+
+    if (pool == NULL)
+        return;
+
+    /* If samples are still out there, the last one back turns off the lights. */
+    SDL_LockMutex(pool->mutex);
+    pool->destroyed = 1;
+    nuke_it = (pool->outstanding == 0);
+    SDL_UnlockMutex(pool->mutex);
+
+    if (nuke_it)
+        free_sample_pool(pool);
+} /* Sound_DestroySamplePool */
+
+
+void Sound_GetSamplePoolStats(Sound_SamplePool *pool,
+                              Sound_SamplePoolStats *stats)
+{
+    if ((pool == NULL) || (stats == NULL))
+        return;
+
+    SDL_LockMutex(pool->mutex);
+    SDL_memcpy(stats, &pool->stats, sizeof (Sound_SamplePoolStats));
+    SDL_UnlockMutex(pool->mutex);
+} /* Sound_GetSamplePoolStats */
+
+
+void Sound_SetResampleQuality(Sound_ResampleQuality quality)
+{
+    resample_quality = quality;
+} /* Sound_SetResampleQuality */
+
+
+Sound_ResampleQuality Sound_GetResampleQuality(void)
+{
+    return resample_quality;
+} /* Sound_GetResampleQuality */
+
+
+void Sound_SetFileMapping(int enable)
+{
+    file_mapping = enable;
+} /* Sound_SetFileMapping */
+
+
+int Sound_GetFileMapping(void)
+{
+    return file_mapping;
+} /* Sound_GetFileMapping */
+
+
+void Sound_SetSeekIndexGranularity(Uint32 ms)
+{
+    seek_index_granularity = ms;
+} /* Sound_SetSeekIndexGranularity */
+
+
+Uint32 Sound_GetSeekIndexGranularity(void)
+{
+    return seek_index_granularity;
+} /* Sound_GetSeekIndexGranularity */
+
+
 /*
  * Allocate a Sound_Sample, and fill in most of its fields. Those that need
  *  to be filled in later, by a decoder, will be initialized to zero.
+ *  If (pool) isn't NULL, we try to recycle memory from there first.
  */
-static Sound_Sample *alloc_sample(SDL_RWops *rw, Sound_AudioInfo *desired,
-                                    Uint32 bufferSize)
+static Sound_Sample *alloc_sample(Sound_SamplePool *pool, SDL_RWops *rw,
+                                  Sound_AudioInfo *desired, Uint32 bufferSize)
 {
-    /*
-     * !!! FIXME: We're going to need to pool samples, since the mixer
-     * !!! FIXME:  might be allocating tons of these on a regular basis.
-     */
-    Sound_Sample *retval = SDL_calloc(1, sizeof (Sound_Sample));
-    Sound_SampleInternal *internal = SDL_calloc(1, sizeof (Sound_SampleInternal));
-    if ((retval == NULL) || (internal == NULL))
+    Sound_Sample *retval = NULL;
+    Sound_SampleInternal *internal = NULL;
+    Uint32 capacity = bufferSize;
+    void *buffer = NULL;
+
+    SDL_assert(bufferSize > 0);
+
+    if (pool != NULL)
     {
-        __Sound_SetError(ERR_OUT_OF_MEMORY);
-        if (retval)
-            SDL_free(retval);
-        if (internal)
-            SDL_free(internal);
+        const int bufclass = pool_class_for_request(bufferSize);
 
-        return NULL;
+        SDL_LockMutex(pool->mutex);
+        if (pool->free_samples != NULL)
+        {
+            retval = pool->free_samples;
+            internal = (Sound_SampleInternal *) retval->opaque;
+            pool->free_samples = internal->next;
+            pool->free_sample_count--;
+            pool->stats.sample_hits++;
+        } /* if */
+        else
+        {
+            pool->stats.sample_misses++;
+        } /* else */
+
+        if (bufclass >= 0)
+        {
+            /*
+             * A slightly bigger buffer is fine, too; samples that need
+             *  format conversion grow theirs by SDL_AudioCVT's len_mult,
+             *  so that's where their buffers end up when they come back.
+             */
+            int i;
+            for (i = bufclass; i < SAMPLEPOOL_CLASSES && i <= bufclass + SAMPLEPOOL_CLASS_SLACK; i++)
+            {
+                if (pool->free_buffers[i] != NULL)
+                    break;
+            } /* for */
+
+            capacity = ((Uint32) 1) << (bufclass + SAMPLEPOOL_MIN_CLASS);
+            if ((i < SAMPLEPOOL_CLASSES) && (pool->free_buffers[i] != NULL))
+            {
+                capacity = ((Uint32) 1) << (i + SAMPLEPOOL_MIN_CLASS);
+                buffer = pool->free_buffers[i];
+                pool->free_buffers[i] = *((void **) buffer);
+                pool->free_buffer_count[i]--;
+                pool->stats.buffer_hits++;
+            } /* if */
+            else
+            {
+                pool->stats.buffer_misses++;
+            } /* else */
+        } /* if */
+        else
+        {
+            pool->stats.buffer_misses++;
+        } /* else */
+
+        pool->outstanding++;
+        SDL_UnlockMutex(pool->mutex);
+
+        if (retval != NULL)
+        {
+            SDL_zerop(retval);
+            SDL_zerop(internal);
+        } /* if */
     } /* if */
 
-    SDL_assert(bufferSize > 0);
-    retval->buffer = SDL_calloc(1, bufferSize);  /* pure ugly. */
-    if (!retval->buffer)
+    if (retval == NULL)
+    {
+        retval = __Sound_calloc(1, sizeof (Sound_Sample));
+        internal = __Sound_calloc(1, sizeof (Sound_SampleInternal));
+    } /* if */
+
+    if (buffer == NULL)
+        buffer = __Sound_calloc(1, capacity);  /* pure ugly. */
+
+    if ((retval == NULL) || (internal == NULL) || (buffer == NULL))
     {
         __Sound_SetError(ERR_OUT_OF_MEMORY);
-        SDL_free(internal);
-        SDL_free(retval);
+        if (retval)
+            __Sound_free(retval);
+        if (internal)
+            __Sound_free(internal);
+        if (buffer)
+            __Sound_free(buffer);
+
+        if (pool != NULL)
+        {
+            int nuke_it;
+            SDL_LockMutex(pool->mutex);
+            pool->outstanding--;
+            nuke_it = ((pool->destroyed) && (pool->outstanding == 0));
+            SDL_UnlockMutex(pool->mutex);
+            if (nuke_it)
+                free_sample_pool(pool);
+        } /* if */
+
         return NULL;
     } /* if */
+
+    retval->buffer = buffer;
     retval->buffer_size = bufferSize;
 
     if (desired != NULL)
         SDL_memcpy(&retval->desired, desired, sizeof (Sound_AudioInfo));
 
     internal->rw = rw;
+    internal->pool = pool;
+    internal->buffer_capacity = capacity;
     retval->opaque = internal;
     return retval;
 } /* alloc_sample */
 
 
+/*
+ * Undo alloc_sample(): give the memory back to the sample's pool, if it
+ *  has one and there's room, or to the heap otherwise. The decoder should
+ *  be closed and the sample unlinked from sample_list before this.
+ */
+static void release_sample(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Sound_SamplePool *pool = internal->pool;
+    void *buffer = sample->buffer;
+    int nuke_it = 0;
+
+    __Sound_DestroyResampler(internal->resampler);
+    internal->resampler = NULL;
+    __Sound_free(internal->staging);
+    internal->staging = NULL;
+    internal->staging_size = 0;
+
+    if ((internal->buffer != NULL) && (internal->buffer != sample->buffer))
+        __Sound_free(internal->buffer);
+
+    if (pool != NULL)
+    {
+        const int bufclass = pool_class_for_capacity(internal->buffer_capacity);
+
+        SDL_LockMutex(pool->mutex);
+
+        if ((buffer != NULL) && (bufclass >= 0) && (!pool->destroyed) &&
+            (pool->free_buffer_count[bufclass] < pool->max_cached))
+        {
+            *((void **) buffer) = pool->free_buffers[bufclass];
+            pool->free_buffers[bufclass] = buffer;
+            pool->free_buffer_count[bufclass]++;
+            buffer = NULL;
+        } /* if */
+
+        if ((!pool->destroyed) && (pool->free_sample_count < pool->max_cached))
+        {
+            internal->next = pool->free_samples;
+            pool->free_samples = sample;
+            pool->free_sample_count++;
+            internal = NULL;
+            sample = NULL;
+        } /* if */
+
+        pool->outstanding--;
+        nuke_it = ((pool->destroyed) && (pool->outstanding == 0));
+        SDL_UnlockMutex(pool->mutex);
+    } /* if */
+
+    if (buffer != NULL)
+        __Sound_free(buffer);
+
+    if (sample != NULL)
+    {
+        __Sound_free(internal);
+        __Sound_free(sample);
+    } /* if */
+
+    if (nuke_it)
+        free_sample_pool(pool);
+} /* release_sample */
+
+
 #if (defined DEBUG_CHATTER)
 static SDL_INLINE const char *fmt_to_str(Uint16 fmt)
 {
@@ -389,19 +862,38 @@ static int init_sample(const Sound_DecoderFunctions *funcs,
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     Sound_AudioInfo desired;
-    int pos = SDL_RWtell(internal->rw);
+    Sound_Arena *prev_arena;
+    int resample;
+    int opened;
+    const Sint64 pos = SDL_RWtell(internal->rw);
 
         /* fill in the funcs for this decoder... */
     sample->decoder = &funcs->info;
     internal->funcs = funcs;
-    if (!funcs->open(sample, ext))
+    internal->total_frames = -1;
+    internal->segmentable = 0;
+
+        /* the decoder's setup lives as long as the sample; use its arena. */
+    prev_arena = __Sound_ArenaEnter(&internal->arena);
+    stats_begin(sample);
+    opened = funcs->open(sample, ext);
+    stats_end(sample);
+    __Sound_ArenaLeave(prev_arena);
+
+    if (!opened)
     {
+        __Sound_ArenaRelease(&internal->arena);
         SDL_RWseek(internal->rw, pos, SEEK_SET);  /* set for next try... */
         return 0;
     } /* if */
 
     /* success; we've got a decoder! */
 
+        /* if it put off finding the length, find_duration() does it later. */
+    internal->duration_pending = ((funcs->duration != NULL) &&
+                                  (internal->total_time < 0));
+    internal->index_pending = 0;
+
     /* Now we need to set up the conversion buffer... */
 
     if (_desired == NULL)
@@ -413,31 +905,84 @@ static int init_sample(const Sound_DecoderFunctions *funcs,
         desired.rate = _desired->rate ? _desired->rate : sample->actual.rate;
     } /* else */
 
+    /*
+     * If we're changing the rate ourselves, SDL_AudioCVT only has to get the
+     *  data to float32 in the right number of channels, and the resampler
+     *  takes it from there.
+     */
+    resample = ( (desired.rate != sample->actual.rate) &&
+                 (resample_quality != SOUND_RESAMPLE_SDL) );
+
     if (SDL_BuildAudioCVT(&internal->sdlcvt,
                             sample->actual.format,
                             sample->actual.channels,
                             sample->actual.rate,
-                            desired.format,
+                            resample ? AUDIO_F32SYS : desired.format,
                             desired.channels,
-                            desired.rate) == -1)
+                            resample ? sample->actual.rate : desired.rate) == -1)
     {
         __Sound_SetError(SDL_GetError());
         funcs->close(sample);
+        __Sound_ArenaRelease(&internal->arena);
         SDL_RWseek(internal->rw, pos, SEEK_SET);  /* set for next try... */
         return 0;
     } /* if */
 
-    if (internal->sdlcvt.len_mult > 1)
+    /*
+     * If it's just a format and/or channel change, see if we can do it in a
+     *  single pass instead of SDL_AudioCVT's filter chain. The CVT sticks
+     *  around anyhow, since its len_mult still tells us how to size buffers.
+     */
+    if ( (internal->sdlcvt.needed) &&
+         ((resample) || (desired.rate == sample->actual.rate)) )
+    {
+        const SDL_AudioFormat cvtfmt = resample ? AUDIO_F32SYS : desired.format;
+        const Uint32 srcframe = ((sample->actual.format & 0xFF) / 8) * sample->actual.channels;
+        const Uint32 dstframe = ((cvtfmt & 0xFF) / 8) * desired.channels;
+
+        internal->convert = __Sound_GetConverter(sample->actual.format,
+                                                 sample->actual.channels,
+                                                 cvtfmt, desired.channels);
+        internal->convert_framesize = dstframe;
+
+            /* we convert in place, too, so make sure the buffer fits. */
+        if (internal->sdlcvt.len_mult * srcframe < dstframe)
+            internal->sdlcvt.len_mult = (dstframe + srcframe - 1) / srcframe;
+    } /* if */
+
+    if (resample)
+    {
+        internal->resampler = __Sound_CreateResampler(resample_quality,
+                                                      desired.channels,
+                                                      sample->actual.rate,
+                                                      desired.rate,
+                                                      desired.format);
+        if (internal->resampler == NULL)
+        {
+            funcs->close(sample);
+            __Sound_ArenaRelease(&internal->arena);
+            SDL_RWseek(internal->rw, pos, SEEK_SET);  /* set for next try... */
+            return 0;
+        } /* if */
+    } /* if */
+
+    if ( (internal->sdlcvt.len_mult > 1) &&
+         (internal->buffer_capacity < sample->buffer_size * internal->sdlcvt.len_mult) )
     {
-        void *rc = SDL_realloc(sample->buffer, sample->buffer_size * internal->sdlcvt.len_mult);
+        const Uint32 newsize = sample->buffer_size * internal->sdlcvt.len_mult;
+        void *rc = __Sound_realloc(sample->buffer, newsize);
         if (rc == NULL)
         {
+            __Sound_DestroyResampler(internal->resampler);
+            internal->resampler = NULL;
             funcs->close(sample);
+            __Sound_ArenaRelease(&internal->arena);
             SDL_RWseek(internal->rw, pos, SEEK_SET);  /* set for next try... */
             return 0;
         } /* if */
 
         sample->buffer = rc;
+        internal->buffer_capacity = newsize;
     } /* if */
 
         /* these pointers are all one and the same. */
@@ -467,35 +1012,233 @@ static int init_sample(const Sound_DecoderFunctions *funcs,
     SNDDBG(("On-the-fly conversion: %s.\n",
             internal->sdlcvt.needed ? "ENABLED" : "DISABLED"));
 
+    SNDDBG(("Single-pass conversion: %s.\n",
+            internal->convert ? "ENABLED" : "DISABLED"));
+
+    SNDDBG(("Streaming resampler: %s.\n",
+            internal->resampler ? "ENABLED" : "DISABLED"));
+
     return 1;
 } /* init_sample */
 
 
-Sound_Sample *Sound_NewSample(SDL_RWops *rw, const char *ext,
-                              Sound_AudioInfo *desired, Uint32 bSize)
+/*
+ * Signature sniffing. Before we go asking decoders to open a stream, we
+ *  read the start of it once and look for well-known magic numbers, so we
+ *  can usually go straight to the right decoder instead of letting each one
+ *  read, reject, and seek back in turn (some of them allocate, too). This is
+ *  only a hint: if the decoder we pick turns the data down anyway, we fall
+ *  back to the usual extension match and then trying everything.
+ */
+#define SNIFF_BUFFER_SIZE 4096
+
+#if SOUND_SUPPORTS_MP3
+/* just enough of the MPEG audio header to find the next frame. */
+static Uint32 mpeg_frame_size(const Uint8 *hdr)
 {
-    Sound_Sample *retval;
-    decoder_element *decoder;
+    static const Uint16 bitrates[5][15] = {
+        { 0,32,64,96,128,160,192,224,256,288,320,352,384,416,448 }, /* v1 L1 */
+        { 0,32,48,56,64,80,96,112,128,160,192,224,256,320,384 },    /* v1 L2 */
+        { 0,32,40,48,56,64,80,96,112,128,160,192,224,256,320 },     /* v1 L3 */
+        { 0,32,48,56,64,80,96,112,128,144,160,176,192,224,256 },    /* v2 L1 */
+        { 0,8,16,24,32,40,48,56,64,80,96,112,128,144,160 }          /* v2 L2/3 */
+    };
+    static const Uint16 rates[3] = { 44100, 48000, 32000 };
+    const int version = (hdr[1] >> 3) & 3;  /* 3==MPEG1, 2==MPEG2, 0==MPEG2.5 */
+    const int layer = 4 - ((hdr[1] >> 1) & 3);
+    const int bitrateidx = hdr[2] >> 4;
+    const int rateidx = (hdr[2] >> 2) & 3;
+    const Uint32 padding = (hdr[2] >> 1) & 1;
+    Uint32 bitrate, rate;
+
+    if ((hdr[0] != 0xFF) || ((hdr[1] & 0xE0) != 0xE0))
+        return 0;  /* no frame sync. */
+    else if ((version == 1) || (layer == 4) || (rateidx == 3))
+        return 0;  /* reserved values. */
+    else if ((bitrateidx == 0) || (bitrateidx == 15))
+        return 0;  /* free format or bogus; don't guess. */
+
+    if (version == 3)
+        bitrate = bitrates[layer - 1][bitrateidx];
+    else
+        bitrate = bitrates[(layer == 1) ? 3 : 4][bitrateidx];
+    bitrate *= 1000;
 
-    /* sanity checks. */
-    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, NULL);
-    BAIL_IF_MACRO(rw == NULL, ERR_INVALID_ARGUMENT, NULL);
+    rate = rates[rateidx];
+    if (version == 2)
+        rate /= 2;
+    else if (version == 0)
+        rate /= 4;
 
-    retval = alloc_sample(rw, desired, bSize);
-    if (!retval)
-        return NULL;  /* alloc_sample() sets error message... */
+    if (layer == 1)
+        return ((12 * bitrate / rate) + padding) * 4;
+    else if ((layer == 3) && (version != 3))
+        return (72 * bitrate / rate) + padding;
+    return (144 * bitrate / rate) + padding;
+} /* mpeg_frame_size */
 
-    if (ext != NULL)
-    {
+
+static int sniff_mpeg(const Uint8 *buf, Uint32 len)
+{
+    Uint32 framelen;
+
+    if ((len >= 10) && (SDL_memcmp(buf, "ID3", 3) == 0))
+        return 1;  /* ID3v2 tag; what comes after it is almost surely MPEG. */
+
+    /* one good header isn't much to go on; insist on a second if we can. */
+    framelen = (len >= 4) ? mpeg_frame_size(buf) : 0;
+    if (framelen == 0)
+        return 0;
+    else if (framelen + 4 > len)
+        return 1;  /* next frame is past what we read; take its word for it. */
+    else if (mpeg_frame_size(buf + framelen) == 0)
+        return 0;
+
+    /* layer and sample rate can't change between frames. */
+    return ( ((buf[1] & 0xFE) == (buf[framelen + 1] & 0xFE)) &&
+             ((buf[2] & 0x0C) == (buf[framelen + 2] & 0x0C)) );
+} /* sniff_mpeg */
+#endif
+
+
+static const Sound_DecoderFunctions *sniff_signature(const Uint8 *buf,
+                                                     Uint32 len)
+{
+#if SOUND_SUPPORTS_WAV
+    if ((len >= 12) && ((SDL_memcmp(buf, "RIFF", 4) == 0) ||
+                        (SDL_memcmp(buf, "RF64", 4) == 0) ||
+                        (SDL_memcmp(buf, "BW64", 4) == 0)) &&
+        (SDL_memcmp(buf + 8, "WAVE", 4) == 0))
+        return &__Sound_DecoderFunctions_WAV;
+#endif
+
+#if SOUND_SUPPORTS_AIFF
+    if ((len >= 12) && (SDL_memcmp(buf, "FORM", 4) == 0) &&
+        ((SDL_memcmp(buf + 8, "AIFF", 4) == 0) ||
+         (SDL_memcmp(buf + 8, "AIFC", 4) == 0)))
+        return &__Sound_DecoderFunctions_AIFF;
+#endif
+
+#if SOUND_SUPPORTS_AU
+    if ((len >= 4) && (SDL_memcmp(buf, ".snd", 4) == 0))
+        return &__Sound_DecoderFunctions_AU;
+#endif
+
+#if SOUND_SUPPORTS_VOC
+    if ((len >= 20) && (SDL_memcmp(buf, "Creative Voice File\032", 20) == 0))
+        return &__Sound_DecoderFunctions_VOC;
+#endif
+
+#if SOUND_SUPPORTS_FLAC
+    if ((len >= 4) && (SDL_memcmp(buf, "fLaC", 4) == 0))
+        return &__Sound_DecoderFunctions_FLAC;
+#endif
+
+#if SOUND_SUPPORTS_SHN
+    if ((len >= 4) && (SDL_memcmp(buf, "ajkg", 4) == 0))
+        return &__Sound_DecoderFunctions_SHN;
+#endif
+
+    if ((len >= 27) && (SDL_memcmp(buf, "OggS", 4) == 0))
+    {
+        /* the first packet on the first page tells us the codec. */
+        const Uint32 packet = 27 + buf[26];
+        if (packet + 7 <= len)
+        {
+#if SOUND_SUPPORTS_VORBIS
+            if (SDL_memcmp(buf + packet, "\001vorbis", 7) == 0)
+                return &__Sound_DecoderFunctions_VORBIS;
+#endif
+#if SOUND_SUPPORTS_FLAC
+            if (SDL_memcmp(buf + packet, "\177FLAC", 5) == 0)
+                return &__Sound_DecoderFunctions_FLAC;
+#endif
+        } /* if */
+        return NULL;
+    } /* if */
+
+#if SOUND_SUPPORTS_MP3
+    /* this one's the least certain, so it goes last. */
+    if (sniff_mpeg(buf, len))
+        return &__Sound_DecoderFunctions_MP3;
+#endif
+
+    return NULL;  /* no idea. */
+} /* sniff_signature */
+
+
+/*
+ * Peek at the start of (rw) and return the available decoder whose
+ *  signature matches, or NULL. The stream is left where we found it.
+ */
+static decoder_element *sniff_decoder(SDL_RWops *rw)
+{
+    Uint8 buf[SNIFF_BUFFER_SIZE];
+    const Sound_DecoderFunctions *funcs;
+    decoder_element *decoder;
+    const Sint64 pos = SDL_RWtell(rw);
+    size_t len;
+
+    if (pos < 0)
+        return NULL;  /* can't seek back, so we can't afford to look. */
+
+    len = SDL_RWread(rw, buf, 1, sizeof (buf));
+    if (SDL_RWseek(rw, pos, RW_SEEK_SET) != pos)
+        return NULL;  /* uhoh. Let the decoders sort it out. */
+
+    funcs = sniff_signature(buf, (Uint32) len);
+    if (funcs == NULL)
+        return NULL;
+
+    for (decoder = &decoders[0]; decoder->funcs != NULL; decoder++)
+    {
+        if ((decoder->funcs == funcs) && (decoder->available))
+            return decoder;
+    } /* for */
+
+    return NULL;
+} /* sniff_decoder */
+
+
+static Sound_Sample *new_sample(Sound_SamplePool *pool, SDL_RWops *rw,
+                                const char *ext, Sound_AudioInfo *desired,
+                                Uint32 bSize)
+{
+    Sound_Sample *retval;
+    decoder_element *decoder;
+    Uint8 tried[sizeof (decoders) / sizeof (decoders[0])];
+
+    /* sanity checks. */
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, NULL);
+    BAIL_IF_MACRO(rw == NULL, ERR_INVALID_ARGUMENT, NULL);
+
+    retval = alloc_sample(pool, rw, desired, bSize);
+    if (!retval)
+        return NULL;  /* alloc_sample() sets error message... */
+
+    SDL_zero(tried);
+
+    /* see if the data's magic number tells us who to ask first... */
+    decoder = sniff_decoder(rw);
+    if (decoder != NULL)
+    {
+        tried[decoder - decoders] = 1;
+        if (init_sample(decoder->funcs, retval, ext, desired))
+            return retval;
+    } /* if */
+
+    if (ext != NULL)
+    {
         for (decoder = &decoders[0]; decoder->funcs != NULL; decoder++)
         {
-            if (decoder->available)
+            if ((decoder->available) && (!tried[decoder - decoders]))
             {
                 const char **decoderExt = decoder->funcs->info.extensions;
                 while (*decoderExt)
                 {
                     if (SDL_strcasecmp(*decoderExt, ext) == 0)
                     {
+                        tried[decoder - decoders] = 1;
                         if (init_sample(decoder->funcs, retval, ext, desired))
                             return retval;
                         break;  /* done with this decoder either way. */
@@ -506,62 +1249,134 @@ Sound_Sample *Sound_NewSample(SDL_RWops *rw, const char *ext,
         } /* for */
     } /* if */
 
-    /* no direct extension match? Try everything we've got... */
+    /* no direct signature or extension match? Try everything we've got... */
     for (decoder = &decoders[0]; decoder->funcs != NULL; decoder++)
     {
-        if (decoder->available)
+        if ((decoder->available) && (!tried[decoder - decoders]))
         {
-            int should_try = 1;
-            const char **decoderExt = decoder->funcs->info.extensions;
-
-                /* skip if we would have tried decoder above... */
-            while (*decoderExt)
-            {
-                if (ext && SDL_strcasecmp(*decoderExt, ext) == 0)
-                {
-                    should_try = 0;
-                    break;
-                } /* if */
-                decoderExt++;
-            } /* while */
-
-            if (should_try)
-            {
-                if (init_sample(decoder->funcs, retval, ext, desired))
-                    return retval;
-            } /* if */
+            if (init_sample(decoder->funcs, retval, ext, desired))
+                return retval;
         } /* if */
     } /* for */
 
     /* nothing could handle the sound data... */
-    SDL_free(retval->opaque);
-    if (retval->buffer != NULL)
-        SDL_free(retval->buffer);
-    SDL_free(retval);
+    release_sample(retval);
     SDL_RWclose(rw);
     __Sound_SetError(ERR_UNSUPPORTED_FORMAT);
     return NULL;
+} /* new_sample */
+
+
+Sound_Sample *Sound_NewSample(SDL_RWops *rw, const char *ext,
+                              Sound_AudioInfo *desired, Uint32 bSize)
+{
+    return new_sample(NULL, rw, ext, desired, bSize);
 } /* Sound_NewSample */
 
 
+Sound_Sample *Sound_NewSampleFromPool(Sound_SamplePool *pool, SDL_RWops *rw,
+                                      const char *ext,
+                                      Sound_AudioInfo *desired, Uint32 bSize)
+{
+    BAIL_IF_MACRO(pool == NULL, ERR_INVALID_ARGUMENT, NULL);
+    return new_sample(pool, rw, ext, desired, bSize);
+} /* Sound_NewSampleFromPool */
+
+
+/*
+ * If the decoded-audio cache has (key)'s sound, open a sample that reads it
+ *  from there, without running the decoder at all. NULL if it doesn't.
+ */
+static Sound_Sample *open_cached_sample(const Sound_CacheKey *key,
+                                        Uint32 bufferSize)
+{
+    Sound_CacheEntry *entry;
+    Sound_Sample *retval = NULL;
+    SDL_RWops *rw = NULL;
+
+    if (key == NULL)
+        return NULL;
+
+    entry = __Sound_CacheLookup(key);
+    if (entry == NULL)
+        return NULL;
+
+    rw = __Sound_CacheEntryRW(entry);
+    if (rw != NULL)
+        retval = alloc_sample(NULL, rw, NULL, bufferSize);
+
+    if (retval == NULL)
+    {
+        if (rw != NULL)
+            SDL_RWclose(rw);
+        __Sound_CacheRelease(entry);
+        return NULL;
+    } /* if */
+
+    /*
+     * The data's already in the format that was asked for, so this never
+     *  converts anything. The cache's open() can't fail, so if init_sample()
+     *  does anyhow, its close() has already let go of the entry.
+     */
+    ((Sound_SampleInternal *) retval->opaque)->decoder_private = entry;
+    if (!init_sample(&__Sound_DecoderFunctions_CACHE, retval, NULL, NULL))
+    {
+        release_sample(retval);
+        SDL_RWclose(rw);
+        return NULL;
+    } /* if */
+
+    return retval;
+} /* open_cached_sample */
+
+
+/* hand (key) to a newly opened (sample), to fill in once it's decoded. */
+static Sound_Sample *keep_cache_key(Sound_Sample *sample, Sound_CacheKey *key)
+{
+    if (sample == NULL)
+        __Sound_CacheFreeKey(key);
+    else
+        ((Sound_SampleInternal *) sample->opaque)->cache_key = key;
+    return sample;
+} /* keep_cache_key */
+
+
 Sound_Sample *Sound_NewSampleFromFile(const char *filename,
                                       Sound_AudioInfo *desired,
                                       Uint32 bufferSize)
 {
+    Sound_CacheKey *key;
+    Sound_Sample *retval;
     const char *ext;
     SDL_RWops *rw;
 
     BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, NULL);
     BAIL_IF_MACRO(filename == NULL, ERR_INVALID_ARGUMENT, NULL);
 
+    key = __Sound_CacheKeyFromFile(filename, desired, resample_quality);
+    retval = open_cached_sample(key, bufferSize);
+    if (retval != NULL)
+    {
+        __Sound_CacheFreeKey(key);
+        return retval;
+    } /* if */
+
     ext = SDL_strrchr(filename, '.');
-    rw = SDL_RWFromFile(filename, "rb");
-    BAIL_IF_MACRO(rw == NULL, SDL_GetError(), NULL);
+    rw = (file_mapping) ? __Sound_RWFromMappedFile(filename) : NULL;
+    if (rw == NULL)
+        rw = SDL_RWFromFile(filename, "rb");
+
+    if (rw == NULL)
+    {
+        __Sound_CacheFreeKey(key);
+        BAIL_MACRO(SDL_GetError(), NULL);
+    } /* if */
 
     if (ext != NULL)
         ext++;
 
-    return Sound_NewSample(rw, ext, desired, bufferSize);
+    retval = Sound_NewSample(rw, ext, desired, bufferSize);
+    return keep_cache_key(retval, key);
 } /* Sound_NewSampleFromFile */
 
 
@@ -571,19 +1386,41 @@ Sound_Sample *Sound_NewSampleFromMem(const Uint8 *data,
                                      Sound_AudioInfo *desired,
                                      Uint32 bufferSize)
 {
+    Sound_CacheKey *key;
+    Sound_Sample *retval;
     SDL_RWops *rw;
 
     BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, NULL);
     BAIL_IF_MACRO(data == NULL, ERR_INVALID_ARGUMENT, NULL);
     BAIL_IF_MACRO(size == 0, ERR_INVALID_ARGUMENT, NULL);
 
+    key = __Sound_CacheKeyFromMem(data, size, ext, desired, resample_quality);
+    retval = open_cached_sample(key, bufferSize);
+    if (retval != NULL)
+    {
+        __Sound_CacheFreeKey(key);
+        return retval;
+    } /* if */
+
     rw = SDL_RWFromConstMem(data, size);
-    BAIL_IF_MACRO(rw == NULL, SDL_GetError(), NULL);
+    if (rw == NULL)
+    {
+        __Sound_CacheFreeKey(key);
+        BAIL_MACRO(SDL_GetError(), NULL);
+    } /* if */
 
-    return Sound_NewSample(rw, ext, desired, bufferSize);
+    retval = Sound_NewSample(rw, ext, desired, bufferSize);
+    return keep_cache_key(retval, key);
 } /* Sound_NewSampleFromMem */
 
 
+/* read-ahead lives further down, next to the decoding it wraps. */
+static Uint32 prefetch_halt(Sound_Sample *sample);
+static void prefetch_free(Sound_Sample *sample);
+static int prefetch_begin(Sound_Sample *sample, Uint32 ms);
+static Sint64 tell_frames(Sound_Sample *sample);
+
+
 void Sound_FreeSample(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal;
@@ -627,20 +1464,15 @@ void Sound_FreeSample(Sound_Sample *sample)
     SDL_UnlockMutex(samplelist_mutex);
 
     /* nuke it... */
+    prefetch_free(sample);
     internal->funcs->close(sample);
+    __Sound_ArenaRelease(&internal->arena);
+    __Sound_CacheFreeKey(internal->cache_key);
 
     if (internal->rw != NULL)  /* this condition is a "just in case" thing. */
         SDL_RWclose(internal->rw);
 
-    if ((internal->buffer != NULL) && (internal->buffer != sample->buffer))
-        SDL_free(internal->buffer);
-
-    SDL_free(internal);
-
-    if (sample->buffer != NULL)
-        SDL_free(sample->buffer);
-
-    SDL_free(sample);
+    release_sample(sample);
 } /* Sound_FreeSample */
 
 
@@ -648,139 +1480,1476 @@ int Sound_SetBufferSize(Sound_Sample *sample, Uint32 newSize)
 {
     void *newBuf = NULL;
     Sound_SampleInternal *internal = NULL;
+    Uint32 prefetch_ms;
 
     BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
     BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
     internal = ((Sound_SampleInternal *) sample->opaque);
-    newBuf = SDL_realloc(sample->buffer, newSize * internal->sdlcvt.len_mult);
-    BAIL_IF_MACRO(newBuf == NULL, ERR_OUT_OF_MEMORY, 0);
 
-    internal->sdlcvt.buf = internal->buffer = sample->buffer = newBuf;
-    sample->buffer_size = newSize;
-    internal->buffer_size = newSize / internal->sdlcvt.len_mult;
-    internal->sdlcvt.len = internal->buffer_size;
+        /* the read-ahead thread uses these, too; it'll restart at the new size. */
+    prefetch_ms = prefetch_halt(sample);
+
+    newBuf = __Sound_realloc(sample->buffer, newSize * internal->sdlcvt.len_mult);
+    if (newBuf != NULL)
+    {
+        internal->sdlcvt.buf = internal->buffer = sample->buffer = newBuf;
+        internal->buffer_capacity = newSize * internal->sdlcvt.len_mult;
+        sample->buffer_size = newSize;
+        internal->buffer_size = newSize / internal->sdlcvt.len_mult;
+        internal->sdlcvt.len = internal->buffer_size;
+    } /* if */
 
+    if (prefetch_ms > 0)
+        prefetch_begin(sample, prefetch_ms);
+
+    BAIL_IF_MACRO(newBuf == NULL, ERR_OUT_OF_MEMORY, 0);
     return 1;
 } /* Sound_SetBufferSize */
 
 
-Uint32 Sound_Decode(Sound_Sample *sample)
+/*
+ * Have the decoder write up to (readsize) bytes to (buffer), in its own
+ *  format, then run any SDL_AudioCVT conversion there, in place. (buffer)
+ *  must have room for (readsize * len_mult) bytes.
+ */
+static Uint32 read_and_convert(Sound_Sample *sample, void *buffer,
+                               Uint32 readsize)
 {
-    Sound_SampleInternal *internal = NULL;
-    Uint32 retval = 0;
-
-        /* a boatload of sanity checks... */
-    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
-    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_PREV_ERROR, 0);
-    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_EOF, ERR_PREV_EOF, 0);
-
-    internal = (Sound_SampleInternal *) sample->opaque;
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    void *origbuf = internal->buffer;
+    const Uint32 origsize = internal->buffer_size;
+    Uint32 frames;
+    Uint32 retval;
+
+        /* point the decoder at the caller's memory for the duration. */
+    internal->buffer = buffer;
+    internal->buffer_size = readsize;
+    STATS_START(internal);
+    retval = internal->funcs->read(sample);
+    STATS_STOP(internal, decode_ns);
+    internal->buffer = origbuf;
+    internal->buffer_size = origsize;
 
-    SDL_assert(sample->buffer != NULL);
-    SDL_assert(sample->buffer_size > 0);
-    SDL_assert(internal->buffer != NULL);
-    SDL_assert(internal->buffer_size > 0);
+    frames = retval / (((sample->actual.format & 0xFF) / 8) *
+                       sample->actual.channels);
+    internal->position += frames;
+    STATS_ADD(internal, frames_decoded, frames);
 
-        /* reset EAGAIN. Decoder can flip it back on if it needs to. */
-    sample->flags &= ~SOUND_SAMPLEFLAG_EAGAIN;
-    retval = internal->funcs->read(sample);
+    if ((retval > 0) && (internal->convert != NULL))
+    {
+        STATS_START(internal);
+        internal->convert(buffer, buffer, frames, sample->actual.channels);
+        STATS_STOP(internal, convert_ns);
+        retval = frames * internal->convert_framesize;
+    } /* if */
 
-    if (retval > 0 && internal->sdlcvt.needed)
+    else if (retval > 0 && internal->sdlcvt.needed)
     {
+        internal->sdlcvt.buf = (Uint8 *) buffer;
         internal->sdlcvt.len = retval;
+        STATS_START(internal);
         SDL_ConvertAudio(&internal->sdlcvt);
+        STATS_STOP(internal, convert_ns);
         retval = internal->sdlcvt.len_cvt;
+        internal->sdlcvt.buf = (Uint8 *) origbuf;
     } /* if */
 
     return retval;
-} /* Sound_Decode */
+} /* read_and_convert */
 
 
-Uint32 Sound_DecodeAll(Sound_Sample *sample)
+/*
+ * Fill (buffer) from the sample's resampler, feeding it from the decoder
+ *  as needed, (readsize) bytes at a time, through (readbuf). That's usually
+ *  (buffer) itself, since everything read is copied into the resampler's
+ *  queue before any output is written.
+ */
+static Uint32 resample_into(Sound_Sample *sample, void *buffer,
+                            Uint32 bufsize, void *readbuf, Uint32 readsize)
 {
-    Sound_SampleInternal *internal = NULL;
-    void *buf = NULL;
-    Uint32 newBufSize = 0;
-
-    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
-    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_EOF, ERR_PREV_EOF, 0);
-    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_PREV_ERROR, 0);
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Sound_Resampler *resampler = internal->resampler;
+    const Uint32 framesize = ((sample->desired.format & 0xFF) / 8) *
+                              sample->desired.channels;
+    const Uint32 cvtframesize = sizeof (float) * sample->desired.channels;
+    const Uint32 frames = bufsize / framesize;
+    Uint32 avail = __Sound_ResamplerAvailable(resampler);
+
+    while ((avail < frames) && (!__Sound_ResamplerFlushed(resampler)))
+    {
+        const Uint32 br = read_and_convert(sample, readbuf, readsize);
+        int ok = 1;
 
-    internal = (Sound_SampleInternal *) sample->opaque;
+        if (br > 0)
+        {
+            STATS_START(internal);
+            ok = __Sound_ResamplerPut(resampler, (const float *) readbuf, br / cvtframesize);
+            STATS_STOP(internal, convert_ns);
+        } /* if */
 
-    while ( ((sample->flags & SOUND_SAMPLEFLAG_EOF) == 0) &&
-            ((sample->flags & SOUND_SAMPLEFLAG_ERROR) == 0) )
-    {
-        Uint32 br = Sound_Decode(sample);
-        void *ptr = SDL_realloc(buf, newBufSize + br);
-        if (ptr == NULL)
+        if (!ok)
         {
             sample->flags |= SOUND_SAMPLEFLAG_ERROR;
-            __Sound_SetError(ERR_OUT_OF_MEMORY);
+            break;
         } /* if */
-        else
+
+        /*
+         * The decoder is done, but the resampler still has the tail of the
+         *  stream queued up. Don't report EOF until that's been handed out.
+         */
+        if (sample->flags & SOUND_SAMPLEFLAG_EOF)
         {
-            buf = ptr;
-            SDL_memcpy( ((char *) buf) + newBufSize, sample->buffer, br );
-            newBufSize += br;
-        } /* else */
+            sample->flags &= ~SOUND_SAMPLEFLAG_EOF;
+            if (!__Sound_ResamplerFlush(resampler))
+            {
+                sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+                break;
+            } /* if */
+        } /* if */
+
+        avail = __Sound_ResamplerAvailable(resampler);
+
+        if (sample->flags & (SOUND_SAMPLEFLAG_ERROR | SOUND_SAMPLEFLAG_EAGAIN))
+            break;  /* hand back what we've got. */
     } /* while */
 
-    if (buf == NULL)  /* ...in case first call to SDL_realloc() fails... */
-        return sample->buffer_size;
+    STATS_START(internal);
+    avail = __Sound_ResamplerGet(resampler, buffer, frames);
+    STATS_STOP(internal, convert_ns);
 
-    if (internal->buffer != sample->buffer)
-        SDL_free(internal->buffer);
+    if ( (__Sound_ResamplerFlushed(resampler)) &&
+         (__Sound_ResamplerAvailable(resampler) == 0) )
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
 
-    SDL_free(sample->buffer);
+    return avail * framesize;
+} /* resample_into */
 
-    internal->sdlcvt.buf = internal->buffer = sample->buffer = buf;
-    sample->buffer_size = newBufSize;
-    internal->buffer_size = newBufSize / internal->sdlcvt.len_mult;
-    internal->sdlcvt.len = internal->buffer_size;
 
-    return newBufSize;
-} /* Sound_DecodeAll */
+/* run the decoder (and converter, and resampler) right now, on this thread. */
+/* decode_direct()'s own space to decode into, at least (size) bytes. */
+static void *staging_buffer(Sound_SampleInternal *internal, Uint32 size)
+{
+    if (internal->staging_size < size)
+    {
+        void *ptr = __Sound_realloc(internal->staging, size);
+        BAIL_IF_MACRO(ptr == NULL, ERR_OUT_OF_MEMORY, NULL);
+        internal->staging = ptr;
+        internal->staging_size = size;
+    } /* if */
 
+    return internal->staging;
+} /* staging_buffer */
 
-int Sound_Rewind(Sound_Sample *sample)
+
+static Uint32 decode_direct(Sound_Sample *sample, void *buffer, Uint32 bufsize)
 {
-    Sound_SampleInternal *internal;
-    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Uint32 len_mult = (Uint32) internal->sdlcvt.len_mult;
+    const Uint32 framesize = ((sample->actual.format & 0xFF) / 8) *
+                              sample->actual.channels;
+    const Uint32 outframesize = ((sample->desired.format & 0xFF) / 8) *
+                                 sample->desired.channels;
+    Uint64 wanted;
+    Uint32 readsize;
+    void *readbuf = buffer;
+    Uint32 retval;
+
+    BAIL_IF_MACRO(bufsize < outframesize, ERR_INVALID_ARGUMENT, 0);
 
-    internal = (Sound_SampleInternal *) sample->opaque;
-    if (!internal->funcs->rewind(sample))
+    /*
+     * The decoder writes in its own format, and conversion happens in place,
+     *  so only hand it as much as will still fit after conversion grows it.
+     *  len_mult is 1 when there's no conversion. Keep to whole frames, since
+     *  some decoders write a frame at a time without checking for a partial.
+     */
+    readsize = bufsize / len_mult;
+    readsize -= readsize % framesize;
+
+    /*
+     * Without a resampler, each source frame is one output frame, so a
+     *  conversion that shrinks the data (S32 or F32 to S16, say) needs more
+     *  room to decode into than the output takes. If the caller's buffer
+     *  doesn't have it, decode in our own and copy the result out. A
+     *  resampler just needs room for one source frame. Sound_Decode()'s
+     *  buffer is sized for its format already; it only ever gets help if
+     *  it's too small for a frame.
+     */
+    if (internal->resampler != NULL)
+        wanted = framesize;
+    else
+        wanted = ((Uint64) (bufsize / outframesize)) * framesize;
+
+    if ((readsize < wanted) && ((readsize == 0) || (buffer != sample->buffer)))
     {
-        sample->flags |= SOUND_SAMPLEFLAG_ERROR;
-        return 0;
+        Uint32 limit = internal->buffer_size - (internal->buffer_size % framesize);
+        if (limit < framesize)
+            limit = framesize;
+        readsize = (wanted < limit) ? (Uint32) wanted : limit;
+        readbuf = staging_buffer(internal, readsize * len_mult);
+        if (readbuf == NULL)
+        {
+            sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+            return 0;
+        } /* if */
     } /* if */
 
+        /* reset EAGAIN. Decoder can flip it back on if it needs to. */
     sample->flags &= ~SOUND_SAMPLEFLAG_EAGAIN;
-    sample->flags &= ~SOUND_SAMPLEFLAG_ERROR;
-    sample->flags &= ~SOUND_SAMPLEFLAG_EOF;
 
-    return 1;
-} /* Sound_Rewind */
+    stats_begin(sample);
+
+    if (internal->resampler != NULL)
+        retval = resample_into(sample, buffer, bufsize, readbuf, readsize);
+    else if (readbuf == buffer)
+        retval = read_and_convert(sample, buffer, readsize);
+    else
+    {
+            /* staged; keep going until the caller's buffer is full. */
+        Uint32 br;
+        retval = 0;
+        do
+        {
+            const Uint32 left = ((bufsize - retval) / outframesize) * framesize;
+            br = read_and_convert(sample, readbuf, SDL_min(left, readsize));
+            SDL_memcpy(((Uint8 *) buffer) + retval, readbuf, br);
+            retval += br;
+        } while ( (br > 0) && (bufsize - retval >= outframesize) &&
+                  ((sample->flags & (SOUND_SAMPLEFLAG_EOF | SOUND_SAMPLEFLAG_ERROR |
+                                     SOUND_SAMPLEFLAG_EAGAIN)) == 0) );
+    } /* else */
 
+    STATS_PEAK(internal, bufsize);
+    if (sample->flags & SOUND_SAMPLEFLAG_EAGAIN)
+        STATS_ADD(internal, eagains, 1);
 
-int Sound_Seek(Sound_Sample *sample, Uint32 ms)
+    stats_end(sample);
+    return retval;
+} /* decode_direct */
+
+
+/* Do one more piece of the scan Sound_BuildSeekIndex() asked for. */
+static void index_step(Sound_Sample *sample)
 {
-    Sound_SampleInternal *internal;
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
 
-    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
-    if (!(sample->flags & SOUND_SAMPLEFLAG_CANSEEK))
-        BAIL_MACRO(ERR_CANNOT_SEEK, 0);
+    stats_begin(sample);
+    if (!internal->funcs->index(sample))
+        internal->index_pending = 0;
+    stats_end(sample);
+} /* index_step */
 
-    internal = (Sound_SampleInternal *) sample->opaque;
-    BAIL_IF_MACRO(!internal->funcs->seek(sample, ms), NULL, 0);
 
-    sample->flags &= ~SOUND_SAMPLEFLAG_EAGAIN;
-    sample->flags &= ~SOUND_SAMPLEFLAG_ERROR;
-    sample->flags &= ~SOUND_SAMPLEFLAG_EOF;
+/*
+ * Read-ahead. A worker thread runs the decoder ahead of the application and
+ *  leaves converted audio in a ring buffer, which the decode calls just copy
+ *  out of. There's exactly one writer (the worker) and one reader (whoever
+ *  calls Sound_Decode()), so the ring needs no lock: each side owns its
+ *  position in the ring, and the two only share the count of bytes in it
+ *  (no free-running counters, so nothing breaks when 32 bits wrap). The
+ *  worker decodes with its own copy of the Sound_Sample and its internals
+ *  (sharing the decoder and resampler state, which only it touches while
+ *  it runs), so nothing the application's thread looks at changes under
+ *  it.
+ *  When the worker hits EOF or an error, it leaves the flags in (done), and
+ *  the reader applies them once the ring runs dry.
+ */
+#define PREFETCH_DONE 0x80000000  /* in (done), plus the final sample flags. */
 
-    return 1;
-} /* Sound_Rewind */
+struct Sound_Prefetch
+{
+    Sound_Sample shadow;      /* what the worker passes to the decoder. */
+    Sound_SampleInternal shadow_internal;  /* (shadow)'s opaque. */
+    SDL_Thread *thread;       /* NULL if read-ahead is off, but data's left. */
+    SDL_sem *wakeup;          /* posted when there's room, or time to stop. */
+    Uint8 *ring;
+    Uint8 *scratch;           /* the worker decodes here, then copies. */
+    Uint32 capacity;          /* ring size in bytes, in whole frames. */
+    Uint32 framesize;         /* bytes per frame in the desired format. */
+    Uint32 chunk;             /* bytes per decode in the worker. */
+    Uint32 ms;                /* what Sound_EnablePrefetch() asked for. */
+    Uint32 head;              /* next byte to write. Only the worker's. */
+    Uint32 tail;              /* next byte to read. Only the reader's. */
+    SDL_atomic_t filled;      /* bytes written but not read yet. */
+    SDL_atomic_t done;
+    SDL_atomic_t stop;
+    Sint64 start_frame;       /* tell_frames() when the ring started. */
+    Uint64 read_frames;       /* frames handed out since then. */
+    Uint32 low_water;
+    Uint32 underruns;
+};
+
+
+static int SDLCALL prefetch_thread(void *data)
+{
+    Sound_Prefetch *pf = (Sound_Prefetch *) data;
+    Sound_Sample *shadow = &pf->shadow;
+
+    while (!SDL_AtomicGet(&pf->stop))
+    {
+        const Uint32 filled = (Uint32) SDL_AtomicGet(&pf->filled);
+        Uint32 br;
+
+        if (pf->capacity - filled < pf->chunk)
+        {
+            if (pf->shadow_internal.index_pending)
+                index_step(shadow);  /* full; scan for seek points meanwhile. */
+            else
+                SDL_SemWait(pf->wakeup);  /* full; wait for the reader. */
+            continue;
+        } /* if */
+
+        br = decode_direct(shadow, pf->scratch, pf->chunk);
+        if (br > 0)
+        {
+            const Uint32 cpy = SDL_min(br, pf->capacity - pf->head);
+            SDL_memcpy(pf->ring + pf->head, pf->scratch, cpy);
+            SDL_memcpy(pf->ring, pf->scratch + cpy, br - cpy);
+            pf->head = (pf->head + br) % pf->capacity;
+            SDL_MemoryBarrierRelease();
+            SDL_AtomicAdd(&pf->filled, (int) br);
+        } /* if */
+
+        if (shadow->flags & (SOUND_SAMPLEFLAG_EOF | SOUND_SAMPLEFLAG_ERROR))
+            break;
+        else if (br == 0)
+        {
+            if ((shadow->flags & SOUND_SAMPLEFLAG_EAGAIN) == 0)
+            {
+                shadow->flags |= SOUND_SAMPLEFLAG_ERROR;  /* no progress?! */
+                break;
+            } /* if */
+            SDL_SemWaitTimeout(pf->wakeup, 10);  /* give the source a moment. */
+        } /* else if */
+    } /* while */
+
+    SDL_AtomicSet(&pf->done, (int) (PREFETCH_DONE | (shadow->flags &
+                     (SOUND_SAMPLEFLAG_EOF | SOUND_SAMPLEFLAG_ERROR))));
+    return 0;
+} /* prefetch_thread */
+
+
+/*
+ * Stop the worker, if it's running. Whatever it already decoded stays put.
+ *  Returns the read-ahead it was running with, in milliseconds, or zero.
+ */
+static Uint32 prefetch_halt(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Sound_Prefetch *pf = internal->prefetch;
+    Uint32 retval = 0;
+
+    if ((pf != NULL) && (pf->thread != NULL))
+    {
+        SDL_AtomicSet(&pf->stop, 1);
+        SDL_SemPost(pf->wakeup);
+        SDL_WaitThread(pf->thread, NULL);
+        pf->thread = NULL;
+        internal->position = pf->shadow_internal.position;
+        internal->index_pending = pf->shadow_internal.index_pending;
+        retval = pf->ms;
+        pf->ms = 0;
+    } /* if */
+
+    return retval;
+} /* prefetch_halt */
+
+
+static void prefetch_destroy(Sound_Prefetch *pf)
+{
+    if (pf->wakeup != NULL)
+        SDL_DestroySemaphore(pf->wakeup);
+    __Sound_free(pf->shadow_internal.staging);
+    __Sound_free(pf->scratch);
+    __Sound_free(pf->ring);
+    __Sound_free(pf);
+} /* prefetch_destroy */
+
+
+/* Stop the worker and throw away anything it decoded. */
+static void prefetch_free(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+
+    if (internal->prefetch != NULL)
+    {
+        prefetch_halt(sample);
+        prefetch_destroy(internal->prefetch);
+        internal->prefetch = NULL;
+    } /* if */
+} /* prefetch_free */
+
+
+/*
+ * Start a worker with a ring of about (ms) milliseconds. Anything an earlier
+ *  worker left in the old ring is carried over, so nothing is lost or
+ *  reordered.
+ */
+static int prefetch_begin(Sound_Sample *sample, Uint32 ms)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Sound_Prefetch *old = internal->prefetch;
+    const Uint32 framesize = ((sample->desired.format & 0xFF) / 8) *
+                              sample->desired.channels;
+    const Uint32 chunk = sample->buffer_size - (sample->buffer_size % framesize);
+    Uint32 pending = 0;
+    Uint64 capacity;
+    Sound_Prefetch *pf;
+
+    BAIL_IF_MACRO(chunk == 0, ERR_INVALID_ARGUMENT, 0);
+
+    prefetch_halt(sample);
+    if (old != NULL)
+        pending = (Uint32) SDL_AtomicGet(&old->filled);
+
+    capacity = ((((Uint64) ms) * sample->desired.rate) / 1000) * framesize;
+    if (capacity < ((Uint64) pending) + (chunk * 2))
+        capacity = ((Uint64) pending) + (chunk * 2);
+    BAIL_IF_MACRO(capacity > 0x7FFFFFFF, ERR_INVALID_ARGUMENT, 0);
+
+    pf = (Sound_Prefetch *) __Sound_calloc(1, sizeof (Sound_Prefetch));
+    BAIL_IF_MACRO(pf == NULL, ERR_OUT_OF_MEMORY, 0);
+    pf->framesize = framesize;
+    pf->chunk = chunk;
+    pf->capacity = (Uint32) capacity;
+    pf->low_water = pf->capacity;
+    pf->ms = ms;
+    pf->ring = (Uint8 *) __Sound_malloc(pf->capacity);
+    pf->scratch = (Uint8 *) __Sound_malloc(pf->chunk);
+    pf->wakeup = SDL_CreateSemaphore(0);
+    if ((pf->ring == NULL) || (pf->scratch == NULL) || (pf->wakeup == NULL))
+    {
+        prefetch_destroy(pf);
+        BAIL_MACRO(ERR_OUT_OF_MEMORY, 0);
+    } /* if */
+
+    if (old != NULL)
+    {
+        const Uint32 cpy = SDL_min(pending, old->capacity - old->tail);
+        SDL_memcpy(pf->ring, old->ring + old->tail, cpy);
+        SDL_memcpy(pf->ring + cpy, old->ring, pending - cpy);
+        pf->head = pending % pf->capacity;
+        SDL_AtomicSet(&pf->filled, (int) pending);
+        SDL_AtomicSet(&pf->done, SDL_AtomicGet(&old->done));
+        pf->start_frame = old->start_frame;
+        pf->read_frames = old->read_frames;
+        pf->underruns = old->underruns;
+        prefetch_destroy(old);
+    } /* if */
+    else
+    {
+        pf->start_frame = tell_frames(sample);
+    } /* else */
+
+    SDL_memcpy(&pf->shadow, sample, sizeof (Sound_Sample));
+    pf->shadow.buffer = pf->scratch;
+    pf->shadow.buffer_size = pf->chunk;
+    pf->shadow.flags &= ~SOUND_SAMPLEFLAG_EAGAIN;
+    pf->shadow.opaque = &pf->shadow_internal;
+    SDL_memcpy(&pf->shadow_internal, internal, sizeof (Sound_SampleInternal));
+    pf->shadow_internal.prefetch = NULL;
+    pf->shadow_internal.staging = NULL;  /* the worker gets its own. */
+    pf->shadow_internal.staging_size = 0;
+#if SOUND_STATS
+    SDL_zero(pf->shadow_internal.stats_pending);
+    if (internal->stats_owner == NULL)
+        pf->shadow_internal.stats_owner = &internal->stats;
+#endif
+    internal->prefetch = pf;
+
+        /* if the last worker already finished, there's nothing left to do. */
+    if ((SDL_AtomicGet(&pf->done) & PREFETCH_DONE) == 0)
+    {
+        pf->thread = SDL_CreateThread(prefetch_thread, "SDL_sound prefetch", pf);
+        if (pf->thread == NULL)
+        {
+            pf->ms = 0;  /* leave any carried-over data to be read out. */
+            BAIL_MACRO(SDL_GetError(), 0);
+        } /* if */
+    } /* if */
+
+    return 1;
+} /* prefetch_begin */
+
+
+/*
+ * The reader's half: copy out what the worker has ready, without ever
+ *  waiting for it. If there's nothing, that's an underrun, reported as
+ *  EAGAIN. Once a halted worker's leftovers are used up, the ring goes away
+ *  and decoding goes back to the calling thread.
+ */
+static Uint32 prefetch_read(Sound_Sample *sample, void *buffer, Uint32 bufsize)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Sound_Prefetch *pf = internal->prefetch;
+    /* check done first: the worker fills the ring before it sets that. */
+    const int done = SDL_AtomicGet(&pf->done);
+    const Uint32 avail = (Uint32) SDL_AtomicGet(&pf->filled);
+    Uint32 retval = bufsize - (bufsize % pf->framesize);
+
+    SDL_MemoryBarrierAcquire();
+    sample->flags &= ~SOUND_SAMPLEFLAG_EAGAIN;
+
+    if (avail < pf->low_water)
+        pf->low_water = avail;
+
+    if (retval > avail)
+        retval = avail;
+
+    if (retval > 0)
+    {
+        const Uint32 cpy = SDL_min(retval, pf->capacity - pf->tail);
+        SDL_memcpy(buffer, pf->ring + pf->tail, cpy);
+        SDL_memcpy(((Uint8 *) buffer) + cpy, pf->ring, retval - cpy);
+        pf->tail = (pf->tail + retval) % pf->capacity;
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicAdd(&pf->filled, -((int) retval));
+        pf->read_frames += retval / pf->framesize;
+        if (pf->thread != NULL)
+            SDL_SemPost(pf->wakeup);
+    } /* if */
+
+    if (retval < avail)
+        return retval;  /* more where that came from. */
+
+    if (done & PREFETCH_DONE)
+        sample->flags |= (Uint32) (done & ~PREFETCH_DONE);
+    else if (pf->thread != NULL)
+    {
+        if (retval == 0)
+        {
+            pf->underruns++;
+            STATS_ADD(internal, eagains, 1);
+            sample->flags |= SOUND_SAMPLEFLAG_EAGAIN;
+        } /* if */
+        return retval;
+    } /* else if */
+
+        /* the worker's gone and so is its data; back to normal decoding. */
+    prefetch_free(sample);
+    return retval;
+} /* prefetch_read */
+
+
+static Uint32 decode_into(Sound_Sample *sample, void *buffer, Uint32 bufsize)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Uint32 retval;
+
+    if (internal->prefetch != NULL)
+    {
+        retval = prefetch_read(sample, buffer, bufsize);
+        STATS_PEAK(internal, bufsize);
+        if ( (retval > 0) || (internal->prefetch != NULL) ||
+             (sample->flags & (SOUND_SAMPLEFLAG_EOF | SOUND_SAMPLEFLAG_ERROR)) )
+        {
+            stats_end(sample);
+            return retval;
+        } /* if */
+    } /* if */
+
+    retval = decode_direct(sample, buffer, bufsize);
+
+        /* Sound_BuildSeekIndex() in the background, without read-ahead. */
+    if (internal->index_pending)
+        index_step(sample);
+
+    return retval;
+} /* decode_into */
+
+
+Uint32 Sound_Decode(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = NULL;
+
+        /* a boatload of sanity checks... */
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_PREV_ERROR, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_EOF, ERR_PREV_EOF, 0);
+
+    internal = (Sound_SampleInternal *) sample->opaque;
+
+    SDL_assert(sample->buffer != NULL);
+    SDL_assert(sample->buffer_size > 0);
+    SDL_assert(internal->buffer != NULL);
+    SDL_assert(internal->buffer_size > 0);
+
+    return decode_into(sample, sample->buffer, sample->buffer_size);
+} /* Sound_Decode */
+
+
+Uint32 Sound_DecodeInto(Sound_Sample *sample, void *buffer, Uint32 bufsize)
+{
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(buffer == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_PREV_ERROR, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_EOF, ERR_PREV_EOF, 0);
+    return decode_into(sample, buffer, bufsize);
+} /* Sound_DecodeInto */
+
+
+Uint32 Sound_DecodeFramesInto(Sound_Sample *sample, void *buffer,
+                              Uint32 frames)
+{
+    Uint32 framesize;
+    Uint64 bufsize;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+
+    framesize = ((sample->desired.format & 0xFF) / 8) * sample->desired.channels;
+    bufsize = ((Uint64) frames) * framesize;
+    if (bufsize > 0xFFFFFFFF)
+        bufsize = 0xFFFFFFFF - (0xFFFFFFFF % framesize);
+
+    return Sound_DecodeInto(sample, buffer, (Uint32) bufsize) / framesize;
+} /* Sound_DecodeFramesInto */
+
+
+/*
+ * If (sample)'s decoder put off working out the length at open time, have it
+ *  do that now. It only gets asked once, whether or not it can tell.
+ */
+static void find_duration(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Uint32 prefetch_ms;
+    Sint64 frames;
+
+    if (!internal->duration_pending)
+        return;
+    internal->duration_pending = 0;
+
+        /* the decoder may move the stream around; keep the read-ahead out. */
+    prefetch_ms = prefetch_halt(sample);
+
+    stats_begin(sample);
+    frames = internal->funcs->duration(sample);
+    stats_end(sample);
+
+    if (frames >= 0)
+    {
+        const Uint32 rate = sample->actual.rate;
+        internal->total_frames = frames;
+        internal->total_time = (Sint32) ((frames / rate) * 1000);
+        internal->total_time += (Sint32) (((frames % rate) * 1000) / rate);
+    } /* if */
+
+    if (prefetch_ms > 0)
+        prefetch_begin(sample, prefetch_ms);
+} /* find_duration */
+
+
+/*
+ * Guess how many bytes a full decode of (sample) will produce, based on the
+ *  duration the decoder reported and the desired output format. Returns zero
+ *  if we can't tell (no duration, or it won't fit in a Uint32).
+ */
+static Uint32 estimate_decoded_size(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Uint64 frame_size = (Uint64) ((sample->desired.format & 0xFF) / 8) *
+                               sample->desired.channels;
+    Uint64 retval;
+
+    find_duration(sample);
+    if (internal->total_time <= 0)
+        return 0;
+
+    retval = (((Uint64) internal->total_time) * sample->desired.rate) / 1000;
+    retval *= frame_size;
+
+        /* leave room for rounding in the decoder's duration math. */
+    retval += sample->buffer_size;
+
+    return (retval > 0xFFFFFFFF) ? 0 : (Uint32) retval;
+} /* estimate_decoded_size */
+
+
+/*
+ * Make (buf), a block of (size) bytes of decoded audio, the sample's buffer,
+ *  as Sound_DecodeAll() and friends promise.
+ */
+static void adopt_decoded_buffer(Sound_Sample *sample, void *buf, Uint32 size)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+
+    if (internal->buffer != sample->buffer)
+        __Sound_free(internal->buffer);
+
+    __Sound_free(sample->buffer);
+
+    internal->sdlcvt.buf = internal->buffer = sample->buffer = buf;
+    internal->buffer_capacity = size;
+    sample->buffer_size = size;
+    internal->buffer_size = size / internal->sdlcvt.len_mult;
+    internal->sdlcvt.len = internal->buffer_size;
+} /* adopt_decoded_buffer */
+
+
+/*
+ * If (sample) came from Sound_NewSampleFromFile() or Sound_NewSampleFromMem()
+ *  with the cache on, and its buffer now holds the whole sound, decoded from
+ *  the very start, keep a copy for the next time someone opens it.
+ */
+static void cache_decoded_buffer(Sound_Sample *sample, int from_start)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+
+    if ( (internal->cache_key != NULL) && (from_start) &&
+         ((sample->flags & SOUND_SAMPLEFLAG_ERROR) == 0) )
+    {
+        __Sound_CacheStore(internal->cache_key, sample);
+        __Sound_CacheFreeKey(internal->cache_key);
+        internal->cache_key = NULL;
+    } /* if */
+} /* cache_decoded_buffer */
+
+
+Uint32 Sound_DecodeAll(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = NULL;
+    void *buf = NULL;
+    Uint32 bufsize = 0;
+    Uint32 newBufSize = 0;
+    int from_start;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_EOF, ERR_PREV_EOF, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_PREV_ERROR, 0);
+
+    internal = (Sound_SampleInternal *) sample->opaque;
+    from_start = ((internal->cache_key != NULL) && (Sound_TellFrames(sample) == 0));
+
+        /* no sense reading ahead; anything already read is used first. */
+    prefetch_halt(sample);
+
+        /* if we know how long this is, allocate it all up front. */
+    bufsize = estimate_decoded_size(sample);
+    if (bufsize > 0)
+    {
+        buf = __Sound_malloc(bufsize);
+        if (buf == NULL)
+            bufsize = 0;  /* oh well, fall back to growing as we go. */
+    } /* if */
+
+    while ( ((sample->flags & SOUND_SAMPLEFLAG_EOF) == 0) &&
+            ((sample->flags & SOUND_SAMPLEFLAG_ERROR) == 0) )
+    {
+            /* make sure one more block fits, then decode right into it. */
+        if (bufsize - newBufSize < sample->buffer_size)
+        {
+            /*
+             * Grow geometrically, so decoding something of unknown length
+             *  doesn't turn into a realloc (and a copy) for every chunk.
+             */
+            const Uint64 needed = ((Uint64) newBufSize) + sample->buffer_size;
+            Uint64 newsize = ((Uint64) bufsize) + (bufsize / 2);
+            void *ptr;
+
+                /* the result's size is a Uint32; past that, we can't grow. */
+            if (needed > 0xFFFFFFFF)
+            {
+                sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+                __Sound_SetError(ERR_OUT_OF_MEMORY);
+                break;
+            } /* if */
+
+            if (newsize < needed)
+                newsize = needed;
+            else if (newsize > 0xFFFFFFFF)
+                newsize = 0xFFFFFFFF;
+
+            ptr = __Sound_realloc(buf, (size_t) newsize);
+            if (ptr == NULL)
+            {
+                sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+                __Sound_SetError(ERR_OUT_OF_MEMORY);
+                break;
+            } /* if */
+
+            buf = ptr;
+            bufsize = (Uint32) newsize;
+        } /* if */
+
+        newBufSize += Sound_DecodeInto(sample, ((char *) buf) + newBufSize,
+                                       sample->buffer_size);
+    } /* while */
+
+    if (buf == NULL)  /* ...in case first call to __Sound_realloc() fails... */
+        return sample->buffer_size;
+
+    if (newBufSize == 0)  /* nothing decoded; keep the original buffer. */
+    {
+        __Sound_free(buf);
+        return 0;
+    } /* if */
+
+        /* give back whatever we overestimated. */
+    if (newBufSize < bufsize)
+    {
+        void *ptr = __Sound_realloc(buf, newBufSize);
+        if (ptr != NULL)
+            buf = ptr;
+    } /* if */
+
+    adopt_decoded_buffer(sample, buf, newBufSize);
+    cache_decoded_buffer(sample, from_start);
+    return newBufSize;
+} /* Sound_DecodeAll */
+
+
+/*
+ * Sound_DecodeAllParallel() cuts what's left of a sample into one run of
+ *  sample frames per thread. Each run gets its own instance of the decoder,
+ *  opened on the same in-memory image of the source, which seeks to the
+ *  start of its run and decodes straight into its slice of the final
+ *  buffer. The calling thread takes the last run with the sample itself, so
+ *  the sample ends up at EOF just like Sound_DecodeAll() would leave it.
+ */
+#define PARALLEL_MIN_FRAMES (64 * 1024)  /* don't bother with less per thread. */
+#define PARALLEL_CHUNK_SIZE (64 * 1024)  /* bytes per decode in each thread. */
+
+typedef struct
+{
+    Sound_Sample *sample;
+    SDL_Thread *thread;
+    Uint64 start;
+    Uint64 frames;
+    Uint8 *output;
+    int ok;
+} decode_segment;
+
+
+static int SDLCALL decode_segment_thread(void *data)
+{
+    decode_segment *seg = (decode_segment *) data;
+    Sound_Sample *sample = seg->sample;
+    const Uint32 framesize = ((sample->desired.format & 0xFF) / 8) *
+                             sample->desired.channels;
+    const Uint32 chunk = (PARALLEL_CHUNK_SIZE / framesize) ? (PARALLEL_CHUNK_SIZE / framesize) : 1;
+    Uint64 left = seg->frames;
+    Uint8 *ptr = seg->output;
+
+    if (!Sound_SeekFrames(sample, seg->start))
+        return 0;
+
+    while (left > 0)
+    {
+        const Uint32 want = (left < chunk) ? (Uint32) left : chunk;
+        const Uint32 got = Sound_DecodeFramesInto(sample, ptr, want);
+        if (got == 0)
+            return 0;  /* EOF or an error before the end of our run. */
+        ptr += got * framesize;
+        left -= got;
+    } /* while */
+
+    seg->ok = 1;
+    return 0;
+} /* decode_segment_thread */
+
+
+/*
+ * Get the whole source of (rw) in memory. Memory RWops are used as-is;
+ *  anything else is read in once, and (*allocated) is set so the caller
+ *  can free it. Returns NULL if the source's size can't be determined.
+ */
+static const Uint8 *source_image(SDL_RWops *rw, int *size, Uint8 **allocated)
+{
+    Sint64 len;
+    Sint64 pos;
+    Uint8 *retval;
+
+    *allocated = NULL;
+    if ((rw->type == SDL_RWOPS_MEMORY) || (rw->type == SDL_RWOPS_MEMORY_RO))
+    {
+        *size = (int) (rw->hidden.mem.stop - rw->hidden.mem.base);
+        return rw->hidden.mem.base;
+    } /* if */
+
+    len = SDL_RWsize(rw);
+    pos = SDL_RWtell(rw);
+    if ((len <= 0) || (len > 0x7FFFFFFF) || (pos < 0))
+        return NULL;
+
+    retval = (Uint8 *) __Sound_malloc((size_t) len);
+    if (retval == NULL)
+        return NULL;
+
+    if ( (SDL_RWseek(rw, 0, RW_SEEK_SET) != 0) ||
+         (SDL_RWread(rw, retval, (size_t) len, 1) != 1) )
+    {
+        SDL_RWseek(rw, pos, RW_SEEK_SET);
+        __Sound_free(retval);
+        return NULL;
+    } /* if */
+
+    SDL_RWseek(rw, pos, RW_SEEK_SET);
+    *allocated = retval;
+    *size = (int) len;
+    return retval;
+} /* source_image */
+
+
+/* Open another instance of (sample)'s decoder on a copy of its source. */
+static Sound_Sample *open_segment_sample(Sound_Sample *sample,
+                                         const Uint8 *image, int size)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Sound_DecoderFunctions *funcs = internal->funcs;
+    Sound_SampleInternal *newinternal;
+    Sound_Sample *retval;
+    SDL_RWops *rw;
+
+    rw = SDL_RWFromConstMem(image, size);
+    if (rw == NULL)
+        return NULL;
+
+    retval = alloc_sample(NULL, rw, &sample->desired, PARALLEL_CHUNK_SIZE);
+    if (retval == NULL)
+    {
+        SDL_RWclose(rw);
+        return NULL;
+    } /* if */
+
+#if SOUND_STATS
+        /* this is all work on (sample)'s behalf. */
+    newinternal = (Sound_SampleInternal *) retval->opaque;
+    newinternal->stats_owner = internal->stats_owner;
+    if (newinternal->stats_owner == NULL)
+        newinternal->stats_owner = &internal->stats;
+#endif
+
+    if (!init_sample(funcs, retval, funcs->info.extensions[0], &sample->desired))
+    {
+        release_sample(retval);
+        SDL_RWclose(rw);
+        return NULL;
+    } /* if */
+
+        /* make sure it's really the same data we're looking at. */
+    newinternal = (Sound_SampleInternal *) retval->opaque;
+    find_duration(retval);
+    if ( (retval->actual.format != sample->actual.format) ||
+         (retval->actual.channels != sample->actual.channels) ||
+         (retval->actual.rate != sample->actual.rate) ||
+         (retval->desired.format != sample->desired.format) ||
+         (retval->desired.channels != sample->desired.channels) ||
+         (newinternal->total_frames != internal->total_frames) ||
+         (!newinternal->segmentable) )
+    {
+        Sound_FreeSample(retval);
+        return NULL;
+    } /* if */
+
+    return retval;
+} /* open_segment_sample */
+
+
+Uint32 Sound_DecodeAllParallel(Sound_Sample *sample, int nthreads)
+{
+    Sound_SampleInternal *internal = NULL;
+    decode_segment *segs = NULL;
+    const Uint8 *image = NULL;
+    Uint8 *allocated = NULL;
+    Uint8 *buf = NULL;
+    Uint32 framesize;
+    Sint64 start;
+    Uint64 remaining;
+    Uint64 outsize;
+    int imagesize = 0;
+    int nsegs;
+    int ok;
+    int i;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_EOF, ERR_PREV_EOF, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_PREV_ERROR, 0);
+
+    internal = (Sound_SampleInternal *) sample->opaque;
+    if (nthreads <= 0)
+        nthreads = SDL_GetCPUCount();
+
+    find_duration(sample);  /* we need the length to split the work. */
+
+    /*
+     * Runs have to be decoded exactly as they would be in one pass, so
+     *  anything that keeps state across frames (resampling, mostly) has to
+     *  go the serial way.
+     */
+    if ( (nthreads < 2) ||
+         (internal->prefetch != NULL) ||
+         (!internal->segmentable) ||
+         (internal->total_frames <= 0) ||
+         (internal->funcs->seek_frames == NULL) ||
+         (internal->resampler != NULL) ||
+         (sample->desired.rate != sample->actual.rate) ||
+         ((sample->flags & SOUND_SAMPLEFLAG_CANSEEK) == 0) )
+    {
+        return Sound_DecodeAll(sample);
+    } /* if */
+
+    start = tell_frames(sample);
+    if ((start < 0) || (start >= internal->total_frames))
+        return Sound_DecodeAll(sample);
+
+    remaining = (Uint64) (internal->total_frames - start);
+    framesize = ((sample->desired.format & 0xFF) / 8) * sample->desired.channels;
+    outsize = remaining * framesize;
+    nsegs = (int) SDL_min((Uint64) nthreads, remaining / PARALLEL_MIN_FRAMES);
+    if ((nsegs < 2) || (outsize > 0xFFFFFFFF))
+        return Sound_DecodeAll(sample);
+
+    image = source_image(internal->rw, &imagesize, &allocated);
+    if (image == NULL)
+        return Sound_DecodeAll(sample);
+
+    buf = (Uint8 *) __Sound_malloc((size_t) outsize);
+    segs = (decode_segment *) __Sound_calloc(nsegs, sizeof (decode_segment));
+    ok = ((buf != NULL) && (segs != NULL));
+
+    for (i = 0; (ok) && (i < nsegs); i++)
+    {
+        const Uint64 first = (remaining * i) / nsegs;
+        const Uint64 last = (remaining * (i + 1)) / nsegs;
+        segs[i].start = ((Uint64) start) + first;
+        segs[i].frames = last - first;
+        segs[i].output = buf + (first * framesize);
+        if (i == nsegs - 1)
+            segs[i].sample = sample;
+        else
+        {
+            segs[i].sample = open_segment_sample(sample, image, imagesize);
+            ok = (segs[i].sample != NULL);
+        } /* else */
+    } /* for */
+
+    if (ok)
+    {
+            /* if a thread won't start, we'll just do its run here. */
+        for (i = 0; i < nsegs - 1; i++)
+        {
+            segs[i].thread = SDL_CreateThread(decode_segment_thread,
+                                              "SDL_sound decode", &segs[i]);
+            if (segs[i].thread == NULL)
+                decode_segment_thread(&segs[i]);
+        } /* for */
+
+        decode_segment_thread(&segs[nsegs - 1]);
+
+        for (i = 0; i < nsegs; i++)
+        {
+            if (segs[i].thread != NULL)
+                SDL_WaitThread(segs[i].thread, NULL);
+            ok = ((ok) && (segs[i].ok));
+        } /* for */
+    } /* if */
+
+    if (segs != NULL)
+    {
+        for (i = 0; i < nsegs - 1; i++)
+        {
+            if (segs[i].sample != NULL)
+                Sound_FreeSample(segs[i].sample);
+        } /* for */
+        __Sound_free(segs);
+    } /* if */
+
+    if (allocated != NULL)
+        __Sound_free(allocated);
+
+    if (!ok)  /* something didn't pan out; do it the slow way. */
+    {
+        if (buf != NULL)
+            __Sound_free(buf);
+        BAIL_IF_MACRO(!Sound_SeekFrames(sample, (Uint64) start), NULL, 0);
+        return Sound_DecodeAll(sample);
+    } /* if */
+
+    adopt_decoded_buffer(sample, buf, (Uint32) outsize);
+    sample->flags |= SOUND_SAMPLEFLAG_EOF;
+    cache_decoded_buffer(sample, (start == 0));
+    return (Uint32) outsize;
+} /* Sound_DecodeAllParallel */
+
+
+Uint32 Sound_DecodeAllToBuffer(Sound_Sample *sample, void *buffer,
+                               Uint32 bufsize)
+{
+    Uint32 retval = 0;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(buffer == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_EOF, ERR_PREV_EOF, 0);
+    BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_PREV_ERROR, 0);
+
+        /* no sense reading ahead; anything already read is used first. */
+    prefetch_halt(sample);
+
+    /*
+     * We can only stop on a Sound_Decode() boundary without losing data,
+     *  so don't start another decode unless a whole sample->buffer_size
+     *  worth of space is left in the caller's buffer.
+     */
+    while ( ((sample->flags & SOUND_SAMPLEFLAG_EOF) == 0) &&
+            ((sample->flags & SOUND_SAMPLEFLAG_ERROR) == 0) &&
+            (bufsize - retval >= sample->buffer_size) )
+    {
+        retval += Sound_DecodeInto(sample, ((char *) buffer) + retval,
+                                   sample->buffer_size);
+    } /* while */
+
+    return retval;
+} /* Sound_DecodeAllToBuffer */
+
+
+Uint32 Sound_GetDecodedSize(Sound_Sample *sample)
+{
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    return estimate_decoded_size(sample);
+} /* Sound_GetDecodedSize */
+
+
+/*
+ * Read-ahead can't survive the decoder moving, so the seek functions stop
+ *  it first (returning how much there was), then restart it afterwards.
+ */
+static Uint32 prefetch_cancel(Sound_Sample *sample)
+{
+    const Uint32 retval = prefetch_halt(sample);
+    prefetch_free(sample);
+    return retval;
+} /* prefetch_cancel */
+
+
+/*
+ * Frame positions the app sees vs. the frames the decoder reads. These only
+ *  differ for samples from the decode cache that were resampled on the way
+ *  in; the ends of the sound always line up exactly.
+ */
+static Uint64 frames_from_source(Sound_Sample *sample, Uint64 frame)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Uint32 rate = internal->source_rate;
+
+    if (rate == 0)
+        return frame;
+    else if (frame >= (Uint64) internal->source_frames)
+        return (Uint64) internal->total_frames;
+    return ((frame * sample->actual.rate) + (rate / 2)) / rate;
+} /* frames_from_source */
+
+
+static Sint64 frames_to_source(Sound_Sample *sample, Sint64 frame)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Uint32 rate = sample->actual.rate;
+
+    if ((internal->source_rate == 0) || (frame < 0))
+        return frame;
+    else if (frame >= internal->total_frames)
+        return internal->source_frames;
+    return (Sint64) ((((Uint64) frame * internal->source_rate) + (rate / 2)) / rate);
+} /* frames_to_source */
+
+
+/* the decoder just moved to (frame); bring everything after it along. */
+static int reposition(Sound_Sample *sample, Uint64 frame, Uint32 prefetch_ms)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+
+    internal->position = frame;
+
+    if ((internal->resampler) && (!__Sound_ResetResampler(internal->resampler)))
+    {
+        sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+        return 0;
+    } /* if */
+
+    sample->flags &= ~SOUND_SAMPLEFLAG_EAGAIN;
+    sample->flags &= ~SOUND_SAMPLEFLAG_ERROR;
+    sample->flags &= ~SOUND_SAMPLEFLAG_EOF;
+
+        /* seeking right to the end is fine; there's just nothing left. */
+    if ((internal->total_frames >= 0) && (frame >= (Uint64) internal->total_frames))
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+
+    if (prefetch_ms > 0)
+        prefetch_begin(sample, prefetch_ms);  /* if not, we just don't. */
+
+    return 1;
+} /* reposition */
+
+
+int Sound_Rewind(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal;
+    Uint32 prefetch_ms;
+    int ok;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+
+    internal = (Sound_SampleInternal *) sample->opaque;
+    prefetch_ms = prefetch_cancel(sample);
+    stats_begin(sample);
+    ok = internal->funcs->rewind(sample);
+    STATS_ADD(internal, seeks, 1);
+    stats_end(sample);
+    if (!ok)
+    {
+        sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+        return 0;
+    } /* if */
+
+    return reposition(sample, 0, prefetch_ms);
+} /* Sound_Rewind */
+
+
+int Sound_Seek(Sound_Sample *sample, Uint32 ms)
+{
+    Sound_SampleInternal *internal;
+    Uint32 prefetch_ms;
+    Uint64 frame;
+    int ok;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    if (!(sample->flags & SOUND_SAMPLEFLAG_CANSEEK))
+        BAIL_MACRO(ERR_CANNOT_SEEK, 0);
+
+    internal = (Sound_SampleInternal *) sample->opaque;
+    frame = __Sound_convertMsToFrames(&sample->actual, ms);
+    find_duration(sample);  /* so we know where the end is. */
+    BAIL_IF_MACRO((internal->total_frames >= 0) &&
+                  (frame > (Uint64) internal->total_frames), ERR_PAST_EOF, 0);
+    prefetch_ms = prefetch_cancel(sample);
+    stats_begin(sample);
+    if (internal->funcs->seek_frames != NULL)
+        ok = internal->funcs->seek_frames(sample, frame);
+    else
+        ok = internal->funcs->seek(sample, ms);
+    STATS_ADD(internal, seeks, 1);
+    stats_end(sample);
+    BAIL_IF_MACRO(!ok, NULL, 0);
+
+    return reposition(sample, frame, prefetch_ms);
+} /* Sound_Seek */
+
+
+int Sound_SeekFrames(Sound_Sample *sample, Uint64 frame)
+{
+    Sound_SampleInternal *internal;
+    Uint32 prefetch_ms;
+    int ok;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    if (!(sample->flags & SOUND_SAMPLEFLAG_CANSEEK))
+        BAIL_MACRO(ERR_CANNOT_SEEK, 0);
+
+    internal = (Sound_SampleInternal *) sample->opaque;
+    find_duration(sample);  /* so we know where the end is. */
+    BAIL_IF_MACRO((internal->source_rate != 0) &&
+                  (frame > (Uint64) internal->source_frames), ERR_PAST_EOF, 0);
+    frame = frames_from_source(sample, frame);
+    BAIL_IF_MACRO((internal->total_frames >= 0) &&
+                  (frame > (Uint64) internal->total_frames), ERR_PAST_EOF, 0);
+    prefetch_ms = prefetch_cancel(sample);
+    stats_begin(sample);
+    if (internal->funcs->seek_frames != NULL)
+        ok = internal->funcs->seek_frames(sample, frame);
+    else
+    {
+        /* the best this decoder can do is milliseconds. */
+        const Uint64 ms = (frame * 1000) / sample->actual.rate;
+        if (ms > 0xFFFFFFFF)
+        {
+            __Sound_SetError(ERR_PAST_EOF);
+            ok = 0;
+        } /* if */
+        else
+        {
+            ok = internal->funcs->seek(sample, (Uint32) ms);
+            frame = __Sound_convertMsToFrames(&sample->actual, (Uint32) ms);
+        } /* else */
+    } /* else */
+    STATS_ADD(internal, seeks, 1);
+    stats_end(sample);
+    BAIL_IF_MACRO(!ok, NULL, 0);
+
+    return reposition(sample, frame, prefetch_ms);
+} /* Sound_SeekFrames */
+
+
+/* where (sample) is, in the decoder's frames. */
+static Sint64 tell_frames(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Sint64 retval = -1;
+
+        /* the decoder belongs to the read-ahead thread; count what we got. */
+    if (internal->prefetch != NULL)
+    {
+        const Sound_Prefetch *pf = internal->prefetch;
+        const Uint64 frames = (pf->read_frames * sample->actual.rate) / sample->desired.rate;
+        return (pf->start_frame < 0) ? -1 : (pf->start_frame + (Sint64) frames);
+    } /* if */
+
+    if (internal->funcs->tell != NULL)
+        retval = internal->funcs->tell(sample);
+
+    if (retval < 0)
+        retval = (Sint64) internal->position;
+
+        /* the decoder is ahead of us by whatever the resampler is holding. */
+    if (internal->resampler != NULL)
+    {
+        const Uint64 pending = __Sound_ResamplerPending(internal->resampler);
+        retval = (((Uint64) retval) > pending) ? (retval - (Sint64) pending) : 0;
+    } /* if */
+
+    return retval;
+} /* tell_frames */
+
+
+Sint64 Sound_TellFrames(Sound_Sample *sample)
+{
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, -1);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, -1);
+    return frames_to_source(sample, tell_frames(sample));
+} /* Sound_TellFrames */
+
+
+int Sound_BuildSeekIndex(Sound_Sample *sample, int background)
+{
+    Sound_SampleInternal *internal;
+    Uint32 prefetch_ms;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+
+    internal = (Sound_SampleInternal *) sample->opaque;
+    if (internal->funcs->index == NULL)
+        return 1;  /* this decoder seeks quickly without one. */
+
+        /* a restarted read-ahead thread picks up where this leaves off. */
+    prefetch_ms = prefetch_halt(sample);
+    internal->index_pending = 1;
+    while ((!background) && (internal->index_pending))
+        index_step(sample);
+
+    if (prefetch_ms > 0)
+        prefetch_begin(sample, prefetch_ms);
+
+    return 1;
+} /* Sound_BuildSeekIndex */
+
+
+int Sound_EnablePrefetch(Sound_Sample *sample, Uint32 ms)
+{
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+
+    if (ms == 0)
+    {
+        prefetch_halt(sample);  /* what's read ahead is still handed out. */
+        return 1;
+    } /* if */
+
+    return prefetch_begin(sample, ms);
+} /* Sound_EnablePrefetch */
+
+
+int Sound_GetPrefetchStats(Sound_Sample *sample, Sound_PrefetchStats *stats)
+{
+    Sound_SampleInternal *internal;
+    const Sound_Prefetch *pf;
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(stats == NULL, ERR_INVALID_ARGUMENT, 0);
+
+    SDL_zerop(stats);
+    internal = (Sound_SampleInternal *) sample->opaque;
+    pf = internal->prefetch;
+    if ((pf == NULL) || (pf->thread == NULL))
+        return 0;
+
+    stats->capacity = pf->capacity;
+    stats->filled = (Uint32) SDL_AtomicGet((SDL_atomic_t *) &pf->filled);
+    stats->low_water = SDL_min(pf->low_water, stats->filled);
+    stats->underruns = pf->underruns;
+    return 1;
+} /* Sound_GetPrefetchStats */
+
+
+int Sound_GetSampleStats(Sound_Sample *sample, Sound_Stats *stats)
+{
+#if SOUND_STATS
+    Sound_SampleInternal *internal;
+    Sound_Stats totals;
+#endif
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(stats == NULL, ERR_INVALID_ARGUMENT, 0);
+
+#if SOUND_STATS
+    internal = (Sound_SampleInternal *) sample->opaque;
+    SDL_AtomicLock(&stats_lock);
+    SDL_memcpy(&totals, &internal->stats, sizeof (Sound_Stats));
+    SDL_AtomicUnlock(&stats_lock);
+    report_stats(stats, &totals);
+    return 1;
+#else
+    SDL_zerop(stats);
+    BAIL_MACRO(ERR_NOT_SUPPORTED, 0);
+#endif
+} /* Sound_GetSampleStats */
+
+
+int Sound_GetDecoderStats(const Sound_DecoderInfo *decoder, Sound_Stats *stats)
+{
+#if SOUND_STATS
+    Sound_Stats totals;
+    int found = 0;
+    size_t i;
+#endif
+
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(stats == NULL, ERR_INVALID_ARGUMENT, 0);
+
+#if SOUND_STATS
+    SDL_zero(totals);
+    SDL_AtomicLock(&stats_lock);
+    for (i = 0; decoders[i].funcs != NULL; i++)
+    {
+        if ((decoder == NULL) || (decoder == &decoders[i].funcs->info))
+        {
+            add_stats(&totals, &decoders[i].stats);
+            found = 1;
+        } /* if */
+    } /* for */
+    SDL_AtomicUnlock(&stats_lock);
+
+    if (!found)
+    {
+        SDL_zerop(stats);
+        BAIL_MACRO(ERR_INVALID_ARGUMENT, 0);
+    } /* if */
+
+    report_stats(stats, &totals);
+    return 1;
+#else
+    (void) decoder;
+    SDL_zerop(stats);
+    BAIL_MACRO(ERR_NOT_SUPPORTED, 0);
+#endif
+} /* Sound_GetDecoderStats */
 
 
 Sint32 Sound_GetDuration(Sound_Sample *sample)
@@ -788,6 +2957,7 @@ Sint32 Sound_GetDuration(Sound_Sample *sample)
     Sound_SampleInternal *internal;
     BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, -1);
     internal = (Sound_SampleInternal *) sample->opaque;
+    find_duration(sample);
     return internal->total_time;
 } /* Sound_GetDuration */
 
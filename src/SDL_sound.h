@@ -196,6 +196,135 @@ typedef struct
 } Sound_Version;
 
 
+/**
+ * \struct Sound_SamplePool
+ * \brief A cache of recycled Sound_Sample memory.
+ *
+ * This is an opaque handle. Create one with Sound_CreateSamplePool(), then
+ *  open samples with Sound_NewSampleFromPool(). When those samples are
+ *  passed to Sound_FreeSample(), their memory goes back to the pool instead
+ *  of the heap, so the next sample opened from the pool can reuse it.
+ *
+ * \sa Sound_CreateSamplePool
+ * \sa Sound_NewSampleFromPool
+ * \sa Sound_DestroySamplePool
+ */
+typedef struct Sound_SamplePool Sound_SamplePool;
+
+
+/**
+ * \struct Sound_SamplePoolStats
+ * \brief How well a Sound_SamplePool is doing its job.
+ *
+ * A "hit" means an allocation was satisfied from memory the pool had cached,
+ *  a "miss" means it had to go to the heap. Samples and their decode buffers
+ *  are counted separately, since a buffer can only be reused for a request
+ *  of the same size class.
+ *
+ * \sa Sound_GetSamplePoolStats
+ */
+typedef struct
+{
+    Uint32 sample_hits;    /**< Sound_Sample structures reused. */
+    Uint32 sample_misses;  /**< Sound_Sample structures allocated. */
+    Uint32 buffer_hits;    /**< Decode buffers reused. */
+    Uint32 buffer_misses;  /**< Decode buffers allocated. */
+} Sound_SamplePoolStats;
+
+
+/**
+ * \enum Sound_ResampleQuality
+ * \brief How samples are converted to a different rate.
+ *
+ * When a sample's desired rate doesn't match the data, SDL_sound resamples
+ *  it with its own streaming filter, which keeps its history from one
+ *  Sound_Decode() call to the next. The better settings use longer filters,
+ *  which cost more CPU per frame. SOUND_RESAMPLE_SDL hands the job to
+ *  SDL_AudioCVT instead, one decoded chunk at a time, like SDL_sound always
+ *  used to.
+ *
+ * \sa Sound_SetResampleQuality
+ */
+typedef enum
+{
+    SOUND_RESAMPLE_SDL = 0,  /**< Use SDL_AudioCVT, one chunk at a time. */
+    SOUND_RESAMPLE_FAST,     /**< Short filter; cheap, some aliasing. */
+    SOUND_RESAMPLE_MEDIUM,   /**< Good quality for playback (the default). */
+    SOUND_RESAMPLE_BEST      /**< Long filter; for offline conversion. */
+} Sound_ResampleQuality;
+
+
+/**
+ * \struct Sound_PrefetchStats
+ * \brief How well a sample's read-ahead is keeping up.
+ *
+ * All sizes are in bytes of decoded audio in the sample's desired format.
+ *  If (low_water) keeps getting close to zero, or (underruns) goes up,
+ *  ask Sound_EnablePrefetch() for more milliseconds.
+ *
+ * \sa Sound_GetPrefetchStats
+ */
+typedef struct
+{
+    Uint32 capacity;   /**< Most that can be decoded ahead. */
+    Uint32 filled;     /**< Decoded and waiting right now. */
+    Uint32 low_water;  /**< Least that was waiting when a decode call came in. */
+    Uint32 underruns;  /**< Decode calls that found nothing waiting. */
+} Sound_PrefetchStats;
+
+
+/**
+ * \struct Sound_DecodeCacheStats
+ * \brief How well the decoded-audio cache is doing its job.
+ *
+ * A "hit" is a Sound_NewSampleFromFile() or Sound_NewSampleFromMem() call
+ *  that was served from the cache without decoding anything; a "miss" is
+ *  one that wasn't. The counters start at zero and are never reset; the
+ *  rest describe the cache right now.
+ *
+ * \sa Sound_GetDecodeCacheStats
+ */
+typedef struct
+{
+    Uint32 hits;       /**< Samples opened from cached audio. */
+    Uint32 misses;     /**< Samples that had to be decoded. */
+    Uint32 evictions;  /**< Entries dropped to stay under budget. */
+    Uint32 entries;    /**< Sounds in the cache now. */
+    Uint64 bytes;      /**< Decoded audio those entries hold. */
+    Uint64 budget;     /**< From Sound_SetDecodeCacheBudget(). */
+} Sound_DecodeCacheStats;
+
+
+/**
+ * \struct Sound_Stats
+ * \brief Where the time goes, for one sample or for one decoder.
+ *
+ * These are running totals. A sample's start when it's created; a decoder's
+ *  cover every sample it's decoded since Sound_Init(), including the time
+ *  spent trying to open data that turned out not to be its format. Samples
+ *  served from the decoded-audio cache only count toward their own stats.
+ *
+ * The RWops counters only see reads and seeks made while SDL_sound is
+ *  decoding, opening or seeking, and only on platforms where the compiler
+ *  supports thread-local variables; elsewhere they stay at zero.
+ *
+ * \sa Sound_GetSampleStats
+ * \sa Sound_GetDecoderStats
+ */
+typedef struct
+{
+    Uint64 bytes_read;        /**< Bytes read from the SDL_RWops. */
+    Uint64 rw_reads;          /**< SDL_RWread() calls on it. */
+    Uint64 rw_seeks;          /**< SDL_RWseek() calls on it. */
+    Uint64 frames_decoded;    /**< Sample frames the decoder produced. */
+    Uint64 decode_ns;         /**< Nanoseconds spent in the decoder. */
+    Uint64 convert_ns;        /**< Nanoseconds converting and resampling. */
+    Uint64 seeks;             /**< Rewinds and seeks. */
+    Uint64 eagains;           /**< Decodes that ended in SOUND_SAMPLEFLAG_EAGAIN. */
+    Uint32 peak_buffer_size;  /**< Largest buffer decoded into, in bytes. */
+} Sound_Stats;
+
+
 /* functions and macros... */
 
 /**
@@ -297,6 +426,64 @@ SNDDECLSPEC int SDLCALL Sound_Init(void);
 SNDDECLSPEC int SDLCALL Sound_Quit(void);
 
 
+/**
+ * \fn int Sound_SetAllocator(SDL_malloc_func malloc_fn, SDL_calloc_func calloc_fn, SDL_realloc_func realloc_fn, SDL_free_func free_fn)
+ * \brief Give SDL_sound your own memory allocator.
+ *
+ * By default, SDL_sound gets its memory from SDL_malloc() and friends. This
+ *  replaces them for everything SDL_sound allocates, including what the
+ *  decoders it's built with allocate on its behalf. Memory SDL_sound hands
+ *  to you (sample->buffer after Sound_DecodeAll(), for instance) still
+ *  belongs to SDL_sound, and shouldn't be passed to your free function
+ *  directly.
+ *
+ * Small allocations made while a decoder opens a sample are grouped into a
+ *  few larger blocks that are returned all at once when the sample is freed,
+ *  so expect fewer, bigger requests than the number of objects involved.
+ *
+ * This can only be called while the library isn't initialized, and with no
+ *  sample pools alive, since anything already allocated has to go back to
+ *  the allocator it came from. Pass NULL for all four functions to go back
+ *  to SDL's.
+ *
+ *    \param malloc_fn Replacement for SDL_malloc().
+ *    \param calloc_fn Replacement for SDL_calloc().
+ *    \param realloc_fn Replacement for SDL_realloc().
+ *    \param free_fn Replacement for SDL_free().
+ *   \return nonzero on success, zero on error. Specifics of the error
+ *           can be gleaned from Sound_GetError(). It's an error to call this
+ *           after Sound_Init(), while any sample pool hasn't been freed
+ *           yet, or to set some functions but not others.
+ *
+ * \sa Sound_GetAllocator
+ * \sa Sound_Init
+ */
+SNDDECLSPEC int SDLCALL Sound_SetAllocator(SDL_malloc_func malloc_fn,
+                                           SDL_calloc_func calloc_fn,
+                                           SDL_realloc_func realloc_fn,
+                                           SDL_free_func free_fn);
+
+
+/**
+ * \fn void Sound_GetAllocator(SDL_malloc_func *malloc_fn, SDL_calloc_func *calloc_fn, SDL_realloc_func *realloc_fn, SDL_free_func *free_fn)
+ * \brief Get the allocator set with Sound_SetAllocator().
+ *
+ * Each pointer that isn't NULL is filled in with the function SDL_sound is
+ *  using, or NULL if it's using SDL's.
+ *
+ *    \param malloc_fn Filled in with the malloc() replacement.
+ *    \param calloc_fn Filled in with the calloc() replacement.
+ *    \param realloc_fn Filled in with the realloc() replacement.
+ *    \param free_fn Filled in with the free() replacement.
+ *
+ * \sa Sound_SetAllocator
+ */
+SNDDECLSPEC void SDLCALL Sound_GetAllocator(SDL_malloc_func *malloc_fn,
+                                            SDL_calloc_func *calloc_fn,
+                                            SDL_realloc_func *realloc_fn,
+                                            SDL_free_func *free_fn);
+
+
 /**
  * \fn const Sound_DecoderInfo **Sound_AvailableDecoders(void)
  * \brief Get a list of sound formats supported by this version of SDL_sound.
@@ -367,10 +554,13 @@ SNDDECLSPEC void SDLCALL Sound_ClearError(void);
  *
  * The data is read via an SDL_RWops structure (see SDL_rwops.h in the SDL
  *  include directory), so it may be coming from memory, disk, network stream,
- *  etc. The (ext) parameter is merely a hint to determining the correct
- *  decoder; if you specify, for example, "mp3" for an extension, and one of
+ *  etc. Before asking any decoder, SDL_sound peeks at the start of the
+ *  stream for a well-known signature ("RIFF"/"WAVE", "fLaC", "OggS", etc),
+ *  and if one matches, that decoder gets first shot at the data. The (ext)
+ *  parameter is merely a hint to determining the correct decoder after
+ *  that; if you specify, for example, "mp3" for an extension, and one of
  *  the decoders lists that as a handled extension, then that decoder is given
- *  first shot at trying to claim the data for decoding. If none of the
+ *  the next shot at trying to claim the data for decoding. If none of the
  *  extensions match (or the extension is NULL), then every decoder examines
  *  the data to determine if it can handle it, until one accepts it. In such a
  *  case your SDL_RWops will need to be capable of rewinding to the start of
@@ -466,6 +656,7 @@ SNDDECLSPEC Sound_Sample * SDLCALL Sound_NewSample(SDL_RWops *rw,
  * \sa Sound_Seek
  * \sa Sound_Rewind
  * \sa Sound_FreeSample
+ * \sa Sound_SetDecodeCacheBudget
  */
 SNDDECLSPEC Sound_Sample * SDLCALL Sound_NewSampleFromMem(const Uint8 *data,
                                                       Uint32 size,
@@ -488,6 +679,10 @@ SNDDECLSPEC Sound_Sample * SDLCALL Sound_NewSampleFromMem(const Uint8 *data,
  * This can pool RWops structures, so it may fragment the heap less over time
  *  than using SDL_RWFromFile().
  *
+ * Where the platform allows it, regular files are memory-mapped rather than
+ *  read through stdio; the decoders see an SDL_RWOPS_MEMORY_RO stream over
+ *  the file's contents. Sound_SetFileMapping() turns this off.
+ *
  *    \param filename file containing sound data.
  *    \param desired Format to convert sound data into. Can usually be NULL,
  *                   if you don't need conversion.
@@ -503,6 +698,8 @@ SNDDECLSPEC Sound_Sample * SDLCALL Sound_NewSampleFromMem(const Uint8 *data,
  * \sa Sound_Seek
  * \sa Sound_Rewind
  * \sa Sound_FreeSample
+ * \sa Sound_SetFileMapping
+ * \sa Sound_SetDecodeCacheBudget
  */
 SNDDECLSPEC Sound_Sample * SDLCALL Sound_NewSampleFromFile(const char *fname,
                                                       Sound_AudioInfo *desired,
@@ -525,13 +722,229 @@ SNDDECLSPEC Sound_Sample * SDLCALL Sound_NewSampleFromFile(const char *fname,
 SNDDECLSPEC void SDLCALL Sound_FreeSample(Sound_Sample *sample);
 
 
+/**
+ * \fn Sound_SamplePool *Sound_CreateSamplePool(Uint32 max_cached)
+ * \brief Create a pool to recycle Sound_Sample memory.
+ *
+ * If you open and close lots of samples (a mixer playing short sound
+ *  effects, say), each Sound_NewSample() and Sound_FreeSample() pair costs
+ *  several trips to the heap. Samples opened with Sound_NewSampleFromPool()
+ *  hand their memory back to the pool when freed, and later samples from
+ *  the same pool reuse it.
+ *
+ * Decode buffers are kept in power-of-two size classes (from 1 kilobyte to
+ *  4 megabytes), so a buffer can be reused by any sample that asks for a
+ *  bufferSize in the same class. Larger buffers aren't pooled.
+ *
+ * Pools are thread safe, and don't depend on Sound_Init(); they can outlive
+ *  a Sound_Quit()/Sound_Init() cycle.
+ *
+ *    \param max_cached The most free samples the pool will hold on to, and
+ *                      the most free buffers it will keep in each size
+ *                      class. Anything past that goes back to the heap.
+ *   \return a new pool, or NULL on error. Specifics of the error can be
+ *           gleaned from Sound_GetError().
+ *
+ * \sa Sound_NewSampleFromPool
+ * \sa Sound_DestroySamplePool
+ * \sa Sound_GetSamplePoolStats
+ */
+SNDDECLSPEC Sound_SamplePool * SDLCALL Sound_CreateSamplePool(Uint32 max_cached);
+
+
+/**
+ * \fn void Sound_DestroySamplePool(Sound_SamplePool *pool)
+ * \brief Dispose of a Sound_SamplePool.
+ *
+ * This frees all the memory the pool has cached. Samples from this pool
+ *  that are still open remain valid; their memory goes back to the heap
+ *  when you Sound_FreeSample() them, and the pool itself is released once
+ *  the last one is freed. Don't open new samples from the pool after this.
+ *
+ *    \param pool The pool to destroy. NULL is a safe no-op.
+ *
+ * \sa Sound_CreateSamplePool
+ */
+SNDDECLSPEC void SDLCALL Sound_DestroySamplePool(Sound_SamplePool *pool);
+
+
+/**
+ * \fn Sound_Sample *Sound_NewSampleFromPool(Sound_SamplePool *pool, SDL_RWops *rw, const char *ext, Sound_AudioInfo *desired, Uint32 bufferSize)
+ * \brief Start decoding a new sound sample, using memory from a pool.
+ *
+ * This is identical to Sound_NewSample(), but memory for the sample and its
+ *  decode buffer comes from (pool) when possible, and goes back to (pool)
+ *  when the sample is passed to Sound_FreeSample().
+ *
+ * Note that a recycled decode buffer is not cleared before it's reused.
+ *
+ *    \param pool Sound_SamplePool to recycle memory from.
+ *    \param rw SDL_RWops with sound data.
+ *    \param ext File extension normally associated with a data format.
+ *               Can usually be NULL.
+ *    \param desired Format to convert sound data into. Can usually be NULL,
+ *                   if you don't need conversion.
+ *    \param bufferSize Size, in bytes, to allocate for the decoding buffer.
+ *   \return Sound_Sample pointer, which is used as a handle to several other
+ *           SDL_sound APIs. NULL on error. If error, use
+ *           Sound_GetError() to see what went wrong.
+ *
+ * \sa Sound_NewSample
+ * \sa Sound_CreateSamplePool
+ * \sa Sound_FreeSample
+ */
+SNDDECLSPEC Sound_Sample * SDLCALL Sound_NewSampleFromPool(Sound_SamplePool *pool,
+                                                      SDL_RWops *rw,
+                                                      const char *ext,
+                                                      Sound_AudioInfo *desired,
+                                                      Uint32 bufferSize);
+
+
+/**
+ * \fn void Sound_GetSamplePoolStats(Sound_SamplePool *pool, Sound_SamplePoolStats *stats)
+ * \brief Find out how often a pool was able to recycle memory.
+ *
+ * The counters start at zero when the pool is created, and are never reset.
+ *
+ *    \param pool The pool to query.
+ *    \param stats Filled in with the pool's current counters.
+ *
+ * \sa Sound_SamplePoolStats
+ */
+SNDDECLSPEC void SDLCALL Sound_GetSamplePoolStats(Sound_SamplePool *pool,
+                                                  Sound_SamplePoolStats *stats);
+
+
+/**
+ * \fn void Sound_SetResampleQuality(Sound_ResampleQuality quality)
+ * \brief Choose how samples opened from now on will be resampled.
+ *
+ * This only matters for samples whose desired rate differs from the rate
+ *  of their data, and only affects samples created after the call; ones
+ *  that are already open keep the resampler they started with. The default
+ *  is SOUND_RESAMPLE_MEDIUM.
+ *
+ *    \param quality The resampling method to use.
+ *
+ * \sa Sound_ResampleQuality
+ * \sa Sound_GetResampleQuality
+ */
+SNDDECLSPEC void SDLCALL Sound_SetResampleQuality(Sound_ResampleQuality quality);
+
+
+/**
+ * \fn Sound_ResampleQuality Sound_GetResampleQuality(void)
+ * \brief Find out how new samples will be resampled.
+ *
+ *   \return the current setting from Sound_SetResampleQuality().
+ *
+ * \sa Sound_SetResampleQuality
+ */
+SNDDECLSPEC Sound_ResampleQuality SDLCALL Sound_GetResampleQuality(void);
+
+
+/**
+ * \fn void Sound_SetFileMapping(int enable)
+ * \brief Choose whether Sound_NewSampleFromFile() memory-maps its files.
+ *
+ * On by default, on platforms with mmap(). A mapped file is read straight
+ *  out of the OS's page cache, with no stdio buffering or system call per
+ *  read, and decoders that need the whole file in memory use the mapping
+ *  instead of a copy. Files that can't be mapped (pipes, empty files, files
+ *  over 2 gigabytes) quietly fall back to stdio either way.
+ *
+ * Turn this off if your files might be truncated by another process while
+ *  they're open: touching the vanished part of a mapping crashes the
+ *  program (SIGBUS) instead of returning a read error. This only affects
+ *  samples created after the call.
+ *
+ *    \param enable Non-zero to map files, zero to always use stdio.
+ *
+ * \sa Sound_GetFileMapping
+ * \sa Sound_NewSampleFromFile
+ */
+SNDDECLSPEC void SDLCALL Sound_SetFileMapping(int enable);
+
+
+/**
+ * \fn int Sound_GetFileMapping(void)
+ * \brief Find out whether Sound_NewSampleFromFile() memory-maps its files.
+ *
+ *   \return the current setting from Sound_SetFileMapping().
+ *
+ * \sa Sound_SetFileMapping
+ */
+SNDDECLSPEC int SDLCALL Sound_GetFileMapping(void);
+
+
+/**
+ * \fn void Sound_SetDecodeCacheBudget(Uint64 bytes)
+ * \brief Turn on the decoded-audio cache, and set how big it can get.
+ *
+ * With the cache on, a sample opened with Sound_NewSampleFromFile() or
+ *  Sound_NewSampleFromMem() that's then fully decoded, from the start, with
+ *  Sound_DecodeAll() or Sound_DecodeAllParallel() leaves a copy of the
+ *  decoded audio in the cache. Opening the same sound again, with the same
+ *  (desired) format and resampling quality, skips the decoder entirely:
+ *  the new sample reads the cached copy, and decoding it is a memcpy().
+ *
+ * Files are recognized by (filename) as given, so call
+ *  Sound_FlushDecodeCache() if they change on disk. Memory sources are
+ *  recognized by a hash of their contents (and their extension).
+ *
+ * A sample opened from the cache reports the decoder that originally
+ *  decoded the sound, and its (actual) format is the same as its (desired)
+ *  format. Sound_SeekFrames() and Sound_TellFrames() still count in the
+ *  original file's frames, so loop points don't move with the cache on.
+ *
+ * When the cache goes over (bytes), the least recently used sounds are
+ *  dropped; anything still being read by an open sample stays in memory
+ *  until that sample is freed. Sounds bigger than (bytes) aren't cached.
+ *  Zero, the default, turns the cache off and empties it. Sound_Quit()
+ *  empties it too, but keeps the budget.
+ *
+ *    \param bytes The most decoded audio to keep, in bytes.
+ *
+ * \sa Sound_FlushDecodeCache
+ * \sa Sound_GetDecodeCacheStats
+ */
+SNDDECLSPEC void SDLCALL Sound_SetDecodeCacheBudget(Uint64 bytes);
+
+
+/**
+ * \fn void Sound_FlushDecodeCache(void)
+ * \brief Empty the decoded-audio cache.
+ *
+ * Samples already open from the cache keep working.
+ *
+ * \sa Sound_SetDecodeCacheBudget
+ */
+SNDDECLSPEC void SDLCALL Sound_FlushDecodeCache(void);
+
+
+/**
+ * \fn void Sound_GetDecodeCacheStats(Sound_DecodeCacheStats *stats)
+ * \brief Find out how the decoded-audio cache is being used.
+ *
+ *    \param stats Filled in with the cache's current counters.
+ *
+ * \sa Sound_DecodeCacheStats
+ * \sa Sound_SetDecodeCacheBudget
+ */
+SNDDECLSPEC void SDLCALL Sound_GetDecodeCacheStats(Sound_DecodeCacheStats *stats);
+
+
 /**
  * \fn Sint32 Sound_GetDuration(Sound_Sample *sample)
  * \brief Retrieve total play time of sample, in milliseconds.
  *
- * Report total time length of sample, in milliseconds. This is a fast
- *  call. Duration is calculated during Sound_NewSample*, so this is just
- *  an accessor into otherwise opaque data.
+ * Report total time length of sample, in milliseconds. This is usually a
+ *  fast call: most formats work out the duration during Sound_NewSample*,
+ *  so this is just an accessor into otherwise opaque data. A few (Ogg
+ *  Vorbis, and MP3 files without a Xing/Info or VBRI header) have to seek
+ *  around the file to find out, so they wait until the first time you ask;
+ *  that first call costs some I/O, and later ones are fast again. The
+ *  sample's decoding position isn't affected.
  *
  * Please note that not all formats can determine a total time, some can't
  *  be exact without fully decoding the data, and thus will estimate the
@@ -601,6 +1014,62 @@ SNDDECLSPEC int SDLCALL Sound_SetBufferSize(Sound_Sample *sample,
 SNDDECLSPEC Uint32 SDLCALL Sound_Decode(Sound_Sample *sample);
 
 
+/**
+ * \fn Uint32 Sound_DecodeInto(Sound_Sample *sample, void *buffer, Uint32 bufsize)
+ * \brief Decode more of the sound data into memory you provide.
+ *
+ * This is Sound_Decode(), except the decoded data goes straight into
+ *  (buffer) instead of sample->buffer, so you don't have to copy it out
+ *  again (into an audio device's ring buffer, for example). If no format
+ *  conversion is needed, the decoder writes directly into (buffer). If
+ *  conversion is needed, the decoder writes to (buffer) and the conversion
+ *  is done there, in place; since conversion can grow the data, less than
+ *  (bufsize) bytes are decoded per call in that case, so that the result
+ *  still fits. If conversion shrinks the data (a decoder that produces
+ *  32-bit samples, decoded to 16-bit), there's no room to decode in place,
+ *  so SDL_sound decodes into a buffer of its own and copies the result to
+ *  (buffer). sample->buffer is not touched.
+ *
+ * Only whole sample frames are decoded. If (bufsize) is too small to hold
+ *  even one frame after conversion, this fails and returns zero.
+ *
+ *    \param sample Do more decoding to this Sound_Sample.
+ *    \param buffer Memory to decode into, in the desired format.
+ *    \param bufsize Size, in bytes, of (buffer).
+ *   \return number of bytes decoded into (buffer). If it is zero, or less
+ *           than you expected, check sample->flags to see what the current
+ *           state of the sample is (EOF, error, read again).
+ *
+ * \sa Sound_Decode
+ * \sa Sound_DecodeFramesInto
+ */
+SNDDECLSPEC Uint32 SDLCALL Sound_DecodeInto(Sound_Sample *sample,
+                                            void *buffer, Uint32 bufsize);
+
+
+/**
+ * \fn Uint32 Sound_DecodeFramesInto(Sound_Sample *sample, void *buffer, Uint32 frames)
+ * \brief Decode more of the sound data into memory you provide, by frame.
+ *
+ * This is Sound_DecodeInto(), but sized in sample frames (one sample for
+ *  each channel, in the desired format) instead of bytes, which is usually
+ *  what an audio callback is asked for.
+ *
+ *    \param sample Do more decoding to this Sound_Sample.
+ *    \param buffer Memory to decode into, in the desired format. Must have
+ *                  room for (frames) frames.
+ *    \param frames Number of sample frames (buffer) can hold.
+ *   \return number of frames decoded into (buffer). If it is zero, or less
+ *           than you expected, check sample->flags to see what the current
+ *           state of the sample is (EOF, error, read again).
+ *
+ * \sa Sound_DecodeInto
+ */
+SNDDECLSPEC Uint32 SDLCALL Sound_DecodeFramesInto(Sound_Sample *sample,
+                                                  void *buffer,
+                                                  Uint32 frames);
+
+
 /**
  * \fn Uint32 Sound_DecodeAll(Sound_Sample *sample)
  * \brief Decode the remainder of the sound data in a Sound_Sample.
@@ -619,12 +1088,17 @@ SNDDECLSPEC Uint32 SDLCALL Sound_Decode(Sound_Sample *sample);
  *
  * When decoding the sample in its entirety, the work is done one buffer at a
  *  time. That is, sound is decoded in sample->buffer_size blocks, and
- *  appended to a continually-growing buffer until the decoding completes.
- *  That means that this function will need enough RAM to hold approximately
- *  sample->buffer_size bytes plus the complete decoded sample at most. The
- *  larger your buffer size, the less overhead this function needs, but beware
- *  the possibility of paging to disk. Best to make this user-configurable if
- *  the sample isn't specific and small.
+ *  appended to a buffer until the decoding completes. If the decoder knows
+ *  the sample's duration, that buffer is allocated once, up front, at the
+ *  size Sound_GetDecodedSize() reports. Otherwise it grows geometrically, and
+ *  is trimmed to fit once decoding is done. That means that this function
+ *  will need enough RAM to hold approximately sample->buffer_size bytes plus
+ *  the complete decoded sample (and, for unknown lengths, up to half again
+ *  that while growing). The larger your buffer size, the less overhead this
+ *  function needs, but beware the possibility of paging to disk. Best to make
+ *  this user-configurable if the sample isn't specific and small.
+ *
+ * If you'd rather manage that memory yourself, see Sound_DecodeAllToBuffer().
  *
  *    \param sample Do all decoding for this Sound_Sample.
  *   \return number of bytes decoded into sample->buffer. You should check
@@ -632,11 +1106,101 @@ SNDDECLSPEC Uint32 SDLCALL Sound_Decode(Sound_Sample *sample);
  *           (EOF, error, read again).
  *
  * \sa Sound_Decode
+ * \sa Sound_DecodeAllToBuffer
  * \sa Sound_SetBufferSize
  */
 SNDDECLSPEC Uint32 SDLCALL Sound_DecodeAll(Sound_Sample *sample);
 
 
+/**
+ * \fn Uint32 Sound_DecodeAllParallel(Sound_Sample *sample, int nthreads)
+ * \brief Decode the remainder of a Sound_Sample, using several threads.
+ *
+ * This does exactly what Sound_DecodeAll() does, with the same results,
+ *  but splits the work across up to (nthreads) threads (the calling thread
+ *  included). The rest of the sample is cut into one run per thread; each
+ *  run is decoded by a separate instance of the decoder, which seeks to the
+ *  start of its run and decodes straight into its part of the new
+ *  sample->buffer.
+ *
+ * That only works if the decoder knows the exact length of the data and can
+ *  seek to any sample frame without decoding everything before it, which
+ *  is true of uncompressed formats (WAV, AIFF, AU, RAW), MS-ADPCM WAVs and
+ *  FLAC. It also has to be the same data no matter where decoding starts,
+ *  so samples that are being resampled (sample->desired.rate differs from
+ *  sample->actual.rate) don't qualify either. Anything that doesn't qualify,
+ *  or is too short to be worth the trouble, just goes to Sound_DecodeAll().
+ *
+ * Each thread needs the source data, too. If the sample was created from
+ *  memory, they share it; otherwise the whole source is read into memory
+ *  for the duration of this call, on top of the decoded sample.
+ *
+ *    \param sample Do all decoding for this Sound_Sample.
+ *    \param nthreads The most threads to use. Zero or less means one per
+ *                    CPU core, as reported by SDL_GetCPUCount().
+ *   \return number of bytes decoded into sample->buffer. You should check
+ *           sample->flags to see what the current state of the sample is
+ *           (EOF, error, read again).
+ *
+ * \sa Sound_DecodeAll
+ */
+SNDDECLSPEC Uint32 SDLCALL Sound_DecodeAllParallel(Sound_Sample *sample,
+                                                   int nthreads);
+
+
+/**
+ * \fn Uint32 Sound_DecodeAllToBuffer(Sound_Sample *sample, void *buffer, Uint32 bufsize)
+ * \brief Decode the remainder of a Sound_Sample into memory you provide.
+ *
+ * This works like Sound_DecodeAll(), but instead of allocating a new buffer
+ *  and swapping it into the sample, the decoded data is written to (buffer),
+ *  which you own. sample->buffer and sample->buffer_size are left alone;
+ *  decoding happens directly in (buffer), as with Sound_DecodeInto().
+ *
+ * Decoding is done in sample->buffer_size blocks, and a block is only
+ *  decoded if there's at least that much room left in (buffer). If the
+ *  buffer fills up before the end of the stream, this returns without
+ *  setting SOUND_SAMPLEFLAG_EOF, and you can call it again with more space
+ *  to pick up where it left off. Sound_GetDecodedSize() will tell you how
+ *  much space to provide to get everything in one call, if that's knowable.
+ *
+ *    \param sample Do all decoding for this Sound_Sample.
+ *    \param buffer Memory to decode into.
+ *    \param bufsize Size, in bytes, of (buffer).
+ *   \return number of bytes decoded into (buffer). You should check
+ *           sample->flags to see what the current state of the sample is
+ *           (EOF, error, read again).
+ *
+ * \sa Sound_DecodeAll
+ * \sa Sound_GetDecodedSize
+ */
+SNDDECLSPEC Uint32 SDLCALL Sound_DecodeAllToBuffer(Sound_Sample *sample,
+                                                   void *buffer,
+                                                   Uint32 bufsize);
+
+
+/**
+ * \fn Uint32 Sound_GetDecodedSize(Sound_Sample *sample)
+ * \brief Get the space needed to hold a fully-decoded sample.
+ *
+ * This uses the sample's duration (see Sound_GetDuration()) and the desired
+ *  audio format to work out how many bytes a full decode will produce, plus
+ *  enough slack for one more Sound_Decode() call. It's meant for sizing the
+ *  buffer you pass to Sound_DecodeAllToBuffer(), and it's what
+ *  Sound_DecodeAll() uses to allocate its buffer up front.
+ *
+ * This is a fast call; nothing is decoded.
+ *
+ *    \param sample Sound_Sample to examine.
+ *   \return number of bytes needed, or zero if it can't be determined (the
+ *           decoder doesn't know the duration, or it's more than 4 gigs).
+ *
+ * \sa Sound_DecodeAllToBuffer
+ * \sa Sound_GetDuration
+ */
+SNDDECLSPEC Uint32 SDLCALL Sound_GetDecodedSize(Sound_Sample *sample);
+
+
 /**
  * \fn int Sound_Rewind(Sound_Sample *sample)
  * \brief Rewind a sample to the start.
@@ -705,6 +1269,9 @@ SNDDECLSPEC int SDLCALL Sound_Rewind(Sound_Sample *sample);
  *  decoding loop can pick up.
  *
  * On success, ERROR, EOF, and EAGAIN are cleared from sample->flags.
+ *  Seeking exactly to the end of the sample succeeds, with nothing left to
+ *  decode: EOF is set right away if the length is known, or by the next
+ *  Sound_Decode() if it isn't. Seeking past the end fails.
  *
  *    \param sample The Sound_Sample to seek.
  *    \param ms The new position, in milliseconds from start of sample.
@@ -715,6 +1282,230 @@ SNDDECLSPEC int SDLCALL Sound_Rewind(Sound_Sample *sample);
  */
 SNDDECLSPEC int SDLCALL Sound_Seek(Sound_Sample *sample, Uint32 ms);
 
+
+/**
+ * \fn int Sound_SeekFrames(Sound_Sample *sample, Uint64 frame)
+ * \brief Seek to an exact sample frame.
+ *
+ * This is Sound_Seek(), but the position is a sample frame (one sample for
+ *  each channel) counted from the start of the sample, at the data's own
+ *  rate (sample->actual.rate), not the desired one. Milliseconds can't
+ *  name every frame, so use this for sample-accurate loop points and the
+ *  like. It has the same requirements and failure cases as Sound_Seek().
+ *
+ * Most decoders land exactly on the frame you ask for. A few formats can
+ *  only seek by milliseconds; for those, this rounds down to the nearest
+ *  millisecond, and Sound_TellFrames() will tell you where you ended up.
+ *
+ * A sample opened from the decoded-audio cache holds audio that was
+ *  already converted, maybe to another rate, but its frames still count at
+ *  the rate of the file it was decoded from. The same frame number lands
+ *  on the same spot whether the cache was hit or not; if the rate was
+ *  changed, that spot is the nearest converted frame.
+ *
+ * On success, ERROR, EOF, and EAGAIN are cleared from sample->flags.
+ *  As with Sound_Seek(), seeking to the frame just past the last one
+ *  succeeds and leaves the sample at EOF; Sound_TellFrames() then reports
+ *  the total.
+ *
+ *    \param sample The Sound_Sample to seek.
+ *    \param frame The new position, in sample frames from start of sample.
+ *   \return nonzero on success, zero on error. Specifics of the
+ *           error can be gleaned from Sound_GetError().
+ *
+ * \sa Sound_Seek
+ * \sa Sound_TellFrames
+ */
+SNDDECLSPEC int SDLCALL Sound_SeekFrames(Sound_Sample *sample, Uint64 frame);
+
+
+/**
+ * \fn Sint64 Sound_TellFrames(Sound_Sample *sample)
+ * \brief Find out where in a sample decoding will continue.
+ *
+ * This reports the sample frame, at the data's own rate
+ *  (sample->actual.rate), that the next Sound_Decode() will start with. If
+ *  the sample is being resampled, that's the frame the next output frame
+ *  comes from, rounded down. Samples from the decoded-audio cache count in
+ *  the original file's frames, as Sound_SeekFrames() does. This is a fast
+ *  call.
+ *
+ *    \param sample The Sound_Sample to query.
+ *   \return the current position in sample frames from start of sample,
+ *           or -1 on error.
+ *
+ * \sa Sound_SeekFrames
+ */
+SNDDECLSPEC Sint64 SDLCALL Sound_TellFrames(Sound_Sample *sample);
+
+
+/**
+ * \fn int Sound_BuildSeekIndex(Sound_Sample *sample, int background)
+ * \brief Scan the rest of a sample's data so any seek in it is fast.
+ *
+ * Some formats (Ogg Vorbis, and FLAC without a SEEKTABLE) have no table of
+ *  contents, so a seek has to hunt through the file for the right spot,
+ *  which takes a lot of scattered reads or decoding. SDL_sound remembers
+ *  where everything it has already decoded is, so seeking back into that
+ *  is quick; this reads through the rest of the data up front, so seeking
+ *  anywhere is. It doesn't decode anything, or change where decoding
+ *  continues.
+ *
+ * If (background) is zero, the whole scan is done before this returns.
+ *  Otherwise it's done a little at a time: by the read-ahead thread when it
+ *  has nothing else to do, if Sound_EnablePrefetch() is on for this sample,
+ *  and after each Sound_Decode() if not. Seeks use whatever has been
+ *  scanned so far, and hunt through the rest.
+ *
+ * Formats that seek quickly anyway have nothing to do here, and this just
+ *  returns success.
+ *
+ *    \param sample The Sound_Sample to scan.
+ *    \param background Nonzero to spread the scan out instead of doing it
+ *                      now.
+ *   \return nonzero on success, zero on error. Specifics of the
+ *           error can be gleaned from Sound_GetError().
+ *
+ * \sa Sound_SeekFrames
+ * \sa Sound_EnablePrefetch
+ */
+SNDDECLSPEC int SDLCALL Sound_BuildSeekIndex(Sound_Sample *sample, int background);
+
+
+/**
+ * \fn void Sound_SetSeekIndexGranularity(Uint32 ms)
+ * \brief Choose how finely samples opened from now on index seek points.
+ *
+ * Some decoders remember where they've been in a file, and where
+ *  Sound_BuildSeekIndex() has looked, so seeking there later is quick.
+ *  Right now that's FLAC, for files without a SEEKTABLE. This sets how far
+ *  apart those remembered spots can be: a seek lands on the closest one
+ *  before its target and works forward from there, so fewer spots take
+ *  less memory, but make seeks do more work. The default, zero, remembers
+ *  every FLAC frame (about 16 bytes for every tenth of a second or so).
+ *  This only affects samples created after the call.
+ *
+ *    \param ms The least audio, in milliseconds, between remembered spots.
+ *
+ * \sa Sound_GetSeekIndexGranularity
+ * \sa Sound_BuildSeekIndex
+ */
+SNDDECLSPEC void SDLCALL Sound_SetSeekIndexGranularity(Uint32 ms);
+
+
+/**
+ * \fn Uint32 Sound_GetSeekIndexGranularity(void)
+ * \brief Find out how finely new samples will index seek points.
+ *
+ *   \return the current setting from Sound_SetSeekIndexGranularity().
+ *
+ * \sa Sound_SetSeekIndexGranularity
+ */
+SNDDECLSPEC Uint32 SDLCALL Sound_GetSeekIndexGranularity(void);
+
+
+/**
+ * \fn int Sound_EnablePrefetch(Sound_Sample *sample, Uint32 ms)
+ * \brief Decode a sample ahead of time, on a background thread.
+ *
+ * Normally, Sound_Decode() and friends run the decoder (and read the file)
+ *  right then, on whatever thread calls them. If that's your audio
+ *  callback, a slow disk can make it miss its deadline. With read-ahead on,
+ *  a separate thread keeps up to (ms) milliseconds of audio decoded and
+ *  converted in advance, and the decode calls just copy it out, without
+ *  ever blocking on the decoder, the disk, or a lock.
+ *
+ * If the read-ahead hasn't got anything ready when you ask for it, the
+ *  decode call returns zero and sets SOUND_SAMPLEFLAG_EAGAIN: try again
+ *  later (and maybe fill in with silence meanwhile). It may also return
+ *  less than you asked for, if that's all that's ready. Sound_GetPrefetchStats()
+ *  tells you how close to running dry it has come.
+ *
+ * Seeking and rewinding throw away what was read ahead and start over from
+ *  the new position. Sound_SetBufferSize() keeps it. Sound_DecodeAll() and
+ *  Sound_DecodeAllToBuffer() turn read-ahead off, since they want
+ *  everything at once anyhow. So does calling this with (ms) set to zero;
+ *  either way, what was already decoded ahead is still handed out first.
+ *
+ * While read-ahead is on, the sample belongs to the read-ahead thread
+ *  and the one thread you decode from; don't call into it from others.
+ *
+ *    \param sample The Sound_Sample to read ahead.
+ *    \param ms How much audio to keep ready, in milliseconds. Zero turns
+ *              read-ahead off. It's always at least two sample->buffer_size
+ *              blocks.
+ *   \return nonzero on success, zero on error. Specifics of the
+ *           error can be gleaned from Sound_GetError().
+ *
+ * \sa Sound_GetPrefetchStats
+ */
+SNDDECLSPEC int SDLCALL Sound_EnablePrefetch(Sound_Sample *sample, Uint32 ms);
+
+
+/**
+ * \fn int Sound_GetPrefetchStats(Sound_Sample *sample, Sound_PrefetchStats *stats)
+ * \brief Find out how a sample's read-ahead is doing.
+ *
+ * Call this from the thread you decode on. Seeking or rewinding the sample
+ *  starts the counters over.
+ *
+ *    \param sample The Sound_Sample to query.
+ *    \param stats Filled in with the current numbers, or zeros if the
+ *                 sample isn't reading ahead.
+ *   \return nonzero if the sample is reading ahead, zero otherwise.
+ *
+ * \sa Sound_PrefetchStats
+ * \sa Sound_EnablePrefetch
+ */
+SNDDECLSPEC int SDLCALL Sound_GetPrefetchStats(Sound_Sample *sample,
+                                               Sound_PrefetchStats *stats);
+
+
+/**
+ * \fn int Sound_GetSampleStats(Sound_Sample *sample, Sound_Stats *stats)
+ * \brief Find out how much work a sample has been.
+ *
+ * This includes work done for the sample by read-ahead (see
+ *  Sound_EnablePrefetch()) and by Sound_DecodeAllParallel()'s threads. It's
+ *  safe to call while read-ahead is running.
+ *
+ * SDL_sound can be built without statistics (with SOUND_STATS defined to
+ *  zero), in which case this fails and (stats) is zeroed.
+ *
+ *    \param sample The Sound_Sample to report on.
+ *    \param stats Filled in with the sample's totals.
+ *   \return nonzero on success, zero on error. Specifics of the error
+ *           can be gleaned from Sound_GetError().
+ *
+ * \sa Sound_Stats
+ * \sa Sound_GetDecoderStats
+ */
+SNDDECLSPEC int SDLCALL Sound_GetSampleStats(Sound_Sample *sample,
+                                             Sound_Stats *stats);
+
+
+/**
+ * \fn int Sound_GetDecoderStats(const Sound_DecoderInfo *decoder, Sound_Stats *stats)
+ * \brief Find out how much work a decoder has done since Sound_Init().
+ *
+ * (decoder) is one of the entries from Sound_AvailableDecoders(), or a
+ *  sample's (decoder) field. Pass NULL to get the totals for all decoders.
+ *  (peak_buffer_size) is the largest of any one sample's.
+ *
+ * SDL_sound can be built without statistics (with SOUND_STATS defined to
+ *  zero), in which case this fails and (stats) is zeroed.
+ *
+ *    \param decoder The decoder to report on, or NULL for all of them.
+ *    \param stats Filled in with the decoder's totals.
+ *   \return nonzero on success, zero on error. Specifics of the error
+ *           can be gleaned from Sound_GetError().
+ *
+ * \sa Sound_Stats
+ * \sa Sound_GetSampleStats
+ */
+SNDDECLSPEC int SDLCALL Sound_GetDecoderStats(const Sound_DecoderInfo *decoder,
+                                              Sound_Stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
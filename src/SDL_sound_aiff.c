@@ -24,6 +24,13 @@
  * For instance, it only makes a token attempt at implementing the AIFF-C
  * standard; basically the parts of it that I can easily understand and test.
  * It's a start, though.
+ *
+ * Of AIFF-C, we handle big-endian PCM ('NONE', 'twos', 'in24', 'in32'),
+ * little-endian PCM ('sowt'), float ('fl32'/'FL32', 'fl64'/'FL64'), 8-bit
+ * unsigned ('raw '), µ-law and A-law ('ulaw', 'alaw'), and Apple's IMA4
+ * ADPCM ('ima4'). Anything that isn't already in a format SDL can play is
+ * byteswapped/unpacked as it's read, in the same pass, so there's no
+ * second trip through SDL_ConvertAudio just to fix the byte order.
  */
 
 #define __SDL_SOUND_INTERNAL__
@@ -41,30 +48,28 @@ typedef struct S_AIFF_FMT_T
     Uint32 total_bytes;
     Uint32 data_starting_offset;
 
+    Uint32 sample_frame_size;   /* bytes per frame that read() outputs.   */
+    Uint32 stored_frame_size;   /* bytes per frame in the SSND chunk.     */
+
+        /* byteswaps/unpacks what's stored into actual.format, if needed. */
+    Sound_ConvertFn convert;
+
     void (*free)(struct S_AIFF_FMT_T *fmt);
     Uint32 (*read_sample)(Sound_Sample *sample);
     int (*rewind_sample)(Sound_Sample *sample);
-    int (*seek_sample)(Sound_Sample *sample, Uint32 ms);
+    int (*seek_sample)(Sound_Sample *sample, Uint64 frame);
 
-
-#if 0
-/*
-   this is ripped from wav.c as ann example of format-specific data.
-   please replace with something more appropriate when the need arises.
-*/
     union
     {
         struct
         {
-            Uint16 cbSize;
-            Uint16 wSamplesPerBlock;
-            Uint16 wNumCoef;
-            ADPCMCOEFSET *aCoeff;
-        } adpcm;
+            Uint8 *block;     /* one raw packet, 34 bytes per channel. */
+            Sint16 *decoded;  /* one decoded packet, for partial reads. */
+            Uint32 frames_left_in_block;
+        } ima4;
 
         /* put other format-specific data here... */
     } fmt;
-#endif
 } fmt_t;
 
 
@@ -92,6 +97,18 @@ typedef struct
 
 /* format/compression types... */
 #define noneID 0x454E4F4E  /* "NONE", in ascii. */
+#define twosID 0x736F7774  /* "twos", in ascii. */
+#define in24ID 0x34326E69  /* "in24", in ascii. */
+#define in32ID 0x32336E69  /* "in32", in ascii. */
+#define sowtID 0x74776F73  /* "sowt", in ascii. */
+#define fl32ID 0x32336C66  /* "fl32", in ascii. */
+#define FL32ID 0x32334C46  /* "FL32", in ascii. */
+#define fl64ID 0x34366C66  /* "fl64", in ascii. */
+#define FL64ID 0x34364C46  /* "FL64", in ascii. */
+#define rawID  0x20776172  /* "raw ", in ascii. */
+#define ulawID 0x77616C75  /* "ulaw", in ascii. */
+#define alawID 0x77616C61  /* "alaw", in ascii. */
+#define ima4ID 0x34616D69  /* "ima4", in ascii. */
 
 typedef struct
 {
@@ -102,8 +119,8 @@ typedef struct
     Uint16 sampleSize;
     Uint32 sampleRate;
         /*
-         * We don't handle AIFF-C compressed audio yet, but for those
-         * interested the allowed compression types are supposed to be
+         * We only handle the AIFF-C types listed at the top of this file.
+         * The original spec's compression types are supposed to be
          *
          *   compressionType   compressionName   meaning
          *   ---------------------------------------------------------------
@@ -195,10 +212,11 @@ static int read_comm_chunk(SDL_RWops *rw, comm_t *comm)
                          + sizeof(comm->sampleSize)
                          + sizeof(sampleRate))
     {
+        /* it's a four-character code; compare it like the chunk IDs. */
         if (SDL_RWread(rw, &comm->compressionType,
                        sizeof (comm->compressionType), 1) != 1)
             return 0;
-        comm->compressionType = SDL_SwapBE32(comm->compressionType);
+        comm->compressionType = SDL_SwapLE32(comm->compressionType);
     } /* if */
     else
     {
@@ -257,6 +275,65 @@ static int read_ssnd_chunk(SDL_RWops *rw, ssnd_t *ssnd)
  * Normal, uncompressed aiff handler...                                      *
  *****************************************************************************/
 
+#define AIFF_MAX_STORED_FRAME (8 * 255)  /* fl64, most channels we take. */
+
+/*
+ * Sound_Decode() lands here for uncompressed AIFFs that aren't stored in
+ *  something we can hand out as-is (big-endian on a little-endian box,
+ *  24-bit, float64, etc). We read whole frames into the start of the buffer
+ *  and fmt->convert() byteswaps, widens or narrows them in place.
+ */
+static Uint32 read_sample_fmt_convert(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    aiff_t *a = (aiff_t *) internal->decoder_private;
+    fmt_t *fmt = &a->fmt;
+    const Uint32 stored = fmt->stored_frame_size;
+    const Uint32 biggest = (stored > fmt->sample_frame_size) ?
+                            stored : fmt->sample_frame_size;
+    const Uint32 avail = ((Uint32) a->bytesLeft) / stored;
+    Uint32 max = internal->buffer_size / biggest;
+    Uint32 frames;
+
+    if (avail == 0)  /* seeked right to the end. */
+    {
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+        return 0;
+    } /* if */
+
+    SDL_assert(internal->buffer_size >= fmt->sample_frame_size);
+
+    if (max == 0)  /* can't fit a stored frame; unpack one on the side. */
+    {
+        Uint8 scratch[AIFF_MAX_STORED_FRAME];
+        SDL_assert(stored <= sizeof (scratch));
+        max = 1;
+        frames = (Uint32) SDL_RWread(internal->rw, scratch, stored, 1);
+        fmt->convert(scratch, scratch, frames, sample->actual.channels);
+        SDL_memcpy(internal->buffer, scratch, frames * fmt->sample_frame_size);
+    } /* if */
+    else
+    {
+        if (max > avail)
+            max = avail;
+        frames = (Uint32) SDL_RWread(internal->rw, internal->buffer, stored, max);
+        fmt->convert(internal->buffer, internal->buffer, frames,
+                     sample->actual.channels);
+    } /* else */
+
+    a->bytesLeft -= frames * stored;
+
+    if ((frames == 0) || (((Uint32) a->bytesLeft) < stored))
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+
+        /* (next call this EAGAIN may turn into an EOF or error.) */
+    else if (frames < max)
+        sample->flags |= SOUND_SAMPLEFLAG_EAGAIN;
+
+    return frames * fmt->sample_frame_size;
+} /* read_sample_fmt_convert */
+
+
 static Uint32 read_sample_fmt_normal(Sound_Sample *sample)
 {
     Uint32 retval;
@@ -265,7 +342,11 @@ static Uint32 read_sample_fmt_normal(Sound_Sample *sample)
     Uint32 max = (internal->buffer_size < (Uint32) a->bytesLeft) ?
                     internal->buffer_size : (Uint32) a->bytesLeft;
 
-    SDL_assert(max > 0);
+    if (max == 0)  /* seeked right to the end. */
+    {
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+        return 0;
+    } /* if */
 
         /*
          * We don't actually do any decoding, so we read the AIFF data
@@ -297,16 +378,20 @@ static int rewind_sample_fmt_normal(Sound_Sample *sample)
 } /* rewind_sample_fmt_normal */
 
 
-static int seek_sample_fmt_normal(Sound_Sample *sample, Uint32 ms)
+static int seek_sample_fmt_normal(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     aiff_t *a = (aiff_t *) internal->decoder_private;
     fmt_t *fmt = &a->fmt;
-    int offset = __Sound_convertMsToBytePos(&sample->actual, ms);
-    int pos = (int) (fmt->data_starting_offset + offset);
-    int rc = SDL_RWseek(internal->rw, pos, SEEK_SET);
+    const Uint64 offset = frame * fmt->stored_frame_size;
+    int pos;
+    int rc;
+
+    BAIL_IF_MACRO(offset > fmt->total_bytes, ERR_PAST_EOF, 0);
+    pos = (int) (fmt->data_starting_offset + offset);
+    rc = SDL_RWseek(internal->rw, pos, SEEK_SET);
     BAIL_IF_MACRO(rc != pos, ERR_IO_ERROR, 0);
-    a->bytesLeft = fmt->total_bytes - offset;
+    a->bytesLeft = fmt->total_bytes - (Uint32) offset;
     return 1;  /* success. */
 } /* seek_sample_fmt_normal */
 
@@ -317,18 +402,300 @@ static void free_fmt_normal(fmt_t *fmt)
 } /* free_fmt_normal */
 
 
-static int read_fmt_normal(SDL_RWops *rw, fmt_t *fmt)
+/*
+ * Pick what we hand out for samples stored as (stored): 8-bit goes out
+ *  as-is, floats as float32, and everything else as native-endian 16- or
+ *  32-bit -- or straight to float32, if that's what the app asked for.
+ */
+static SDL_AudioFormat output_format(Sound_Sample *sample,
+                                     SDL_AudioFormat stored)
 {
+    if ((stored == AUDIO_S8) || (stored == AUDIO_U8))
+        return stored;
+    else if ((sample->desired.format == AUDIO_F32SYS) || SDL_AUDIO_ISFLOAT(stored))
+        return AUDIO_F32SYS;
+    else if ((stored & 0xFF) <= 16)
+        return AUDIO_S16SYS;
+    return AUDIO_S32SYS;
+} /* output_format */
+
+
+static int read_fmt_normal(Sound_Sample *sample, fmt_t *fmt,
+                           SDL_AudioFormat stored)
+{
+    const SDL_AudioFormat actual = output_format(sample, stored);
+
     /* (don't need to read more from the RWops...) */
     fmt->free = free_fmt_normal;
-    fmt->read_sample = read_sample_fmt_normal;
     fmt->rewind_sample = rewind_sample_fmt_normal;
     fmt->seek_sample = seek_sample_fmt_normal;
+    fmt->stored_frame_size = ((stored & 0xFF) / 8) * sample->actual.channels;
+
+    fmt->convert = NULL;
+    if (actual != stored)
+    {
+        fmt->convert = __Sound_GetConverter(stored, 1, actual, 1);
+        BAIL_IF_MACRO(fmt->convert == NULL, "AIFF: Unsupported format", 0);
+    } /* if */
+
+    fmt->read_sample = fmt->convert ? read_sample_fmt_convert : read_sample_fmt_normal;
+    sample->actual.format = actual;
     return 1;
 } /* read_fmt_normal */
 
 
 
+/*****************************************************************************
+ * IMA4 (Apple's IMA ADPCM) handler...                                       *
+ *****************************************************************************/
+
+/*
+ * IMA4 comes in packets of 64 sample frames. Each channel gets a 34 byte
+ *  block: a big-endian header (the top nine bits of the predictor and the
+ *  step index in the low seven), then 32 bytes of nibbles, low nibble
+ *  first. The packet's blocks are one channel after another. Like MS-ADPCM
+ *  in the WAV decoder, we read and decode a whole packet at a time,
+ *  straight into the caller's buffer if it fits, or into
+ *  fmt->fmt.ima4.decoded to be handed out over a few reads if not.
+ */
+#define IMA4_BLOCK_BYTES  34
+#define IMA4_PACKET_FRAMES 64
+
+static const Sint16 ima_step_table[89] =
+{
+        7,     8,     9,    10,    11,    12,    13,    14,    16,    17,
+       19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+       50,    55,    60,    66,    73,    80,    88,    97,   107,   118,
+      130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+      337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+      876,   963,  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+     2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+     5894,  6484,  7132,  7845,  8630,  9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const Sint8 ima_index_table[16] =
+{
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+
+static SDL_INLINE Sint16 do_ima_nibble(Uint8 nib, Sint32 *predictor,
+                                       int *index)
+{
+    const Sint32 step = ima_step_table[*index];
+    Sint32 diff = step >> 3;
+
+    if (nib & 4)
+        diff += step;
+    if (nib & 2)
+        diff += step >> 1;
+    if (nib & 1)
+        diff += step >> 2;
+    if (nib & 8)
+        diff = -diff;
+
+    *predictor += diff;
+    if (*predictor < -32768)
+        *predictor = -32768;
+    else if (*predictor > 32767)
+        *predictor = 32767;
+
+    *index += ima_index_table[nib];
+    if (*index < 0)
+        *index = 0;
+    else if (*index > 88)
+        *index = 88;
+
+    return (Sint16) *predictor;
+} /* do_ima_nibble */
+
+
+/* Decode the packet in fmt->fmt.ima4.block into 64 interleaved frames. */
+static void decode_ima4_packet(const Uint8 *src, Sint16 *dst, Uint32 channels)
+{
+    Uint32 ch, i;
+
+    for (ch = 0; ch < channels; ch++, src += IMA4_BLOCK_BYTES)
+    {
+        Sint32 predictor = (Sint16) ((((Uint16) src[0]) << 8) | (src[1] & 0x80));
+        int index = src[1] & 0x7F;
+        Sint16 *out = dst + ch;
+
+        if (index > 88)
+            index = 88;
+
+        for (i = 2; i < IMA4_BLOCK_BYTES; i++)
+        {
+            *out = do_ima_nibble(src[i] & 0x0F, &predictor, &index);
+            out += channels;
+            *out = do_ima_nibble(src[i] >> 4, &predictor, &index);
+            out += channels;
+        } /* for */
+    } /* for */
+} /* decode_ima4_packet */
+
+
+/* Pull the next whole packet off the RWops into fmt->fmt.ima4.block. */
+static SDL_INLINE int read_ima4_packet(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    aiff_t *a = (aiff_t *) internal->decoder_private;
+    fmt_t *fmt = &a->fmt;
+    const size_t rc = SDL_RWread(internal->rw, fmt->fmt.ima4.block,
+                                 fmt->stored_frame_size, 1);
+    BAIL_IF_MACRO(rc != 1, ERR_IO_ERROR, 0);
+    a->bytesLeft -= fmt->stored_frame_size;
+    return 1;
+} /* read_ima4_packet */
+
+
+static Uint32 read_sample_fmt_ima4(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    aiff_t *a = (aiff_t *) internal->decoder_private;
+    fmt_t *fmt = &a->fmt;
+    const Uint32 channels = sample->actual.channels;
+    const Uint32 framesize = fmt->sample_frame_size;
+    Uint8 *buf = (Uint8 *) internal->buffer;
+    Uint32 bw = 0;
+
+    while (1)
+    {
+        const Uint32 avail = (internal->buffer_size - bw) / framesize;
+        const Uint32 left = fmt->fmt.ima4.frames_left_in_block;
+
+        if (avail == 0)
+            break;
+
+        if (left > 0)  /* hand out what's left of a partially-read packet. */
+        {
+            const Uint32 cpy = (left < avail) ? left : avail;
+            const Sint16 *src = fmt->fmt.ima4.decoded +
+                                ((IMA4_PACKET_FRAMES - left) * channels);
+            SDL_memcpy(buf + bw, src, cpy * framesize);
+            fmt->fmt.ima4.frames_left_in_block -= cpy;
+            bw += cpy * framesize;
+            continue;
+        } /* if */
+
+        if (((Uint32) a->bytesLeft) < fmt->stored_frame_size)
+        {
+            sample->flags |= SOUND_SAMPLEFLAG_EOF;
+            break;
+        } /* if */
+
+        if (!read_ima4_packet(sample))
+        {
+            sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+            break;
+        } /* if */
+
+        if (avail >= IMA4_PACKET_FRAMES)  /* fits; decode right into place. */
+        {
+            decode_ima4_packet(fmt->fmt.ima4.block, (Sint16 *) (buf + bw), channels);
+            bw += IMA4_PACKET_FRAMES * framesize;
+        } /* if */
+        else
+        {
+            decode_ima4_packet(fmt->fmt.ima4.block, fmt->fmt.ima4.decoded, channels);
+            fmt->fmt.ima4.frames_left_in_block = IMA4_PACKET_FRAMES;
+        } /* else */
+    } /* while */
+
+    return bw;
+} /* read_sample_fmt_ima4 */
+
+
+static int rewind_sample_fmt_ima4(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    aiff_t *a = (aiff_t *) internal->decoder_private;
+    a->fmt.fmt.ima4.frames_left_in_block = 0;
+    return 1;
+} /* rewind_sample_fmt_ima4 */
+
+
+static int seek_sample_fmt_ima4(Sound_Sample *sample, Uint64 frame)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    aiff_t *a = (aiff_t *) internal->decoder_private;
+    fmt_t *fmt = &a->fmt;
+    const Uint32 origframesleft = fmt->fmt.ima4.frames_left_in_block;
+    const Sint32 origbytesleft = a->bytesLeft;
+    const Sint64 origpos = SDL_RWtell(internal->rw);
+    const Uint64 packet = frame / IMA4_PACKET_FRAMES;
+    const Uint32 skip = (Uint32) (frame % IMA4_PACKET_FRAMES);
+    const Uint64 offset = packet * fmt->stored_frame_size;
+    int pos;
+    int rc;
+
+    BAIL_IF_MACRO(offset > fmt->total_bytes, ERR_PAST_EOF, 0);
+    BAIL_IF_MACRO((skip > 0) && (offset + fmt->stored_frame_size > fmt->total_bytes),
+                  ERR_PAST_EOF, 0);
+    pos = (int) (fmt->data_starting_offset + offset);
+    rc = SDL_RWseek(internal->rw, pos, SEEK_SET);
+    BAIL_IF_MACRO(rc != pos, ERR_IO_ERROR, 0);
+    a->bytesLeft = fmt->total_bytes - (Uint32) offset;
+    fmt->fmt.ima4.frames_left_in_block = 0;
+
+    if (skip == 0)
+        return 1;  /* start of a packet; read() will pick up from here. */
+
+    /* The frame we need is in this packet: decode it, skip to the frame. */
+    if (!read_ima4_packet(sample))
+    {
+        SDL_RWseek(internal->rw, origpos, SEEK_SET);  /* try to make sane. */
+        fmt->fmt.ima4.frames_left_in_block = origframesleft;
+        a->bytesLeft = origbytesleft;
+        return 0;
+    } /* if */
+
+    decode_ima4_packet(fmt->fmt.ima4.block, fmt->fmt.ima4.decoded,
+                       sample->actual.channels);
+    fmt->fmt.ima4.frames_left_in_block = IMA4_PACKET_FRAMES - skip;
+    return 1;  /* success. */
+} /* seek_sample_fmt_ima4 */
+
+
+static void free_fmt_ima4(fmt_t *fmt)
+{
+    if (fmt->fmt.ima4.block != NULL)
+        __Sound_free(fmt->fmt.ima4.block);
+
+    if (fmt->fmt.ima4.decoded != NULL)
+        __Sound_free(fmt->fmt.ima4.decoded);
+} /* free_fmt_ima4 */
+
+
+static int read_fmt_ima4(Sound_Sample *sample, fmt_t *fmt)
+{
+    const Uint32 channels = sample->actual.channels;
+
+    SDL_memset(&fmt->fmt.ima4, '\0', sizeof (fmt->fmt.ima4));
+    fmt->free = free_fmt_ima4;
+    fmt->read_sample = read_sample_fmt_ima4;
+    fmt->rewind_sample = rewind_sample_fmt_ima4;
+    fmt->seek_sample = seek_sample_fmt_ima4;
+    fmt->convert = NULL;
+
+    /* a "frame" of stored data is a whole packet here. */
+    fmt->stored_frame_size = IMA4_BLOCK_BYTES * channels;
+    sample->actual.format = AUDIO_S16SYS;
+
+    /* fmt->free() is always called, so these malloc()s will be cleaned up. */
+    fmt->fmt.ima4.block = (Uint8 *) __Sound_malloc(fmt->stored_frame_size);
+    BAIL_IF_MACRO(fmt->fmt.ima4.block == NULL, ERR_OUT_OF_MEMORY, 0);
+
+    fmt->fmt.ima4.decoded = (Sint16 *) __Sound_malloc(sizeof (Sint16) *
+                                        IMA4_PACKET_FRAMES * channels);
+    BAIL_IF_MACRO(fmt->fmt.ima4.decoded == NULL, ERR_OUT_OF_MEMORY, 0);
+
+    return 1;
+} /* read_fmt_ima4 */
+
+
+
 
 /*****************************************************************************
  * Everything else...                                                        *
@@ -367,7 +734,7 @@ static int find_chunk(SDL_RWops *rw, Uint32 id)
 } /* find_chunk */
 
 
-static int read_fmt(SDL_RWops *rw, comm_t *c, fmt_t *fmt)
+static int read_fmt(Sound_Sample *sample, comm_t *c, fmt_t *fmt)
 {
     fmt->type = c->compressionType;
 
@@ -375,10 +742,58 @@ static int read_fmt(SDL_RWops *rw, comm_t *c, fmt_t *fmt)
     switch (fmt->type)
     {
         case noneID:
+        case twosID:
             SNDDBG(("AIFF: Appears to be uncompressed audio.\n"));
-            return read_fmt_normal(rw, fmt);
-
-        /* add other types here. */
+            if (c->sampleSize <= 8)
+                return read_fmt_normal(sample, fmt, AUDIO_S8);
+            else if (c->sampleSize <= 16)
+                return read_fmt_normal(sample, fmt, AUDIO_S16MSB);
+            else if (c->sampleSize <= 24)
+                return read_fmt_normal(sample, fmt, SOUND_AUDIO_S24MSB);
+            else if (c->sampleSize <= 32)
+                return read_fmt_normal(sample, fmt, AUDIO_S32MSB);
+            BAIL_MACRO("AIFF: Unsupported sample size.", 0);
+
+        case in24ID:
+            return read_fmt_normal(sample, fmt, SOUND_AUDIO_S24MSB);
+
+        case in32ID:
+            return read_fmt_normal(sample, fmt, AUDIO_S32MSB);
+
+        case sowtID:
+            SNDDBG(("AIFF: Appears to be little-endian audio.\n"));
+            if (c->sampleSize <= 8)
+                return read_fmt_normal(sample, fmt, AUDIO_S8);
+            else if (c->sampleSize <= 16)
+                return read_fmt_normal(sample, fmt, AUDIO_S16LSB);
+            else if (c->sampleSize <= 24)
+                return read_fmt_normal(sample, fmt, SOUND_AUDIO_S24LSB);
+            else if (c->sampleSize <= 32)
+                return read_fmt_normal(sample, fmt, AUDIO_S32LSB);
+            BAIL_MACRO("AIFF: Unsupported sample size.", 0);
+
+        case fl32ID:
+        case FL32ID:
+            SNDDBG(("AIFF: Appears to be float32 audio.\n"));
+            return read_fmt_normal(sample, fmt, AUDIO_F32MSB);
+
+        case fl64ID:
+        case FL64ID:
+            SNDDBG(("AIFF: Appears to be float64 audio.\n"));
+            return read_fmt_normal(sample, fmt, SOUND_AUDIO_F64MSB);
+
+        case rawID:
+            return read_fmt_normal(sample, fmt, AUDIO_U8);
+
+        case ulawID:
+            return read_fmt_normal(sample, fmt, SOUND_AUDIO_ULAW);
+
+        case alawID:
+            return read_fmt_normal(sample, fmt, SOUND_AUDIO_ALAW);
+
+        case ima4ID:
+            SNDDBG(("AIFF: Appears to be IMA4 ADPCM audio.\n"));
+            return read_fmt_ima4(sample, fmt);
 
         default:
             SNDDBG(("AIFF: Format %lu is unknown.\n",
@@ -391,12 +806,20 @@ static int read_fmt(SDL_RWops *rw, comm_t *c, fmt_t *fmt)
 } /* read_fmt */
 
 
+static void free_aiff(aiff_t *a)
+{
+    if (a->fmt.free != NULL)
+        a->fmt.free(&(a->fmt));
+    __Sound_free(a);
+} /* free_aiff */
+
+
 static int AIFF_open(Sound_Sample *sample, const char *ext)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     SDL_RWops *rw = internal->rw;
     Uint32 chunk_id;
-    int bytes_per_sample;
+    Uint32 frames;
     long pos;
     comm_t c;
     ssnd_t s;
@@ -416,37 +839,20 @@ static int AIFF_open(Sound_Sample *sample, const char *ext)
     BAIL_IF_MACRO(!read_comm_chunk(rw, &c),
                   "AIFF: Can't read common chunk.", 0);
 
+    BAIL_IF_MACRO(c.numChannels == 0, "AIFF: Invalid channel count.", 0);
+    BAIL_IF_MACRO(c.numChannels > 255, "AIFF: Too many channels.", 0);
+    BAIL_IF_MACRO(c.sampleRate == 0, "AIFF: Unsupported sample rate.", 0);
+
     sample->actual.channels = (Uint8) c.numChannels;
     sample->actual.rate = c.sampleRate;
 
-    /* Really, sample->total_time = (c.numSampleFrames*1000) c.sampleRate */
-    internal->total_time = (c.numSampleFrames / c.sampleRate) * 1000;
-    internal->total_time += (c.numSampleFrames % c.sampleRate)
-                             *  1000 / c.sampleRate;
-
-    if (c.sampleSize <= 8)
-    {
-        sample->actual.format = AUDIO_S8;
-        bytes_per_sample = c.numChannels;
-    } /* if */
-    else if (c.sampleSize <= 16)
-    {
-        sample->actual.format = AUDIO_S16MSB;
-        bytes_per_sample = 2 * c.numChannels;
-    } /* if */
-    else
-    {
-        BAIL_MACRO("AIFF: Unsupported sample size.", 0);
-    } /* else */
-
-    BAIL_IF_MACRO(c.sampleRate == 0, "AIFF: Unsupported sample rate.", 0);
-
-    a = (aiff_t *) SDL_malloc(sizeof(aiff_t));
+    a = (aiff_t *) __Sound_malloc(sizeof(aiff_t));
     BAIL_IF_MACRO(a == NULL, ERR_OUT_OF_MEMORY, 0);
+    SDL_memset(a, '\0', sizeof (aiff_t));
 
-    if (!read_fmt(rw, &c, &(a->fmt)))
+    if (!read_fmt(sample, &c, &(a->fmt)))
     {
-        SDL_free(a);
+        free_aiff(a);
         return 0;
     } /* if */
 
@@ -454,19 +860,45 @@ static int AIFF_open(Sound_Sample *sample, const char *ext)
 
     if (!find_chunk(rw, ssndID))
     {
-        SDL_free(a);
+        free_aiff(a);
         BAIL_MACRO("AIFF: No sound data chunk.", 0);
     } /* if */
 
     if (!read_ssnd_chunk(rw, &s))
     {
-        SDL_free(a);
+        free_aiff(a);
         BAIL_MACRO("AIFF: Can't read sound data chunk.", 0);
     } /* if */
 
-    a->fmt.total_bytes = a->bytesLeft = bytes_per_sample * c.numSampleFrames;
+    if (a->fmt.type == ima4ID)
+    {
+        /*
+         * numSampleFrames is supposed to count packets here, but not
+         *  everything writes it that way; the SSND chunk size is reliable.
+         */
+        const Uint32 hdr = 8 + s.offset;
+        const Uint32 datasize = (s.ckDataSize > hdr) ? (s.ckDataSize - hdr) : 0;
+        const Uint32 packets = datasize / a->fmt.stored_frame_size;
+        frames = packets * IMA4_PACKET_FRAMES;
+        a->fmt.total_bytes = packets * a->fmt.stored_frame_size;
+    } /* if */
+    else
+    {
+        frames = c.numSampleFrames;
+        a->fmt.total_bytes = a->fmt.stored_frame_size * frames;
+    } /* else */
+
+    a->bytesLeft = a->fmt.total_bytes;
     a->fmt.data_starting_offset = SDL_RWtell(rw);
+    a->fmt.sample_frame_size = ( ((sample->actual.format & 0xFF) / 8) *
+                                 sample->actual.channels );
     internal->decoder_private = (void *) a;
+    internal->total_frames = frames;
+    internal->segmentable = 1;
+
+    /* Really, sample->total_time = (frames*1000) / c.sampleRate */
+    internal->total_time = (frames / c.sampleRate) * 1000;
+    internal->total_time += (frames % c.sampleRate) * 1000 / c.sampleRate;
 
     sample->flags = SOUND_SAMPLEFLAG_CANSEEK;
 
@@ -478,9 +910,7 @@ static int AIFF_open(Sound_Sample *sample, const char *ext)
 static void AIFF_close(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    aiff_t *a = (aiff_t *) internal->decoder_private;
-    a->fmt.free(&(a->fmt));
-    SDL_free(a);
+    free_aiff((aiff_t *) internal->decoder_private);
 } /* AIFF_close */
 
 
@@ -504,11 +934,17 @@ static int AIFF_rewind(Sound_Sample *sample)
 } /* AIFF_rewind */
 
 
-static int AIFF_seek(Sound_Sample *sample, Uint32 ms)
+static int AIFF_seek_frames(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     aiff_t *a = (aiff_t *) internal->decoder_private;
-    return a->fmt.seek_sample(sample, ms);
+    return a->fmt.seek_sample(sample, frame);
+} /* AIFF_seek_frames */
+
+
+static int AIFF_seek(Sound_Sample *sample, Uint32 ms)
+{
+    return AIFF_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
 } /* AIFF_seek */
 
 static const char *extensions_aiff[] = { "AIFF", "AIF", NULL };
@@ -527,7 +963,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_AIFF =
     AIFF_close,     /*  close() method */
     AIFF_read,      /*   read() method */
     AIFF_rewind,    /* rewind() method */
-    AIFF_seek       /*   seek() method */
+    AIFF_seek,      /*   seek() method */
+    AIFF_seek_frames, /* seek_frames() method */
+    NULL,           /*   tell() method */
+    NULL,           /* duration() method */
+    NULL            /*  index() method */
 };
 
 
@@ -0,0 +1,288 @@
+/**
+ * SDL_sound; An abstract sound format decoding API.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+/*
+ * Memory management.
+ *
+ * Everything SDL_sound allocates, including what dr_flac, dr_mp3,
+ *  stb_vorbis and libmodplug allocate on its behalf, comes through here, so
+ *  an app can hand us its own allocator with Sound_SetAllocator().
+ *
+ * Each block carries a small header saying how big it is and whether it
+ *  came from a sample's arena. While a decoder's open() method runs,
+ *  small allocations are carved out of that sample's arena instead of going
+ *  to the heap one by one: decoders do most of their allocating in open(),
+ *  it's mostly small and lives exactly as long as the sample, so a bump
+ *  allocator gets all of it out of a few big blocks and gives it all back in
+ *  one go at Sound_FreeSample(). Freeing an arena block does nothing (the
+ *  memory goes when the arena does), and reallocating one moves it to the
+ *  heap if it needs to grow. Big allocations, and anything after open(),
+ *  still go to the heap, so transient buffers don't get pinned for the
+ *  life of the sample.
+ *
+ * Which arena is current is tracked per thread, so samples opening on
+ *  different threads don't interfere. If the compiler can't do thread-local
+ *  variables, there's no arena and everything goes to the heap.
+ */
+
+#define __SDL_SOUND_INTERNAL__
+#include "SDL_sound_internal.h"
+
+#define ALLOC_HEADER_SIZE 16           /* keeps the heap's 16-byte alignment. */
+#define ARENA_BLOCK_SIZE (32 * 1024)
+#define ARENA_MAX_ALLOC (4 * 1024)     /* bigger than this goes to the heap. */
+
+typedef struct
+{
+    size_t size;         /* what the caller asked for. */
+    Sound_Arena *arena;  /* the arena it's from, or NULL for the heap. */
+} AllocHeader;
+
+SDL_COMPILE_TIME_ASSERT(alloc_header, sizeof (AllocHeader) <= ALLOC_HEADER_SIZE);
+
+struct Sound_ArenaBlock
+{
+    Sound_ArenaBlock *next;
+    Uint8 padding[ALLOC_HEADER_SIZE - sizeof (Sound_ArenaBlock *)];
+    /* ARENA_BLOCK_SIZE bytes follow. */
+};
+
+/* NULL means "use SDL's." These only change while nothing's allocated. */
+static SDL_malloc_func malloc_func = NULL;
+static SDL_calloc_func calloc_func = NULL;
+static SDL_realloc_func realloc_func = NULL;
+static SDL_free_func free_func = NULL;
+
+#ifdef SOUND_THREAD_LOCAL
+static SOUND_THREAD_LOCAL Sound_Arena *current_arena = NULL;
+#endif
+
+
+static SDL_INLINE void *raw_malloc(size_t size)
+{
+    return malloc_func ? malloc_func(size) : SDL_malloc(size);
+} /* raw_malloc */
+
+static SDL_INLINE void *raw_calloc(size_t nmemb, size_t size)
+{
+    return calloc_func ? calloc_func(nmemb, size) : SDL_calloc(nmemb, size);
+} /* raw_calloc */
+
+static SDL_INLINE void *raw_realloc(void *ptr, size_t size)
+{
+    return realloc_func ? realloc_func(ptr, size) : SDL_realloc(ptr, size);
+} /* raw_realloc */
+
+static SDL_INLINE void raw_free(void *ptr)
+{
+    if (free_func)
+        free_func(ptr);
+    else
+        SDL_free(ptr);
+} /* raw_free */
+
+
+/* fill in a header at (mem) and return the caller's part of the block. */
+static SDL_INLINE void *finish_block(void *mem, size_t size, Sound_Arena *arena)
+{
+    AllocHeader *hdr = (AllocHeader *) mem;
+    if (hdr == NULL)
+        return NULL;
+    hdr->size = size;
+    hdr->arena = arena;
+    return ((Uint8 *) mem) + ALLOC_HEADER_SIZE;
+} /* finish_block */
+
+static SDL_INLINE AllocHeader *header_of(void *ptr)
+{
+    return (AllocHeader *) (((Uint8 *) ptr) - ALLOC_HEADER_SIZE);
+} /* header_of */
+
+
+static void *arena_alloc(Sound_Arena *arena, size_t size)
+{
+    const size_t need = ALLOC_HEADER_SIZE + ((size + 15) & ~((size_t) 15));
+    Uint8 *retval;
+
+    if (arena->avail < need)
+    {
+        Sound_ArenaBlock *block = (Sound_ArenaBlock *)
+                raw_malloc(sizeof (Sound_ArenaBlock) + ARENA_BLOCK_SIZE);
+        if (block == NULL)
+            return NULL;
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->next = ((Uint8 *) block) + sizeof (Sound_ArenaBlock);
+        arena->avail = ARENA_BLOCK_SIZE;
+        arena->reserved += ARENA_BLOCK_SIZE;
+    } /* if */
+
+    retval = arena->next;
+    arena->next += need;
+    arena->avail -= need;
+    arena->used += size;
+    return finish_block(retval, size, arena);
+} /* arena_alloc */
+
+
+void *__Sound_malloc(size_t size)
+{
+#ifdef SOUND_THREAD_LOCAL
+    Sound_Arena *arena = current_arena;
+    if ((arena != NULL) && (size <= ARENA_MAX_ALLOC))
+    {
+        void *retval = arena_alloc(arena, size);
+        if (retval != NULL)
+            return retval;
+    } /* if */
+#endif
+
+    if (size > ((size_t) -1) - ALLOC_HEADER_SIZE)
+        return NULL;
+    return finish_block(raw_malloc(size + ALLOC_HEADER_SIZE), size, NULL);
+} /* __Sound_malloc */
+
+
+void *__Sound_calloc(size_t nmemb, size_t size)
+{
+    size_t total;
+
+    if ((size != 0) && (nmemb > (((size_t) -1) - ALLOC_HEADER_SIZE) / size))
+        return NULL;
+    total = nmemb * size;
+
+#ifdef SOUND_THREAD_LOCAL
+    if ((current_arena != NULL) && (total <= ARENA_MAX_ALLOC))
+    {
+        void *retval = arena_alloc(current_arena, total);
+        if (retval != NULL)
+            return SDL_memset(retval, '\0', total);
+    } /* if */
+#endif
+
+    return finish_block(raw_calloc(1, total + ALLOC_HEADER_SIZE), total, NULL);
+} /* __Sound_calloc */
+
+
+void *__Sound_realloc(void *ptr, size_t size)
+{
+    AllocHeader *hdr;
+    void *retval;
+
+    if (ptr == NULL)
+        return __Sound_malloc(size);
+
+    hdr = header_of(ptr);
+    if (hdr->arena == NULL)
+    {
+        if (size > ((size_t) -1) - ALLOC_HEADER_SIZE)
+            return NULL;
+        return finish_block(raw_realloc(hdr, size + ALLOC_HEADER_SIZE), size, NULL);
+    } /* if */
+
+    /* an arena block: shrink in place, or copy it somewhere bigger. */
+    if (size <= hdr->size)
+        return ptr;
+
+    retval = __Sound_malloc(size);
+    if (retval != NULL)
+        SDL_memcpy(retval, ptr, hdr->size);
+    return retval;
+} /* __Sound_realloc */
+
+
+void __Sound_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        AllocHeader *hdr = header_of(ptr);
+        if (hdr->arena == NULL)  /* arena blocks go with their arena. */
+            raw_free(hdr);
+    } /* if */
+} /* __Sound_free */
+
+
+char *__Sound_strdup(const char *str)
+{
+    const size_t len = SDL_strlen(str) + 1;
+    char *retval = (char *) __Sound_malloc(len);
+    if (retval != NULL)
+        SDL_memcpy(retval, str, len);
+    return retval;
+} /* __Sound_strdup */
+
+
+Sound_Arena *__Sound_ArenaEnter(Sound_Arena *arena)
+{
+#ifdef SOUND_THREAD_LOCAL
+    Sound_Arena *retval = current_arena;
+    current_arena = arena;
+    return retval;
+#else
+    (void) arena;
+    return NULL;
+#endif
+} /* __Sound_ArenaEnter */
+
+
+void __Sound_ArenaLeave(Sound_Arena *previous)
+{
+#ifdef SOUND_THREAD_LOCAL
+    current_arena = previous;
+#else
+    (void) previous;
+#endif
+} /* __Sound_ArenaLeave */
+
+
+void __Sound_ArenaRelease(Sound_Arena *arena)
+{
+    while (arena->blocks != NULL)
+    {
+        Sound_ArenaBlock *next = arena->blocks->next;
+        raw_free(arena->blocks);
+        arena->blocks = next;
+    } /* while */
+
+    SDL_zerop(arena);
+} /* __Sound_ArenaRelease */
+
+
+int Sound_SetAllocator(SDL_malloc_func malloc_fn, SDL_calloc_func calloc_fn,
+                       SDL_realloc_func realloc_fn, SDL_free_func free_fn)
+{
+    const int all_null = ( (malloc_fn == NULL) && (calloc_fn == NULL) &&
+                           (realloc_fn == NULL) && (free_fn == NULL) );
+    const int none_null = ( (malloc_fn != NULL) && (calloc_fn != NULL) &&
+                            (realloc_fn != NULL) && (free_fn != NULL) );
+
+    BAIL_IF_MACRO(__Sound_IsInitialized(), ERR_IS_INITIALIZED, 0);
+    BAIL_IF_MACRO(__Sound_LiveSamplePools() > 0, ERR_POOLS_ALIVE, 0);
+    BAIL_IF_MACRO((!all_null) && (!none_null), ERR_INVALID_ARGUMENT, 0);
+
+    malloc_func = malloc_fn;
+    calloc_func = calloc_fn;
+    realloc_func = realloc_fn;
+    free_func = free_fn;
+    return 1;
+} /* Sound_SetAllocator */
+
+
+void Sound_GetAllocator(SDL_malloc_func *malloc_fn, SDL_calloc_func *calloc_fn,
+                        SDL_realloc_func *realloc_fn, SDL_free_func *free_fn)
+{
+    if (malloc_fn)
+        *malloc_fn = malloc_func;
+    if (calloc_fn)
+        *calloc_fn = calloc_func;
+    if (realloc_fn)
+        *realloc_fn = realloc_func;
+    if (free_fn)
+        *free_fn = free_func;
+} /* Sound_GetAllocator */
+
+/* end of SDL_sound_alloc.c ... */
+
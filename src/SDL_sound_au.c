@@ -8,8 +8,11 @@
 
 /*
  * Sun/NeXT .au decoder for SDL_sound.
- * Formats supported: 8 and 16 bit linear PCM, 8 bit µ-law.
+ * Formats supported: 8 and 16 bit linear PCM, 8 bit µ-law and A-law.
  * Files without valid header are assumed to be 8 bit µ-law, 8kHz, mono.
+ *
+ * µ-law and A-law expand to 16-bit, or straight to float32 if that's what
+ *  the app asked for, so nothing needs a second pass to get there.
  */
 
 #define __SDL_SOUND_INTERNAL__
@@ -45,6 +48,7 @@ enum
     AU_ENC_ULAW_8       = 1,        /* 8-bit ISDN µ-law */
     AU_ENC_LINEAR_8     = 2,        /* 8-bit linear PCM */
     AU_ENC_LINEAR_16    = 3,        /* 16-bit linear PCM */
+    AU_ENC_ALAW_8       = 27,       /* 8-bit ISDN A-law */
 
     /* the rest are unsupported (I have never seen them in the wild) */
     AU_ENC_LINEAR_24    = 4,        /* 24-bit linear PCM */
@@ -55,8 +59,7 @@ enum
     AU_ENC_ADPCM_G721   = 23,
     AU_ENC_ADPCM_G722   = 24,
     AU_ENC_ADPCM_G723_3 = 25,
-    AU_ENC_ADPCM_G723_5 = 26,
-    AU_ENC_ALAW_8       = 27
+    AU_ENC_ADPCM_G723_5 = 26
 };
 
 struct audec
@@ -65,6 +68,7 @@ struct audec
     Uint32 remaining;
     Uint32 start_offset;
     int encoding;
+    Sound_ConvertFn expand;     /* µ-law/A-law to actual.format, or NULL. */
 };
 
 
@@ -103,6 +107,25 @@ static int read_au_header(SDL_RWops *rw, struct au_file_hdr *hdr)
 } /* read_au_header */
 
 
+/*
+ * Companded audio is expanded as it's read. 16-bit is what most devices
+ *  want, but if the app asked for float32 we go there directly instead of
+ *  leaving SDL_ConvertAudio a second pass over the data.
+ */
+static int setup_companded(Sound_Sample *sample, struct audec *dec,
+                           SDL_AudioFormat law)
+{
+    if (sample->desired.format == AUDIO_F32SYS)
+        sample->actual.format = AUDIO_F32SYS;
+    else
+        sample->actual.format = AUDIO_S16SYS;
+
+    dec->expand = __Sound_GetConverter(law, 1, sample->actual.format, 1);
+    BAIL_IF_MACRO(dec->expand == NULL, "AU: Unsupported .au encoding", 0);
+    return 1;
+} /* setup_companded */
+
+
 #define AU_MAGIC 0x2E736E64  /* ".snd", in ASCII (bigendian number) */
 
 static int AU_open(Sound_Sample *sample, const char *ext)
@@ -117,8 +140,9 @@ static int AU_open(Sound_Sample *sample, const char *ext)
     /* read_au_header() will do byte order swapping. */
     BAIL_IF_MACRO(!read_au_header(rw, &hdr), "AU: bad header", 0);
 
-    dec = SDL_malloc(sizeof *dec);
+    dec = __Sound_malloc(sizeof *dec);
     BAIL_IF_MACRO(dec == NULL, ERR_OUT_OF_MEMORY, 0);
+    dec->expand = NULL;
     internal->decoder_private = dec;
 
     if (hdr.magic == AU_MAGIC)
@@ -128,10 +152,22 @@ static int AU_open(Sound_Sample *sample, const char *ext)
         switch(dec->encoding)
         {
             case AU_ENC_ULAW_8:
-                /* Convert 8-bit µ-law to 16-bit linear on the fly. This is
+                /* Convert 8-bit µ-law to linear on the fly. This is
                    slightly wasteful if the audio driver must convert them
                    back, but µ-law only devices are rare (mostly _old_ Suns) */
-                sample->actual.format = AUDIO_S16SYS;
+                if (!setup_companded(sample, dec, SOUND_AUDIO_ULAW))
+                {
+                    __Sound_free(dec);
+                    return 0;
+                } /* if */
+                break;
+
+            case AU_ENC_ALAW_8:
+                if (!setup_companded(sample, dec, SOUND_AUDIO_ALAW))
+                {
+                    __Sound_free(dec);
+                    return 0;
+                } /* if */
                 break;
 
             case AU_ENC_LINEAR_8:
@@ -143,7 +179,7 @@ static int AU_open(Sound_Sample *sample, const char *ext)
                 break;
 
             default:
-                SDL_free(dec);
+                __Sound_free(dec);
                 BAIL_MACRO("AU: Unsupported .au encoding", 0);
         } /* switch */
 
@@ -157,7 +193,7 @@ static int AU_open(Sound_Sample *sample, const char *ext)
         {
             if (SDL_RWread(rw, &c, 1, 1) != 1)
             {
-                SDL_free(dec);
+                __Sound_free(dec);
                 BAIL_MACRO(ERR_IO_ERROR, 0);
             } /* if */
         } /* for */
@@ -176,17 +212,22 @@ static int AU_open(Sound_Sample *sample, const char *ext)
         SDL_RWseek(rw, -HDR_SIZE, SEEK_CUR);
         dec->encoding = AU_ENC_ULAW_8;
         dec->remaining = (Uint32)-1; 		/* no limit */
-        sample->actual.format = AUDIO_S16SYS;
+        if (!setup_companded(sample, dec, SOUND_AUDIO_ULAW))
+        {
+            __Sound_free(dec);
+            return 0;
+        } /* if */
         sample->actual.rate = 8000;
         sample->actual.channels = 1;
     } /* else if */
 
     else
     {
-        SDL_free(dec);
+        __Sound_free(dec);
         BAIL_MACRO("AU: Not an .AU stream.", 0);
     } /* else */    
 
+    /* µ-law and A-law are a byte per sample, whatever they expand to. */
     bytes_per_second = ( ( dec->encoding == AU_ENC_LINEAR_16 ) ? 2 : 1 )
         * sample->actual.rate * sample->actual.channels ;
     internal->total_time = ((dec->remaining == -1) ? (-1) :
@@ -194,6 +235,14 @@ static int AU_open(Sound_Sample *sample, const char *ext)
                             ( ( dec->remaining % bytes_per_second ) * 1000 /
                               bytes_per_second ) );
 
+    if (dec->remaining != (Uint32) -1)
+    {
+        const Uint32 bytes_per_frame = ( ( dec->encoding == AU_ENC_LINEAR_16 ) ? 2 : 1 )
+            * sample->actual.channels;
+        internal->total_frames = dec->remaining / bytes_per_frame;
+        internal->segmentable = 1;
+    } /* if */
+
     sample->flags = SOUND_SAMPLEFLAG_CANSEEK;
     dec->total = dec->remaining;
     dec->start_offset = SDL_RWtell(rw);
@@ -206,47 +255,10 @@ static int AU_open(Sound_Sample *sample, const char *ext)
 static void AU_close(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = sample->opaque;
-    SDL_free(internal->decoder_private);
+    __Sound_free(internal->decoder_private);
 } /* AU_close */
 
 
-/* table to convert from µ-law encoding to signed 16-bit samples,
-   generated by a throwaway perl script */
-static Sint16 ulaw_to_linear[256] = {
-    -32124,-31100,-30076,-29052,-28028,-27004,-25980,-24956,
-    -23932,-22908,-21884,-20860,-19836,-18812,-17788,-16764,
-    -15996,-15484,-14972,-14460,-13948,-13436,-12924,-12412,
-    -11900,-11388,-10876,-10364, -9852, -9340, -8828, -8316,
-     -7932, -7676, -7420, -7164, -6908, -6652, -6396, -6140,
-     -5884, -5628, -5372, -5116, -4860, -4604, -4348, -4092,
-     -3900, -3772, -3644, -3516, -3388, -3260, -3132, -3004,
-     -2876, -2748, -2620, -2492, -2364, -2236, -2108, -1980,
-     -1884, -1820, -1756, -1692, -1628, -1564, -1500, -1436,
-     -1372, -1308, -1244, -1180, -1116, -1052,  -988,  -924,
-      -876,  -844,  -812,  -780,  -748,  -716,  -684,  -652,
-      -620,  -588,  -556,  -524,  -492,  -460,  -428,  -396,
-      -372,  -356,  -340,  -324,  -308,  -292,  -276,  -260,
-      -244,  -228,  -212,  -196,  -180,  -164,  -148,  -132,
-      -120,  -112,  -104,   -96,   -88,   -80,   -72,   -64,
-       -56,   -48,   -40,   -32,   -24,   -16,    -8,     0,
-     32124, 31100, 30076, 29052, 28028, 27004, 25980, 24956,
-     23932, 22908, 21884, 20860, 19836, 18812, 17788, 16764,
-     15996, 15484, 14972, 14460, 13948, 13436, 12924, 12412,
-     11900, 11388, 10876, 10364,  9852,  9340,  8828,  8316,
-      7932,  7676,  7420,  7164,  6908,  6652,  6396,  6140,
-      5884,  5628,  5372,  5116,  4860,  4604,  4348,  4092,
-      3900,  3772,  3644,  3516,  3388,  3260,  3132,  3004,
-      2876,  2748,  2620,  2492,  2364,  2236,  2108,  1980,
-      1884,  1820,  1756,  1692,  1628,  1564,  1500,  1436,
-      1372,  1308,  1244,  1180,  1116,  1052,   988,   924,
-       876,   844,   812,   780,   748,   716,   684,   652,
-       620,   588,   556,   524,   492,   460,   428,   396,
-       372,   356,   340,   324,   308,   292,   276,   260,
-       244,   228,   212,   196,   180,   164,   148,   132,
-       120,   112,   104,    96,    88,    80,    72,    64,
-        56,    48,    40,    32,    24,    16,     8,     0
-};
-
 
 static Uint32 AU_read(Sound_Sample *sample)
 {
@@ -255,15 +267,16 @@ static Uint32 AU_read(Sound_Sample *sample)
     struct audec *dec = internal->decoder_private;
     int maxlen;
     Uint8 *buf;
+    int expansion = 1;
 
     maxlen = internal->buffer_size;
     buf = internal->buffer;
-    if (dec->encoding == AU_ENC_ULAW_8)
+    if (dec->expand != NULL)
     {
-        /* We read µ-law samples into the second half of the buffer, so
-           we can expand them to 16-bit samples afterwards */
-        maxlen >>= 1;
-        buf += maxlen;
+        /* Read one byte per sample, then expand in place to 16 or 32 bits;
+           the converter works backwards, so nothing is clobbered. */
+        expansion = (sample->actual.format & 0xFF) / 8;
+        maxlen /= expansion;
     } /* if */
 
     if (maxlen > dec->remaining)
@@ -279,13 +292,10 @@ static Uint32 AU_read(Sound_Sample *sample)
         if (ret < maxlen)
             sample->flags |= SOUND_SAMPLEFLAG_EAGAIN;
 
-        if (dec->encoding == AU_ENC_ULAW_8)
+        if (dec->expand != NULL)
         {
-            int i;
-            Sint16 *dst = internal->buffer;
-            for (i = 0; i < ret; i++)
-                dst[i] = ulaw_to_linear[buf[i]];
-            ret <<= 1;                  /* return twice as much as read */
+            dec->expand(buf, buf, (Uint32) ret, 1);
+            ret *= expansion;           /* return more than we read */
         } /* if */
     } /* else */
 
@@ -304,22 +314,29 @@ static int AU_rewind(Sound_Sample *sample)
 } /* AU_rewind */
 
 
-static int AU_seek(Sound_Sample *sample, Uint32 ms)
+static int AU_seek_frames(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     struct audec *dec = (struct audec *) internal->decoder_private;
-    int offset = __Sound_convertMsToBytePos(&sample->actual, ms);
+    Uint64 offset = frame * sample->actual.channels;
     int rc;
     int pos;
 
-    if (dec->encoding == AU_ENC_ULAW_8)
-        offset >>= 1;  /* halve the byte offset for compression. */
+    if (dec->expand == NULL)  /* u-law and A-law are a byte per sample. */
+        offset *= ((sample->actual.format & 0xFF) / 8);
 
+    BAIL_IF_MACRO((dec->total != (Uint32) -1) && (offset > dec->total), ERR_PAST_EOF, 0);
     pos = (int) (dec->start_offset + offset);
     rc = SDL_RWseek(internal->rw, pos, SEEK_SET);
     BAIL_IF_MACRO(rc != pos, ERR_IO_ERROR, 0);
-    dec->remaining = dec->total - offset;
+    dec->remaining = dec->total - (Uint32) offset;
     return 1;
+} /* AU_seek_frames */
+
+
+static int AU_seek(Sound_Sample *sample, Uint32 ms)
+{
+    return AU_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
 } /* AU_seek */
 
 /*
@@ -343,7 +360,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_AU =
     AU_close,       /*  close() method */
     AU_read,        /*   read() method */
     AU_rewind,      /* rewind() method */
-    AU_seek         /*   seek() method */
+    AU_seek,        /*   seek() method */
+    AU_seek_frames, /* seek_frames() method */
+    NULL,           /*   tell() method */
+    NULL,           /* duration() method */
+    NULL            /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_AU */
@@ -0,0 +1,522 @@
+/**
+ * SDL_sound; An abstract sound format decoding API.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+/*
+ * The decoded-audio cache.
+ *
+ * Each entry is one sound's complete decoded output, in the format it was
+ *  asked for, keyed by where it came from (a file name, or a hash of the
+ *  bytes for memory sources) plus the requested format, channels, rate and
+ *  resampler. Sound_NewSampleFromFile() and Sound_NewSampleFromMem() look
+ *  here first; on a hit, the new sample reads straight out of the entry
+ *  through the tiny "decoder" at the bottom of this file, and the real
+ *  decoder never runs. On a miss, the sample keeps its key, and if it gets
+ *  decoded from start to finish with Sound_DecodeAll(), the result is
+ *  stored.
+ *
+ * Each sample reading an entry holds a reference to it. Eviction (least
+ *  recently used first, whenever the total is over budget) takes an entry
+ *  out of the table, but its memory stays put until the last sample using
+ *  it is freed.
+ */
+
+#define __SDL_SOUND_INTERNAL__
+#include "SDL_sound_internal.h"
+
+#define CACHE_BUCKETS 256  /* a power of two. */
+
+struct Sound_CacheKey
+{
+    char *name;         /* file name, or memory source's extension (or ""). */
+    int is_file;
+    Uint64 hash;        /* of a memory source's bytes. */
+    Uint32 size;        /* of a memory source. */
+    Sound_AudioInfo desired;  /* as requested; zeros mean "as the file is". */
+    Sound_ResampleQuality quality;
+    Uint32 bucket;
+};
+
+struct Sound_CacheEntry
+{
+    Sound_CacheKey key;
+    const Sound_DecoderInfo *decoder;  /* who decoded it the first time. */
+    Sound_AudioInfo info;              /* what's in (data). */
+    Uint32 source_rate;                /* the file's rate, and its length */
+    Sint64 source_frames;              /*  in its own frames. */
+    Uint8 *data;
+    Uint32 size;
+    Uint32 refcount;
+    int evicted;  /* out of the table; freed when refcount hits zero. */
+    Sound_CacheEntry *hash_next;
+    Sound_CacheEntry *lru_prev;  /* toward the most recently used. */
+    Sound_CacheEntry *lru_next;
+};
+
+static SDL_mutex *cache_mutex = NULL;
+static Sound_CacheEntry *buckets[CACHE_BUCKETS];
+static Sound_CacheEntry *lru_head = NULL;  /* most recently used. */
+static Sound_CacheEntry *lru_tail = NULL;  /* first to go. */
+static Uint64 cache_budget = 0;
+static Sound_DecodeCacheStats cache_stats;
+
+
+/* this isn't cryptographic, just a good spread for telling assets apart. */
+static Uint64 hash_bytes(const Uint8 *data, Uint32 len)
+{
+    Uint64 h = 0x9E3779B97F4A7C15ULL ^ len;
+    Uint64 w;
+
+    while (len >= 8)
+    {
+        SDL_memcpy(&w, data, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+        data += 8;
+        len -= 8;
+    } /* while */
+
+    w = 0;
+    SDL_memcpy(&w, data, len);
+    h = (h ^ w) * 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+} /* hash_bytes */
+
+
+static Uint32 hash_key(const Sound_CacheKey *key)
+{
+    const char *str;
+    Uint32 h = 2166136261u;  /* FNV-1a */
+
+    for (str = key->name; *str; str++)
+        h = (h ^ (Uint8) *str) * 16777619u;
+
+    h = (h ^ (Uint32) key->hash ^ (Uint32) (key->hash >> 32)) * 16777619u;
+    h = (h ^ key->size) * 16777619u;
+    h = (h ^ key->desired.format ^ (key->desired.channels << 16)) * 16777619u;
+    h = (h ^ key->desired.rate) * 16777619u;
+    h = (h ^ (Uint32) key->quality) * 16777619u;
+    return h;
+} /* hash_key */
+
+
+static int keys_match(const Sound_CacheKey *a, const Sound_CacheKey *b)
+{
+    return ( (a->bucket == b->bucket) &&
+             (a->is_file == b->is_file) &&
+             (a->hash == b->hash) &&
+             (a->size == b->size) &&
+             (a->desired.format == b->desired.format) &&
+             (a->desired.channels == b->desired.channels) &&
+             (a->desired.rate == b->desired.rate) &&
+             (a->quality == b->quality) &&
+             (SDL_strcmp(a->name, b->name) == 0) );
+} /* keys_match */
+
+
+static Sound_CacheKey *make_key(const char *name, int is_file, Uint64 hash,
+                                Uint32 size, const Sound_AudioInfo *desired,
+                                Sound_ResampleQuality quality)
+{
+    Sound_CacheKey *retval;
+
+    if (cache_budget == 0)
+        return NULL;  /* caching is off; don't even bother. */
+
+    retval = (Sound_CacheKey *) __Sound_calloc(1, sizeof (Sound_CacheKey));
+    if (retval == NULL)
+        return NULL;
+
+    retval->name = __Sound_strdup((name != NULL) ? name : "");
+    if (retval->name == NULL)
+    {
+        __Sound_free(retval);
+        return NULL;
+    } /* if */
+
+    retval->is_file = is_file;
+    retval->hash = hash;
+    retval->size = size;
+    if (desired != NULL)
+    {
+        retval->desired.format = desired->format;
+        retval->desired.channels = desired->channels;
+        retval->desired.rate = desired->rate;
+    } /* if */
+    retval->quality = quality;
+    retval->bucket = hash_key(retval);
+    return retval;
+} /* make_key */
+
+
+Sound_CacheKey *__Sound_CacheKeyFromFile(const char *fname,
+                                         const Sound_AudioInfo *desired,
+                                         Sound_ResampleQuality quality)
+{
+    return make_key(fname, 1, 0, 0, desired, quality);
+} /* __Sound_CacheKeyFromFile */
+
+
+Sound_CacheKey *__Sound_CacheKeyFromMem(const Uint8 *data, Uint32 size,
+                                        const char *ext,
+                                        const Sound_AudioInfo *desired,
+                                        Sound_ResampleQuality quality)
+{
+    if (cache_budget == 0)
+        return NULL;
+    return make_key(ext, 0, hash_bytes(data, size), size, desired, quality);
+} /* __Sound_CacheKeyFromMem */
+
+
+void __Sound_CacheFreeKey(Sound_CacheKey *key)
+{
+    if (key != NULL)
+    {
+        __Sound_free(key->name);
+        __Sound_free(key);
+    } /* if */
+} /* __Sound_CacheFreeKey */
+
+
+static void free_entry(Sound_CacheEntry *entry)
+{
+    __Sound_free(entry->key.name);
+    __Sound_free(entry->data);
+    __Sound_free(entry);
+} /* free_entry */
+
+
+/* all of these expect cache_mutex to be held... */
+
+static void lru_unlink(Sound_CacheEntry *entry)
+{
+    if (entry->lru_prev != NULL)
+        entry->lru_prev->lru_next = entry->lru_next;
+    else
+        lru_head = entry->lru_next;
+
+    if (entry->lru_next != NULL)
+        entry->lru_next->lru_prev = entry->lru_prev;
+    else
+        lru_tail = entry->lru_prev;
+
+    entry->lru_prev = entry->lru_next = NULL;
+} /* lru_unlink */
+
+
+static void lru_push(Sound_CacheEntry *entry)
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = lru_head;
+    if (lru_head != NULL)
+        lru_head->lru_prev = entry;
+    else
+        lru_tail = entry;
+    lru_head = entry;
+} /* lru_push */
+
+
+static Sound_CacheEntry *find_entry(const Sound_CacheKey *key)
+{
+    Sound_CacheEntry *entry = buckets[key->bucket & (CACHE_BUCKETS - 1)];
+    while ((entry != NULL) && (!keys_match(&entry->key, key)))
+        entry = entry->hash_next;
+    return entry;
+} /* find_entry */
+
+
+/* take (entry) out of the table; it's freed now, or by its last user. */
+static void remove_entry(Sound_CacheEntry *entry)
+{
+    Sound_CacheEntry **prev = &buckets[entry->key.bucket & (CACHE_BUCKETS - 1)];
+
+    while (*prev != entry)
+        prev = &(*prev)->hash_next;
+    *prev = entry->hash_next;
+    lru_unlink(entry);
+
+    cache_stats.entries--;
+    cache_stats.bytes -= entry->size;
+
+    if (entry->refcount == 0)
+        free_entry(entry);
+    else
+        entry->evicted = 1;
+} /* remove_entry */
+
+
+static void evict_to(Uint64 budget)
+{
+    while ((cache_stats.bytes > budget) && (lru_tail != NULL))
+    {
+        remove_entry(lru_tail);
+        cache_stats.evictions++;
+    } /* while */
+} /* evict_to */
+
+
+Sound_CacheEntry *__Sound_CacheLookup(const Sound_CacheKey *key)
+{
+    Sound_CacheEntry *retval;
+
+    SDL_LockMutex(cache_mutex);
+    retval = find_entry(key);
+    if (retval == NULL)
+        cache_stats.misses++;
+    else
+    {
+        cache_stats.hits++;
+        retval->refcount++;
+        lru_unlink(retval);
+        lru_push(retval);
+    } /* else */
+    SDL_UnlockMutex(cache_mutex);
+
+    return retval;
+} /* __Sound_CacheLookup */
+
+
+void __Sound_CacheStore(const Sound_CacheKey *key, const Sound_Sample *sample)
+{
+    const Sound_SampleInternal *internal = (const Sound_SampleInternal *) sample->opaque;
+    Sound_CacheEntry *entry;
+    int dupe;
+
+    if ((sample->buffer_size == 0) || (sample->buffer_size > cache_budget))
+        return;
+
+        /* copy it before taking the lock; this could take a moment. */
+    entry = (Sound_CacheEntry *) __Sound_calloc(1, sizeof (Sound_CacheEntry));
+    if (entry == NULL)
+        return;
+
+    SDL_memcpy(&entry->key, key, sizeof (Sound_CacheKey));
+    entry->key.name = __Sound_strdup(key->name);
+    entry->data = (Uint8 *) __Sound_malloc(sample->buffer_size);
+    if ((entry->key.name == NULL) || (entry->data == NULL))
+    {
+        free_entry(entry);
+        return;
+    } /* if */
+
+    SDL_memcpy(entry->data, sample->buffer, sample->buffer_size);
+    entry->size = sample->buffer_size;
+    entry->decoder = sample->decoder;
+    entry->info.format = sample->desired.format;
+    entry->info.channels = sample->desired.channels;
+    entry->info.rate = sample->desired.rate;
+    entry->source_rate = sample->actual.rate;
+    if (internal->total_frames >= 0)
+        entry->source_frames = internal->total_frames;
+    else  /* it was decoded from the start, so this is where the end is. */
+        entry->source_frames = (Sint64) internal->position;
+
+    SDL_LockMutex(cache_mutex);
+    dupe = (find_entry(key) != NULL);  /* someone beat us to it? */
+    if (!dupe)
+    {
+        Sound_CacheEntry **bucket = &buckets[key->bucket & (CACHE_BUCKETS - 1)];
+        entry->hash_next = *bucket;
+        *bucket = entry;
+        lru_push(entry);
+        cache_stats.entries++;
+        cache_stats.bytes += entry->size;
+        evict_to(cache_budget);
+    } /* if */
+    SDL_UnlockMutex(cache_mutex);
+
+    if (dupe)
+        free_entry(entry);
+} /* __Sound_CacheStore */
+
+
+void __Sound_CacheRelease(Sound_CacheEntry *entry)
+{
+    int nuke_it;
+
+    SDL_LockMutex(cache_mutex);
+    entry->refcount--;
+    nuke_it = ((entry->evicted) && (entry->refcount == 0));
+    SDL_UnlockMutex(cache_mutex);
+
+    if (nuke_it)
+        free_entry(entry);
+} /* __Sound_CacheRelease */
+
+
+SDL_RWops *__Sound_CacheEntryRW(Sound_CacheEntry *entry)
+{
+    return SDL_RWFromConstMem(entry->data, (int) entry->size);
+} /* __Sound_CacheEntryRW */
+
+
+int __Sound_CacheInit(void)
+{
+    cache_mutex = SDL_CreateMutex();
+    BAIL_IF_MACRO(cache_mutex == NULL, SDL_GetError(), 0);
+    return 1;
+} /* __Sound_CacheInit */
+
+
+void __Sound_CacheQuit(void)
+{
+        /* every sample is gone by now, so nothing holds a reference. */
+    while (lru_tail != NULL)
+        remove_entry(lru_tail);
+
+    SDL_DestroyMutex(cache_mutex);
+    cache_mutex = NULL;
+} /* __Sound_CacheQuit */
+
+
+void Sound_SetDecodeCacheBudget(Uint64 bytes)
+{
+    if (cache_mutex != NULL)
+        SDL_LockMutex(cache_mutex);
+
+    cache_budget = bytes;
+    evict_to(bytes);
+
+    if (cache_mutex != NULL)
+        SDL_UnlockMutex(cache_mutex);
+} /* Sound_SetDecodeCacheBudget */
+
+
+void Sound_FlushDecodeCache(void)
+{
+    if (cache_mutex != NULL)
+    {
+        SDL_LockMutex(cache_mutex);
+        while (lru_tail != NULL)
+            remove_entry(lru_tail);
+        SDL_UnlockMutex(cache_mutex);
+    } /* if */
+} /* Sound_FlushDecodeCache */
+
+
+void Sound_GetDecodeCacheStats(Sound_DecodeCacheStats *stats)
+{
+    if (stats == NULL)
+        return;
+
+    if (cache_mutex != NULL)
+        SDL_LockMutex(cache_mutex);
+
+    SDL_memcpy(stats, &cache_stats, sizeof (Sound_DecodeCacheStats));
+    stats->budget = cache_budget;
+
+    if (cache_mutex != NULL)
+        SDL_UnlockMutex(cache_mutex);
+} /* Sound_GetDecodeCacheStats */
+
+
+/*
+ * The "decoder" for samples opened from the cache. SDL_sound.c points the
+ *  sample's RWops at the entry's data and hands us the entry, referenced,
+ *  in decoder_private; the audio is already in the desired format, so this
+ *  is just reading a buffer. The sample reports the original decoder, and
+ *  SDL_sound.c counts its frame positions in the original file's frames.
+ */
+
+static int CACHE_init(void)
+{
+    return 1;  /* always succeeds. */
+} /* CACHE_init */
+
+
+static void CACHE_quit(void)
+{
+    /* it's a no-op. */
+} /* CACHE_quit */
+
+
+static int CACHE_open(Sound_Sample *sample, const char *ext)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Sound_CacheEntry *entry = (const Sound_CacheEntry *) internal->decoder_private;
+    const Uint32 framesize = ((entry->info.format & 0xFF) / 8) * entry->info.channels;
+
+    SDL_memcpy(&sample->actual, &entry->info, sizeof (Sound_AudioInfo));
+    sample->decoder = entry->decoder;
+    sample->flags = SOUND_SAMPLEFLAG_CANSEEK;
+    internal->total_frames = (Sint64) (entry->size / framesize);
+    internal->total_time = (Sint32) ((((Uint64) internal->total_frames) * 1000) /
+                                     entry->info.rate);
+    internal->source_rate = entry->source_rate;
+    internal->source_frames = entry->source_frames;
+    return 1;
+} /* CACHE_open */
+
+
+static void CACHE_close(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    __Sound_CacheRelease((Sound_CacheEntry *) internal->decoder_private);
+} /* CACHE_close */
+
+
+static Uint32 CACHE_read(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Uint32 retval = (Uint32) SDL_RWread(internal->rw, internal->buffer,
+                                              1, internal->buffer_size);
+    if (retval < internal->buffer_size)
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+    return retval;
+} /* CACHE_read */
+
+
+static int CACHE_rewind(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    BAIL_IF_MACRO(SDL_RWseek(internal->rw, 0, SEEK_SET) != 0, ERR_IO_ERROR, 0);
+    return 1;
+} /* CACHE_rewind */
+
+
+static int CACHE_seek_frames(Sound_Sample *sample, Uint64 frame)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Uint64 offset = frame * (((sample->actual.format & 0xFF) / 8) *
+                                   sample->actual.channels);
+    const Sint64 pos = (Sint64) offset;
+    int err = (SDL_RWseek(internal->rw, pos, SEEK_SET) != pos);
+    BAIL_IF_MACRO(err, ERR_IO_ERROR, 0);
+    return 1;
+} /* CACHE_seek_frames */
+
+
+static int CACHE_seek(Sound_Sample *sample, Uint32 ms)
+{
+    return CACHE_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
+} /* CACHE_seek */
+
+
+static const char *extensions_cache[] = { NULL };
+const Sound_DecoderFunctions __Sound_DecoderFunctions_CACHE =
+{
+    {
+        extensions_cache,
+        "Previously decoded audio",
+        "SDL_sound contributors (see CREDITS)",
+        "https://icculus.org/SDL_sound/"
+    },
+
+    CACHE_init,       /*   init() method */
+    CACHE_quit,       /*   quit() method */
+    CACHE_open,       /*   open() method */
+    CACHE_close,      /*  close() method */
+    CACHE_read,       /*   read() method */
+    CACHE_rewind,     /* rewind() method */
+    CACHE_seek,       /*   seek() method */
+    CACHE_seek_frames, /* seek_frames() method */
+    NULL,             /*   tell() method */
+    NULL,             /* duration() method */
+    NULL              /*  index() method */
+};
+
+/* end of SDL_sound_cache.c ... */
+
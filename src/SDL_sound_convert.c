@@ -0,0 +1,1147 @@
+/**
+ * SDL_sound; An abstract sound format decoding API.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+/*
+ * Sample format and channel conversion.
+ *
+ * SDL_ConvertAudio() runs a chain of filters over each chunk, one pass per
+ *  step (byteswap, then to float, then to stereo, then to the final type...).
+ *  For the conversions that come up all the time, we do it all in a single
+ *  pass instead: each source sample is loaded, converted, and stored in its
+ *  final form and channel layout. The very common ones get SIMD versions.
+ *
+ * Anything not covered here (U8 output, more than two channels changing,
+ *  etc) returns NULL from __Sound_GetConverter(), and SDL_AudioCVT handles
+ *  it like it always did.
+ *
+ * Every converter works in place: when the output is bigger than the input,
+ *  we run backwards from the end of the buffer so we never overwrite a frame
+ *  before we've read it.
+ */
+
+#define __SDL_SOUND_INTERNAL__
+#include "SDL_sound_internal.h"
+
+static SDL_INLINE Sint16 float_to_s16(float val)
+{
+    if (val >= 1.0f)
+        return 32767;
+    else if (val <= -1.0f)
+        return -32768;
+    return (Sint16) (val * 32768.0f);
+} /* float_to_s16 */
+
+static SDL_INLINE Sint32 float_to_s32(float val)
+{
+    if (val >= 1.0f)
+        return 2147483647;
+    else if (val <= -1.0f)
+        return (-2147483647 - 1);
+    return (Sint32) (val * 2147483648.0f);
+} /* float_to_s32 */
+
+/* packed 24-bit goes to the top of an Sint32, like SDL does for S32. */
+static SDL_INLINE Sint32 load_s24lsb(const void *p, Uint32 i)
+{
+    const Uint8 *ptr = ((const Uint8 *) p) + (i * 3);
+    return (Sint32) ( (((Uint32) ptr[0]) << 8) | (((Uint32) ptr[1]) << 16) |
+                      (((Uint32) ptr[2]) << 24) );
+} /* load_s24lsb */
+
+static SDL_INLINE Sint32 load_s24msb(const void *p, Uint32 i)
+{
+    const Uint8 *ptr = ((const Uint8 *) p) + (i * 3);
+    return (Sint32) ( (((Uint32) ptr[2]) << 8) | (((Uint32) ptr[1]) << 16) |
+                      (((Uint32) ptr[0]) << 24) );
+} /* load_s24msb */
+
+static SDL_INLINE float load_f64lsb(const void *p, Uint32 i)
+{
+    union { Uint64 ui64; double d; } cvt;
+    cvt.ui64 = SDL_SwapLE64(((const Uint64 *) p)[i]);
+    return (float) cvt.d;
+} /* load_f64lsb */
+
+static SDL_INLINE float load_f64msb(const void *p, Uint32 i)
+{
+    union { Uint64 ui64; double d; } cvt;
+    cvt.ui64 = SDL_SwapBE64(((const Uint64 *) p)[i]);
+    return (float) cvt.d;
+} /* load_f64msb */
+
+/* G.711 companded bytes to signed 16-bit. The µ-law table was generated by
+   a throwaway perl script (it used to live in the .au decoder); the A-law
+   one follows the same G.711 decoding rules. */
+static const Sint16 ulaw_to_linear[256] = {
+    -32124,-31100,-30076,-29052,-28028,-27004,-25980,-24956,
+    -23932,-22908,-21884,-20860,-19836,-18812,-17788,-16764,
+    -15996,-15484,-14972,-14460,-13948,-13436,-12924,-12412,
+    -11900,-11388,-10876,-10364, -9852, -9340, -8828, -8316,
+     -7932, -7676, -7420, -7164, -6908, -6652, -6396, -6140,
+     -5884, -5628, -5372, -5116, -4860, -4604, -4348, -4092,
+     -3900, -3772, -3644, -3516, -3388, -3260, -3132, -3004,
+     -2876, -2748, -2620, -2492, -2364, -2236, -2108, -1980,
+     -1884, -1820, -1756, -1692, -1628, -1564, -1500, -1436,
+     -1372, -1308, -1244, -1180, -1116, -1052,  -988,  -924,
+      -876,  -844,  -812,  -780,  -748,  -716,  -684,  -652,
+      -620,  -588,  -556,  -524,  -492,  -460,  -428,  -396,
+      -372,  -356,  -340,  -324,  -308,  -292,  -276,  -260,
+      -244,  -228,  -212,  -196,  -180,  -164,  -148,  -132,
+      -120,  -112,  -104,   -96,   -88,   -80,   -72,   -64,
+       -56,   -48,   -40,   -32,   -24,   -16,    -8,     0,
+     32124, 31100, 30076, 29052, 28028, 27004, 25980, 24956,
+     23932, 22908, 21884, 20860, 19836, 18812, 17788, 16764,
+     15996, 15484, 14972, 14460, 13948, 13436, 12924, 12412,
+     11900, 11388, 10876, 10364,  9852,  9340,  8828,  8316,
+      7932,  7676,  7420,  7164,  6908,  6652,  6396,  6140,
+      5884,  5628,  5372,  5116,  4860,  4604,  4348,  4092,
+      3900,  3772,  3644,  3516,  3388,  3260,  3132,  3004,
+      2876,  2748,  2620,  2492,  2364,  2236,  2108,  1980,
+      1884,  1820,  1756,  1692,  1628,  1564,  1500,  1436,
+      1372,  1308,  1244,  1180,  1116,  1052,   988,   924,
+       876,   844,   812,   780,   748,   716,   684,   652,
+       620,   588,   556,   524,   492,   460,   428,   396,
+       372,   356,   340,   324,   308,   292,   276,   260,
+       244,   228,   212,   196,   180,   164,   148,   132,
+       120,   112,   104,    96,    88,    80,    72,    64,
+        56,    48,    40,    32,    24,    16,     8,     0
+};
+
+static const Sint16 alaw_to_linear[256] = {
+     -5504, -5248, -6016, -5760, -4480, -4224, -4992, -4736,
+     -7552, -7296, -8064, -7808, -6528, -6272, -7040, -6784,
+     -2752, -2624, -3008, -2880, -2240, -2112, -2496, -2368,
+     -3776, -3648, -4032, -3904, -3264, -3136, -3520, -3392,
+    -22016,-20992,-24064,-23040,-17920,-16896,-19968,-18944,
+    -30208,-29184,-32256,-31232,-26112,-25088,-28160,-27136,
+    -11008,-10496,-12032,-11520, -8960, -8448, -9984, -9472,
+    -15104,-14592,-16128,-15616,-13056,-12544,-14080,-13568,
+      -344,  -328,  -376,  -360,  -280,  -264,  -312,  -296,
+      -472,  -456,  -504,  -488,  -408,  -392,  -440,  -424,
+       -88,   -72,  -120,  -104,   -24,    -8,   -56,   -40,
+      -216,  -200,  -248,  -232,  -152,  -136,  -184,  -168,
+     -1376, -1312, -1504, -1440, -1120, -1056, -1248, -1184,
+     -1888, -1824, -2016, -1952, -1632, -1568, -1760, -1696,
+      -688,  -656,  -752,  -720,  -560,  -528,  -624,  -592,
+      -944,  -912, -1008,  -976,  -816,  -784,  -880,  -848,
+      5504,  5248,  6016,  5760,  4480,  4224,  4992,  4736,
+      7552,  7296,  8064,  7808,  6528,  6272,  7040,  6784,
+      2752,  2624,  3008,  2880,  2240,  2112,  2496,  2368,
+      3776,  3648,  4032,  3904,  3264,  3136,  3520,  3392,
+     22016, 20992, 24064, 23040, 17920, 16896, 19968, 18944,
+     30208, 29184, 32256, 31232, 26112, 25088, 28160, 27136,
+     11008, 10496, 12032, 11520,  8960,  8448,  9984,  9472,
+     15104, 14592, 16128, 15616, 13056, 12544, 14080, 13568,
+       344,   328,   376,   360,   280,   264,   312,   296,
+       472,   456,   504,   488,   408,   392,   440,   424,
+        88,    72,   120,   104,    24,     8,    56,    40,
+       216,   200,   248,   232,   152,   136,   184,   168,
+      1376,  1312,  1504,  1440,  1120,  1056,  1248,  1184,
+      1888,  1824,  2016,  1952,  1632,  1568,  1760,  1696,
+       688,   656,   752,   720,   560,   528,   624,   592,
+       944,   912,  1008,   976,   816,   784,   880,   848
+};
+
+
+/* Load one sample as a float in [-1.0, 1.0). */
+#define LOAD_U8(p, i) ((((float) ((const Uint8 *) (p))[i]) - 128.0f) * (1.0f / 128.0f))
+#define LOAD_S8(p, i) (((float) ((const Sint8 *) (p))[i]) * (1.0f / 128.0f))
+#define LOAD_U16LSB(p, i) ((((float) SDL_SwapLE16(((const Uint16 *) (p))[i])) - 32768.0f) * (1.0f / 32768.0f))
+#define LOAD_U16MSB(p, i) ((((float) SDL_SwapBE16(((const Uint16 *) (p))[i])) - 32768.0f) * (1.0f / 32768.0f))
+#define LOAD_S16LSB(p, i) (((float) ((Sint16) SDL_SwapLE16(((const Uint16 *) (p))[i]))) * (1.0f / 32768.0f))
+#define LOAD_S16MSB(p, i) (((float) ((Sint16) SDL_SwapBE16(((const Uint16 *) (p))[i]))) * (1.0f / 32768.0f))
+#define LOAD_S32LSB(p, i) (((float) ((Sint32) SDL_SwapLE32(((const Uint32 *) (p))[i]))) * (1.0f / 2147483648.0f))
+#define LOAD_S32MSB(p, i) (((float) ((Sint32) SDL_SwapBE32(((const Uint32 *) (p))[i]))) * (1.0f / 2147483648.0f))
+#define LOAD_F32LSB(p, i) SDL_SwapFloatLE(((const float *) (p))[i])
+#define LOAD_F32MSB(p, i) SDL_SwapFloatBE(((const float *) (p))[i])
+#define LOAD_S24LSB(p, i) (((float) load_s24lsb(p, i)) * (1.0f / 2147483648.0f))
+#define LOAD_S24MSB(p, i) (((float) load_s24msb(p, i)) * (1.0f / 2147483648.0f))
+#define LOAD_F64LSB(p, i) load_f64lsb(p, i)
+#define LOAD_F64MSB(p, i) load_f64msb(p, i)
+#define LOAD_ULAW(p, i) (((float) ulaw_to_linear[((const Uint8 *) (p))[i]]) * (1.0f / 32768.0f))
+#define LOAD_ALAW(p, i) (((float) alaw_to_linear[((const Uint8 *) (p))[i]]) * (1.0f / 32768.0f))
+
+/* Store one float sample in native byte order. */
+#define STORE_S16(p, i, v) ((Sint16 *) (p))[i] = float_to_s16(v)
+#define STORE_S32(p, i, v) ((Sint32 *) (p))[i] = float_to_s32(v)
+#define STORE_F32(p, i, v) ((float *) (p))[i] = (v)
+
+/*
+ * This builds the three scalar converters for one pair of sample types:
+ *  same channel count, mono to stereo, and stereo to mono (averaged).
+ *  The size comparisons are constant, so the compiler keeps one loop.
+ */
+#define SOUND_CONVERTERS(src, srcsize, dst, dstsize) \
+    static void convert_##src##_to_##dst(const void *in, void *out, \
+                                         Uint32 frames, Uint32 channels) \
+    { \
+        const Uint32 total = frames * channels; \
+        Uint32 i; \
+        if (dstsize > srcsize) { \
+            for (i = total; i > 0; i--) { \
+                const float val = LOAD_##src(in, i - 1); \
+                STORE_##dst(out, i - 1, val); \
+            } \
+        } else { \
+            for (i = 0; i < total; i++) { \
+                const float val = LOAD_##src(in, i); \
+                STORE_##dst(out, i, val); \
+            } \
+        } \
+    } \
+    static void convert_##src##_to_##dst##_mono_to_stereo(const void *in, \
+                        void *out, Uint32 frames, Uint32 channels) \
+    { \
+        Uint32 i; \
+        for (i = frames; i > 0; i--) { \
+            const float val = LOAD_##src(in, i - 1); \
+            STORE_##dst(out, (i * 2) - 2, val); \
+            STORE_##dst(out, (i * 2) - 1, val); \
+        } \
+    } \
+    static void convert_##src##_to_##dst##_stereo_to_mono(const void *in, \
+                        void *out, Uint32 frames, Uint32 channels) \
+    { \
+        Uint32 i; \
+        if (dstsize > (srcsize * 2)) { \
+            for (i = frames; i > 0; i--) { \
+                const float l = LOAD_##src(in, (i * 2) - 2); \
+                const float r = LOAD_##src(in, (i * 2) - 1); \
+                STORE_##dst(out, i - 1, (l + r) * 0.5f); \
+            } \
+        } else { \
+            for (i = 0; i < frames; i++) { \
+                const float l = LOAD_##src(in, i * 2); \
+                const float r = LOAD_##src(in, (i * 2) + 1); \
+                STORE_##dst(out, i, (l + r) * 0.5f); \
+            } \
+        } \
+    }
+
+#define SOUND_CONVERTERS_TO_ALL(src, srcsize) \
+    SOUND_CONVERTERS(src, srcsize, S16, 2) \
+    SOUND_CONVERTERS(src, srcsize, S32, 4) \
+    SOUND_CONVERTERS(src, srcsize, F32, 4)
+
+SOUND_CONVERTERS_TO_ALL(U8, 1)
+SOUND_CONVERTERS_TO_ALL(S8, 1)
+SOUND_CONVERTERS_TO_ALL(U16LSB, 2)
+SOUND_CONVERTERS_TO_ALL(U16MSB, 2)
+SOUND_CONVERTERS_TO_ALL(S16LSB, 2)
+SOUND_CONVERTERS_TO_ALL(S16MSB, 2)
+SOUND_CONVERTERS_TO_ALL(S32LSB, 4)
+SOUND_CONVERTERS_TO_ALL(S32MSB, 4)
+SOUND_CONVERTERS_TO_ALL(F32LSB, 4)
+SOUND_CONVERTERS_TO_ALL(F32MSB, 4)
+SOUND_CONVERTERS_TO_ALL(S24LSB, 3)
+SOUND_CONVERTERS_TO_ALL(S24MSB, 3)
+SOUND_CONVERTERS_TO_ALL(F64LSB, 8)
+SOUND_CONVERTERS_TO_ALL(F64MSB, 8)
+SOUND_CONVERTERS_TO_ALL(ULAW, 1)
+SOUND_CONVERTERS_TO_ALL(ALAW, 1)
+
+#undef SOUND_CONVERTERS_TO_ALL
+#undef SOUND_CONVERTERS
+
+
+/* Just flipping byte order (S16MSB to S16LSB, etc) is exact; skip floats. */
+static void swap16(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    const Uint16 *src = (const Uint16 *) in;
+    Uint16 *dst = (Uint16 *) out;
+    const Uint32 total = frames * channels;
+    Uint32 i;
+    for (i = 0; i < total; i++)
+        dst[i] = SDL_Swap16(src[i]);
+} /* swap16 */
+
+static void swap32(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    const Uint32 *src = (const Uint32 *) in;
+    Uint32 *dst = (Uint32 *) out;
+    const Uint32 total = frames * channels;
+    Uint32 i;
+    for (i = 0; i < total; i++)
+        dst[i] = SDL_Swap32(src[i]);
+} /* swap32 */
+
+/* Expanding G.711 to 16-bit is exact; a table lookup beats going through float. */
+static void ulaw_to_s16(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    const Uint8 *src = (const Uint8 *) in;
+    Sint16 *dst = (Sint16 *) out;
+    Uint32 i;
+    for (i = frames * channels; i > 0; i--)
+        dst[i - 1] = ulaw_to_linear[src[i - 1]];
+} /* ulaw_to_s16 */
+
+static void alaw_to_s16(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    const Uint8 *src = (const Uint8 *) in;
+    Sint16 *dst = (Sint16 *) out;
+    Uint32 i;
+    for (i = frames * channels; i > 0; i--)
+        dst[i - 1] = alaw_to_linear[src[i - 1]];
+} /* alaw_to_s16 */
+
+
+/*
+ * SIMD versions of the conversions we see the most: 16-bit integer to and
+ *  from float (most decoders, most audio devices), 16- and 32-bit
+ *  byteswapping (AIFF is big-endian), 32-bit integer to float (FLAC),
+ *  unpacking 24-bit (WAV, AIFF), and expanding µ-law/A-law (.au). The
+ *  scalar versions above handle whatever's left over at the ends.
+ */
+
+#if SOUND_HAVE_SSE_INTRINSICS
+static SOUND_TARGETING("sse2") void s16_to_f32_sse2(const void *in, void *out,
+                                                     Uint32 frames, Uint32 channels)
+{
+    const Sint16 *src = (const Sint16 *) in;
+    float *dst = (float *) out;
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    Uint32 i = frames * channels;
+
+    /* we grow, so go backwards. Odd samples at the end go first. */
+    while (i % 8)
+    {
+        i--;
+        dst[i] = ((float) src[i]) * (1.0f / 32768.0f);
+    } /* while */
+
+    while (i > 0)
+    {
+        __m128i ints;
+        i -= 8;
+        ints = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(ints, ints), 16)), scale));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(ints, ints), 16)), scale));
+    } /* while */
+} /* s16_to_f32_sse2 */
+
+static SOUND_TARGETING("sse2") void s16swap_to_f32_sse2(const void *in, void *out,
+                                                         Uint32 frames, Uint32 channels)
+{
+    const Uint16 *src = (const Uint16 *) in;
+    float *dst = (float *) out;
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    Uint32 i = frames * channels;
+
+    while (i % 8)
+    {
+        i--;
+        dst[i] = ((float) ((Sint16) SDL_Swap16(src[i]))) * (1.0f / 32768.0f);
+    } /* while */
+
+    while (i > 0)
+    {
+        __m128i ints;
+        i -= 8;
+        ints = _mm_loadu_si128((const __m128i *) (src + i));
+        ints = _mm_or_si128(_mm_slli_epi16(ints, 8), _mm_srli_epi16(ints, 8));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(ints, ints), 16)), scale));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(ints, ints), 16)), scale));
+    } /* while */
+} /* s16swap_to_f32_sse2 */
+
+static SOUND_TARGETING("sse2") void f32_to_s16_sse2(const void *in, void *out,
+                                                     Uint32 frames, Uint32 channels)
+{
+    const float *src = (const float *) in;
+    Sint16 *dst = (Sint16 *) out;
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 negone = _mm_set1_ps(-1.0f);
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    /* we shrink, so go forwards. packs saturates 32768 down to 32767. */
+    for (i = 0; i + 8 <= total; i += 8)
+    {
+        const __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), negone), one);
+        const __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), negone), one);
+        const __m128i ia = _mm_cvttps_epi32(_mm_mul_ps(a, scale));
+        const __m128i ib = _mm_cvttps_epi32(_mm_mul_ps(b, scale));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packs_epi32(ia, ib));
+    } /* for */
+
+    for (; i < total; i++)
+        dst[i] = float_to_s16(src[i]);
+} /* f32_to_s16_sse2 */
+
+static SOUND_TARGETING("sse2") void s32_to_f32_sse2(const void *in, void *out,
+                                                     Uint32 frames, Uint32 channels)
+{
+    const Sint32 *src = (const Sint32 *) in;
+    float *dst = (float *) out;
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    for (i = 0; i + 4 <= total; i += 4)
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (src + i))), scale));
+
+    for (; i < total; i++)
+        dst[i] = ((float) src[i]) * (1.0f / 2147483648.0f);
+} /* s32_to_f32_sse2 */
+
+static SOUND_TARGETING("sse2") void swap16_sse2(const void *in, void *out,
+                                                 Uint32 frames, Uint32 channels)
+{
+    const Uint16 *src = (const Uint16 *) in;
+    Uint16 *dst = (Uint16 *) out;
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    for (i = 0; i + 8 <= total; i += 8)
+    {
+        const __m128i val = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_or_si128(_mm_slli_epi16(val, 8), _mm_srli_epi16(val, 8)));
+    } /* for */
+
+    for (; i < total; i++)
+        dst[i] = SDL_Swap16(src[i]);
+} /* swap16_sse2 */
+
+/*
+ * Packed 24-bit widens four samples per shuffle, in either byte order
+ *  (AIFF stores it big-endian). We grow, so go backwards; the 16-byte load
+ *  reads a sample past the four we want, so the last couple of samples are
+ *  always done one at a time.
+ */
+SDL_FORCE_INLINE SOUND_TARGETING("sse4.1") __m128i load_s24_sse41(const Uint8 *src, const int msb)
+{
+    const __m128i lsb_shuf = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                                           -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128i msb_shuf = _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3,
+                                           -1, 8, 7, 6, -1, 11, 10, 9);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), msb ? msb_shuf : lsb_shuf);
+} /* load_s24_sse41 */
+
+SDL_FORCE_INLINE SOUND_TARGETING("sse4.1") void s24_to_s32_sse41(const Uint8 *src,
+                                                Sint32 *dst, Uint32 total, const int msb)
+{
+    Uint32 i = total;
+
+    while ((i > 0) && ((i % 4) || (i + 2 > total)))
+    {
+        i--;
+        dst[i] = msb ? load_s24msb(src, i) : load_s24lsb(src, i);
+    } /* while */
+
+    while (i > 0)
+    {
+        i -= 4;
+        _mm_storeu_si128((__m128i *) (dst + i), load_s24_sse41(src + (i * 3), msb));
+    } /* while */
+} /* s24_to_s32_sse41 */
+
+SDL_FORCE_INLINE SOUND_TARGETING("sse4.1") void s24_to_f32_sse41(const Uint8 *src,
+                                                float *dst, Uint32 total, const int msb)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    Uint32 i = total;
+
+    while ((i > 0) && ((i % 4) || (i + 2 > total)))
+    {
+        i--;
+        dst[i] = msb ? LOAD_S24MSB(src, i) : LOAD_S24LSB(src, i);
+    } /* while */
+
+    while (i > 0)
+    {
+        i -= 4;
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(load_s24_sse41(src + (i * 3), msb)), scale));
+    } /* while */
+} /* s24_to_f32_sse41 */
+
+static SOUND_TARGETING("sse4.1") void s24lsb_to_s32_sse41(const void *in, void *out,
+                                                           Uint32 frames, Uint32 channels)
+{
+    s24_to_s32_sse41((const Uint8 *) in, (Sint32 *) out, frames * channels, 0);
+} /* s24lsb_to_s32_sse41 */
+
+static SOUND_TARGETING("sse4.1") void s24lsb_to_f32_sse41(const void *in, void *out,
+                                                           Uint32 frames, Uint32 channels)
+{
+    s24_to_f32_sse41((const Uint8 *) in, (float *) out, frames * channels, 0);
+} /* s24lsb_to_f32_sse41 */
+
+static SOUND_TARGETING("sse4.1") void s24msb_to_s32_sse41(const void *in, void *out,
+                                                           Uint32 frames, Uint32 channels)
+{
+    s24_to_s32_sse41((const Uint8 *) in, (Sint32 *) out, frames * channels, 1);
+} /* s24msb_to_s32_sse41 */
+
+static SOUND_TARGETING("sse4.1") void s24msb_to_f32_sse41(const void *in, void *out,
+                                                           Uint32 frames, Uint32 channels)
+{
+    s24_to_f32_sse41((const Uint8 *) in, (float *) out, frames * channels, 1);
+} /* s24msb_to_f32_sse41 */
+
+/* 32-bit byteswapping (big-endian float and Sint32 AIFF) is one pshufb. */
+static SOUND_TARGETING("sse4.1") void swap32_sse41(const void *in, void *out,
+                                                    Uint32 frames, Uint32 channels)
+{
+    const __m128i shuf = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                       11, 10, 9, 8, 15, 14, 13, 12);
+    const Uint32 *src = (const Uint32 *) in;
+    Uint32 *dst = (Uint32 *) out;
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    for (i = 0; i + 4 <= total; i += 4)
+    {
+        const __m128i val = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_shuffle_epi8(val, shuf));
+    } /* for */
+
+    for (; i < total; i++)
+        dst[i] = SDL_Swap32(src[i]);
+} /* swap32_sse41 */
+
+/*
+ * G.711 expansion without the table: split each byte into sign, exponent
+ *  and mantissa, then get (1 << exponent) from a byte shuffle so a single
+ *  16-bit multiply does the per-lane shift. Input is eight bytes already
+ *  widened to 16-bit lanes. The results match the tables exactly.
+ */
+SDL_FORCE_INLINE SOUND_TARGETING("sse4.1") __m128i g711_expand_sse41(__m128i x, const int alaw)
+{
+    const __m128i ulaw_scale = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                             0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i alaw_scale = _mm_setr_epi8(1, 1, 2, 4, 8, 16, 32, 64,
+                                             0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i sign = _mm_set1_epi16(0x80);
+    __m128i exponent, mantissa, scale, val, negative;
+
+    x = _mm_xor_si128(x, _mm_set1_epi16(alaw ? 0x55 : 0xFF));
+    exponent = _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi16(7));
+    mantissa = _mm_and_si128(x, _mm_set1_epi16(0x0F));
+    /* 0x8000 zeroes the high byte of each lane's shuffle result. */
+    scale = _mm_or_si128(exponent, _mm_set1_epi16((short) 0x8000));
+
+    if (alaw)
+    {
+        /* segment 0 has no implied leading bit, and isn't shifted. */
+        const __m128i lead = _mm_and_si128(_mm_cmpgt_epi16(exponent, _mm_setzero_si128()), _mm_set1_epi16(0x100));
+        val = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(mantissa, 4), _mm_set1_epi16(8)), lead);
+        val = _mm_mullo_epi16(val, _mm_shuffle_epi8(alaw_scale, scale));
+        negative = _mm_cmpeq_epi16(_mm_and_si128(x, sign), _mm_setzero_si128());
+    } /* if */
+    else
+    {
+        val = _mm_add_epi16(_mm_slli_epi16(mantissa, 3), _mm_set1_epi16(0x84));
+        val = _mm_mullo_epi16(val, _mm_shuffle_epi8(ulaw_scale, scale));
+        val = _mm_sub_epi16(val, _mm_set1_epi16(0x84));
+        negative = _mm_cmpeq_epi16(_mm_and_si128(x, sign), sign);
+    } /* else */
+
+    return _mm_sub_epi16(_mm_xor_si128(val, negative), negative);
+} /* g711_expand_sse41 */
+
+/* sixteen bytes in, sixteen samples out; we grow, so go backwards. */
+SDL_FORCE_INLINE SOUND_TARGETING("sse4.1") void g711_to_s16_sse41(const Uint8 *src,
+                                Sint16 *dst, Uint32 total, const Sint16 *table, const int alaw)
+{
+    Uint32 i = total;
+
+    while (i % 16)
+    {
+        i--;
+        dst[i] = table[src[i]];
+    } /* while */
+
+    while (i > 0)
+    {
+        __m128i bytes;
+        i -= 16;
+        bytes = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i + 8), g711_expand_sse41(_mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8)), alaw));
+        _mm_storeu_si128((__m128i *) (dst + i), g711_expand_sse41(_mm_cvtepu8_epi16(bytes), alaw));
+    } /* while */
+} /* g711_to_s16_sse41 */
+
+SDL_FORCE_INLINE SOUND_TARGETING("sse4.1") void g711_to_f32_sse41(const Uint8 *src,
+                                float *dst, Uint32 total, const Sint16 *table, const int alaw)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    Uint32 i = total;
+
+    while (i % 16)
+    {
+        i--;
+        dst[i] = ((float) table[src[i]]) * (1.0f / 32768.0f);
+    } /* while */
+
+    while (i > 0)
+    {
+        __m128i bytes, lo, hi;
+        i -= 16;
+        bytes = _mm_loadu_si128((const __m128i *) (src + i));
+        hi = g711_expand_sse41(_mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8)), alaw);
+        lo = g711_expand_sse41(_mm_cvtepu8_epi16(bytes), alaw);
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(hi, 8))), scale));
+        _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(hi)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(lo, 8))), scale));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(lo)), scale));
+    } /* while */
+} /* g711_to_f32_sse41 */
+
+static SOUND_TARGETING("sse4.1") void ulaw_to_s16_sse41(const void *in, void *out,
+                                                         Uint32 frames, Uint32 channels)
+{
+    g711_to_s16_sse41((const Uint8 *) in, (Sint16 *) out, frames * channels, ulaw_to_linear, 0);
+} /* ulaw_to_s16_sse41 */
+
+static SOUND_TARGETING("sse4.1") void alaw_to_s16_sse41(const void *in, void *out,
+                                                         Uint32 frames, Uint32 channels)
+{
+    g711_to_s16_sse41((const Uint8 *) in, (Sint16 *) out, frames * channels, alaw_to_linear, 1);
+} /* alaw_to_s16_sse41 */
+
+static SOUND_TARGETING("sse4.1") void ulaw_to_f32_sse41(const void *in, void *out,
+                                                         Uint32 frames, Uint32 channels)
+{
+    g711_to_f32_sse41((const Uint8 *) in, (float *) out, frames * channels, ulaw_to_linear, 0);
+} /* ulaw_to_f32_sse41 */
+
+static SOUND_TARGETING("sse4.1") void alaw_to_f32_sse41(const void *in, void *out,
+                                                         Uint32 frames, Uint32 channels)
+{
+    g711_to_f32_sse41((const Uint8 *) in, (float *) out, frames * channels, alaw_to_linear, 1);
+} /* alaw_to_f32_sse41 */
+#endif
+
+#if SOUND_HAVE_AVX_INTRINSICS
+static SOUND_TARGETING("avx2") void s16_to_f32_avx2(const void *in, void *out,
+                                                     Uint32 frames, Uint32 channels)
+{
+    const Sint16 *src = (const Sint16 *) in;
+    float *dst = (float *) out;
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    Uint32 i = frames * channels;
+
+    while (i % 16)
+    {
+        i--;
+        dst[i] = ((float) src[i]) * (1.0f / 32768.0f);
+    } /* while */
+
+    while (i > 0)
+    {
+        __m128i lo, hi;
+        i -= 16;
+        lo = _mm_loadu_si128((const __m128i *) (src + i));
+        hi = _mm_loadu_si128((const __m128i *) (src + i + 8));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(hi)), scale));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(lo)), scale));
+    } /* while */
+} /* s16_to_f32_avx2 */
+
+static SOUND_TARGETING("avx2") void f32_to_s16_avx2(const void *in, void *out,
+                                                     Uint32 frames, Uint32 channels)
+{
+    const float *src = (const float *) in;
+    Sint16 *dst = (Sint16 *) out;
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 negone = _mm256_set1_ps(-1.0f);
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    for (i = 0; i + 16 <= total; i += 16)
+    {
+        const __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), negone), one);
+        const __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i + 8), negone), one);
+        const __m256i ia = _mm256_cvttps_epi32(_mm256_mul_ps(a, scale));
+        const __m256i ib = _mm256_cvttps_epi32(_mm256_mul_ps(b, scale));
+            /* packs works within 128-bit lanes, so put the halves back. */
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(ia, ib), 0xD8);
+        _mm256_storeu_si256((__m256i *) (dst + i), packed);
+    } /* for */
+
+    for (; i < total; i++)
+        dst[i] = float_to_s16(src[i]);
+} /* f32_to_s16_avx2 */
+#endif
+
+#if SOUND_HAVE_NEON_INTRINSICS
+static void s16_to_f32_neon(const void *in, void *out,
+                            Uint32 frames, Uint32 channels)
+{
+    const Sint16 *src = (const Sint16 *) in;
+    float *dst = (float *) out;
+    Uint32 i = frames * channels;
+
+    while (i % 8)
+    {
+        i--;
+        dst[i] = ((float) src[i]) * (1.0f / 32768.0f);
+    } /* while */
+
+    while (i > 0)
+    {
+        int16x8_t ints;
+        i -= 8;
+        ints = vld1q_s16(src + i);
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(ints))), 1.0f / 32768.0f));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(ints))), 1.0f / 32768.0f));
+    } /* while */
+} /* s16_to_f32_neon */
+
+static void s16swap_to_f32_neon(const void *in, void *out,
+                                Uint32 frames, Uint32 channels)
+{
+    const Uint16 *src = (const Uint16 *) in;
+    float *dst = (float *) out;
+    Uint32 i = frames * channels;
+
+    while (i % 8)
+    {
+        i--;
+        dst[i] = ((float) ((Sint16) SDL_Swap16(src[i]))) * (1.0f / 32768.0f);
+    } /* while */
+
+    while (i > 0)
+    {
+        int16x8_t ints;
+        i -= 8;
+        ints = vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(src + i))));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(ints))), 1.0f / 32768.0f));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(ints))), 1.0f / 32768.0f));
+    } /* while */
+} /* s16swap_to_f32_neon */
+
+static void f32_to_s16_neon(const void *in, void *out,
+                            Uint32 frames, Uint32 channels)
+{
+    const float *src = (const float *) in;
+    Sint16 *dst = (Sint16 *) out;
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t negone = vdupq_n_f32(-1.0f);
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    for (i = 0; i + 8 <= total; i += 8)
+    {
+        const float32x4_t a = vminq_f32(vmaxq_f32(vld1q_f32(src + i), negone), one);
+        const float32x4_t b = vminq_f32(vmaxq_f32(vld1q_f32(src + i + 4), negone), one);
+        const int32x4_t ia = vcvtq_s32_f32(vmulq_n_f32(a, 32768.0f));
+        const int32x4_t ib = vcvtq_s32_f32(vmulq_n_f32(b, 32768.0f));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(ia), vqmovn_s32(ib)));
+    } /* for */
+
+    for (; i < total; i++)
+        dst[i] = float_to_s16(src[i]);
+} /* f32_to_s16_neon */
+
+static void s32_to_f32_neon(const void *in, void *out,
+                            Uint32 frames, Uint32 channels)
+{
+    const Sint32 *src = (const Sint32 *) in;
+    float *dst = (float *) out;
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    for (i = 0; i + 4 <= total; i += 4)
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)), 1.0f / 2147483648.0f));
+
+    for (; i < total; i++)
+        dst[i] = ((float) src[i]) * (1.0f / 2147483648.0f);
+} /* s32_to_f32_neon */
+
+static void swap16_neon(const void *in, void *out,
+                        Uint32 frames, Uint32 channels)
+{
+    const Uint16 *src = (const Uint16 *) in;
+    Uint16 *dst = (Uint16 *) out;
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    for (i = 0; i + 8 <= total; i += 8)
+        vst1q_u16(dst + i, vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(src + i)))));
+
+    for (; i < total; i++)
+        dst[i] = SDL_Swap16(src[i]);
+} /* swap16_neon */
+
+static void swap32_neon(const void *in, void *out,
+                        Uint32 frames, Uint32 channels)
+{
+    const Uint32 *src = (const Uint32 *) in;
+    Uint32 *dst = (Uint32 *) out;
+    const Uint32 total = frames * channels;
+    Uint32 i;
+
+    for (i = 0; i + 4 <= total; i += 4)
+        vst1q_u32(dst + i, vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(vld1q_u32(src + i)))));
+
+    for (; i < total; i++)
+        dst[i] = SDL_Swap32(src[i]);
+} /* swap32_neon */
+
+/* vld3 splits eight packed 24-bit samples into their three bytes. */
+SDL_FORCE_INLINE void load_s24_neon(const Uint8 *src, int32x4_t *lo, int32x4_t *hi, const int msb)
+{
+    const uint8x8x3_t bytes = vld3_u8(src);
+    const uint8x8_t b0 = msb ? bytes.val[2] : bytes.val[0];  /* least significant */
+    const uint8x8_t b2 = msb ? bytes.val[0] : bytes.val[2];  /* most significant */
+    const uint16x8_t low = vshll_n_u8(b0, 8);
+    const uint16x8_t high = vorrq_u16(vmovl_u8(bytes.val[1]), vshll_n_u8(b2, 8));
+    const uint16x8x2_t both = vzipq_u16(low, high);
+    *lo = vreinterpretq_s32_u16(both.val[0]);
+    *hi = vreinterpretq_s32_u16(both.val[1]);
+} /* load_s24_neon */
+
+SDL_FORCE_INLINE void s24_to_s32_neon(const Uint8 *src, Sint32 *dst, Uint32 total, const int msb)
+{
+    Uint32 i = total;
+
+    /* we grow, so go backwards. Odd samples at the end go first. */
+    while (i % 8)
+    {
+        i--;
+        dst[i] = msb ? load_s24msb(src, i) : load_s24lsb(src, i);
+    } /* while */
+
+    while (i > 0)
+    {
+        int32x4_t lo, hi;
+        i -= 8;
+        load_s24_neon(src + (i * 3), &lo, &hi, msb);
+        vst1q_s32(dst + i + 4, hi);
+        vst1q_s32(dst + i, lo);
+    } /* while */
+} /* s24_to_s32_neon */
+
+SDL_FORCE_INLINE void s24_to_f32_neon(const Uint8 *src, float *dst, Uint32 total, const int msb)
+{
+    Uint32 i = total;
+
+    while (i % 8)
+    {
+        i--;
+        dst[i] = msb ? LOAD_S24MSB(src, i) : LOAD_S24LSB(src, i);
+    } /* while */
+
+    while (i > 0)
+    {
+        int32x4_t lo, hi;
+        i -= 8;
+        load_s24_neon(src + (i * 3), &lo, &hi, msb);
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(hi), 1.0f / 2147483648.0f));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(lo), 1.0f / 2147483648.0f));
+    } /* while */
+} /* s24_to_f32_neon */
+
+static void s24lsb_to_s32_neon(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    s24_to_s32_neon((const Uint8 *) in, (Sint32 *) out, frames * channels, 0);
+} /* s24lsb_to_s32_neon */
+
+static void s24lsb_to_f32_neon(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    s24_to_f32_neon((const Uint8 *) in, (float *) out, frames * channels, 0);
+} /* s24lsb_to_f32_neon */
+
+static void s24msb_to_s32_neon(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    s24_to_s32_neon((const Uint8 *) in, (Sint32 *) out, frames * channels, 1);
+} /* s24msb_to_s32_neon */
+
+static void s24msb_to_f32_neon(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    s24_to_f32_neon((const Uint8 *) in, (float *) out, frames * channels, 1);
+} /* s24msb_to_f32_neon */
+
+/* Same G.711 bit-twiddling as the SSE4.1 version, but NEON has real
+   per-lane shifts, so no multiply. */
+SDL_FORCE_INLINE int16x8_t g711_expand_neon(uint8x8_t bytes, const int alaw)
+{
+    const uint16x8_t x = vmovl_u8(veor_u8(bytes, vdup_n_u8(alaw ? 0x55 : 0xFF)));
+    const uint16x8_t exponent = vandq_u16(vshrq_n_u16(x, 4), vdupq_n_u16(7));
+    const uint16x8_t mantissa = vandq_u16(x, vdupq_n_u16(0x0F));
+    const uint16x8_t sign = vtstq_u16(x, vdupq_n_u16(0x80));
+    int16x8_t val;
+
+    if (alaw)
+    {
+        /* segment 0 has no implied leading bit, and isn't shifted. */
+        const uint16x8_t seg = vminq_u16(exponent, vdupq_n_u16(1));
+        const uint16x8_t mag = vaddq_u16(vaddq_u16(vshlq_n_u16(mantissa, 4), vdupq_n_u16(8)), vshlq_n_u16(seg, 8));
+        val = vreinterpretq_s16_u16(vshlq_u16(mag, vreinterpretq_s16_u16(vsubq_u16(exponent, seg))));
+        return vbslq_s16(sign, val, vnegq_s16(val));
+    } /* if */
+
+    val = vreinterpretq_s16_u16(vshlq_u16(vaddq_u16(vshlq_n_u16(mantissa, 3), vdupq_n_u16(0x84)), vreinterpretq_s16_u16(exponent)));
+    val = vsubq_s16(val, vdupq_n_s16(0x84));
+    return vbslq_s16(sign, vnegq_s16(val), val);
+} /* g711_expand_neon */
+
+SDL_FORCE_INLINE void g711_to_s16_neon(const Uint8 *src, Sint16 *dst, Uint32 total,
+                                       const Sint16 *table, const int alaw)
+{
+    Uint32 i = total;
+
+    /* we grow, so go backwards. Odd samples at the end go first. */
+    while (i % 8)
+    {
+        i--;
+        dst[i] = table[src[i]];
+    } /* while */
+
+    while (i > 0)
+    {
+        i -= 8;
+        vst1q_s16(dst + i, g711_expand_neon(vld1_u8(src + i), alaw));
+    } /* while */
+} /* g711_to_s16_neon */
+
+SDL_FORCE_INLINE void g711_to_f32_neon(const Uint8 *src, float *dst, Uint32 total,
+                                       const Sint16 *table, const int alaw)
+{
+    Uint32 i = total;
+
+    while (i % 8)
+    {
+        i--;
+        dst[i] = ((float) table[src[i]]) * (1.0f / 32768.0f);
+    } /* while */
+
+    while (i > 0)
+    {
+        int16x8_t val;
+        i -= 8;
+        val = g711_expand_neon(vld1_u8(src + i), alaw);
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(val))), 1.0f / 32768.0f));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(val))), 1.0f / 32768.0f));
+    } /* while */
+} /* g711_to_f32_neon */
+
+static void ulaw_to_s16_neon(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    g711_to_s16_neon((const Uint8 *) in, (Sint16 *) out, frames * channels, ulaw_to_linear, 0);
+} /* ulaw_to_s16_neon */
+
+static void alaw_to_s16_neon(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    g711_to_s16_neon((const Uint8 *) in, (Sint16 *) out, frames * channels, alaw_to_linear, 1);
+} /* alaw_to_s16_neon */
+
+static void ulaw_to_f32_neon(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    g711_to_f32_neon((const Uint8 *) in, (float *) out, frames * channels, ulaw_to_linear, 0);
+} /* ulaw_to_f32_neon */
+
+static void alaw_to_f32_neon(const void *in, void *out, Uint32 frames, Uint32 channels)
+{
+    g711_to_f32_neon((const Uint8 *) in, (float *) out, frames * channels, alaw_to_linear, 1);
+} /* alaw_to_f32_neon */
+#endif
+
+
+typedef struct
+{
+    SDL_AudioFormat src;
+    SDL_AudioFormat dst;
+    Sound_ConvertFn same;
+    Sound_ConvertFn mono_to_stereo;
+    Sound_ConvertFn stereo_to_mono;
+} ConverterEntry;
+
+#define AUDIO_S24LSB SOUND_AUDIO_S24LSB
+#define AUDIO_S24MSB SOUND_AUDIO_S24MSB
+#define AUDIO_F64LSB SOUND_AUDIO_F64LSB
+#define AUDIO_F64MSB SOUND_AUDIO_F64MSB
+#define AUDIO_ULAW SOUND_AUDIO_ULAW
+#define AUDIO_ALAW SOUND_AUDIO_ALAW
+#define SOUND_CONVERTER_ENTRY(src, dst) \
+    { AUDIO_##src, AUDIO_##dst##SYS, convert_##src##_to_##dst, \
+      convert_##src##_to_##dst##_mono_to_stereo, \
+      convert_##src##_to_##dst##_stereo_to_mono }
+
+#define SOUND_CONVERTER_ENTRIES(src) \
+    SOUND_CONVERTER_ENTRY(src, S16), \
+    SOUND_CONVERTER_ENTRY(src, S32), \
+    SOUND_CONVERTER_ENTRY(src, F32)
+
+static const ConverterEntry converters[] =
+{
+    SOUND_CONVERTER_ENTRIES(U8),
+    SOUND_CONVERTER_ENTRIES(S8),
+    SOUND_CONVERTER_ENTRIES(U16LSB),
+    SOUND_CONVERTER_ENTRIES(U16MSB),
+    SOUND_CONVERTER_ENTRIES(S16LSB),
+    SOUND_CONVERTER_ENTRIES(S16MSB),
+    SOUND_CONVERTER_ENTRIES(S32LSB),
+    SOUND_CONVERTER_ENTRIES(S32MSB),
+    SOUND_CONVERTER_ENTRIES(F32LSB),
+    SOUND_CONVERTER_ENTRIES(F32MSB),
+    SOUND_CONVERTER_ENTRIES(S24LSB),
+    SOUND_CONVERTER_ENTRIES(S24MSB),
+    SOUND_CONVERTER_ENTRIES(F64LSB),
+    SOUND_CONVERTER_ENTRIES(F64MSB),
+    SOUND_CONVERTER_ENTRIES(ULAW),
+    SOUND_CONVERTER_ENTRIES(ALAW)
+};
+
+#undef SOUND_CONVERTER_ENTRIES
+#undef SOUND_CONVERTER_ENTRY
+#undef AUDIO_ALAW
+#undef AUDIO_ULAW
+#undef AUDIO_F64MSB
+#undef AUDIO_F64LSB
+#undef AUDIO_S24MSB
+#undef AUDIO_S24LSB
+
+
+/* see if there's a SIMD version of a same-channel-count conversion. */
+static Sound_ConvertFn choose_simd_converter(SDL_AudioFormat srcfmt,
+                                             SDL_AudioFormat dstfmt)
+{
+    const SDL_AudioFormat s16swapped = (AUDIO_S16SYS == AUDIO_S16LSB) ? AUDIO_S16MSB : AUDIO_S16LSB;
+    const SDL_AudioFormat s32swapped = (AUDIO_S32SYS == AUDIO_S32LSB) ? AUDIO_S32MSB : AUDIO_S32LSB;
+    const SDL_AudioFormat f32swapped = (AUDIO_F32SYS == AUDIO_F32LSB) ? AUDIO_F32MSB : AUDIO_F32LSB;
+
+#if SOUND_HAVE_AVX_INTRINSICS
+    if (SDL_HasAVX2())
+    {
+        if ((srcfmt == AUDIO_S16SYS) && (dstfmt == AUDIO_F32SYS))
+            return s16_to_f32_avx2;
+        else if ((srcfmt == AUDIO_F32SYS) && (dstfmt == AUDIO_S16SYS))
+            return f32_to_s16_avx2;
+    } /* if */
+#endif
+
+#if SOUND_HAVE_SSE_INTRINSICS
+    if (SDL_HasSSE41())
+    {
+        if ((srcfmt == SOUND_AUDIO_S24LSB) && (dstfmt == AUDIO_S32SYS))
+            return s24lsb_to_s32_sse41;
+        else if ((srcfmt == SOUND_AUDIO_S24LSB) && (dstfmt == AUDIO_F32SYS))
+            return s24lsb_to_f32_sse41;
+        else if ((srcfmt == SOUND_AUDIO_S24MSB) && (dstfmt == AUDIO_S32SYS))
+            return s24msb_to_s32_sse41;
+        else if ((srcfmt == SOUND_AUDIO_S24MSB) && (dstfmt == AUDIO_F32SYS))
+            return s24msb_to_f32_sse41;
+        else if ((srcfmt == s32swapped) && (dstfmt == AUDIO_S32SYS))
+            return swap32_sse41;
+        else if ((srcfmt == f32swapped) && (dstfmt == AUDIO_F32SYS))
+            return swap32_sse41;
+        else if ((srcfmt == SOUND_AUDIO_ULAW) && (dstfmt == AUDIO_S16SYS))
+            return ulaw_to_s16_sse41;
+        else if ((srcfmt == SOUND_AUDIO_ULAW) && (dstfmt == AUDIO_F32SYS))
+            return ulaw_to_f32_sse41;
+        else if ((srcfmt == SOUND_AUDIO_ALAW) && (dstfmt == AUDIO_S16SYS))
+            return alaw_to_s16_sse41;
+        else if ((srcfmt == SOUND_AUDIO_ALAW) && (dstfmt == AUDIO_F32SYS))
+            return alaw_to_f32_sse41;
+    } /* if */
+
+    if (SDL_HasSSE2())
+    {
+        if ((srcfmt == AUDIO_S16SYS) && (dstfmt == AUDIO_F32SYS))
+            return s16_to_f32_sse2;
+        else if ((srcfmt == s16swapped) && (dstfmt == AUDIO_F32SYS))
+            return s16swap_to_f32_sse2;
+        else if ((srcfmt == AUDIO_F32SYS) && (dstfmt == AUDIO_S16SYS))
+            return f32_to_s16_sse2;
+        else if ((srcfmt == AUDIO_S32SYS) && (dstfmt == AUDIO_F32SYS))
+            return s32_to_f32_sse2;
+        else if ((srcfmt == s16swapped) && (dstfmt == AUDIO_S16SYS))
+            return swap16_sse2;
+    } /* if */
+#endif
+
+#if SOUND_HAVE_NEON_INTRINSICS
+    if (SDL_HasNEON())
+    {
+        if ((srcfmt == AUDIO_S16SYS) && (dstfmt == AUDIO_F32SYS))
+            return s16_to_f32_neon;
+        else if ((srcfmt == s16swapped) && (dstfmt == AUDIO_F32SYS))
+            return s16swap_to_f32_neon;
+        else if ((srcfmt == AUDIO_F32SYS) && (dstfmt == AUDIO_S16SYS))
+            return f32_to_s16_neon;
+        else if ((srcfmt == AUDIO_S32SYS) && (dstfmt == AUDIO_F32SYS))
+            return s32_to_f32_neon;
+        else if ((srcfmt == s16swapped) && (dstfmt == AUDIO_S16SYS))
+            return swap16_neon;
+        else if ((srcfmt == s32swapped) && (dstfmt == AUDIO_S32SYS))
+            return swap32_neon;
+        else if ((srcfmt == f32swapped) && (dstfmt == AUDIO_F32SYS))
+            return swap32_neon;
+        else if ((srcfmt == SOUND_AUDIO_S24LSB) && (dstfmt == AUDIO_S32SYS))
+            return s24lsb_to_s32_neon;
+        else if ((srcfmt == SOUND_AUDIO_S24LSB) && (dstfmt == AUDIO_F32SYS))
+            return s24lsb_to_f32_neon;
+        else if ((srcfmt == SOUND_AUDIO_S24MSB) && (dstfmt == AUDIO_S32SYS))
+            return s24msb_to_s32_neon;
+        else if ((srcfmt == SOUND_AUDIO_S24MSB) && (dstfmt == AUDIO_F32SYS))
+            return s24msb_to_f32_neon;
+        else if ((srcfmt == SOUND_AUDIO_ULAW) && (dstfmt == AUDIO_S16SYS))
+            return ulaw_to_s16_neon;
+        else if ((srcfmt == SOUND_AUDIO_ULAW) && (dstfmt == AUDIO_F32SYS))
+            return ulaw_to_f32_neon;
+        else if ((srcfmt == SOUND_AUDIO_ALAW) && (dstfmt == AUDIO_S16SYS))
+            return alaw_to_s16_neon;
+        else if ((srcfmt == SOUND_AUDIO_ALAW) && (dstfmt == AUDIO_F32SYS))
+            return alaw_to_f32_neon;
+    } /* if */
+#endif
+
+    (void) s16swapped;
+    (void) s32swapped;
+    (void) f32swapped;
+    return NULL;
+} /* choose_simd_converter */
+
+
+Sound_ConvertFn __Sound_GetConverter(SDL_AudioFormat srcfmt, Uint8 srcch,
+                                     SDL_AudioFormat dstfmt, Uint8 dstch)
+{
+    size_t i;
+
+    if (srcch == dstch)
+    {
+        Sound_ConvertFn simd = choose_simd_converter(srcfmt, dstfmt);
+        if (simd != NULL)
+            return simd;
+        else if ((srcfmt == SOUND_AUDIO_ULAW) && (dstfmt == AUDIO_S16SYS))
+            return ulaw_to_s16;
+        else if ((srcfmt == SOUND_AUDIO_ALAW) && (dstfmt == AUDIO_S16SYS))
+            return alaw_to_s16;
+
+            /* same type, other byte order? Don't go through float. */
+        if ((srcfmt & ~SDL_AUDIO_MASK_ENDIAN) == (dstfmt & ~SDL_AUDIO_MASK_ENDIAN))
+        {
+            if (srcfmt == dstfmt)
+                return NULL;  /* nothing to do; shouldn't have asked. */
+            else if ((srcfmt & 0xFF) == 16)
+                return swap16;
+            else if ((srcfmt & 0xFF) == 32)
+                return swap32;
+        } /* if */
+    } /* if */
+
+    else if (!( ((srcch == 1) && (dstch == 2)) || ((srcch == 2) && (dstch == 1)) ))
+        return NULL;  /* let SDL_AudioCVT figure out surround mixes. */
+
+    for (i = 0; i < SDL_arraysize(converters); i++)
+    {
+        const ConverterEntry *entry = &converters[i];
+        if ((entry->src == srcfmt) && (entry->dst == dstfmt))
+        {
+            if (srcch == dstch)
+                return entry->same;
+            return (srcch == 1) ? entry->mono_to_stereo : entry->stereo_to_mono;
+        } /* if */
+    } /* for */
+
+    return NULL;
+} /* __Sound_GetConverter */
+
+/* end of SDL_sound_convert.c ... */
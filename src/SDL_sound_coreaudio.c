@@ -232,11 +232,11 @@ static int CoreAudio_open(Sound_Sample *sample, const char *ext)
 	UInt32 format_size;
 	
 
-	core_audio_file_container = (CoreAudioFileContainer*)SDL_malloc(sizeof(CoreAudioFileContainer));
+	core_audio_file_container = (CoreAudioFileContainer*)__Sound_malloc(sizeof(CoreAudioFileContainer));
 	BAIL_IF_MACRO(core_audio_file_container == NULL, ERR_OUT_OF_MEMORY, 0);
 
 
-	audio_file_id = (AudioFileID*)SDL_malloc(sizeof(AudioFileID));
+	audio_file_id = (AudioFileID*)__Sound_malloc(sizeof(AudioFileID));
 	BAIL_IF_MACRO(audio_file_id == NULL, ERR_OUT_OF_MEMORY, 0);
 
 	error_result = AudioFileOpenWithCallbacks(
@@ -251,8 +251,8 @@ static int CoreAudio_open(Sound_Sample *sample, const char *ext)
 	if (error_result != noErr)
 	{
 		AudioFileClose(*audio_file_id);
-		SDL_free(audio_file_id);
-		SDL_free(core_audio_file_container);
+		__Sound_free(audio_file_id);
+		__Sound_free(core_audio_file_container);
 		SNDDBG(("Core Audio: can't grok data. reason: [%s].\n", CoreAudio_FourCCToString(error_result)));
 		BAIL_MACRO("Core Audio: Not valid audio data.", 0);
 	} /* if */
@@ -267,8 +267,8 @@ static int CoreAudio_open(Sound_Sample *sample, const char *ext)
     if (error_result != noErr)
 	{
 		AudioFileClose(*audio_file_id);
-		SDL_free(audio_file_id);
-		SDL_free(core_audio_file_container);
+		__Sound_free(audio_file_id);
+		__Sound_free(core_audio_file_container);
 		SNDDBG(("Core Audio: AudioFileGetProperty failed. reason: [%s]", CoreAudio_FourCCToString(error_result)));
 		BAIL_MACRO("Core Audio: Not valid audio data.", 0);
 	} /* if */
@@ -283,8 +283,8 @@ static int CoreAudio_open(Sound_Sample *sample, const char *ext)
     if (error_result != noErr)
 	{
 		AudioFileClose(*audio_file_id);
-		SDL_free(audio_file_id);
-		SDL_free(core_audio_file_container);
+		__Sound_free(audio_file_id);
+		__Sound_free(core_audio_file_container);
 		SNDDBG(("Core Audio: AudioFileGetProperty failed. reason: [%s].\n", CoreAudio_FourCCToString(error_result)));
 		BAIL_MACRO("Core Audio: Not valid audio data.", 0);
 	} /* if */
@@ -394,8 +394,8 @@ static int CoreAudio_open(Sound_Sample *sample, const char *ext)
 	if(error_result != noErr)
 	{
 		AudioFileClose(*audio_file_id);
-		SDL_free(audio_file_id);
-		SDL_free(core_audio_file_container);
+		__Sound_free(audio_file_id);
+		__Sound_free(core_audio_file_container);
 		SNDDBG(("Core Audio: can't wrap data. reason: [%s].\n", CoreAudio_FourCCToString(error_result)));
 		BAIL_MACRO("Core Audio: Failed to wrap data.", 0);
 	} /* if */
@@ -483,14 +483,14 @@ static int CoreAudio_open(Sound_Sample *sample, const char *ext)
 	{
 		ExtAudioFileDispose(core_audio_file_container->extAudioFileRef);
 		AudioFileClose(*audio_file_id);
-		SDL_free(audio_file_id);
-		SDL_free(core_audio_file_container);
+		__Sound_free(audio_file_id);
+		__Sound_free(core_audio_file_container);
 		SNDDBG(("Core Audio: ExtAudioFileSetProperty(kExtAudioFileProperty_ClientDataFormat) failed, reason: [%s].\n", CoreAudio_FourCCToString(error_result)));
 		BAIL_MACRO("Core Audio: Not valid audio data.", 0);
 	}	
 
 
-	core_audio_file_container->outputFormat = (AudioStreamBasicDescription*)SDL_malloc(sizeof(AudioStreamBasicDescription));
+	core_audio_file_container->outputFormat = (AudioStreamBasicDescription*)__Sound_malloc(sizeof(AudioStreamBasicDescription));
 	BAIL_IF_MACRO(core_audio_file_container->outputFormat == NULL, ERR_OUT_OF_MEMORY, 0);
 
 
@@ -511,11 +511,11 @@ static void CoreAudio_close(Sound_Sample *sample)
 	Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
 	CoreAudioFileContainer* core_audio_file_container = (CoreAudioFileContainer *) internal->decoder_private;
 
-	SDL_free(core_audio_file_container->outputFormat);
+	__Sound_free(core_audio_file_container->outputFormat);
 	ExtAudioFileDispose(core_audio_file_container->extAudioFileRef);
 	AudioFileClose(*core_audio_file_container->audioFileID);
-	SDL_free(core_audio_file_container->audioFileID);
-	SDL_free(core_audio_file_container);
+	__Sound_free(core_audio_file_container->audioFileID);
+	__Sound_free(core_audio_file_container);
 } /* CoreAudio_close */
 
 
@@ -545,7 +545,7 @@ static Uint32 CoreAudio_read(Sound_Sample *sample)
 //	printf("buffer_size_in_frames=%ld, internal->buffer_size=%d, internal->buffer=0x%x outputFormat->mBytesPerFrame=%d, sample->buffer_size=%d\n", buffer_size_in_frames, internal->buffer_size, internal->buffer, core_audio_file_container->outputFormat->mBytesPerFrame, sample->buffer_size); 
 
 
-//	void* temp_buffer = SDL_malloc(max_buffer_size);
+//	void* temp_buffer = __Sound_malloc(max_buffer_size);
 	
 	AudioBufferList audio_buffer_list;
 	audio_buffer_list.mNumberBuffers = 1;
@@ -696,6 +696,37 @@ static int CoreAudio_seek(Sound_Sample *sample, Uint32 ms)
 } /* CoreAudio_seek */
 
 
+/* ExtAudioFileSeek() and ExtAudioFileTell() work in client-format frames. */
+static int CoreAudio_seek_frames(Sound_Sample *sample, Uint64 frame)
+{
+	OSStatus error_result = noErr;
+	Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+	CoreAudioFileContainer* core_audio_file_container = (CoreAudioFileContainer *) internal->decoder_private;
+
+	error_result = ExtAudioFileSeek(core_audio_file_container->extAudioFileRef, (SInt64) frame);
+	if(error_result != noErr)
+	{
+		sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+		BAIL_MACRO("Core Audio: ExtAudioFileSeek failed.", 0);
+	} /* if */
+
+	return 1;
+} /* CoreAudio_seek_frames */
+
+
+static Sint64 CoreAudio_tell(Sound_Sample *sample)
+{
+	Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+	CoreAudioFileContainer* core_audio_file_container = (CoreAudioFileContainer *) internal->decoder_private;
+	SInt64 frame = 0;
+
+	if (ExtAudioFileTell(core_audio_file_container->extAudioFileRef, &frame) != noErr)
+		return -1;
+
+	return (Sint64) frame;
+} /* CoreAudio_tell */
+
+
 static const char *extensions_coreaudio[] =
 {
 	"aif",
@@ -738,7 +769,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_CoreAudio =
     CoreAudio_close,      /*  close() method */
     CoreAudio_read,       /*   read() method */
     CoreAudio_rewind,     /* rewind() method */
-    CoreAudio_seek        /*   seek() method */
+    CoreAudio_seek,       /*   seek() method */
+    CoreAudio_seek_frames, /* seek_frames() method */
+    CoreAudio_tell,       /*   tell() method */
+    NULL,                 /* duration() method */
+    NULL                  /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_COREAUDIO */
@@ -31,13 +31,597 @@
 #define DR_FLAC_NO_WIN32_IO 1
 #define DR_FLAC_NO_CRC 1
 #define DRFLAC_ASSERT(x) SDL_assert((x))
-#define DRFLAC_MALLOC(sz) SDL_malloc((sz))
-#define DRFLAC_REALLOC(p, sz) SDL_realloc((p), (sz))
-#define DRFLAC_FREE(p) SDL_free((p))
+#define DRFLAC_MALLOC(sz) __Sound_malloc((sz))
+#define DRFLAC_REALLOC(p, sz) __Sound_realloc((p), (sz))
+#define DRFLAC_FREE(p) __Sound_free((p))
 #define DRFLAC_COPY_MEMORY(dst, src, sz) SDL_memcpy((dst), (src), (sz))
 #define DRFLAC_ZERO_MEMORY(p, sz) SDL_memset((p), 0, (sz))
 #include "dr_flac.h"
 
+/*
+ * LPC restoration: sample[i] += (sum of coefficient[j] * sample[i-1-j]) >> shift.
+ *
+ * Every sample depends on the one before it, so this can't be spread across
+ *  samples. The SIMD versions instead do the dot product for the older
+ *  history (lags 5 and up) in vectors, loaded straight out of the buffer,
+ *  and keep the four newest samples in registers, with all but the newest
+ *  one's term added up a sample ahead. That way the chain from one sample
+ *  to the next is one multiply, a couple of adds and the shift, and never
+ *  waits on a store that hasn't landed yet. The plain version for orders up
+ *  to 4 (which is what FIXED subframes use) does the register part alone.
+ *  dr_flac decodes a subframe's residuals first and then hands them to one
+ *  of these; where there isn't one, it adds the prediction itself as it
+ *  reads each residual.
+ *
+ * The sums are the same as dr_flac's, so the output is bit-for-bit
+ *  identical: wrapping 32-bit sums for 16-bit audio and narrower, where
+ *  the order of the adds makes no difference, and 64-bit sums for wider
+ *  audio (and the side channel of 16-bit stereo), which can't overflow.
+ *  Negative shifts aren't valid FLAC; those go to dr_flac's code.
+ */
+
+/* [0] for 32-bit sums, [1] for 64-bit; then by order. NULL means use dr_flac's. */
+static drflac_restore_lpc_proc lpc_restore[2][33];
+
+
+static void lpc32_upto4(Uint32 count, Uint32 order, Sint32 shift,
+                        const Sint32 *coefficients, Sint32 *samples)
+{
+    const Uint32 c0 = (Uint32) coefficients[0];
+    const Uint32 c1 = (order > 1) ? (Uint32) coefficients[1] : 0;
+    const Uint32 c2 = (order > 2) ? (Uint32) coefficients[2] : 0;
+    const Uint32 c3 = (order > 3) ? (Uint32) coefficients[3] : 0;
+    Uint32 x1, x2, x3, partial;
+    Uint32 i;
+
+    for (i = order; (i < 4) && (i < count); i++)
+        samples[i] = (Sint32) ((Uint32) samples[i] + (Uint32) drflac__calculate_prediction_32(order, shift, coefficients, samples + i));
+
+    if (i >= count)
+        return;
+
+    x1 = (Uint32) samples[i-1];
+    x2 = (Uint32) samples[i-2];
+    x3 = (Uint32) samples[i-3];
+    partial = (c3 * (Uint32) samples[i-4]) + (c2 * x3) + (c1 * x2);
+    for (; i < count; i++)
+    {
+        const Uint32 prediction = partial + (c0 * x1);
+        partial = (c3 * x3) + (c2 * x2) + (c1 * x1);
+        x3 = x2;
+        x2 = x1;
+        x1 = (Uint32) samples[i] + (Uint32) (((Sint32) prediction) >> shift);
+        samples[i] = (Sint32) x1;
+    } /* for */
+} /* lpc32_upto4 */
+
+static void lpc64_upto4(Uint32 count, Uint32 order, Sint32 shift,
+                        const Sint32 *coefficients, Sint32 *samples)
+{
+    const Sint64 c0 = coefficients[0];
+    const Sint64 c1 = (order > 1) ? coefficients[1] : 0;
+    const Sint64 c2 = (order > 2) ? coefficients[2] : 0;
+    const Sint64 c3 = (order > 3) ? coefficients[3] : 0;
+    Sint64 x1, x2, x3, partial;
+    Uint32 i;
+
+    for (i = order; (i < 4) && (i < count); i++)
+        samples[i] = (Sint32) ((Uint32) samples[i] + (Uint32) drflac__calculate_prediction_64(order, shift, coefficients, samples + i));
+
+    if (i >= count)
+        return;
+
+    x1 = samples[i-1];
+    x2 = samples[i-2];
+    x3 = samples[i-3];
+    partial = (c3 * samples[i-4]) + (c2 * x3) + (c1 * x2);
+    for (; i < count; i++)
+    {
+        const Sint64 prediction = partial + (c0 * x1);
+        partial = (c3 * x3) + (c2 * x2) + (c1 * x1);
+        x3 = x2;
+        x2 = x1;
+        x1 = (Sint32) ((Uint32) samples[i] + (Uint32) (Sint32) (prediction >> shift));
+        samples[i] = (Sint32) x1;
+    } /* for */
+} /* lpc64_upto4 */
+
+
+#if SOUND_HAVE_SSE_INTRINSICS || SOUND_HAVE_NEON_INTRINSICS
+/*
+ * Lay out coefficients 4 and up to match the history vectors: vector (v)
+ *  holds samples[i - window + 4v] through samples[i - window + 4v + 3].
+ */
+static void lpc_reverse_coefficients(Uint32 order, Uint32 window,
+                                     const Sint32 *coefficients, Sint32 *reversed)
+{
+    Uint32 j;
+    SDL_memset(reversed, '\0', sizeof (Sint32) * (window - 4));
+    for (j = 4; j < order; j++)
+        reversed[window - 1 - j] = coefficients[j];
+} /* lpc_reverse_coefficients */
+#endif
+
+
+#if SOUND_HAVE_SSE_INTRINSICS
+SDL_FORCE_INLINE SOUND_TARGETING("sse4.1") void lpc32_sse41(const Uint32 nvec, Uint32 count, Uint32 order, Sint32 shift,
+                                                            const Sint32 *coefficients, Sint32 *samples)
+{
+    const Uint32 window = (nvec * 4) + 4;
+    const Uint32 c0 = (Uint32) coefficients[0];
+    const Uint32 c1 = (Uint32) coefficients[1];
+    const Uint32 c2 = (Uint32) coefficients[2];
+    const Uint32 c3 = (Uint32) coefficients[3];
+    Sint32 reversed[28];
+    __m128i c[7];
+    Uint32 x1, x2, x3, partial;
+    Uint32 i, v;
+
+    lpc_reverse_coefficients(order, window, coefficients, reversed);
+    for (v = 0; v < nvec; v++)
+        c[v] = _mm_loadu_si128((const __m128i *) (reversed + (v * 4)));
+
+    for (i = order; (i < window) && (i < count); i++)
+        samples[i] = (Sint32) ((Uint32) samples[i] + (Uint32) drflac__calculate_prediction_32(order, shift, coefficients, samples + i));
+
+    if (i >= count)
+        return;
+
+    x1 = (Uint32) samples[i-1];
+    x2 = (Uint32) samples[i-2];
+    x3 = (Uint32) samples[i-3];
+    partial = (c3 * (Uint32) samples[i-4]) + (c2 * x3) + (c1 * x2);
+    for (; i < count; i++)
+    {
+        const Sint32 *history = samples + i - window;
+        __m128i sum = _mm_mullo_epi32(_mm_loadu_si128((const __m128i *) history), c[0]);
+        Uint32 prediction;
+
+        for (v = 1; v < nvec; v++)
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_loadu_si128((const __m128i *) (history + (v * 4))), c[v]));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        prediction = (Uint32) _mm_cvtsi128_si32(sum) + partial + (c0 * x1);
+        partial = (c3 * x3) + (c2 * x2) + (c1 * x1);
+        x3 = x2;
+        x2 = x1;
+        x1 = (Uint32) samples[i] + (Uint32) (((Sint32) prediction) >> shift);
+        samples[i] = (Sint32) x1;
+    } /* for */
+} /* lpc32_sse41 */
+
+SDL_FORCE_INLINE SOUND_TARGETING("sse4.1") void lpc64_sse41(const Uint32 nvec, Uint32 count, Uint32 order, Sint32 shift,
+                                                            const Sint32 *coefficients, Sint32 *samples)
+{
+    const Uint32 window = (nvec * 4) + 4;
+    const Sint64 c0 = coefficients[0];
+    const Sint64 c1 = coefficients[1];
+    const Sint64 c2 = coefficients[2];
+    const Sint64 c3 = coefficients[3];
+    Sint32 reversed[28];
+    __m128i ceven[7];
+    __m128i codd[7];
+    Sint64 x1, x2, x3, partial;
+    Uint32 i, v;
+
+    lpc_reverse_coefficients(order, window, coefficients, reversed);
+    for (v = 0; v < nvec; v++)
+    {
+        ceven[v] = _mm_loadu_si128((const __m128i *) (reversed + (v * 4)));
+        codd[v] = _mm_srli_epi64(ceven[v], 32);
+    } /* for */
+
+    for (i = order; (i < window) && (i < count); i++)
+        samples[i] = (Sint32) ((Uint32) samples[i] + (Uint32) drflac__calculate_prediction_64(order, shift, coefficients, samples + i));
+
+    if (i >= count)
+        return;
+
+    x1 = samples[i-1];
+    x2 = samples[i-2];
+    x3 = samples[i-3];
+    partial = (c3 * samples[i-4]) + (c2 * x3) + (c1 * x2);
+    for (; i < count; i++)
+    {
+        const Sint32 *history = samples + i - window;
+        __m128i sum = _mm_setzero_si128();
+        Sint64 prediction;
+        Sint64 lanes[2];
+
+        /* _mm_mul_epi32 does lanes 0 and 2; shift 1 and 3 down for the rest. */
+        for (v = 0; v < nvec; v++)
+        {
+            const __m128i h = _mm_loadu_si128((const __m128i *) (history + (v * 4)));
+            sum = _mm_add_epi64(sum, _mm_mul_epi32(h, ceven[v]));
+            sum = _mm_add_epi64(sum, _mm_mul_epi32(_mm_srli_epi64(h, 32), codd[v]));
+        } /* for */
+
+        _mm_storeu_si128((__m128i *) lanes, sum);
+        prediction = lanes[0] + lanes[1] + partial + (c0 * x1);
+        partial = (c3 * x3) + (c2 * x2) + (c1 * x1);
+        x3 = x2;
+        x2 = x1;
+        x1 = (Sint32) ((Uint32) samples[i] + (Uint32) (Sint32) (prediction >> shift));
+        samples[i] = (Sint32) x1;
+    } /* for */
+} /* lpc64_sse41 */
+
+static SOUND_TARGETING("sse4.1") void lpc32_upto8_sse41(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc32_sse41(1, count, order, shift, coefficients, samples); }
+static SOUND_TARGETING("sse4.1") void lpc32_upto12_sse41(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc32_sse41(2, count, order, shift, coefficients, samples); }
+static SOUND_TARGETING("sse4.1") void lpc32_upto16_sse41(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc32_sse41(3, count, order, shift, coefficients, samples); }
+static SOUND_TARGETING("sse4.1") void lpc32_upto32_sse41(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc32_sse41(7, count, order, shift, coefficients, samples); }
+static SOUND_TARGETING("sse4.1") void lpc64_upto8_sse41(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc64_sse41(1, count, order, shift, coefficients, samples); }
+static SOUND_TARGETING("sse4.1") void lpc64_upto12_sse41(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc64_sse41(2, count, order, shift, coefficients, samples); }
+static SOUND_TARGETING("sse4.1") void lpc64_upto16_sse41(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc64_sse41(3, count, order, shift, coefficients, samples); }
+static SOUND_TARGETING("sse4.1") void lpc64_upto32_sse41(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc64_sse41(7, count, order, shift, coefficients, samples); }
+#endif
+
+#if SOUND_HAVE_NEON_INTRINSICS
+SDL_FORCE_INLINE void lpc32_neon(const Uint32 nvec, Uint32 count, Uint32 order, Sint32 shift,
+                                 const Sint32 *coefficients, Sint32 *samples)
+{
+    const Uint32 window = (nvec * 4) + 4;
+    const Uint32 c0 = (Uint32) coefficients[0];
+    const Uint32 c1 = (Uint32) coefficients[1];
+    const Uint32 c2 = (Uint32) coefficients[2];
+    const Uint32 c3 = (Uint32) coefficients[3];
+    Sint32 reversed[28];
+    int32x4_t c[7];
+    Uint32 x1, x2, x3, partial;
+    Uint32 i, v;
+
+    lpc_reverse_coefficients(order, window, coefficients, reversed);
+    for (v = 0; v < nvec; v++)
+        c[v] = vld1q_s32(reversed + (v * 4));
+
+    for (i = order; (i < window) && (i < count); i++)
+        samples[i] = (Sint32) ((Uint32) samples[i] + (Uint32) drflac__calculate_prediction_32(order, shift, coefficients, samples + i));
+
+    if (i >= count)
+        return;
+
+    x1 = (Uint32) samples[i-1];
+    x2 = (Uint32) samples[i-2];
+    x3 = (Uint32) samples[i-3];
+    partial = (c3 * (Uint32) samples[i-4]) + (c2 * x3) + (c1 * x2);
+    for (; i < count; i++)
+    {
+        const Sint32 *history = samples + i - window;
+        int32x4_t sum = vmulq_s32(vld1q_s32(history), c[0]);
+        int32x2_t half;
+        Uint32 prediction;
+
+        for (v = 1; v < nvec; v++)
+            sum = vmlaq_s32(sum, vld1q_s32(history + (v * 4)), c[v]);
+        half = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+
+        prediction = (Uint32) vget_lane_s32(vpadd_s32(half, half), 0) + partial + (c0 * x1);
+        partial = (c3 * x3) + (c2 * x2) + (c1 * x1);
+        x3 = x2;
+        x2 = x1;
+        x1 = (Uint32) samples[i] + (Uint32) (((Sint32) prediction) >> shift);
+        samples[i] = (Sint32) x1;
+    } /* for */
+} /* lpc32_neon */
+
+SDL_FORCE_INLINE void lpc64_neon(const Uint32 nvec, Uint32 count, Uint32 order, Sint32 shift,
+                                 const Sint32 *coefficients, Sint32 *samples)
+{
+    const Uint32 window = (nvec * 4) + 4;
+    const Sint64 c0 = coefficients[0];
+    const Sint64 c1 = coefficients[1];
+    const Sint64 c2 = coefficients[2];
+    const Sint64 c3 = coefficients[3];
+    Sint32 reversed[28];
+    int32x4_t c[7];
+    Sint64 x1, x2, x3, partial;
+    Uint32 i, v;
+
+    lpc_reverse_coefficients(order, window, coefficients, reversed);
+    for (v = 0; v < nvec; v++)
+        c[v] = vld1q_s32(reversed + (v * 4));
+
+    for (i = order; (i < window) && (i < count); i++)
+        samples[i] = (Sint32) ((Uint32) samples[i] + (Uint32) drflac__calculate_prediction_64(order, shift, coefficients, samples + i));
+
+    if (i >= count)
+        return;
+
+    x1 = samples[i-1];
+    x2 = samples[i-2];
+    x3 = samples[i-3];
+    partial = (c3 * samples[i-4]) + (c2 * x3) + (c1 * x2);
+    for (; i < count; i++)
+    {
+        const Sint32 *history = samples + i - window;
+        int64x2_t sum = vdupq_n_s64(0);
+        Sint64 prediction;
+
+        for (v = 0; v < nvec; v++)
+        {
+            const int32x4_t h = vld1q_s32(history + (v * 4));
+            sum = vmlal_s32(sum, vget_low_s32(h), vget_low_s32(c[v]));
+            sum = vmlal_s32(sum, vget_high_s32(h), vget_high_s32(c[v]));
+        } /* for */
+
+        prediction = vgetq_lane_s64(sum, 0) + vgetq_lane_s64(sum, 1) + partial + (c0 * x1);
+        partial = (c3 * x3) + (c2 * x2) + (c1 * x1);
+        x3 = x2;
+        x2 = x1;
+        x1 = (Sint32) ((Uint32) samples[i] + (Uint32) (Sint32) (prediction >> shift));
+        samples[i] = (Sint32) x1;
+    } /* for */
+} /* lpc64_neon */
+
+static void lpc32_upto8_neon(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc32_neon(1, count, order, shift, coefficients, samples); }
+static void lpc32_upto12_neon(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc32_neon(2, count, order, shift, coefficients, samples); }
+static void lpc32_upto16_neon(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc32_neon(3, count, order, shift, coefficients, samples); }
+static void lpc32_upto32_neon(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc32_neon(7, count, order, shift, coefficients, samples); }
+static void lpc64_upto8_neon(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc64_neon(1, count, order, shift, coefficients, samples); }
+static void lpc64_upto12_neon(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc64_neon(2, count, order, shift, coefficients, samples); }
+static void lpc64_upto16_neon(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc64_neon(3, count, order, shift, coefficients, samples); }
+static void lpc64_upto32_neon(Uint32 count, Uint32 order, Sint32 shift, const Sint32 *coefficients, Sint32 *samples) { lpc64_neon(7, count, order, shift, coefficients, samples); }
+#endif
+
+static void set_lpc_kernel(int wide, Uint32 first, Uint32 last, drflac_restore_lpc_proc fn)
+{
+    Uint32 i;
+    for (i = first; i <= last; i++)
+        lpc_restore[wide][i] = fn;
+} /* set_lpc_kernel */
+
+static void choose_lpc_kernels(void)
+{
+    SDL_memset(lpc_restore, '\0', sizeof (lpc_restore));
+
+    /* for orders 1 and 2 at 16 bits, dr_flac's own loop is already as quick. */
+    set_lpc_kernel(0, 3, 4, lpc32_upto4);
+    set_lpc_kernel(1, 1, 4, lpc64_upto4);
+
+#if SOUND_HAVE_SSE_INTRINSICS
+    if (SDL_HasSSE41())
+    {
+        set_lpc_kernel(0, 5, 8, lpc32_upto8_sse41);
+        set_lpc_kernel(0, 9, 12, lpc32_upto12_sse41);
+        set_lpc_kernel(0, 13, 16, lpc32_upto16_sse41);
+        set_lpc_kernel(0, 17, 32, lpc32_upto32_sse41);
+        set_lpc_kernel(1, 5, 8, lpc64_upto8_sse41);
+        set_lpc_kernel(1, 9, 12, lpc64_upto12_sse41);
+        set_lpc_kernel(1, 13, 16, lpc64_upto16_sse41);
+        set_lpc_kernel(1, 17, 32, lpc64_upto32_sse41);
+    } /* if */
+#endif
+
+#if SOUND_HAVE_NEON_INTRINSICS
+    if (SDL_HasNEON())
+    {
+        set_lpc_kernel(0, 5, 8, lpc32_upto8_neon);
+        set_lpc_kernel(0, 9, 12, lpc32_upto12_neon);
+        set_lpc_kernel(0, 13, 16, lpc32_upto16_neon);
+        set_lpc_kernel(0, 17, 32, lpc32_upto32_neon);
+        set_lpc_kernel(1, 5, 8, lpc64_upto8_neon);
+        set_lpc_kernel(1, 9, 12, lpc64_upto12_neon);
+        set_lpc_kernel(1, 13, 16, lpc64_upto16_neon);
+        set_lpc_kernel(1, 17, 32, lpc64_upto32_neon);
+    } /* if */
+#endif
+} /* choose_lpc_kernels */
+
+/* dr_flac asks for this for every LPC and FIXED subframe; see dr_flac.h. */
+static drflac_restore_lpc_proc drflac__get_restore_lpc_proc(drflac_uint32 bitsPerSample, drflac_uint32 order, drflac_int32 shift)
+{
+    if ((shift < 0) || (order > 32))
+        return NULL;
+    return lpc_restore[(bitsPerSample > 16) ? 1 : 0][order];
+} /* drflac__get_restore_lpc_proc */
+
+
+/*
+ * dr_flac seeks through a SEEKTABLE if the file has one, and otherwise
+ *  walks every frame from the start of the stream (or from wherever it is,
+ *  going forward). Plenty of files have no SEEKTABLE, so we keep our own
+ *  list of where frames start, a contiguous run from the first frame
+ *  forward (the "frontier" is where it ends). Decoding fills it in as it
+ *  goes; FLAC_index() fills it in ahead of time by hunting for frame
+ *  headers without decoding anything. A seek into the indexed part jumps to
+ *  the closest frame at or before the target and decodes one frame; one
+ *  past it walks frames from the frontier, indexing them on the way.
+ *
+ * Entries are at least Sound_GetSeekIndexGranularity() milliseconds apart,
+ *  which bounds the memory; at the default of zero, every frame gets one.
+ *
+ * Ogg FLAC doesn't use any of this: dr_flac seeks it with Ogg's pages.
+ */
+
+#define FLAC_SCAN_CHUNK (64 * 1024)  /* bytes read per FLAC_index() call. */
+#define FLAC_MAX_HEADER 16  /* longest possible frame header, with CRC. */
+
+typedef struct
+{
+    Sint64 offset;  /* where the frame header starts in the stream. */
+    Uint64 frame;   /* the first sample frame it decodes to. */
+} FlacIndexEntry;
+
+typedef struct
+{
+    drflac *dr;
+    int indexing;  /* zero for Ogg FLAC. */
+    FlacIndexEntry *index;
+    Uint32 index_count;
+    Uint32 index_capacity;
+    Uint64 spacing;  /* sample frames between index entries, at least. */
+    Sint64 frontier_offset;  /* first frame that hasn't been indexed... */
+    Uint64 frontier_frame;   /*  ...and where it decodes to. */
+    int at_frontier;  /* decoding the frame at the frontier right now. */
+    int at_end;  /* seeked to just past the last frame; nothing to read. */
+    int index_done;
+    Uint8 *scan_buf;
+    Uint32 scan_buf_size;
+} FlacDecoder;
+
+
+/* Where dr_flac's next unread byte is; it reads ahead into its caches. */
+static Sint64 flac_stream_pos(Sound_Sample *sample, const drflac *dr)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const drflac_bs *bs = &dr->bs;
+    Sint64 buffered = (Sint64) (DRFLAC_CACHE_L2_LINES_REMAINING(bs) * sizeof (drflac_cache_t));
+    buffered += (Sint64) bs->unalignedByteCount;
+    buffered += (Sint64) (DRFLAC_CACHE_L1_BITS_REMAINING(bs) / 8);
+    return SDL_RWtell(internal->rw) - buffered;
+} /* flac_stream_pos */
+
+
+static void add_index_entry(FlacDecoder *flac, Sint64 offset, Uint64 frame)
+{
+    if (flac->index_count > 0)
+    {
+        if (frame < flac->index[flac->index_count - 1].frame + flac->spacing)
+            return;  /* too close to the last one (or a repeat of it). */
+    } /* if */
+
+    if (flac->index_count == flac->index_capacity)
+    {
+        const Uint32 newcap = flac->index_capacity ? flac->index_capacity * 2 : 256;
+        void *ptr = __Sound_realloc(flac->index, newcap * sizeof (FlacIndexEntry));
+        if (ptr == NULL)
+        {
+            flac->index_done = 1;  /* out of memory; seek with what we've got. */
+            return;
+        } /* if */
+        flac->index = (FlacIndexEntry *) ptr;
+        flac->index_capacity = newcap;
+    } /* if */
+
+    flac->index[flac->index_count].offset = offset;
+    flac->index[flac->index_count].frame = frame;
+    flac->index_count++;
+} /* add_index_entry */
+
+
+/*
+ * A frame starts at (offset), and decodes to sample frame (frame). This is
+ *  called for every frame we move through in order; if the one before it
+ *  was at the frontier, this one is the new frontier.
+ */
+static void index_frame(FlacDecoder *flac, Sint64 offset, Uint64 frame)
+{
+    if (flac->at_frontier && (offset > flac->frontier_offset))
+    {
+        flac->frontier_offset = offset;
+        flac->frontier_frame = frame;
+    } /* if */
+
+    flac->at_frontier = 0;
+    if ((!flac->index_done) && (offset == flac->frontier_offset))
+    {
+        add_index_entry(flac, offset, frame);
+        flac->at_frontier = 1;
+    } /* if */
+} /* index_frame */
+
+
+static Uint8 frame_header_crc8(const Uint8 *ptr, Uint32 len)
+{
+    Uint8 crc = 0;
+    while (len--)
+    {
+        int i;
+        crc ^= *(ptr++);
+        for (i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (Uint8) ((crc << 1) ^ 0x07) : (Uint8) (crc << 1);
+    } /* while */
+    return crc;
+} /* frame_header_crc8 */
+
+
+/*
+ * See if there's a frame header at (ptr), with (avail) bytes to look at.
+ *  Returns its length, or zero if it isn't one. (number) is the frame
+ *  number, or the first sample frame's number for a variable-blocksize
+ *  stream, which (variable) says.
+ */
+static Uint32 parse_frame_header(const Uint8 *ptr, Uint32 avail, Uint64 *number,
+                                 Uint32 *blocksize, int *variable)
+{
+    Uint32 len = 5;
+    Uint32 extra = 0;
+    Uint32 bscode, srcode;
+    Uint64 num;
+    Uint8 first;
+
+    if ((avail < 6) || (ptr[0] != 0xFF) || ((ptr[1] & 0xFE) != 0xF8))
+        return 0;
+
+    bscode = ptr[2] >> 4;
+    srcode = ptr[2] & 0xF;
+    if ((bscode == 0) || (srcode == 15))
+        return 0;
+    else if (((ptr[3] >> 4) > 10) || (((ptr[3] >> 1) & 0x3) == 0x3) || (ptr[3] & 0x1))
+        return 0;  /* reserved channel layout, sample size, or bit. */
+
+    /* the frame/sample number, UTF-8 style. */
+    first = ptr[4];
+    if (first < 0x80)
+        num = first;
+    else if (first < 0xC0)
+        return 0;
+    else
+    {
+        Uint32 i;
+        while ((first << extra) & 0x40)
+            extra++;  /* count the continuation bytes. */
+        if (extra > 6)
+            return 0;
+        num = first & (0x3F >> extra);
+        if (avail < len + extra)
+            return 0;
+        for (i = 0; i < extra; i++)
+        {
+            if ((ptr[len + i] & 0xC0) != 0x80)
+                return 0;
+            num = (num << 6) | (ptr[len + i] & 0x3F);
+        } /* for */
+        len += extra;
+    } /* else */
+
+    if (bscode == 6)
+        extra = 1;
+    else if (bscode == 7)
+        extra = 2;
+    else
+        extra = 0;
+
+    if (srcode == 12)
+        extra++;
+    else if ((srcode == 13) || (srcode == 14))
+        extra += 2;
+
+    if (avail < len + extra + 1)
+        return 0;
+
+    if (bscode == 1)
+        *blocksize = 192;
+    else if (bscode <= 5)
+        *blocksize = 576 << (bscode - 2);
+    else if (bscode == 6)
+        *blocksize = ((Uint32) ptr[len]) + 1;
+    else if (bscode == 7)
+        *blocksize = ((((Uint32) ptr[len]) << 8) | ptr[len + 1]) + 1;
+    else
+        *blocksize = 256 << (bscode - 8);
+
+    len += extra;
+    if (frame_header_crc8(ptr, len) != ptr[len])
+        return 0;
+
+    *number = num;
+    *variable = (ptr[1] & 0x1);
+    return len + 1;
+} /* parse_frame_header */
+
+
 static size_t flac_read(void* pUserData, void* pBufferOut, size_t bytesToRead)
 {
     Uint8 *ptr = (Uint8 *) pBufferOut;
@@ -46,25 +630,18 @@ static size_t flac_read(void* pUserData, void* pBufferOut, size_t bytesToRead)
     SDL_RWops *rwops = internal->rw;
     size_t retval = 0;
 
-    /* !!! FIXME: dr_flac treats returning less than bytesToRead as EOF. So we can't EAGAIN. */
+    /*
+     * !!! FIXME: dr_flac treats returning less than bytesToRead as EOF. So we can't EAGAIN.
+     * Don't touch sample->flags here; FLAC_read() works out EOF itself, since
+     *  the read-ahead thread decodes with a different Sound_Sample than this.
+     */
     while (retval < bytesToRead)
     {
-        const size_t rc = SDL_RWread(rwops, ptr, 1, bytesToRead);
+        const size_t rc = SDL_RWread(rwops, ptr, 1, bytesToRead - retval);
         if (rc == 0)
-        {
-            sample->flags |= SOUND_SAMPLEFLAG_EOF;
-            break;
-        } /* if */
-        else if (rc == -1) /** FIXME: this error check is broken **/
-        {
-            sample->flags |= SOUND_SAMPLEFLAG_ERROR;
-            break;
-        } /* else if */
-        else
-        {
-            retval += rc;
-            ptr += rc;
-        } /* else */
+            break;  /* EOF or i/o error; dr_flac can't tell the difference. */
+        retval += rc;
+        ptr += rc;
     } /* while */
 
     return retval;
@@ -81,6 +658,7 @@ static drflac_bool32 flac_seek(void* pUserData, int offset, drflac_seek_origin o
 
 static int FLAC_init(void)
 {
+    choose_lpc_kernels();
     return 1;  /* always succeeds. */
 } /* FLAC_init */
 
@@ -94,14 +672,21 @@ static void FLAC_quit(void)
 static int FLAC_open(Sound_Sample *sample, const char *ext)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    FlacDecoder *flac;
     drflac *dr = drflac_open(flac_read, flac_seek, sample);
 
     if (!dr)
     {
-        BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_IO_ERROR, 0);
         BAIL_MACRO("FLAC: Not a FLAC stream.", 0);
     } /* if */
 
+    flac = (FlacDecoder *) __Sound_calloc(1, sizeof (FlacDecoder));
+    if (flac == NULL)
+    {
+        drflac_close(dr);
+        BAIL_MACRO(ERR_OUT_OF_MEMORY, 0);
+    } /* if */
+
     SNDDBG(("FLAC: Accepting data stream.\n"));
     sample->flags = SOUND_SAMPLEFLAG_CANSEEK;
 
@@ -117,9 +702,20 @@ static int FLAC_open(Sound_Sample *sample, const char *ext)
         const Uint64 frames = (Uint64) (dr->totalSampleCount / dr->channels);
         internal->total_time = (frames / rate) * 1000;
         internal->total_time += ((dr->totalSampleCount % dr->sampleRate) * 1000) / dr->sampleRate;
+        internal->total_frames = (Sint64) frames;
+        internal->segmentable = 1;
     } /* else */
 
-    internal->decoder_private = dr;
+    flac->dr = dr;
+    flac->indexing = ((dr->container == drflac_container_native) && (dr->firstFramePos > 0));
+    flac->spacing = ((Uint64) Sound_GetSeekIndexGranularity() * dr->sampleRate) / 1000;
+    if (flac->spacing == 0)
+        flac->spacing = 1;
+    flac->frontier_offset = (Sint64) dr->firstFramePos;
+    flac->frontier_frame = 0;
+    flac->index_done = !flac->indexing;
+
+    internal->decoder_private = flac;
 
     return 1;
 } /* FLAC_open */
@@ -127,36 +723,281 @@ static int FLAC_open(Sound_Sample *sample, const char *ext)
 static void FLAC_close(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drflac *dr = (drflac *) internal->decoder_private;
-    drflac_close(dr);
+    FlacDecoder *flac = (FlacDecoder *) internal->decoder_private;
+    drflac_close(flac->dr);
+    __Sound_free(flac->index);
+    __Sound_free(flac->scan_buf);
+    __Sound_free(flac);
 } /* FLAC_close */
 
 static Uint32 FLAC_read(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drflac *dr = (drflac *) internal->decoder_private;
-    const drflac_uint64 rc = drflac_read_s32(dr, internal->buffer_size / sizeof (drflac_int32), (drflac_int32 *) internal->buffer);
-    /* !!! FIXME: the flac_read callback sets ERROR and EOF flags, but this only tells you about i/o errors, not corruption. */
+    FlacDecoder *flac = (FlacDecoder *) internal->decoder_private;
+    drflac *dr = flac->dr;
+    drflac_int32 *buffer = (drflac_int32 *) internal->buffer;
+    const drflac_uint64 wanted = internal->buffer_size / sizeof (drflac_int32);
+    drflac_uint64 rc = 0;
+
+    if (flac->at_end)
+    {
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+        return 0;
+    } /* if */
+
+    /* with an index to fill in, go a frame at a time, to see where each starts. */
+    while (rc < wanted)
+    {
+        drflac_uint64 want = wanted - rc;
+        drflac_uint64 got;
+
+        if (flac->indexing)
+        {
+            if (dr->currentFrame.samplesRemaining == 0)
+            {
+                index_frame(flac, flac_stream_pos(sample, dr), dr->currentSample / dr->channels);
+                want = SDL_min(want, dr->channels);  /* just enough to load it. */
+            } /* if */
+            else if (want > dr->currentFrame.samplesRemaining)
+            {
+                want = dr->currentFrame.samplesRemaining;
+            } /* else if */
+        } /* if */
+
+        got = drflac_read_s32(dr, want, buffer + rc);
+        rc += got;
+        if (got < want)
+            break;
+    } /* while */
+
+    /* !!! FIXME: dr_flac only comes up short at the end, or on i/o errors or corruption, which we can't tell apart. */
+    if (rc < wanted)
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
     return rc * sizeof (drflac_int32);
 } /* FLAC_read */
 
-static int FLAC_rewind(Sound_Sample *sample)
+/*
+ * Jump to the frame at (offset), which starts at sample frame (first), and
+ *  walk frames from there until one holds (frame). Only that one gets
+ *  decoded.
+ */
+static int seek_from_frame(Sound_Sample *sample, FlacDecoder *flac,
+                           Sint64 offset, Uint64 first, Uint64 frame)
+{
+    drflac *dr = flac->dr;
+    drflac_uint64 skip;
+
+    if (!drflac__seek_to_byte(&dr->bs, (drflac_uint64) offset))
+        return 0;
+
+    SDL_memset(&dr->currentFrame, '\0', sizeof (dr->currentFrame));
+
+    while (1)
+    {
+        index_frame(flac, offset, first);
+        if (!drflac__read_next_frame_header(&dr->bs, dr->bitsPerSample, &dr->currentFrame.header))
+            return 0;
+        else if (frame < first + dr->currentFrame.header.blockSize)
+            break;
+        else if (drflac__seek_to_next_frame(dr) != DRFLAC_SUCCESS)
+            return 0;
+        first += dr->currentFrame.header.blockSize;
+        offset = flac_stream_pos(sample, dr);
+    } /* while */
+
+    if (drflac__decode_frame(dr) != DRFLAC_SUCCESS)
+        return 0;
+
+    dr->currentSample = first * dr->channels;
+    skip = (frame - first) * dr->channels;
+    return (drflac_read_s32(dr, skip, NULL) == skip);
+} /* seek_from_frame */
+
+static int FLAC_seek_frames(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drflac *dr = (drflac *) internal->decoder_private;
-    return (drflac_seek_to_sample(dr, 0) == DRFLAC_TRUE);
+    FlacDecoder *flac = (FlacDecoder *) internal->decoder_private;
+    drflac *dr = flac->dr;
+    const Uint64 total = dr->totalSampleCount / dr->channels;
+    const Uint64 pos = dr->currentSample / dr->channels;
+    const Uint64 remaining = dr->currentFrame.samplesRemaining / dr->channels;
+    const Uint64 consumed = dr->currentFrame.header.blockSize - remaining;
+    Uint32 lo, hi;
+
+    flac->at_frontier = 0;  /* we're not following on from the last frame now. */
+    flac->at_end = 0;
+
+    /* dr_flac would clamp these to the last frame; land on the end instead. */
+    if ((total > 0) && (frame >= total))
+    {
+        BAIL_IF_MACRO(frame > total, ERR_PAST_EOF, 0);
+        flac->at_end = 1;
+        return 1;
+    } /* if */
+
+    if ((!flac->indexing) || (frame == 0))
+        return (drflac_seek_to_sample(dr, frame * dr->channels) == DRFLAC_TRUE);
+
+    /* in the frame that's already decoded, dr_flac just moves along in it. */
+    if ((frame >= pos) ? (frame - pos < remaining) : (pos - frame < consumed))
+        return (drflac_seek_to_sample(dr, frame * dr->channels) == DRFLAC_TRUE);
+
+    /* past what's indexed: a SEEKTABLE, or walking on from here, beats walking from the frontier. */
+    if (frame >= flac->frontier_frame)
+    {
+        if ((dr->seekpointCount > 0) || ((pos >= flac->frontier_frame) && (pos <= frame)))
+            return (drflac_seek_to_sample(dr, frame * dr->channels) == DRFLAC_TRUE);
+        return seek_from_frame(sample, flac, flac->frontier_offset, flac->frontier_frame, frame);
+    } /* if */
+
+    if (flac->index_count == 0)  /* ran out of memory before the first entry. */
+        return (drflac_seek_to_sample(dr, frame * dr->channels) == DRFLAC_TRUE);
+
+    /* find the last entry at or before (frame). The first one is frame 0. */
+    lo = 0;
+    hi = flac->index_count;
+    while (hi - lo > 1)
+    {
+        const Uint32 mid = lo + ((hi - lo) / 2);
+        if (flac->index[mid].frame <= frame)
+            lo = mid;
+        else
+            hi = mid;
+    } /* while */
+
+    return seek_from_frame(sample, flac, flac->index[lo].offset, flac->index[lo].frame, frame);
+} /* FLAC_seek_frames */
+
+static int FLAC_rewind(Sound_Sample *sample)
+{
+    return FLAC_seek_frames(sample, 0);
 } /* FLAC_rewind */
 
 static int FLAC_seek(Sound_Sample *sample, Uint32 ms)
 {
-    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drflac *dr = (drflac *) internal->decoder_private;
-    const float frames_per_ms = ((float) sample->actual.rate) / 1000.0f;
-    const drflac_uint64 frame_offset = (drflac_uint64) (frames_per_ms * ((float) ms));
-    const drflac_uint64 sampnum = frame_offset * sample->actual.channels;
-    return (drflac_seek_to_sample(dr, sampnum) == DRFLAC_TRUE);
+    return FLAC_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
 } /* FLAC_seek */
 
+static Sint64 FLAC_tell(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    FlacDecoder *flac = (FlacDecoder *) internal->decoder_private;
+    if (flac->at_end)
+        return (Sint64) (flac->dr->totalSampleCount / flac->dr->channels);
+    return (Sint64) (flac->dr->currentSample / flac->dr->channels);
+} /* FLAC_tell */
+
+/*
+ * Index frames past the frontier, a chunk of the file at a time, by finding
+ *  each frame's header and hunting for the next one after it: a sync code
+ *  followed by a header with a good CRC and the next frame (or sample)
+ *  number. Nothing gets decoded.
+ */
+static int FLAC_index(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    FlacDecoder *flac = (FlacDecoder *) internal->decoder_private;
+    SDL_RWops *rw = internal->rw;
+    const Sint64 origpos = SDL_RWtell(rw);
+    Uint32 avail = 0;
+    Uint32 pos = 0;
+    Uint32 limit;
+    Uint32 len;
+    Uint64 number;
+    Uint32 blocksize;
+    int variable;
+    int eof;
+
+    if (flac->index_done)
+        return 0;
+
+    if (flac->scan_buf == NULL)
+    {
+        flac->scan_buf = (Uint8 *) __Sound_malloc(FLAC_SCAN_CHUNK);
+        if (flac->scan_buf == NULL)
+        {
+            flac->index_done = 1;
+            return 0;
+        } /* if */
+        flac->scan_buf_size = FLAC_SCAN_CHUNK;
+    } /* if */
+
+    if (SDL_RWseek(rw, flac->frontier_offset, RW_SEEK_SET) == -1)
+    {
+        SDL_RWseek(rw, origpos, RW_SEEK_SET);
+        flac->index_done = 1;
+        return 0;
+    } /* if */
+
+    while (avail < flac->scan_buf_size)
+    {
+        const size_t rc = SDL_RWread(rw, flac->scan_buf + avail, 1, flac->scan_buf_size - avail);
+        if (rc == 0)
+            break;
+        avail += (Uint32) rc;
+    } /* while */
+
+    eof = (avail < flac->scan_buf_size);
+    BAIL_IF_MACRO(SDL_RWseek(rw, origpos, RW_SEEK_SET) == -1, ERR_IO_ERROR, 0);
+
+    /* if a header would run off the end of what we've read, look again next time. */
+    limit = eof ? avail : avail - FLAC_MAX_HEADER;
+
+    len = parse_frame_header(flac->scan_buf, avail, &number, &blocksize, &variable);
+    while (len > 0)
+    {
+        const Uint64 want = variable ? number + blocksize : number + 1;
+        Uint32 next = pos + len;
+        Uint32 nextlen = 0;
+        Uint64 nextnum = 0;
+        Uint32 nextblocksize = 0;
+        int nextvariable = 0;
+
+        for (; next < limit; next++)
+        {
+            if (flac->scan_buf[next] == 0xFF)
+            {
+                nextlen = parse_frame_header(flac->scan_buf + next, avail - next,
+                                             &nextnum, &nextblocksize, &nextvariable);
+                if ((nextlen > 0) && (nextnum == want) && (nextvariable == variable))
+                    break;
+                nextlen = 0;
+            } /* if */
+        } /* for */
+
+        if (nextlen == 0)  /* this frame runs past what we've read. */
+        {
+            if (eof)  /* ...or it's the last one. */
+                break;
+            else if (pos == 0)  /* bigger than the whole buffer? Get a bigger buffer. */
+            {
+                void *ptr = __Sound_realloc(flac->scan_buf, flac->scan_buf_size * 2);
+                if (ptr == NULL)
+                    break;
+                flac->scan_buf = (Uint8 *) ptr;
+                flac->scan_buf_size *= 2;
+            } /* else if */
+            return 1;
+        } /* if */
+
+        add_index_entry(flac, flac->frontier_offset, flac->frontier_frame);
+        flac->frontier_offset += (Sint64) (next - pos);
+        flac->frontier_frame += blocksize;
+        pos = next;
+        len = nextlen;
+        number = nextnum;
+        blocksize = nextblocksize;
+    } /* while */
+
+    /* end of the stream (or lost in it): index what we can, and stop. */
+    if (len > 0)
+        add_index_entry(flac, flac->frontier_offset, flac->frontier_frame);
+    flac->index_done = 1;
+    __Sound_free(flac->scan_buf);
+    flac->scan_buf = NULL;
+    return 0;
+} /* FLAC_index */
+
 static const char *extensions_flac[] = { "FLAC", "FLA", NULL };
 const Sound_DecoderFunctions __Sound_DecoderFunctions_FLAC =
 {
@@ -173,7 +1014,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_FLAC =
     FLAC_close,      /*  close() method */
     FLAC_read,       /*   read() method */
     FLAC_rewind,     /* rewind() method */
-    FLAC_seek        /*   seek() method */
+    FLAC_seek,       /*   seek() method */
+    FLAC_seek_frames, /* seek_frames() method */
+    FLAC_tell,       /*   tell() method */
+    NULL,            /* duration() method */
+    FLAC_index       /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_FLAC */
@@ -33,6 +33,15 @@
 #pragma GCC visibility push(hidden)
 #endif
 
+/* thread-local statics, where the compiler has them. */
+#if (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L))
+#define SOUND_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#define SOUND_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define SOUND_THREAD_LOCAL __thread
+#endif
+
 #if (defined DEBUG_CHATTER)
 #define SNDDBG(x) SDL_LogDebug x
 #else
@@ -79,6 +88,20 @@
 #define SOUND_SUPPORTS_COREAUDIO 0
 #endif
 
+/* map files with mmap() where there is one (not Android: assets aren't files). */
+#ifndef SOUND_HAVE_MMAP
+#if (defined(__unix__) || defined(__unix) || defined(__APPLE__)) && !defined(__ANDROID__)
+#define SOUND_HAVE_MMAP 1
+#else
+#define SOUND_HAVE_MMAP 0
+#endif
+#endif
+
+/* Sound_GetSampleStats() bookkeeping. Define this to 0 to build it out. */
+#ifndef SOUND_STATS
+#define SOUND_STATS 1
+#endif
+
 
 /*
  * SDL itself only supports mono and stereo output, but hopefully we can
@@ -237,9 +260,222 @@ typedef struct __SOUND_DECODERFUNCTIONS__
          *  continue as if nothing happened.
          */
     int (*seek)(Sound_Sample *sample, Uint32 ms);
+
+        /*
+         * Reposition the decoding to sample frame (frame), counted at
+         *  sample->actual.rate from the start of the stream. Nonzero on
+         *  success, zero on failure. This is the same as seek(), but exact:
+         *  the next read() should start with precisely that frame.
+         *
+         * This can be NULL, in which case SDL_sound converts the frame to
+         *  milliseconds and uses seek() instead. If you implement this,
+         *  your seek() can usually just be:
+         *
+         *    return XXX_seek_frames(sample,
+         *                     __Sound_convertMsToFrames(&sample->actual, ms));
+         */
+    int (*seek_frames)(Sound_Sample *sample, Uint64 frame);
+
+        /*
+         * Return the sample frame (at sample->actual.rate) that the next
+         *  read() will start with, or -1 if you don't know.
+         *
+         * This can be NULL; SDL_sound counts the frames you hand back from
+         *  read(), and resets that count on rewind and seek, which is right
+         *  for most decoders. Implement it if your decoder library already
+         *  tracks its position.
+         */
+    Sint64 (*tell)(Sound_Sample *sample);
+
+        /*
+         * Work out the length of the stream, in sample frames at
+         *  sample->actual.rate, or return -1 if you can't.
+         *
+         * This can be NULL. Most decoders know the length from the headers
+         *  they read in open() and just fill in total_time there. If finding
+         *  it costs extra I/O (seeking to the end of the file, say), leave
+         *  total_time at -1 in open() and do the work here instead; SDL_sound
+         *  calls this once, the first time the app (or SDL_sound itself)
+         *  wants the length, and fills in total_time and total_frames from
+         *  what you return. You may also set segmentable here. The stream
+         *  position has to be where it was when this returns.
+         */
+    Sint64 (*duration)(Sound_Sample *sample);
+
+        /*
+         * Do a bit more of a scan through the stream for seek points, for
+         *  Sound_BuildSeekIndex(). Return nonzero if there's more to do, and
+         *  zero once the whole stream is indexed, or if you can't get any
+         *  further. Keep each call short (tens of kilobytes of I/O, say);
+         *  this runs between decodes, sometimes on the read-ahead thread.
+         *  The stream position has to be where it was when this returns.
+         *
+         * This can be NULL if your seeks are fast without an index.
+         */
+    int (*index)(Sound_Sample *sample);
 } Sound_DecoderFunctions;
 
 
+/*
+ * Fused, single-pass format and channel conversion (SDL_sound_convert.c).
+ *  Converts (frames) frames of (channels) channels from (src) to (dst); the
+ *  two may be the same buffer. Get one with __Sound_GetConverter(), which
+ *  returns NULL for anything it doesn't handle (then use SDL_AudioCVT).
+ */
+typedef void (*Sound_ConvertFn)(const void *src, void *dst,
+                                Uint32 frames, Uint32 channels);
+
+Sound_ConvertFn __Sound_GetConverter(SDL_AudioFormat srcfmt, Uint8 srcch,
+                                     SDL_AudioFormat dstfmt, Uint8 dstch);
+
+/*
+ * Sample types SDL doesn't have, that __Sound_GetConverter() will unpack
+ *  for decoders that store them. They never show up as an actual format;
+ *  a decoder converts them to something SDL knows before handing them out.
+ */
+#define SOUND_AUDIO_S24LSB 0x8018  /* packed, three bytes per sample. */
+#define SOUND_AUDIO_S24MSB 0x9018  /* same, big-endian (AIFF). */
+#define SOUND_AUDIO_F64LSB 0x8140  /* IEEE double. */
+#define SOUND_AUDIO_F64MSB 0x9140  /* same, big-endian (AIFF). */
+#define SOUND_AUDIO_ULAW   0x0408  /* 8-bit G.711 µ-law. */
+#define SOUND_AUDIO_ALAW   0x0808  /* 8-bit G.711 A-law. */
+
+
+/*
+ * The streaming rate converter (SDL_sound_resample.c). It takes float32
+ *  frames at the decoder's rate in the desired channel count, and produces
+ *  frames at the desired rate and format, keeping its filter history
+ *  between calls.
+ */
+typedef struct Sound_Resampler Sound_Resampler;
+
+/* returns NULL and sets the error message on failure. */
+Sound_Resampler *__Sound_CreateResampler(Sound_ResampleQuality quality,
+                                         Uint8 channels, Uint32 inrate,
+                                         Uint32 outrate,
+                                         SDL_AudioFormat outfmt);
+void __Sound_DestroyResampler(Sound_Resampler *r);
+
+/* forget all history and pending input, as after a seek. Zero on failure. */
+int __Sound_ResetResampler(Sound_Resampler *r);
+
+/* queue (frames) interleaved float32 frames. Zero on out of memory. */
+int __Sound_ResamplerPut(Sound_Resampler *r, const float *src, Uint32 frames);
+
+/* no more input is coming; let the tail of the stream out. Zero on failure. */
+int __Sound_ResamplerFlush(Sound_Resampler *r);
+int __Sound_ResamplerFlushed(const Sound_Resampler *r);
+
+/* input frames queued that haven't been consumed by output yet. */
+Uint64 __Sound_ResamplerPending(const Sound_Resampler *r);
+
+/* output frames that can be produced from what's queued right now. */
+Uint32 __Sound_ResamplerAvailable(const Sound_Resampler *r);
+
+/* write up to (frames) output frames to (dst); returns frames written. */
+Uint32 __Sound_ResamplerGet(Sound_Resampler *r, void *dst, Uint32 frames);
+
+
+/*
+ * Map (filename) read-only and return it as a memory RWops that unmaps on
+ *  close (SDL_sound_mmap.c). Returns NULL, without setting an error, if
+ *  the file can't or shouldn't be mapped; use SDL_RWFromFile() then.
+ */
+SDL_RWops *__Sound_RWFromMappedFile(const char *filename);
+
+
+/*
+ * The decoded-audio cache (SDL_sound_cache.c). Keys are built from where a
+ *  sample came from and what format was asked for; the key functions
+ *  return NULL when the cache is off (or memory is tight), so a NULL key
+ *  just means "don't cache this".
+ */
+typedef struct Sound_CacheKey Sound_CacheKey;
+typedef struct Sound_CacheEntry Sound_CacheEntry;
+
+int __Sound_CacheInit(void);
+void __Sound_CacheQuit(void);
+Sound_CacheKey *__Sound_CacheKeyFromFile(const char *fname,
+                                         const Sound_AudioInfo *desired,
+                                         Sound_ResampleQuality quality);
+Sound_CacheKey *__Sound_CacheKeyFromMem(const Uint8 *data, Uint32 size,
+                                        const char *ext,
+                                        const Sound_AudioInfo *desired,
+                                        Sound_ResampleQuality quality);
+void __Sound_CacheFreeKey(Sound_CacheKey *key);
+
+/* returns a referenced entry, or NULL on a miss. */
+Sound_CacheEntry *__Sound_CacheLookup(const Sound_CacheKey *key);
+void __Sound_CacheRelease(Sound_CacheEntry *entry);
+
+/* a read-only memory RWops over the entry's decoded audio. */
+SDL_RWops *__Sound_CacheEntryRW(Sound_CacheEntry *entry);
+
+/* copy (sample)'s buffer, which holds the whole decoded sound, into the cache. */
+void __Sound_CacheStore(const Sound_CacheKey *key, const Sound_Sample *sample);
+
+/* reads samples opened from the cache; (decoder_private) is the entry. */
+extern const Sound_DecoderFunctions __Sound_DecoderFunctions_CACHE;
+
+
+/*
+ * Memory (SDL_sound_alloc.c). Use these instead of SDL_malloc() and
+ *  friends for anything SDL_sound allocates, so it goes through the app's
+ *  allocator (see Sound_SetAllocator()). Never mix the two families.
+ */
+void *__Sound_malloc(size_t size);
+void *__Sound_calloc(size_t nmemb, size_t size);
+void *__Sound_realloc(void *ptr, size_t size);
+void __Sound_free(void *ptr);
+char *__Sound_strdup(const char *str);
+
+/*
+ * A sample's bump arena. Between __Sound_ArenaEnter() and
+ *  __Sound_ArenaLeave() on the same thread, small allocations come from
+ *  (arena); __Sound_free() on them is a no-op, and __Sound_ArenaRelease()
+ *  gives back everything at once.
+ */
+typedef struct Sound_ArenaBlock Sound_ArenaBlock;
+typedef struct
+{
+    Sound_ArenaBlock *blocks;  /* newest first. */
+    Uint8 *next;               /* free space in the newest block... */
+    size_t avail;              /*  ...and how much of it there is. */
+    size_t reserved;           /* total size of the blocks. */
+    size_t used;               /* what's been handed out of them. */
+} Sound_Arena;
+
+/* returns the arena that was current, to pass to __Sound_ArenaLeave(). */
+Sound_Arena *__Sound_ArenaEnter(Sound_Arena *arena);
+void __Sound_ArenaLeave(Sound_Arena *previous);
+void __Sound_ArenaRelease(Sound_Arena *arena);
+
+/* non-zero between Sound_Init() and Sound_Quit(). */
+int __Sound_IsInitialized(void);
+
+/* sample pools created and not freed yet; they can outlive Sound_Quit(). */
+int __Sound_LiveSamplePools(void);
+
+
+#if SOUND_STATS && defined(SOUND_THREAD_LOCAL)
+/*
+ * While a sample is decoding or seeking, SDL_sound.c points these at that
+ *  sample's stats, so decoders' reads and seeks get counted without any of
+ *  them having to know about it. RWops traffic outside of that isn't counted.
+ */
+size_t __Sound_StatsRWread(SDL_RWops *rw, void *ptr, size_t size, size_t n);
+Sint64 __Sound_StatsRWseek(SDL_RWops *rw, Sint64 offset, int whence);
+#undef SDL_RWread
+#define SDL_RWread(rw, ptr, size, n) __Sound_StatsRWread(rw, ptr, size, n)
+#undef SDL_RWseek
+#define SDL_RWseek(rw, offset, whence) __Sound_StatsRWseek(rw, offset, whence)
+#endif
+
+
+/* background read-ahead state; it's all private to SDL_sound.c. */
+typedef struct Sound_Prefetch Sound_Prefetch;
+
+
 typedef void (*MixFunc)(float *dst, void *src, Uint32 frames, float *gains);
 
 typedef struct __SOUND_SAMPLEINTERNAL__
@@ -255,9 +491,78 @@ typedef struct __SOUND_SAMPLEINTERNAL__
     Sint32 total_time;
     Uint32 mix_position;
     MixFunc mix;
+    Sound_SamplePool *pool;   /* NULL if this didn't come from a pool. */
+    Uint32 buffer_capacity;   /* bytes actually allocated at sample->buffer. */
+    Sound_Resampler *resampler;  /* NULL if SDL_AudioCVT does the rate. */
+    Sound_ConvertFn convert;     /* used instead of sdlcvt if not NULL. */
+    Uint64 position;             /* next frame read() returns, if no tell(). */
+    Uint32 convert_framesize;    /* bytes per frame that (convert) outputs. */
+    void *staging;               /* decode here if the caller's buffer can't. */
+    Uint32 staging_size;
+
+        /*
+         * Decoders that know the exact length of the stream, in sample
+         *  frames, set total_frames in open(); it's -1 otherwise. If
+         *  seek_frames() on this data is sample-exact and doesn't have to
+         *  decode everything before the target, they also set segmentable,
+         *  and Sound_DecodeAllParallel() will split the work across threads.
+         */
+    Sint64 total_frames;
+    int segmentable;
+    int duration_pending;        /* nonzero until funcs->duration() runs. */
+
+        /*
+         * Samples read from the decode cache count frame positions at the
+         *  rate of the file it was decoded from, so loop points don't move
+         *  when the cache is on. This is that rate (zero if it's
+         *  sample->actual's), and the file's length in its frames.
+         */
+    Uint32 source_rate;
+    Sint64 source_frames;
+    int index_pending;           /* nonzero while funcs->index() has work. */
+
+    Sound_Prefetch *prefetch;    /* NULL unless reading ahead. */
+    Sound_CacheKey *cache_key;   /* store a whole decode under this. */
+    Sound_Arena arena;           /* what the decoder allocated in open(). */
+
+#if SOUND_STATS
+        /*
+         * Counts build up in stats_pending during a decode or seek, and are
+         *  added to (stats) and the decoder's totals when it's done. The
+         *  *_ns fields hold SDL_GetPerformanceCounter() ticks until they're
+         *  reported. Read-ahead and parallel decoding run on copies of a
+         *  sample; those copies have stats_owner pointing at the real
+         *  sample's (stats), so it all adds up in one place.
+         */
+    Sound_Stats stats;
+    Sound_Stats stats_pending;
+    Sound_Stats *stats_owner;    /* NULL for a sample's own internals. */
+    Uint64 stats_clock;          /* when the current timing started. */
+#endif
 } Sound_SampleInternal;
 
 
+/*
+ * SIMD support for the conversion, resampling and FLAC kernels. These are always
+ *  chosen at runtime (with SDL_HasSSE() and friends), so on GCC and Clang we
+ *  compile each kernel for its own target instead of the whole file.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SOUND_HAVE_SSE_INTRINSICS 1
+#define SOUND_HAVE_AVX_INTRINSICS 1
+#define SOUND_TARGETING(x) __attribute__((target(x)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1)))
+#define SOUND_HAVE_SSE_INTRINSICS 1
+#define SOUND_HAVE_AVX_INTRINSICS 1
+#define SOUND_TARGETING(x)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define SOUND_HAVE_NEON_INTRINSICS 1
+#include <arm_neon.h>
+#endif
+
+
 /* error messages... */
 #define ERR_IS_INITIALIZED       "Already initialized"
 #define ERR_NOT_INITIALIZED      "Not initialized"
@@ -273,6 +578,7 @@ typedef struct __SOUND_SAMPLEINTERNAL__
 #define ERR_PREV_ERROR           "Previous decoding already caused an error"
 #define ERR_PREV_EOF             "Previous decoding already triggered EOF"
 #define ERR_CANNOT_SEEK          "Sample is not seekable"
+#define ERR_POOLS_ALIVE          "Sample pools still exist"
 
 /*
  * Call this to set the message returned by Sound_GetError().
@@ -289,6 +595,12 @@ void __Sound_SetError(const char *err);
  */
 Uint32 __Sound_convertMsToBytePos(Sound_AudioInfo *info, Uint32 ms);
 
+/*
+ * Call this to convert milliseconds to a sample frame, based on audio data
+ *  characteristics. Unlike float math, this is exact for any duration.
+ */
+Uint64 __Sound_convertMsToFrames(const Sound_AudioInfo *info, Uint32 ms);
+
 
 /* These get used all over for lessening code clutter. */
 #define BAIL_MACRO(e, r) { __Sound_SetError(e); return r; }
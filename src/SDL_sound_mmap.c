@@ -0,0 +1,99 @@
+/**
+ * SDL_sound; An abstract sound format decoding API.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+/*
+ * Memory-mapped files for Sound_NewSampleFromFile().
+ *
+ * The whole file is mapped read-only and handed to the decoders as an
+ *  ordinary SDL_RWOPS_MEMORY_RO stream, so reads are memcpy()s out of the
+ *  page cache instead of trips through stdio, and anything that wants the
+ *  whole file at once (ModPlug, Sound_DecodeAllParallel()) uses the mapping
+ *  directly instead of copying it. Processes playing the same file share
+ *  the same pages.
+ *
+ * The one catch is that if something truncates the file while it's mapped,
+ *  touching the missing pages raises SIGBUS instead of failing a read. Apps
+ *  that can't rule that out can turn this off with Sound_SetFileMapping().
+ */
+
+#define __SDL_SOUND_INTERNAL__
+#include "SDL_sound_internal.h"
+
+#if SOUND_HAVE_MMAP
+
+/* these are the C library's symbols, not ours; don't mark them hidden. */
+#if SOUND_HAVE_PRAGMA_VISIBILITY
+#pragma GCC visibility push(default)
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if SOUND_HAVE_PRAGMA_VISIBILITY
+#pragma GCC visibility pop
+#endif
+
+static int SDLCALL mapped_close(SDL_RWops *rw)
+{
+    if (rw != NULL)
+    {
+        munmap(rw->hidden.mem.base,
+               (size_t) (rw->hidden.mem.stop - rw->hidden.mem.base));
+        SDL_FreeRW(rw);
+    } /* if */
+
+    return 0;
+} /* mapped_close */
+
+
+SDL_RWops *__Sound_RWFromMappedFile(const char *filename)
+{
+    struct stat statbuf;
+    SDL_RWops *retval;
+    void *ptr;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+
+        /* pipes, devices and empty or huge files go through stdio. */
+    if ( (fstat(fd, &statbuf) == -1) || (!S_ISREG(statbuf.st_mode)) ||
+         (statbuf.st_size <= 0) || (statbuf.st_size > 0x7FFFFFFF) )
+    {
+        close(fd);
+        return NULL;
+    } /* if */
+
+    ptr = mmap(NULL, (size_t) statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  /* the mapping keeps the file open. */
+    if (ptr == MAP_FAILED)
+        return NULL;
+
+    retval = SDL_RWFromConstMem(ptr, (int) statbuf.st_size);
+    if (retval == NULL)
+    {
+        munmap(ptr, (size_t) statbuf.st_size);
+        return NULL;
+    } /* if */
+
+    retval->close = mapped_close;
+    return retval;
+} /* __Sound_RWFromMappedFile */
+
+#else
+
+SDL_RWops *__Sound_RWFromMappedFile(const char *filename)
+{
+    (void) filename;
+    return NULL;  /* no mmap() here; always use stdio. */
+} /* __Sound_RWFromMappedFile */
+
+#endif
+
+/* end of SDL_sound_mmap.c ... */
+
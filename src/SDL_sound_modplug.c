@@ -114,10 +114,10 @@ static int MODPLUG_open(Sound_Sample *sample, const char *ext)
     }
     else
     {
-        data = SDL_malloc((size_t) size);
+        data = __Sound_malloc((size_t) size);
         BAIL_IF_MACRO(data == NULL, ERR_OUT_OF_MEMORY, 0);
         retval = SDL_RWread(internal->rw, data, 1, size);
-        if (retval != (size_t)size) SDL_free(data);
+        if (retval != (size_t)size) __Sound_free(data);
         BAIL_IF_MACRO(retval != (size_t)size, ERR_IO_ERROR, 0);
     }
 
@@ -154,7 +154,7 @@ static int MODPLUG_open(Sound_Sample *sample, const char *ext)
     /* The buffer may be a bit too large, but that doesn't matter. I think
        it's safe to free it as soon as ModPlug_Load() is finished anyway. */
     module = ModPlug_Load(data, (int) size, &settings);
-    if (retval) SDL_free(data);
+    if (retval) __Sound_free(data);
     BAIL_IF_MACRO(module == NULL, "MODPLUG: Not a module file.", 0);
 
     internal->total_time = ModPlug_GetLength(module);
@@ -199,6 +199,7 @@ static int MODPLUG_seek(Sound_Sample *sample, Uint32 ms)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     ModPlugFile *module = (ModPlugFile *) internal->decoder_private;
+    BAIL_IF_MACRO((Sint32) ms > internal->total_time, ERR_PAST_EOF, 0);
     ModPlug_Seek(module, ms);
     return 1;
 } /* MODPLUG_seek */
@@ -219,7 +220,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_MODPLUG =
     MODPLUG_close,      /*  close() method */
     MODPLUG_read,       /*   read() method */
     MODPLUG_rewind,     /* rewind() method */
-    MODPLUG_seek        /*   seek() method */
+    MODPLUG_seek,       /*   seek() method */
+    NULL,               /* seek_frames() method */
+    NULL,               /*   tell() method */
+    NULL,               /* duration() method */
+    NULL                /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_MODPLUG */
@@ -9,7 +9,23 @@
 /*
  * MP3 decoder for SDL_sound.
  *
- * !!! FIXME: write something here.
+ * dr_mp3 does the decoding. It can only seek by decoding everything from the
+ *  start of the file, though, and it doesn't know how long a stream is, so
+ *  this file also reads MPEG frame headers on its own, without decoding
+ *  anything.
+ *
+ * At open, we look for a Xing/Info or VBRI header in the first frame. That
+ *  says how many frames there are (so we know the exact duration without
+ *  reading the whole file), and if there's a LAME tag, how much encoder
+ *  delay and padding to trim for gapless playback. Without one of those
+ *  headers, we walk every frame header in the file once to count them.
+ *
+ * Either way, the first seek builds (or that walk already built) an index
+ *  of where every MP3_INDEX_STRIDE'th frame starts. A seek then finds the
+ *  nearest indexed frame, steps over a few headers to the one it wants, and
+ *  decodes just enough frames before it to fill Layer III's bit reservoir
+ *  and the synthesis filter's history, so the output is exactly what
+ *  decoding from the start would have produced.
  *
  * dr_mp3 is here: https://github.com/mackron/dr_libs/
  */
@@ -23,9 +39,9 @@
 #define DR_MP3_NO_STDIO 1
 #define DR_MP3_FLOAT_OUTPUT 1
 #define DRMP3_ASSERT(x) SDL_assert((x))
-#define DRMP3_MALLOC(sz) SDL_malloc((sz))
-#define DRMP3_REALLOC(p, sz) SDL_realloc((p), (sz))
-#define DRMP3_FREE(p) SDL_free((p))
+#define DRMP3_MALLOC(sz) __Sound_malloc((sz))
+#define DRMP3_REALLOC(p, sz) __Sound_realloc((p), (sz))
+#define DRMP3_FREE(p) __Sound_free((p))
 #define DRMP3_COPY_MEMORY(dst, src, sz) SDL_memcpy((dst), (src), (sz))
 #define DRMP3_ZERO_MEMORY(p, sz) SDL_memset((p), 0, (sz))
 
@@ -46,33 +62,72 @@
 
 #include "dr_mp3.h"
 
+#define MP3_INDEX_STRIDE 8        /* frames between index entries. */
+#define MP3_MAX_PREROLL 24        /* more than a full bit reservoir's worth. */
+#define MP3_SCAN_CHUNK (64 * 1024)
+#define MP3_DECODER_DELAY 529     /* samples of delay the decoder adds. */
+
+typedef struct
+{
+    drmp3 dr;
+    Uint8 first_header[DRMP3_HDR_SIZE];
+    Sint64 first_frame;       /* file offset of the first audio frame. */
+    Sint64 audio_end;         /* where trailing tags start, -1 if unknown. */
+    Uint32 frame_samples;     /* per MPEG frame. */
+    Uint32 start_skip;        /* samples to drop at the start (gapless). */
+    Sint64 mpeg_frames;       /* audio frames in the stream, -1 if unknown. */
+    Sint64 total_frames;      /* sample frames we output, -1 if unknown. */
+    Uint64 position;          /* next sample frame MP3_read() returns. */
+    Sint64 *index;            /* offset of every MP3_INDEX_STRIDE'th frame. */
+    Uint32 index_count;
+    int index_state;          /* 0: not built yet, 1: built, -1: can't. */
+} Mp3Decoder;
+
+/* Buffered, forward-mostly reads over the RWops, for walking headers. */
+typedef struct
+{
+    SDL_RWops *rw;
+    Uint8 *buf;
+    size_t capacity;
+    Sint64 bufpos;     /* file offset of buf[0]. */
+    size_t buflen;
+    Sint64 rwpos;      /* where the RWops is, or -1 if we don't know. */
+    Sint64 end;        /* act like the file stops here, if >= 0. */
+} Mp3Scanner;
+
+
 static size_t mp3_read(void* pUserData, void* pBufferOut, size_t bytesToRead)
 {
     Uint8 *ptr = (Uint8 *) pBufferOut;
     Sound_Sample *sample = (Sound_Sample *) pUserData;
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Mp3Decoder *mp3 = (const Mp3Decoder *) internal->decoder_private;
     SDL_RWops *rwops = internal->rw;
     size_t retval = 0;
 
-    /* !!! FIXME: dr_mp3 treats returning less than bytesToRead as EOF. So we can't EAGAIN. */
+    /*
+     * Stop dr_mp3 at the last frame, so it doesn't take an ID3v1 or APE tag
+     *  after it for junk and throw that frame away.
+     */
+    if (mp3->audio_end >= 0)
+    {
+        const Sint64 pos = SDL_RWtell(rwops);
+        if ((pos >= 0) && (pos + (Sint64) bytesToRead > mp3->audio_end))
+            bytesToRead = (pos < mp3->audio_end) ? (size_t) (mp3->audio_end - pos) : 0;
+    } /* if */
+
+    /*
+     * !!! FIXME: dr_mp3 treats returning less than bytesToRead as EOF. So we can't EAGAIN.
+     * Don't touch sample->flags here; MP3_read() works out EOF itself, since
+     *  the read-ahead thread decodes with a different Sound_Sample than this.
+     */
     while (retval < bytesToRead)
     {
-        const size_t rc = SDL_RWread(rwops, ptr, 1, bytesToRead);
+        const size_t rc = SDL_RWread(rwops, ptr, 1, bytesToRead - retval);
         if (rc == 0)
-        {
-            sample->flags |= SOUND_SAMPLEFLAG_EOF;
-            break;
-        } /* if */
-        else if (rc == -1) /** FIXME: this error check is broken **/
-        {
-            sample->flags |= SOUND_SAMPLEFLAG_ERROR;
-            break;
-        } /* else if */
-        else
-        {
-            retval += rc;
-            ptr += rc;
-        } /* else */
+            break;  /* EOF or i/o error; dr_mp3 can't tell the difference. */
+        retval += rc;
+        ptr += rc;
     } /* while */
 
     return retval;
@@ -87,6 +142,438 @@ static drmp3_bool32 mp3_seek(void* pUserData, int offset, drmp3_seek_origin orig
 } /* mp3_seek */
 
 
+static int scanner_init(Mp3Scanner *scan, SDL_RWops *rw, size_t capacity, Sint64 end)
+{
+    SDL_zerop(scan);
+    scan->buf = (Uint8 *) __Sound_malloc(capacity);
+    BAIL_IF_MACRO(!scan->buf, ERR_OUT_OF_MEMORY, 0);
+    scan->rw = rw;
+    scan->capacity = capacity;
+    scan->rwpos = -1;
+    scan->end = end;
+    return 1;
+} /* scanner_init */
+
+static void scanner_quit(Mp3Scanner *scan)
+{
+    __Sound_free(scan->buf);
+    scan->buf = NULL;
+} /* scanner_quit */
+
+/* Returns (len) bytes from file offset (pos), or NULL if there aren't that many. */
+static const Uint8 *scanner_get(Mp3Scanner *scan, Sint64 pos, size_t len)
+{
+    size_t keep = 0;
+
+    SDL_assert(len <= scan->capacity);
+
+    if ((pos >= scan->bufpos) && (pos + (Sint64) len <= scan->bufpos + (Sint64) scan->buflen))
+        return scan->buf + (size_t) (pos - scan->bufpos);
+
+    /* keep whatever we already have of the range, and read the rest. */
+    if ((pos >= scan->bufpos) && (pos < scan->bufpos + (Sint64) scan->buflen))
+    {
+        keep = (size_t) ((scan->bufpos + (Sint64) scan->buflen) - pos);
+        SDL_memmove(scan->buf, scan->buf + (size_t) (pos - scan->bufpos), keep);
+    } /* if */
+
+    scan->bufpos = pos;
+    scan->buflen = keep;
+
+    if (scan->rwpos != pos + (Sint64) keep)
+    {
+        scan->rwpos = SDL_RWseek(scan->rw, pos + (Sint64) keep, RW_SEEK_SET);
+        if (scan->rwpos != pos + (Sint64) keep)
+        {
+            scan->rwpos = -1;
+            return NULL;
+        } /* if */
+    } /* if */
+
+    while (scan->buflen < scan->capacity)
+    {
+        size_t want = scan->capacity - scan->buflen;
+        size_t rc;
+        if ((scan->end >= 0) && (scan->rwpos + (Sint64) want > scan->end))
+            want = (scan->rwpos < scan->end) ? (size_t) (scan->end - scan->rwpos) : 0;
+        rc = want ? SDL_RWread(scan->rw, scan->buf + scan->buflen, 1, want) : 0;
+        if (rc == 0)
+            break;
+        scan->buflen += rc;
+        scan->rwpos += (Sint64) rc;
+    } /* while */
+
+    return (scan->buflen >= len) ? scan->buf : NULL;
+} /* scanner_get */
+
+
+/* Size of the frame whose header is (h), or zero for free-format streams. */
+static Uint32 frame_size(const Uint8 *h)
+{
+    return (Uint32) (drmp3_hdr_frame_bytes(h, 0) + drmp3_hdr_padding(h));
+} /* frame_size */
+
+/*
+ * Is there a frame like (like) at (pos)? To cut down on false syncs, the
+ *  frame after it has to check out too, unless it's the last in the file.
+ */
+static Uint32 frame_at(Mp3Scanner *scan, const Uint8 *like, Sint64 pos)
+{
+    const Uint8 *h = scanner_get(scan, pos, DRMP3_HDR_SIZE);
+    Uint32 size;
+
+    if ((h == NULL) || (!drmp3_hdr_compare(like, h)))
+        return 0;
+
+    size = frame_size(h);
+    if (size == 0)
+        return 0;
+
+    h = scanner_get(scan, pos + size, DRMP3_HDR_SIZE);
+    if ((h != NULL) && (!drmp3_hdr_compare(like, h)))
+        return 0;
+    else if ((h == NULL) && (scanner_get(scan, pos, size) == NULL))
+        return 0;  /* truncated; dr_mp3 won't decode it either. */
+
+    return size;
+} /* frame_at */
+
+/* Look for the next frame at or after (pos); returns -1 if there isn't one. */
+static Sint64 find_frame(Mp3Scanner *scan, const Uint8 *like, Sint64 pos, Uint32 *size)
+{
+    const Uint8 *h;
+
+    while ((h = scanner_get(scan, pos, DRMP3_HDR_SIZE)) != NULL)
+    {
+        if ((h[0] == 0xFF) && ((like != NULL) || (drmp3_hdr_valid(h))))
+        {
+            Uint8 hdr[DRMP3_HDR_SIZE];  /* (h) can move when frame_at() reads. */
+            SDL_memcpy(hdr, h, DRMP3_HDR_SIZE);
+            *size = frame_at(scan, (like != NULL) ? like : hdr, pos);
+            if (*size != 0)
+                return pos;
+        } /* if */
+        pos++;
+    } /* while */
+
+    return -1;
+} /* find_frame */
+
+
+static Uint32 read_be32(const Uint8 *ptr)
+{
+    return (((Uint32) ptr[0]) << 24) | (((Uint32) ptr[1]) << 16) |
+           (((Uint32) ptr[2]) << 8) | ((Uint32) ptr[3]);
+} /* read_be32 */
+
+/*
+ * If the frame at (h) is a Xing/Info or VBRI header instead of audio, fill
+ *  in what it tells us and return non-zero.
+ */
+static int parse_info_frame(Mp3Decoder *mp3, const Uint8 *h, Uint32 size)
+{
+    const int mpeg1 = DRMP3_HDR_TEST_MPEG1(h) ? 1 : 0;
+    const int mono = DRMP3_HDR_IS_MONO(h) ? 1 : 0;
+    const Uint32 xingpos = DRMP3_HDR_SIZE + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+    const Uint32 vbripos = DRMP3_HDR_SIZE + 32;
+
+    if ( (size >= xingpos + 8) &&
+         ((SDL_memcmp(h + xingpos, "Xing", 4) == 0) ||
+          (SDL_memcmp(h + xingpos, "Info", 4) == 0)) )
+    {
+        const Uint32 flags = read_be32(h + xingpos + 4);
+        Uint32 pos = xingpos + 8;
+
+        if ((flags & 0x1) && (pos + 4 <= size))
+            mp3->mpeg_frames = (Sint64) read_be32(h + pos);
+        pos += (flags & 0x1) ? 4 : 0;
+        pos += (flags & 0x2) ? 4 : 0;   /* stream size */
+        pos += (flags & 0x4) ? 100 : 0; /* seek TOC; the index is exact, though. */
+        pos += (flags & 0x8) ? 4 : 0;   /* quality */
+
+        /* a LAME tag (FFmpeg writes one, too) has the gapless info. */
+        if ( (pos + 24 <= size) &&
+             ((SDL_memcmp(h + pos, "LAME", 4) == 0) ||
+              (SDL_memcmp(h + pos, "Lavf", 4) == 0) ||
+              (SDL_memcmp(h + pos, "Lavc", 4) == 0)) )
+        {
+            const Uint8 *gapless = h + pos + 21;
+            const Uint32 delay = (((Uint32) gapless[0]) << 4) | (gapless[1] >> 4);
+            const Uint32 padding = (((Uint32) (gapless[1] & 0xF)) << 8) | gapless[2];
+            const Uint64 samples = ((Uint64) mp3->mpeg_frames) * mp3->frame_samples;
+
+            if ((mp3->mpeg_frames > 0) && (delay + MP3_DECODER_DELAY + padding < samples))
+            {
+                mp3->start_skip = delay + MP3_DECODER_DELAY;
+                mp3->total_frames = (Sint64) (samples - delay - padding);
+                if (padding < MP3_DECODER_DELAY)  /* can't go past the last frame. */
+                    mp3->total_frames = (Sint64) (samples - mp3->start_skip);
+                SNDDBG(("MP3: LAME tag: delay %u, padding %u.\n",
+                        (unsigned int) delay, (unsigned int) padding));
+            } /* if */
+        } /* if */
+
+        return 1;
+    } /* if */
+
+    if ((size >= vbripos + 18) && (SDL_memcmp(h + vbripos, "VBRI", 4) == 0))
+    {
+        mp3->mpeg_frames = (Sint64) read_be32(h + vbripos + 14);
+        return 1;
+    } /* if */
+
+    return 0;
+} /* parse_info_frame */
+
+
+/* Skip an ID3v2 tag at (pos), if there is one. */
+static Sint64 skip_id3v2(Mp3Scanner *scan, Sint64 pos)
+{
+    const Uint8 *h = scanner_get(scan, pos, 10);
+    if ((h != NULL) && (SDL_memcmp(h, "ID3", 3) == 0) &&
+        (((h[6] | h[7] | h[8] | h[9]) & 0x80) == 0))
+    {
+        const Sint64 size = (((Sint64) h[6]) << 21) | (((Sint64) h[7]) << 14) |
+                            (((Sint64) h[8]) << 7) | ((Sint64) h[9]);
+        return pos + 10 + size + ((h[5] & 0x10) ? 10 : 0);  /* (footer?) */
+    } /* if */
+    return pos;
+} /* skip_id3v2 */
+
+
+/* Find where the audio stops and an ID3v1 and/or APEv2 tag starts. */
+static Sint64 find_audio_end(SDL_RWops *rw)
+{
+    Sint64 end = SDL_RWsize(rw);
+    Uint8 tag[32];
+
+    if (end < 0)
+        return -1;
+
+    if ( (end >= 128) && (SDL_RWseek(rw, end - 128, RW_SEEK_SET) == end - 128) &&
+         (SDL_RWread(rw, tag, 3, 1) == 1) && (SDL_memcmp(tag, "TAG", 3) == 0) )
+        end -= 128;
+
+    if ( (end >= 32) && (SDL_RWseek(rw, end - 32, RW_SEEK_SET) == end - 32) &&
+         (SDL_RWread(rw, tag, 32, 1) == 1) && (SDL_memcmp(tag, "APETAGEX", 8) == 0) )
+    {
+        /* the size covers the items and this footer, but not the header. */
+        const Uint32 size = ((Uint32) tag[12]) | (((Uint32) tag[13]) << 8) |
+                            (((Uint32) tag[14]) << 16) | (((Uint32) tag[15]) << 24);
+        const Sint64 total = ((Sint64) size) + ((tag[23] & 0x80) ? 32 : 0);
+        if (total <= end)
+            end -= total;
+    } /* if */
+
+    return end;
+} /* find_audio_end */
+
+
+/* Walk every frame header from the first, filling in the index as we go. */
+static int build_index(Sound_Sample *sample, Mp3Decoder *mp3)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Mp3Scanner scan;
+    Sint64 pos = mp3->first_frame;
+    Uint32 capacity = 0;
+    Sint64 frames = 0;
+    Uint32 size;
+
+    if (mp3->index_state != 0)
+        return (mp3->index_state > 0);
+
+    mp3->index_state = -1;  /* until we're done. */
+    BAIL_IF_MACRO(DRMP3_HDR_IS_FREE_FORMAT(mp3->first_header), ERR_CANNOT_SEEK, 0);
+    BAIL_IF_MACRO(!scanner_init(&scan, internal->rw, MP3_SCAN_CHUNK, mp3->audio_end), NULL, 0);
+
+    while ((pos = find_frame(&scan, mp3->first_header, pos, &size)) >= 0)
+    {
+        if ((frames % MP3_INDEX_STRIDE) == 0)
+        {
+            if (mp3->index_count == capacity)
+            {
+                Sint64 *ptr;
+                capacity = capacity ? (capacity * 2) : 256;
+                ptr = (Sint64 *) __Sound_realloc(mp3->index, capacity * sizeof (Sint64));
+                if (ptr == NULL)
+                {
+                    scanner_quit(&scan);
+                    BAIL_MACRO(ERR_OUT_OF_MEMORY, 0);
+                } /* if */
+                mp3->index = ptr;
+            } /* if */
+            mp3->index[mp3->index_count++] = pos;
+        } /* if */
+
+        frames++;
+        pos += size;
+    } /* while */
+
+    scanner_quit(&scan);
+
+    SNDDBG(("MP3: indexed %d frames (header said %d).\n",
+            (int) frames, (int) mp3->mpeg_frames));
+
+    /* trust what we counted over what a header said. */
+    if (mp3->mpeg_frames != frames)
+    {
+        mp3->mpeg_frames = frames;
+        if (mp3->total_frames >= 0)  /* gapless info is no good now. */
+        {
+            mp3->start_skip = 0;
+            mp3->total_frames = -1;
+        } /* if */
+    } /* if */
+
+    mp3->index_state = 1;
+    return 1;
+} /* build_index */
+
+
+static void reset_decoder(drmp3 *dr)
+{
+    dr->framesConsumed = 0;
+    dr->framesRemaining = 0;
+    dr->dataSize = 0;
+    dr->atEnd = DRMP3_FALSE;
+    dr->src.cache.cachedFrameCount = 0;
+    dr->src.cache.iNextFrame = 0;
+    dr->src.algo.linear.isPrevFramesLoaded = DRMP3_FALSE;
+    dr->src.algo.linear.isNextFramesLoaded = DRMP3_FALSE;
+    drmp3dec_init(&dr->decoder);  /* forget the bit reservoir, etc. */
+} /* reset_decoder */
+
+
+/* Position dr_mp3 so the next sample it returns is (sample_index) from the first audio frame. */
+static int seek_indexed(Sound_Sample *sample, Mp3Decoder *mp3, Uint64 sample_index)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Uint8 *hdr = mp3->first_header;
+    const int layer3 = (DRMP3_HDR_GET_LAYER(hdr) == 1);
+    const Uint32 reservoir = DRMP3_HDR_TEST_MPEG1(hdr) ? 511 : 255;
+    const Uint32 overhead = DRMP3_HDR_SIZE + 2 + (DRMP3_HDR_TEST_MPEG1(hdr) ? 32 : 17);
+    Sint64 offsets[MP3_INDEX_STRIDE + MP3_MAX_PREROLL + 2];
+    drmp3 *dr = &mp3->dr;
+    const Uint64 target = sample_index / mp3->frame_samples;
+    const Uint32 skip = (Uint32) (sample_index % mp3->frame_samples);
+    Uint64 first, frame, start;
+    Mp3Scanner scan;
+    Uint32 count = 0;
+    Uint32 i, bytes;
+
+    reset_decoder(dr);
+
+    if (target >= (Uint64) mp3->mpeg_frames)  /* at (or past) the end. */
+    {
+        dr->atEnd = DRMP3_TRUE;
+        return (target == (Uint64) mp3->mpeg_frames) && (skip == 0);
+    } /* if */
+
+    /* step from the nearest index entry before the preroll to the target. */
+    first = (target > MP3_MAX_PREROLL) ? (target - MP3_MAX_PREROLL) : 0;
+    first -= first % MP3_INDEX_STRIDE;
+    BAIL_IF_MACRO(!scanner_init(&scan, internal->rw, 16 * 1024, mp3->audio_end), NULL, 0);
+    offsets[0] = mp3->index[first / MP3_INDEX_STRIDE];
+    for (frame = first; frame < target; frame++)
+    {
+        const Uint8 *h = scanner_get(&scan, offsets[count], DRMP3_HDR_SIZE);
+        const Uint32 size = h ? frame_size(h) : 0;
+        if (size == 0)
+        {
+            scanner_quit(&scan);
+            BAIL_MACRO(ERR_IO_ERROR, 0);
+        } /* if */
+        offsets[count + 1] = offsets[count] + size;
+        count++;
+    } /* for */
+
+    /*
+     * offsets[count] is the target frame. Decode the frame before it, so
+     *  the overlap and synthesis history are right, and before that, enough
+     *  frames that it finds its whole bit reservoir. Layers I and II don't
+     *  have a reservoir.
+     */
+    start = count ? (count - 1) : 0;
+    if (layer3)
+    {
+        for (bytes = 0; (start > 0) && (bytes < reservoir); )
+        {
+            const Sint64 size = offsets[start] - offsets[start - 1];
+            start--;
+            bytes += (size > overhead) ? (Uint32) (size - overhead) : 0;
+        } /* for */
+    } /* if */
+
+    for (i = (Uint32) start; i < count; i++)
+    {
+        const Uint32 size = (Uint32) (offsets[i + 1] - offsets[i]);
+        const Uint8 *data = scanner_get(&scan, offsets[i], size);
+        drmp3dec_frame_info info;
+        if (data == NULL)
+        {
+            scanner_quit(&scan);
+            BAIL_MACRO(ERR_IO_ERROR, 0);
+        } /* if */
+        drmp3dec_decode_frame(&dr->decoder, data, (int) size, (drmp3d_sample_t *) dr->frames, &info);
+    } /* for */
+
+    scanner_quit(&scan);
+
+    BAIL_IF_MACRO(SDL_RWseek(internal->rw, offsets[count], RW_SEEK_SET) != offsets[count], ERR_IO_ERROR, 0);
+    return (drmp3_read_f32(dr, skip, NULL) == skip);
+} /* seek_indexed */
+
+
+/* For streams we can't index: decode from the start, like dr_mp3 would. */
+static int seek_linear(Sound_Sample *sample, Mp3Decoder *mp3, Uint64 sample_index)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    reset_decoder(&mp3->dr);
+    BAIL_IF_MACRO(SDL_RWseek(internal->rw, mp3->first_frame, RW_SEEK_SET) != mp3->first_frame, ERR_IO_ERROR, 0);
+    return (drmp3_read_f32(&mp3->dr, sample_index, NULL) == sample_index);
+} /* seek_linear */
+
+
+static int seek_to(Sound_Sample *sample, Mp3Decoder *mp3, Uint64 frame)
+{
+    const int indexed = build_index(sample, mp3);  /* may change start_skip. */
+    int rc;
+
+    if ((mp3->total_frames >= 0) && (frame > (Uint64) mp3->total_frames))
+        BAIL_MACRO(ERR_PAST_EOF, 0);
+
+    if (indexed)
+        rc = seek_indexed(sample, mp3, frame + mp3->start_skip);
+    else
+        rc = seek_linear(sample, mp3, frame + mp3->start_skip);
+
+    mp3->position = frame;
+    return rc;
+} /* seek_to */
+
+
+static void set_duration(Sound_Sample *sample, Mp3Decoder *mp3)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    const Uint32 rate = mp3->dr.sampleRate;
+
+    if ((mp3->total_frames < 0) && (mp3->mpeg_frames >= 0))
+        mp3->total_frames = mp3->mpeg_frames * mp3->frame_samples;
+
+    if (mp3->total_frames < 0)
+    {
+        internal->total_time = -1;
+        return;
+    } /* if */
+
+    internal->total_frames = mp3->total_frames;
+    internal->total_time = (Sint32) ((mp3->total_frames / rate) * 1000);
+    internal->total_time += (Sint32) (((mp3->total_frames % rate) * 1000) / rate);
+    internal->segmentable = (mp3->index_state >= 0) &&
+                            !DRMP3_HDR_IS_FREE_FORMAT(mp3->first_header);
+} /* set_duration */
+
+
 static int MP3_init(void)
 {
     return 1;  /* always succeeds. */
@@ -98,28 +585,87 @@ static void MP3_quit(void)
     /* it's a no-op. */
 } /* MP3_quit */
 
+
+static void free_mp3(Mp3Decoder *mp3)
+{
+    __Sound_free(mp3->index);
+    __Sound_free(mp3);
+} /* free_mp3 */
+
 static int MP3_open(Sound_Sample *sample, const char *ext)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drmp3 *dr = (drmp3 *) SDL_calloc(1, sizeof (drmp3));
+    Mp3Decoder *mp3 = (Mp3Decoder *) __Sound_calloc(1, sizeof (Mp3Decoder));
+    drmp3_config config;
+    const Uint8 *h;
+    Mp3Scanner scan;
+    Sint64 pos;
+    Uint32 size = 0;
+
+    BAIL_IF_MACRO(!mp3, ERR_OUT_OF_MEMORY, 0);
+    mp3->mpeg_frames = -1;
+    mp3->total_frames = -1;
+
+    pos = SDL_RWtell(internal->rw);
+    mp3->audio_end = find_audio_end(internal->rw);
+
+    if (!scanner_init(&scan, internal->rw, 16 * 1024, mp3->audio_end))
+    {
+        __Sound_free(mp3);
+        return 0;
+    } /* if */
 
-    BAIL_IF_MACRO(!dr, ERR_OUT_OF_MEMORY, 0);
-    if (drmp3_init(dr, mp3_read, mp3_seek, sample, NULL) != DRMP3_TRUE)
+    /* find the first frame, and see if it's a Xing/Info/VBRI header. */
+    pos = (pos < 0) ? -1 : find_frame(&scan, NULL, skip_id3v2(&scan, pos), &size);
+    h = (pos < 0) ? NULL : scanner_get(&scan, pos, size);
+    if (h == NULL)
     {
-        SDL_free(dr);
-        BAIL_IF_MACRO(sample->flags & SOUND_SAMPLEFLAG_ERROR, ERR_IO_ERROR, 0);
+        scanner_quit(&scan);
+        __Sound_free(mp3);
         BAIL_MACRO("MP3: Not an MPEG-1 layer 1-3 stream.", 0);
     } /* if */
 
+    SDL_memcpy(mp3->first_header, h, DRMP3_HDR_SIZE);
+    mp3->frame_samples = drmp3_hdr_frame_samples(h);
+    mp3->first_frame = pos;
+    if (parse_info_frame(mp3, h, size))
+        mp3->first_frame += size;
+    scanner_quit(&scan);
+
+    /* decode at the stream's own rate; Sound_Decode() does the rest. */
+    SDL_zero(config);
+    config.outputSampleRate = drmp3_hdr_sample_rate_hz(mp3->first_header);
+
+    internal->decoder_private = mp3;  /* mp3_read() wants this. */
+    if ( (SDL_RWseek(internal->rw, mp3->first_frame, RW_SEEK_SET) != mp3->first_frame) ||
+         (drmp3_init(&mp3->dr, mp3_read, mp3_seek, sample, &config) != DRMP3_TRUE) )
+    {
+        internal->decoder_private = NULL;
+        __Sound_free(mp3);
+        BAIL_MACRO("MP3: Not an MPEG-1 layer 1-3 stream.", 0);
+    } /* if */
+
+    if (mp3->start_skip > 0)
+    {
+        /* skip the encoder delay. */
+        if (!seek_to(sample, mp3, 0))
+        {
+            internal->decoder_private = NULL;
+            drmp3_uninit(&mp3->dr);
+            free_mp3(mp3);
+            BAIL_MACRO("MP3: Couldn't find the start of the stream.", 0);
+        } /* if */
+    } /* if */
+
     SNDDBG(("MP3: Accepting data stream.\n"));
     sample->flags = SOUND_SAMPLEFLAG_CANSEEK;
 
-    sample->actual.channels = dr->channels;
-    sample->actual.rate = dr->sampleRate;
+    sample->actual.channels = mp3->dr.channels;
+    sample->actual.rate = mp3->dr.sampleRate;
     sample->actual.format = AUDIO_F32SYS;  /* dr_mp3 only does float. */
 
-    internal->total_time = -1;  /* !!! FIXME? */
-    internal->decoder_private = dr;
+    /* without a frame count, MP3_duration() walks the headers, if asked. */
+    set_duration(sample, mp3);
 
     return 1;
 } /* MP3_open */
@@ -127,39 +673,74 @@ static int MP3_open(Sound_Sample *sample, const char *ext)
 static void MP3_close(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drmp3 *dr = (drmp3 *) internal->decoder_private;
-    drmp3_uninit(dr);
-    SDL_free(dr);
+    Mp3Decoder *mp3 = (Mp3Decoder *) internal->decoder_private;
+    drmp3_uninit(&mp3->dr);
+    free_mp3(mp3);
 } /* MP3_close */
 
 static Uint32 MP3_read(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     const int channels = (int) sample->actual.channels;
-    drmp3 *dr = (drmp3 *) internal->decoder_private;
-    const drmp3_uint64 frames_to_read = (internal->buffer_size / channels) / sizeof (float);
-    const drmp3_uint64 rc = drmp3_read_f32(dr, frames_to_read, (float *) internal->buffer);
-    /* !!! FIXME: the mp3_read callback sets ERROR and EOF flags, but this only tells you about i/o errors, not corruption. */
-    return rc * channels * sizeof (float);
+    Mp3Decoder *mp3 = (Mp3Decoder *) internal->decoder_private;
+    drmp3_uint64 frames_to_read = (internal->buffer_size / channels) / sizeof (float);
+    drmp3_uint64 rc;
+    int at_end = 0;
+
+    /* don't hand out the encoder's padding. */
+    if ( (mp3->total_frames >= 0) &&
+         (frames_to_read >= (Uint64) mp3->total_frames - mp3->position) )
+    {
+        frames_to_read = (Uint64) mp3->total_frames - mp3->position;
+        at_end = 1;
+    } /* if */
+
+    rc = frames_to_read ? drmp3_read_f32(&mp3->dr, frames_to_read, (float *) internal->buffer) : 0;
+    mp3->position += rc;
+
+    /* !!! FIXME: dr_mp3 only comes up short at the end, or on i/o errors, which we can't tell apart. */
+    if ((at_end) || (rc < frames_to_read))
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+    return (Uint32) (rc * channels * sizeof (float));
 } /* MP3_read */
 
 static int MP3_rewind(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drmp3 *dr = (drmp3 *) internal->decoder_private;
-    return (drmp3_seek_to_frame(dr, 0) == DRMP3_TRUE);
+    return seek_to(sample, (Mp3Decoder *) internal->decoder_private, 0);
 } /* MP3_rewind */
 
-static int MP3_seek(Sound_Sample *sample, Uint32 ms)
+static int MP3_seek_frames(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drmp3 *dr = (drmp3 *) internal->decoder_private;
-    const float frames_per_ms = ((float) sample->actual.rate) / 1000.0f;
-    const drmp3_uint64 frame_offset = (drmp3_uint64) (frames_per_ms * ((float) ms));
-    return (drmp3_seek_to_frame(dr, frame_offset) == DRMP3_TRUE);
+    return seek_to(sample, (Mp3Decoder *) internal->decoder_private, frame);
+} /* MP3_seek_frames */
+
+static int MP3_seek(Sound_Sample *sample, Uint32 ms)
+{
+    return MP3_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
 } /* MP3_seek */
 
 /* dr_mp3 will play layer 1 and 2 files, too */
+static Sint64 MP3_duration(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    Mp3Decoder *mp3 = (Mp3Decoder *) internal->decoder_private;
+
+    /* no frame count in a header? Then count them now. */
+    if ((mp3->mpeg_frames < 0) && (mp3->index_state == 0))
+    {
+        const Sint64 pos = SDL_RWtell(internal->rw);
+        BAIL_IF_MACRO(pos < 0, ERR_IO_ERROR, -1);
+        build_index(sample, mp3);  /* this moves the stream around. */
+        BAIL_IF_MACRO(SDL_RWseek(internal->rw, pos, RW_SEEK_SET) != pos, ERR_IO_ERROR, -1);
+    } /* if */
+
+    set_duration(sample, mp3);
+    return mp3->total_frames;
+} /* MP3_duration */
+
+
 static const char *extensions_mp3[] = { "MP3", "MP2", "MP1", NULL };
 const Sound_DecoderFunctions __Sound_DecoderFunctions_MP3 =
 {
@@ -176,7 +757,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_MP3 =
     MP3_close,      /*  close() method */
     MP3_read,       /*   read() method */
     MP3_rewind,     /* rewind() method */
-    MP3_seek        /*   seek() method */
+    MP3_seek,       /*   seek() method */
+    MP3_seek_frames, /* seek_frames() method */
+    NULL,           /*   tell() method */
+    MP3_duration,   /* duration() method */
+    NULL            /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_MP3 */
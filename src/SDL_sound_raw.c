@@ -83,6 +83,9 @@ static int RAW_open(Sound_Sample *sample, const char *ext)
       * ( (sample->actual.format & 0x0018) >> 3) );
     internal->total_time = ( pos ) / sample_rate * 1000;
     internal->total_time += (pos % sample_rate) * 1000 / sample_rate;
+    internal->total_frames = pos / (((sample->actual.format & 0xFF) / 8) *
+                                    sample->actual.channels);
+    internal->segmentable = 1;
 
     return 1; /* we'll handle this data. */
 } /* RAW_open */
@@ -129,13 +132,21 @@ static int RAW_rewind(Sound_Sample *sample)
 } /* RAW_rewind */
 
 
-static int RAW_seek(Sound_Sample *sample, Uint32 ms)
+static int RAW_seek_frames(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    int pos = (int) __Sound_convertMsToBytePos(&sample->actual, ms);
+    const Uint64 offset = frame * (((sample->actual.format & 0xFF) / 8) *
+                                   sample->actual.channels);
+    const Sint64 pos = (Sint64) offset;
     int err = (SDL_RWseek(internal->rw, pos, SEEK_SET) != pos);
     BAIL_IF_MACRO(err, ERR_IO_ERROR, 0);
     return 1;
+} /* RAW_seek_frames */
+
+
+static int RAW_seek(Sound_Sample *sample, Uint32 ms)
+{
+    return RAW_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
 } /* RAW_seek */
 
 static const char *extensions_raw[] = { "RAW", NULL };
@@ -154,7 +165,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_RAW =
     RAW_close,      /*  close() method */
     RAW_read,       /*   read() method */
     RAW_rewind,     /* rewind() method */
-    RAW_seek        /*   seek() method */
+    RAW_seek,       /*   seek() method */
+    RAW_seek_frames, /* seek_frames() method */
+    NULL,           /*   tell() method */
+    NULL,           /* duration() method */
+    NULL            /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_RAW */
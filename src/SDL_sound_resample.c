@@ -0,0 +1,634 @@
+/**
+ * SDL_sound; An abstract sound format decoding API.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ */
+
+/*
+ * Sample rate conversion.
+ *
+ * SDL_AudioCVT converts each chunk on its own, so a resampled stream gets a
+ *  little discontinuity at every chunk boundary, and the decode buffer has
+ *  to be oversized by len_mult to hold the result. This is a streaming
+ *  polyphase windowed-sinc resampler that keeps its filter history in the
+ *  Sound_Sample instead, so it doesn't care where the chunks split.
+ *
+ * Input is always float32 at the decoder's rate (SDL_AudioCVT still handles
+ *  format and channel conversion before we get it), in the desired number of
+ *  channels. We keep it deinterleaved in a FIFO so each channel's filter is
+ *  one contiguous dot product, which is what the SIMD kernels below do. The
+ *  output is written directly in the desired format.
+ *
+ * For rates that reduce to a reasonable fraction (44100->48000 is 147/160,
+ *  22050->48000 is 147/320) there's a filter for every phase and each output
+ *  sample is exact. Otherwise, we keep a fixed table of phases and linearly
+ *  interpolate between the two nearest ones.
+ */
+
+#define __SDL_SOUND_INTERNAL__
+#include "SDL_sound_internal.h"
+
+#define RESAMPLE_PI 3.14159265358979323846
+
+/* process this many output frames before converting them to final format. */
+#define RESAMPLE_BLOCK_FRAMES 256
+
+/* don't let heavy downsampling make filters absurdly long. */
+#define RESAMPLE_MAX_TAPS 1024
+
+/* beyond this many floats, a table for every phase isn't worth it. */
+#define RESAMPLE_MAX_TABLE_FLOATS (128 * 1024)
+
+typedef float (*DotProductFn)(const float *a, const float *b, Uint32 count);
+
+struct Sound_Resampler
+{
+    Uint8 channels;
+    SDL_AudioFormat format;   /* output format. */
+    Uint32 step;              /* input rate, reduced. */
+    Uint32 phases;            /* output rate, reduced. */
+    Uint32 table_phases;      /* filters in the table (minus one if interp). */
+    int interpolate;          /* nonzero if table_phases != phases. */
+    Uint32 taps;              /* filter length; always a multiple of 8. */
+    float *filters;
+    DotProductFn dot;
+
+    float *fifo;              /* (channels) planes of (capacity) floats. */
+    Uint32 capacity;
+    Uint32 frames;            /* valid frames in each plane. */
+    Uint32 pos;               /* first input frame of the next output. */
+    Uint32 phase;             /* next output's offset past pos: phase/phases. */
+
+    Uint64 total_in;          /* real input frames since last reset. */
+    Uint64 total_out;         /* output frames since last reset. */
+    int flushed;              /* nonzero if input is done. */
+
+    float *scratch;           /* RESAMPLE_BLOCK_FRAMES interleaved frames. */
+    Sound_ConvertFn store;    /* float32 to output format, if not NULL. */
+};
+
+
+/* The dot product kernels. (count) is always a multiple of 8. */
+
+static float dot_scalar(const float *a, const float *b, Uint32 count)
+{
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+    Uint32 i;
+    for (i = 0; i < count; i += 4)
+    {
+        sum0 += a[i] * b[i];
+        sum1 += a[i+1] * b[i+1];
+        sum2 += a[i+2] * b[i+2];
+        sum3 += a[i+3] * b[i+3];
+    } /* for */
+    return (sum0 + sum1) + (sum2 + sum3);
+} /* dot_scalar */
+
+#if SOUND_HAVE_SSE_INTRINSICS
+static SOUND_TARGETING("sse") float dot_sse(const float *a, const float *b,
+                                             Uint32 count)
+{
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    float tmp[4];
+    Uint32 i;
+
+    for (i = 0; i < count; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a+i), _mm_loadu_ps(b+i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a+i+4), _mm_loadu_ps(b+i+4)));
+    } /* for */
+
+    _mm_storeu_ps(tmp, _mm_add_ps(sum0, sum1));
+    return (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+} /* dot_sse */
+#endif
+
+#if SOUND_HAVE_AVX_INTRINSICS
+static SOUND_TARGETING("avx") float dot_avx(const float *a, const float *b,
+                                             Uint32 count)
+{
+    __m256 sum = _mm256_setzero_ps();
+    __m128 half;
+    float tmp[4];
+    Uint32 i;
+
+    for (i = 0; i < count; i += 8)
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a+i), _mm256_loadu_ps(b+i)));
+
+    half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    _mm_storeu_ps(tmp, half);
+    return (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+} /* dot_avx */
+#endif
+
+#if SOUND_HAVE_NEON_INTRINSICS
+static float dot_neon(const float *a, const float *b, Uint32 count)
+{
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    float32x2_t half;
+    Uint32 i;
+
+    for (i = 0; i < count; i += 8)
+    {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(a+i), vld1q_f32(b+i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(a+i+4), vld1q_f32(b+i+4));
+    } /* for */
+
+    sum0 = vaddq_f32(sum0, sum1);
+    half = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+} /* dot_neon */
+#endif
+
+static DotProductFn choose_dot_product(void)
+{
+#if SOUND_HAVE_AVX_INTRINSICS
+    if (SDL_HasAVX())
+        return dot_avx;
+#endif
+#if SOUND_HAVE_SSE_INTRINSICS
+    if (SDL_HasSSE())
+        return dot_sse;
+#endif
+#if SOUND_HAVE_NEON_INTRINSICS
+    if (SDL_HasNEON())
+        return dot_neon;
+#endif
+    return dot_scalar;
+} /* choose_dot_product */
+
+
+/* zeroth order modified Bessel function of the first kind, for Kaiser. */
+static double bessel_i0(double x)
+{
+    const double xsq = (x * x) / 4.0;
+    double sum = 1.0;
+    double term = 1.0;
+    int i;
+
+    for (i = 1; i < 64; i++)
+    {
+        term *= xsq / ((double) i * (double) i);
+        sum += term;
+        if (term < (sum * 1e-12))
+            break;
+    } /* for */
+
+    return sum;
+} /* bessel_i0 */
+
+
+/*
+ * Fill in one filter: a sinc lowpass at (cutoff) times the input rate,
+ *  under a Kaiser window, centered (frac) of a frame past the middle tap.
+ */
+static void build_filter(float *dst, Uint32 taps, double frac,
+                         double cutoff, double beta)
+{
+    const double half = taps / 2.0;
+    const double center = half - 1.0 + frac;
+    const double i0beta = bessel_i0(beta);
+    double sum = 0.0;
+    Uint32 i;
+
+    for (i = 0; i < taps; i++)
+    {
+        const double x = ((double) i) - center;
+        const double w = x / half;
+        double val = cutoff;
+
+        if (x != 0.0)
+            val = SDL_sin(RESAMPLE_PI * cutoff * x) / (RESAMPLE_PI * x);
+
+        if ((w <= -1.0) || (w >= 1.0))
+            val = 0.0;
+        else
+            val *= bessel_i0(beta * SDL_sqrt(1.0 - (w * w))) / i0beta;
+
+        dst[i] = (float) val;
+        sum += val;
+    } /* for */
+
+        /* normalize, so every phase has exactly unity gain at DC. */
+    if (sum != 0.0)
+    {
+        for (i = 0; i < taps; i++)
+            dst[i] = (float) (dst[i] / sum);
+    } /* if */
+} /* build_filter */
+
+
+static Uint32 gcd(Uint32 a, Uint32 b)
+{
+    while (b != 0)
+    {
+        const Uint32 tmp = a % b;
+        a = b;
+        b = tmp;
+    } /* while */
+    return a;
+} /* gcd */
+
+
+Sound_Resampler *__Sound_CreateResampler(Sound_ResampleQuality quality,
+                                         Uint8 channels, Uint32 inrate,
+                                         Uint32 outrate,
+                                         SDL_AudioFormat outfmt)
+{
+    Sound_Resampler *r;
+    Uint32 half_taps, max_phases, divisor, i;
+    double rolloff, beta, cutoff;
+
+    BAIL_IF_MACRO(channels == 0, ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF_MACRO((inrate == 0) || (outrate == 0), ERR_INVALID_ARGUMENT, NULL);
+
+    switch (quality)
+    {
+        case SOUND_RESAMPLE_FAST:
+            half_taps = 4; beta = 5.0; rolloff = 0.85; max_phases = 64;
+            break;
+        case SOUND_RESAMPLE_BEST:
+            half_taps = 32; beta = 10.0; rolloff = 0.95; max_phases = 512;
+            break;
+        default:
+            half_taps = 16; beta = 8.0; rolloff = 0.92; max_phases = 256;
+            break;
+    } /* switch */
+
+    r = (Sound_Resampler *) __Sound_calloc(1, sizeof (Sound_Resampler));
+    BAIL_IF_MACRO(r == NULL, ERR_OUT_OF_MEMORY, NULL);
+
+    divisor = gcd(inrate, outrate);
+    r->channels = channels;
+    r->format = outfmt;
+    r->step = inrate / divisor;
+    r->phases = outrate / divisor;
+    r->dot = choose_dot_product();
+    if (outfmt != AUDIO_F32SYS)
+        r->store = __Sound_GetConverter(AUDIO_F32SYS, 1, outfmt, 1);
+
+        /* when downsampling, the filter has to cut below the new Nyquist. */
+    cutoff = rolloff;
+    if (inrate > outrate)
+    {
+        const double ratio = ((double) outrate) / ((double) inrate);
+        cutoff *= ratio;
+        half_taps = (Uint32) SDL_ceil(half_taps / ratio);
+    } /* if */
+
+    r->taps = ((half_taps * 2) + 7) & ~7;
+    if (r->taps > RESAMPLE_MAX_TAPS)
+        r->taps = RESAMPLE_MAX_TAPS;
+
+    if ((r->phases <= max_phases * 4) &&
+        (((Uint64) r->phases) * r->taps <= RESAMPLE_MAX_TABLE_FLOATS))
+    {
+        r->table_phases = r->phases;
+        r->interpolate = 0;
+    } /* if */
+    else
+    {
+        r->table_phases = max_phases;
+        r->interpolate = 1;
+    } /* else */
+
+    r->filters = (float *) __Sound_malloc(sizeof (float) * r->taps *
+                                      (r->table_phases + 1));
+    r->scratch = (float *) __Sound_malloc(sizeof (float) * channels *
+                                      RESAMPLE_BLOCK_FRAMES);
+    if ((r->filters == NULL) || (r->scratch == NULL))
+    {
+        __Sound_DestroyResampler(r);
+        BAIL_MACRO(ERR_OUT_OF_MEMORY, NULL);
+    } /* if */
+
+        /* the extra filter at the end is phase 1.0, for interpolating. */
+    for (i = 0; i <= r->table_phases; i++)
+    {
+        build_filter(r->filters + (i * r->taps), r->taps,
+                     ((double) i) / ((double) r->table_phases), cutoff, beta);
+    } /* for */
+
+    if (!__Sound_ResetResampler(r))
+    {
+        __Sound_DestroyResampler(r);
+        return NULL;
+    } /* if */
+
+    SNDDBG(("Resampler: %u -> %u, %u taps, %u phases%s.\n",
+            (unsigned int) inrate, (unsigned int) outrate,
+            (unsigned int) r->taps, (unsigned int) r->table_phases,
+            r->interpolate ? " (interpolated)" : ""));
+
+    return r;
+} /* __Sound_CreateResampler */
+
+
+void __Sound_DestroyResampler(Sound_Resampler *r)
+{
+    if (r != NULL)
+    {
+        __Sound_free(r->filters);
+        __Sound_free(r->fifo);
+        __Sound_free(r->scratch);
+        __Sound_free(r);
+    } /* if */
+} /* __Sound_DestroyResampler */
+
+
+/* make sure there's room for (count) more frames at the end of the FIFO. */
+static int reserve_fifo(Sound_Resampler *r, Uint32 count)
+{
+    const Uint32 keep = r->frames - r->pos;
+    Uint32 ch;
+
+        /* slide out what we've finished with, if that makes room. */
+    if ((r->frames + count > r->capacity) && (r->pos > 0))
+    {
+        for (ch = 0; ch < r->channels; ch++)
+        {
+            float *plane = r->fifo + (ch * r->capacity);
+            SDL_memmove(plane, plane + r->pos, keep * sizeof (float));
+        } /* for */
+        r->frames = keep;
+        r->pos = 0;
+    } /* if */
+
+    if (r->frames + count > r->capacity)
+    {
+        const Uint32 newcap = (r->frames + count) * 2;
+        float *fifo = (float *) __Sound_malloc(sizeof (float) * r->channels * newcap);
+        BAIL_IF_MACRO(fifo == NULL, ERR_OUT_OF_MEMORY, 0);
+
+        for (ch = 0; ch < r->channels; ch++)
+        {
+            SDL_memcpy(fifo + (ch * newcap), r->fifo + (ch * r->capacity),
+                       r->frames * sizeof (float));
+        } /* for */
+
+        __Sound_free(r->fifo);
+        r->fifo = fifo;
+        r->capacity = newcap;
+    } /* if */
+
+    return 1;
+} /* reserve_fifo */
+
+
+static int append_silence(Sound_Resampler *r, Uint32 count)
+{
+    Uint32 ch;
+
+    if (!reserve_fifo(r, count))
+        return 0;
+
+    for (ch = 0; ch < r->channels; ch++)
+        SDL_memset(r->fifo + (ch * r->capacity) + r->frames, '\0', count * sizeof (float));
+    r->frames += count;
+    return 1;
+} /* append_silence */
+
+
+int __Sound_ResetResampler(Sound_Resampler *r)
+{
+    r->frames = r->pos = r->phase = 0;
+    r->total_in = r->total_out = 0;
+    r->flushed = 0;
+
+    /*
+     * Prime the history with silence, so the first output frame is centered
+     *  right on the first input frame and the stream doesn't shift in time.
+     */
+    return append_silence(r, (r->taps / 2) - 1);
+} /* __Sound_ResetResampler */
+
+
+int __Sound_ResamplerPut(Sound_Resampler *r, const float *src, Uint32 frames)
+{
+    const Uint32 channels = r->channels;
+    Uint32 ch, i;
+
+    SDL_assert(!r->flushed);
+
+    if (!reserve_fifo(r, frames))
+        return 0;
+
+    for (ch = 0; ch < channels; ch++)
+    {
+        float *dst = r->fifo + (ch * r->capacity) + r->frames;
+        const float *in = src + ch;
+        for (i = 0; i < frames; i++, in += channels)
+            dst[i] = *in;
+    } /* for */
+
+    r->frames += frames;
+    r->total_in += frames;
+    return 1;
+} /* __Sound_ResamplerPut */
+
+
+int __Sound_ResamplerFlush(Sound_Resampler *r)
+{
+    if (!r->flushed)
+    {
+            /* enough silence that the last real frame gets its full filter. */
+        if (!append_silence(r, r->taps))
+            return 0;
+        r->flushed = 1;
+    } /* if */
+    return 1;
+} /* __Sound_ResamplerFlush */
+
+
+int __Sound_ResamplerFlushed(const Sound_Resampler *r)
+{
+    return r->flushed;
+} /* __Sound_ResamplerFlushed */
+
+
+Uint32 __Sound_ResamplerAvailable(const Sound_Resampler *r)
+{
+    Uint64 retval;
+
+    if (r->pos + r->taps > r->frames)
+        retval = 0;
+    else
+    {
+        /*
+         * Output k needs pos + (phase + k*step) / phases + taps <= frames,
+         *  so count the k that satisfy that.
+         */
+        const Uint64 last = (r->frames - r->taps) - r->pos;
+        retval = (((last + 1) * r->phases) - r->phase + r->step - 1) / r->step;
+    } /* else */
+
+    if (r->flushed)  /* don't run off into the padding. */
+    {
+        const Uint64 total = ((r->total_in * r->phases) + r->step - 1) / r->step;
+        const Uint64 remaining = (total > r->total_out) ? total - r->total_out : 0;
+        if (retval > remaining)
+            retval = remaining;
+    } /* if */
+
+    return (retval > 0xFFFFFFFF) ? 0xFFFFFFFF : (Uint32) retval;
+} /* __Sound_ResamplerAvailable */
+
+
+Uint64 __Sound_ResamplerPending(const Sound_Resampler *r)
+{
+        /* round down, so we report the frame the next output starts in. */
+    const Uint64 consumed = (r->total_out * r->step) / r->phases;
+    return (r->total_in > consumed) ? (r->total_in - consumed) : 0;
+} /* __Sound_ResamplerPending */
+
+
+/* convert interleaved float frames to the output format. */
+static void store_frames(const float *src, void *_dst, Uint32 count,
+                         SDL_AudioFormat fmt)
+{
+    Uint32 i;
+
+    switch (fmt)
+    {
+        case AUDIO_U8:
+        case AUDIO_S8:
+        {
+            Uint8 *dst = (Uint8 *) _dst;
+            const int bias = (fmt == AUDIO_U8) ? 128 : 0;
+            for (i = 0; i < count; i++)
+            {
+                float val = src[i];
+                val = (val > 1.0f) ? 1.0f : ((val < -1.0f) ? -1.0f : val);
+                dst[i] = (Uint8) (((int) (val * 127.0f)) + bias);
+            } /* for */
+            break;
+        } /* case */
+
+        case AUDIO_U16LSB:
+        case AUDIO_U16MSB:
+        case AUDIO_S16LSB:
+        case AUDIO_S16MSB:
+        {
+            Uint16 *dst = (Uint16 *) _dst;
+            const int bias = (fmt & SDL_AUDIO_MASK_SIGNED) ? 0 : 32768;
+            const int swap = ((fmt & SDL_AUDIO_MASK_ENDIAN) != (AUDIO_S16SYS & SDL_AUDIO_MASK_ENDIAN));
+            for (i = 0; i < count; i++)
+            {
+                float val = src[i];
+                Uint16 sample;
+                val = (val > 1.0f) ? 1.0f : ((val < -1.0f) ? -1.0f : val);
+                sample = (Uint16) (((int) (val * 32767.0f)) + bias);
+                dst[i] = swap ? SDL_Swap16(sample) : sample;
+            } /* for */
+            break;
+        } /* case */
+
+        case AUDIO_S32LSB:
+        case AUDIO_S32MSB:
+        {
+            Uint32 *dst = (Uint32 *) _dst;
+            const int swap = (fmt != AUDIO_S32SYS);
+            for (i = 0; i < count; i++)
+            {
+                const float val = src[i];
+                Sint32 sample;
+                if (val >= 1.0f)
+                    sample = 2147483647;
+                else if (val <= -1.0f)
+                    sample = -2147483647;
+                else
+                    sample = (Sint32) (val * 2147483647.0);
+                dst[i] = swap ? SDL_Swap32((Uint32) sample) : (Uint32) sample;
+            } /* for */
+            break;
+        } /* case */
+
+        case AUDIO_F32LSB:
+        case AUDIO_F32MSB:
+        {
+            if (fmt == AUDIO_F32SYS)
+                SDL_memcpy(_dst, src, count * sizeof (float));
+            else
+            {
+                Uint32 *dst = (Uint32 *) _dst;
+                const Uint32 *in = (const Uint32 *) src;
+                for (i = 0; i < count; i++)
+                    dst[i] = SDL_Swap32(in[i]);
+            } /* else */
+            break;
+        } /* case */
+
+        default:
+            SDL_assert(0 && "unexpected output format");
+            break;
+    } /* switch */
+} /* store_frames */
+
+
+Uint32 __Sound_ResamplerGet(Sound_Resampler *r, void *_dst, Uint32 frames)
+{
+    const Uint32 channels = r->channels;
+    const Uint32 taps = r->taps;
+    const Uint32 framesize = ((r->format & 0xFF) / 8) * channels;
+    const DotProductFn dot = r->dot;
+    Uint8 *dst = (Uint8 *) _dst;
+    const Uint32 avail = __Sound_ResamplerAvailable(r);
+    Uint32 retval = 0;
+
+    if (frames > avail)
+        frames = avail;
+
+    while (retval < frames)
+    {
+        Uint32 block = frames - retval;
+        float *out = r->scratch;
+        Uint32 i, ch;
+
+        if (block > RESAMPLE_BLOCK_FRAMES)
+            block = RESAMPLE_BLOCK_FRAMES;
+
+        for (i = 0; i < block; i++)
+        {
+            const float *in = r->fifo + r->pos;
+
+            if (!r->interpolate)
+            {
+                const float *filter = r->filters + (r->phase * taps);
+                for (ch = 0; ch < channels; ch++, in += r->capacity)
+                    *(out++) = dot(in, filter, taps);
+            } /* if */
+            else
+            {
+                const Uint64 scaled = ((Uint64) r->phase) * r->table_phases;
+                const Uint32 idx = (Uint32) (scaled / r->phases);
+                const float frac = ((float) (scaled % r->phases)) / ((float) r->phases);
+                const float *filter0 = r->filters + (idx * taps);
+                const float *filter1 = filter0 + taps;
+                for (ch = 0; ch < channels; ch++, in += r->capacity)
+                {
+                    const float a = dot(in, filter0, taps);
+                    const float b = dot(in, filter1, taps);
+                    *(out++) = a + ((b - a) * frac);
+                } /* for */
+            } /* else */
+
+            r->phase += r->step;
+            r->pos += r->phase / r->phases;
+            r->phase %= r->phases;
+        } /* for */
+
+        if (r->store != NULL)
+            r->store(r->scratch, dst, block, channels);
+        else
+            store_frames(r->scratch, dst, block * channels, r->format);
+        dst += block * framesize;
+        retval += block;
+    } /* while */
+
+    r->total_out += retval;
+    return retval;
+} /* __Sound_ResamplerGet */
+
+/* end of SDL_sound_resample.c ... */
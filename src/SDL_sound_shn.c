@@ -434,7 +434,7 @@ static Sint32 **shn_long2d(Uint32 n0, Uint32 n1)
     Sint32 **array0;
     Uint32 size = (n0 * sizeof (Sint32 *)) + (n0 * n1 * sizeof (Sint32));
 
-    array0 = (Sint32 **) SDL_malloc(size);
+    array0 = (Sint32 **) __Sound_malloc(size);
     if (array0 != NULL)
     {
         int i;
@@ -543,7 +543,7 @@ static int SHN_open(Sound_Sample *sample, const char *ext)
     Sint32 chan;
 
     SDL_memset(shn, '\0', sizeof (shn_t));
-    shn->getbufp = shn->getbuf = (Uint8 *) SDL_malloc(SHN_BUFSIZ);
+    shn->getbufp = shn->getbuf = (Uint8 *) __Sound_malloc(SHN_BUFSIZ);
     shn->datatype = SHN_TYPE_EOF;
     shn->nchan = DEFAULT_NCHAN;
     shn->blocksize = DEFAULT_BLOCK_SIZE;
@@ -588,7 +588,7 @@ static int SHN_open(Sound_Sample *sample, const char *ext)
 
     if (shn->maxnlpc > 0)
     {
-        shn->qlpc = (int *) SDL_malloc((Uint32) (shn->maxnlpc * sizeof (Sint32)));
+        shn->qlpc = (int *) __Sound_malloc((Uint32) (shn->maxnlpc * sizeof (Sint32)));
         if (shn->qlpc == NULL)
         {
             __Sound_SetError(ERR_OUT_OF_MEMORY);
@@ -615,7 +615,7 @@ static int SHN_open(Sound_Sample *sample, const char *ext)
 
     shn->start_pos = SDL_RWtell(rw);
 
-    shn = (shn_t *) SDL_malloc(sizeof (shn_t));
+    shn = (shn_t *) __Sound_malloc(sizeof (shn_t));
     if (shn == NULL)
     {
         __Sound_SetError(ERR_OUT_OF_MEMORY);
@@ -631,13 +631,13 @@ static int SHN_open(Sound_Sample *sample, const char *ext)
 
 shn_open_puke:
     if (_shn.getbuf)
-        SDL_free(_shn.getbuf);
+        __Sound_free(_shn.getbuf);
     if (_shn.buffer != NULL)
-        SDL_free(_shn.buffer);
+        __Sound_free(_shn.buffer);
     if (_shn.offset != NULL)
-        SDL_free(_shn.offset);
+        __Sound_free(_shn.offset);
     if (_shn.qlpc != NULL)
-        SDL_free(_shn.qlpc);
+        __Sound_free(_shn.qlpc);
 
     return 0;
 } /* SHN_open */
@@ -681,21 +681,21 @@ static void SHN_close(Sound_Sample *sample)
     shn_t *shn = (shn_t *) internal->decoder_private;
 
     if (shn->qlpc != NULL)
-        SDL_free(shn->qlpc);
+        __Sound_free(shn->qlpc);
 
     if (shn->backBuffer != NULL)
-        SDL_free(shn->backBuffer);
+        __Sound_free(shn->backBuffer);
 
     if (shn->offset != NULL)
-        SDL_free(shn->offset);
+        __Sound_free(shn->offset);
 
     if (shn->buffer != NULL)
-        SDL_free(shn->buffer);
+        __Sound_free(shn->buffer);
 
     if (shn->getbuf != NULL)
-        SDL_free(shn->getbuf);
+        __Sound_free(shn->getbuf);
 
-    SDL_free(shn);
+    __Sound_free(shn);
 } /* SHN_close */
 
 
@@ -826,7 +826,7 @@ static Uint32 put_to_buffers(Sound_Sample *sample, Uint32 bw)
 
     if (shn->backBufferSize < bsiz)
     {
-        void *rc = SDL_realloc(shn->backBuffer, bsiz);
+        void *rc = __Sound_realloc(shn->backBuffer, bsiz);
         if (rc == NULL)
         {
             sample->flags |= SOUND_SAMPLEFLAG_ERROR;
@@ -1299,7 +1299,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_SHN =
     SHN_close,      /*  close() method */
     SHN_read,       /*   read() method */
     SHN_rewind,     /* rewind() method */
-    SHN_seek        /*   seek() method */
+    SHN_seek,       /*   seek() method */
+    NULL,           /* seek_frames() method */
+    NULL,           /*   tell() method */
+    NULL,           /* duration() method */
+    NULL            /*  index() method */
 };
 
 #endif  /* defined SOUND_SUPPORTS_SHN */
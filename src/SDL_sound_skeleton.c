@@ -119,6 +119,26 @@ static int FMT_seek(Sound_Sample *sample, Uint32 ms)
     return 1;  /* success. */
 } /* FMT_seek */
 
+
+static int FMT_seek_frames(Sound_Sample *sample, Uint64 frame)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+
+        /* seek to the exact sample frame... */
+    BAIL_IF_MACRO(SDL_RWseek(internal->rw, 0, SEEK_SET) != 0, ERR_IO_ERROR, 0);
+
+    (set state as necessary.)
+
+    return 1;  /* success. */
+} /* FMT_seek_frames */
+
+
+static Sint64 FMT_tell(Sound_Sample *sample)
+{
+    (return the next sample frame read() will produce, or -1 if you
+     don't know; SDL_sound will count the frames itself then.)
+} /* FMT_tell */
+
 static const char *extensions_fmt[] = { "FMT", NULL };
 const Sound_DecoderFunctions __Sound_DecoderFunctions_FMT =
 {
@@ -135,7 +155,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_FMT =
     FMT_close,      /*  close() method */
     FMT_read,       /*   read() method */
     FMT_rewind,     /* rewind() method */
-    FMT_seek        /*   seek() method */
+    FMT_seek,       /*   seek() method */
+    FMT_seek_frames, /* seek_frames() method (NULL if you only have seek()) */
+    FMT_tell,       /*   tell() method (NULL is fine) */
+    NULL,           /* duration() method (NULL is fine) */
+    NULL            /*  index() method (NULL is fine) */
 };
 
 #endif /* SOUND_SUPPORTS_FMT */
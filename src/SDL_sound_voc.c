@@ -415,20 +415,20 @@ static int VOC_open(Sound_Sample *sample, const char *ext)
     if (!voc_check_header(internal->rw))
         return 0;
 
-    v = (vs_t *) SDL_calloc(1, sizeof (vs_t));
+    v = (vs_t *) __Sound_calloc(1, sizeof (vs_t));
     BAIL_IF_MACRO(v == NULL, ERR_OUT_OF_MEMORY, 0);
 
     v->start_pos = SDL_RWtell(internal->rw);
     v->rate = -1;
     if (!voc_get_block(sample, v))
     {
-        SDL_free(v);
+        __Sound_free(v);
         return 0;
     } /* if */
 
     if (v->rate == -1)
     {
-        SDL_free(v);
+        __Sound_free(v);
         BAIL_MACRO("VOC: data had no sound!", 0);
     } /* if */
 
@@ -444,7 +444,7 @@ static int VOC_open(Sound_Sample *sample, const char *ext)
 static void VOC_close(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    SDL_free(internal->decoder_private);
+    __Sound_free(internal->decoder_private);
 } /* VOC_close */
 
 
@@ -489,7 +489,7 @@ static int VOC_rewind(Sound_Sample *sample)
 } /* VOC_rewind */
 
 
-static int VOC_seek(Sound_Sample *sample, Uint32 ms)
+static int VOC_seek_frames(Sound_Sample *sample, Uint64 frame)
 {
     /*
      * VOCs don't lend themselves well to seeking, since you have to
@@ -503,7 +503,8 @@ static int VOC_seek(Sound_Sample *sample, Uint32 ms)
 
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     vs_t *v = (vs_t *) internal->decoder_private;
-    int offset = __Sound_convertMsToBytePos(&sample->actual, ms);
+    Uint64 offset = frame * (((sample->actual.format & 0xFF) / 8) *
+                             sample->actual.channels);
     int origpos = SDL_RWtell(internal->rw);
     int origrest = v->rest;
 
@@ -513,18 +514,24 @@ static int VOC_seek(Sound_Sample *sample, Uint32 ms)
 
     while (offset > 0)
     {
-        Uint32 rc = voc_read_waveform(sample, 0, offset);
+        Uint32 rc = voc_read_waveform(sample, 0, (Uint32) SDL_min(offset, 0x7FFFFFFF));
         if ( (rc == 0) || (!voc_get_block(sample, v)) )
         {
             SDL_RWseek(internal->rw, origpos, SEEK_SET);
             v->rest = origrest;
-            return 0;
+            BAIL_MACRO(ERR_PAST_EOF, 0);
         } /* if */
 
         offset -= rc;
     } /* while */
 
     return 1;
+} /* VOC_seek_frames */
+
+
+static int VOC_seek(Sound_Sample *sample, Uint32 ms)
+{
+    return VOC_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
 } /* VOC_seek */
 
 
@@ -544,7 +551,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_VOC =
     VOC_close,      /*  close() method */
     VOC_read,       /*   read() method */
     VOC_rewind,     /* rewind() method */
-    VOC_seek        /*   seek() method */
+    VOC_seek,       /*   seek() method */
+    VOC_seek_frames, /* seek_frames() method */
+    NULL,           /*   tell() method */
+    NULL,           /* duration() method */
+    NULL            /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_VOC */
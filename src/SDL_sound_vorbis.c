@@ -43,6 +43,9 @@
 #ifdef memcpy
 #undef memcpy
 #endif
+#ifdef memmove
+#undef memmove
+#endif
 #ifdef alloca
 #undef alloca
 #endif
@@ -50,12 +53,13 @@
 #define memset SDL_memset
 #define memcmp SDL_memcmp
 #define memcpy SDL_memcpy
+#define memmove SDL_memmove
 #define qsort SDL_qsort
 #define pow SDL_pow
 #define floor SDL_floor
-#define malloc SDL_malloc
-#define realloc SDL_realloc
-#define free SDL_free
+#define malloc __Sound_malloc
+#define realloc __Sound_realloc
+#define free __Sound_free
 #define alloca(x) ((void *) SDL_stack_alloc(Uint8, (x)))
 #define dealloca(x) SDL_stack_free((x))
 #define ldexp(v, e) SDL_scalbn((v), (e))
@@ -111,7 +115,6 @@ static int VORBIS_open(Sound_Sample *sample, const char *ext)
     SDL_RWops *rw = internal->rw;
     int err = 0;
     stb_vorbis *stb = stb_vorbis_open_rwops(rw, 0, &err, NULL);
-    unsigned int num_frames;
 
     BAIL_IF_MACRO(!stb, vorbis_error_string(err), 0);
 
@@ -122,15 +125,12 @@ static int VORBIS_open(Sound_Sample *sample, const char *ext)
     sample->actual.format = AUDIO_F32SYS;
     sample->actual.channels = stb->channels;
     sample->actual.rate = stb->sample_rate;
-    num_frames = stb_vorbis_stream_length_in_samples(stb);
-    if (!num_frames)
-        internal->total_time = -1;
-    else
-    {
-        const unsigned int rate = stb->sample_rate;
-        internal->total_time = (num_frames / rate) * 1000;
-        internal->total_time += (num_frames % rate) * 1000 / rate;
-    } /* else */
+
+    /*
+     * Finding the length means seeking to the end and hunting backwards for
+     *  the last page, so VORBIS_duration() waits until someone asks.
+     */
+    internal->total_time = -1;
 
     return 1; /* we'll handle this data. */
 } /* VORBIS_open */
@@ -186,18 +186,59 @@ static int VORBIS_rewind(Sound_Sample *sample)
 } /* VORBIS_rewind */
 
 
-static int VORBIS_seek(Sound_Sample *sample, Uint32 ms)
+static int VORBIS_seek_frames(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     stb_vorbis *stb = (stb_vorbis *) internal->decoder_private;
-    const float frames_per_ms = ((float) sample->actual.rate) / 1000.0f;
-    const Uint32 frame_offset = (Uint32) (frames_per_ms * ((float) ms));
-    const unsigned int sampnum = (unsigned int) frame_offset;
+    const unsigned int sampnum = (unsigned int) frame;
+    BAIL_IF_MACRO(frame > 0xFFFFFFFF, ERR_PAST_EOF, 0);
     BAIL_IF_MACRO(!stb_vorbis_seek(stb, sampnum), vorbis_error_string(stb_vorbis_get_error(stb)), 0);
     return 1;
+} /* VORBIS_seek_frames */
+
+
+static int VORBIS_seek(Sound_Sample *sample, Uint32 ms)
+{
+    return VORBIS_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
 } /* VORBIS_seek */
 
 
+static Sint64 VORBIS_tell(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    stb_vorbis *stb = (stb_vorbis *) internal->decoder_private;
+    const int loc = stb_vorbis_get_sample_offset(stb);
+    if (loc < 0)
+        return -1;  /* position unknown; let the caller count frames. */
+
+    /* current_loc counts frames already decoded into stb's own buffers. */
+    return ((Sint64) loc) - (stb->channel_buffer_end - stb->channel_buffer_start);
+} /* VORBIS_tell */
+
+
+static Sint64 VORBIS_duration(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    stb_vorbis *stb = (stb_vorbis *) internal->decoder_private;
+
+    /*
+     * stb_vorbis puts the stream back where it was, and keeps the last
+     *  page's position and granule around, so seeks after this don't have
+     *  to go looking for it again.
+     */
+    const unsigned int num_frames = stb_vorbis_stream_length_in_samples(stb);
+    return num_frames ? ((Sint64) num_frames) : -1;
+} /* VORBIS_duration */
+
+
+static int VORBIS_index(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    stb_vorbis *stb = (stb_vorbis *) internal->decoder_private;
+    return stb_vorbis_index_pages(stb, 64 * 1024);
+} /* VORBIS_index */
+
+
 static const char *extensions_vorbis[] = { "OGG", NULL };
 const Sound_DecoderFunctions __Sound_DecoderFunctions_VORBIS =
 {
@@ -214,7 +255,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_VORBIS =
     VORBIS_close,      /*  close() method */
     VORBIS_read,       /*   read() method */
     VORBIS_rewind,     /* rewind() method */
-    VORBIS_seek        /*   seek() method */
+    VORBIS_seek,       /*   seek() method */
+    VORBIS_seek_frames, /* seek_frames() method */
+    VORBIS_tell,       /*   tell() method */
+    VORBIS_duration,   /* duration() method */
+    VORBIS_index       /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_VORBIS */
@@ -37,6 +37,16 @@ static SDL_INLINE int read_le32(SDL_RWops *rw, Uint32 *ui32)
     return 1;
 } /* read_le32 */
 
+
+/* Better than SDL_ReadLE64, since you can detect i/o errors... */
+static SDL_INLINE int read_le64(SDL_RWops *rw, Uint64 *ui64)
+{
+    int rc = SDL_RWread(rw, ui64, sizeof (Uint64), 1);
+    BAIL_IF_MACRO(rc != 1, ERR_IO_ERROR, 0);
+    *ui64 = SDL_SwapLE64(*ui64);
+    return 1;
+} /* read_le64 */
+
 static SDL_INLINE int read_le16s(SDL_RWops *rw, Sint16 *si16)
 {
     return read_le16(rw, (Uint16 *) si16);
@@ -48,30 +58,60 @@ static SDL_INLINE int read_le32s(SDL_RWops *rw, Sint32 *si32)
 } /* read_le32s */
 
 
-/* This is just cleaner on the caller's end... */
-static SDL_INLINE int read_uint8(SDL_RWops *rw, Uint8 *ui8)
-{
-    int rc = SDL_RWread(rw, ui8, sizeof (Uint8), 1);
-    BAIL_IF_MACRO(rc != 1, ERR_IO_ERROR, 0);
-    return 1;
-} /* read_uint8 */
-
-
     /* Chunk management code... */
 
 #define riffID 0x46464952  /* "RIFF", in ascii. */
+#define rf64ID 0x34364652  /* "RF64", in ascii. */
+#define bw64ID 0x34365742  /* "BW64", in ascii. */
 #define waveID 0x45564157  /* "WAVE", in ascii. */
 #define factID 0x74636166  /* "fact", in ascii. */
 
 
+/*****************************************************************************
+ * The DS64 chunk...                                                         *
+ *****************************************************************************/
+
+#define ds64ID 0x34367364  /* "ds64", in ascii. */
+
+/*
+ * RF64 (EBU Tech 3306) and BW64 (ITU-R BS.2088) are RIFF WAVE with 64-bit
+ *  sizes, for files past 4 gigabytes. The RIFF and data chunk sizes are
+ *  0xFFFFFFFF, and the real ones are in a "ds64" chunk that has to come
+ *  first. It can also list other oversized chunks in a table, but nobody
+ *  writes anything but the data chunk that big, so we skip the table.
+ */
+static int read_ds64_chunk(SDL_RWops *rw, Uint64 *datasize)
+{
+    Uint32 id = 0;
+    Uint32 size = 0;
+    Uint64 riffsize = 0;
+    Uint64 samplecount = 0;
+    Sint64 pos;
+
+    BAIL_IF_MACRO(!read_le32(rw, &id), NULL, 0);
+    BAIL_IF_MACRO(id != ds64ID, "WAV: No ds64 chunk.", 0);
+    BAIL_IF_MACRO(!read_le32(rw, &size), NULL, 0);
+    BAIL_IF_MACRO(size < 24, "WAV: Invalid chunk size", 0);
+    pos = SDL_RWtell(rw) + size;
+
+    BAIL_IF_MACRO(!read_le64(rw, &riffsize), NULL, 0);
+    BAIL_IF_MACRO(!read_le64(rw, datasize), NULL, 0);
+    BAIL_IF_MACRO(!read_le64(rw, &samplecount), NULL, 0);
+    BAIL_IF_MACRO(SDL_RWseek(rw, pos, SEEK_SET) != pos, ERR_IO_ERROR, 0);
+    return 1;
+} /* read_ds64_chunk */
+
+
 /*****************************************************************************
  * The FORMAT chunk...                                                       *
  *****************************************************************************/
 
 #define fmtID  0x20746D66  /* "fmt ", in ascii. */
 
-#define FMT_NORMAL 0x0001    /* Uncompressed waveform data.     */
-#define FMT_ADPCM  0x0002    /* ADPCM compressed waveform data. */
+#define FMT_NORMAL     0x0001  /* Uncompressed waveform data.     */
+#define FMT_ADPCM      0x0002  /* ADPCM compressed waveform data. */
+#define FMT_IEEE_FLOAT 0x0003  /* Uncompressed float data.        */
+#define FMT_EXTENSIBLE 0xFFFE  /* Real format is in the SubFormat. */
 
 typedef struct
 {
@@ -98,16 +138,24 @@ typedef struct S_WAV_FMT_T
     Uint16 wBlockAlign;
     Uint16 wBitsPerSample;
 
-    Uint32 next_chunk_offset;
+        /* only in WAVE_FORMAT_EXTENSIBLE; wFormatTag gets the SubFormat. */
+    Uint16 wValidBitsPerSample;
+    Uint32 dwChannelMask;
+
+    Sint64 next_chunk_offset;
     
-    Uint32 sample_frame_size;
-    Uint32 data_starting_offset;
-    Uint32 total_bytes;
+    Uint32 sample_frame_size;   /* bytes per frame that read() outputs.   */
+    Uint32 stored_frame_size;   /* bytes per frame in the data chunk.     */
+    Sint64 data_starting_offset;
+    Uint64 total_bytes;
+
+        /* unpacks what's stored into (sample_frame_size) frames, if needed. */
+    Sound_ConvertFn convert;
 
     void (*free)(struct S_WAV_FMT_T *fmt);
     Uint32 (*read_sample)(Sound_Sample *sample);
     int (*rewind_sample)(Sound_Sample *sample);
-    int (*seek_sample)(Sound_Sample *sample, Uint32 ms);
+    int (*seek_sample)(Sound_Sample *sample, Uint64 frame);
 
     union
     {
@@ -118,9 +166,9 @@ typedef struct S_WAV_FMT_T
             Uint16 wNumCoef;
             ADPCMCOEFSET *aCoef;
             ADPCMBLOCKHEADER *blockheaders;
+            Uint8 *block;     /* one raw wBlockAlign block. */
+            Sint16 *decoded;  /* one decoded block, for partial reads. */
             Uint32 samples_left_in_block;
-            int nibble_state;
-            Sint8 nibble;
         } adpcm;
 
         /* put other format-specific data here... */
@@ -150,6 +198,34 @@ static int read_fmt_chunk(SDL_RWops *rw, fmt_t *fmt)
     BAIL_IF_MACRO(!read_le16(rw, &fmt->wBlockAlign), NULL, 0);
     BAIL_IF_MACRO(!read_le16(rw, &fmt->wBitsPerSample), NULL, 0);
 
+    /*
+     * WAVE_FORMAT_EXTENSIBLE is how >16-bit and multichannel files say what
+     *  they are. The first two bytes of the SubFormat GUID are the format
+     *  tag, and we handle the data just like a file that used that tag
+     *  directly. The channel mask lists the speakers in the order the
+     *  channels are stored, which for the usual layouts is also SDL's order.
+     */
+    if ((Uint16) fmt->wFormatTag == FMT_EXTENSIBLE)
+    {
+        Uint16 cbSize;
+        Uint16 subformat;
+        BAIL_IF_MACRO(fmt->chunkSize < 40, "WAV: Invalid chunk size", 0);
+        BAIL_IF_MACRO(!read_le16(rw, &cbSize), NULL, 0);
+        BAIL_IF_MACRO(cbSize < 22, "WAV: Invalid extensible format", 0);
+        BAIL_IF_MACRO(!read_le16(rw, &fmt->wValidBitsPerSample), NULL, 0);
+        BAIL_IF_MACRO(!read_le32(rw, &fmt->dwChannelMask), NULL, 0);
+        BAIL_IF_MACRO(!read_le16(rw, &subformat), NULL, 0);
+        SNDDBG(("WAV: Extensible; format 0x%X, %d valid bits, mask 0x%X.\n",
+                (unsigned int) subformat, (int) fmt->wValidBitsPerSample,
+                (unsigned int) fmt->dwChannelMask));
+
+            /* the rest of the fmt chunk is format-specific; no ADPCM here. */
+        BAIL_IF_MACRO((subformat != FMT_NORMAL) &&
+                      (subformat != FMT_IEEE_FLOAT),
+                      "WAV: Unsupported extensible format", 0);
+        fmt->wFormatTag = (Sint16) subformat;
+    } /* if */
+
     return 1;
 } /* read_fmt_chunk */
 
@@ -164,7 +240,7 @@ static int read_fmt_chunk(SDL_RWops *rw, fmt_t *fmt)
 typedef struct
 {
     Uint32 chunkID;
-    Sint32 chunkSize;
+    Uint32 chunkSize;  /* 0xFFFFFFFF in RF64; the real size is in ds64. */
     /* Then, (chunkSize) bytes of waveform data... */
 } data_t;
 
@@ -177,7 +253,7 @@ static int read_data_chunk(SDL_RWops *rw, data_t *data)
 {
     /* skip reading the chunk ID, since it was already read at this point... */
     data->chunkID = dataID;
-    BAIL_IF_MACRO(!read_le32s(rw, &data->chunkSize), NULL, 0);
+    BAIL_IF_MACRO(!read_le32(rw, &data->chunkSize), NULL, 0);
     return 1;
 } /* read_data_chunk */
 
@@ -191,7 +267,7 @@ static int read_data_chunk(SDL_RWops *rw, data_t *data)
 typedef struct
 {
     fmt_t *fmt;
-    Sint32 bytesLeft;
+    Uint64 bytesLeft;
 } wav_t;
 
 
@@ -201,6 +277,65 @@ typedef struct
  * Normal, uncompressed waveform handler...                                  *
  *****************************************************************************/
 
+#define WAV_MAX_STORED_FRAME (8 * 255)  /* float64, most channels we take. */
+
+/*
+ * Sound_Decode() lands here for uncompressed WAVs that need unpacking
+ *  (24-bit, float64). We read whole frames into the start of the buffer
+ *  and fmt->convert() widens or narrows them in place. A buffer too small
+ *  for even one stored frame (float64 to float32 into a one-frame buffer,
+ *  say) gets a single frame, unpacked on the side and copied in.
+ */
+static Uint32 read_sample_fmt_convert(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    wav_t *w = (wav_t *) internal->decoder_private;
+    fmt_t *fmt = w->fmt;
+    const Uint32 stored = fmt->stored_frame_size;
+    const Uint32 biggest = (stored > fmt->sample_frame_size) ?
+                            stored : fmt->sample_frame_size;
+    const Uint64 avail = w->bytesLeft / stored;
+    Uint32 max = internal->buffer_size / biggest;
+    Uint32 frames;
+
+    if (avail == 0)  /* seeked right to the end. */
+    {
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+        return 0;
+    } /* if */
+
+    SDL_assert(internal->buffer_size >= fmt->sample_frame_size);
+
+    if (max == 0)
+    {
+        Uint8 scratch[WAV_MAX_STORED_FRAME];
+        SDL_assert(stored <= sizeof (scratch));
+        max = 1;
+        frames = (Uint32) SDL_RWread(internal->rw, scratch, stored, 1);
+        fmt->convert(scratch, scratch, frames, fmt->wChannels);
+        SDL_memcpy(internal->buffer, scratch, frames * fmt->sample_frame_size);
+    } /* if */
+    else
+    {
+        if (max > avail)
+            max = (Uint32) avail;
+        frames = (Uint32) SDL_RWread(internal->rw, internal->buffer, stored, max);
+        fmt->convert(internal->buffer, internal->buffer, frames, fmt->wChannels);
+    } /* else */
+
+    w->bytesLeft -= frames * stored;
+
+    if ((frames == 0) || (w->bytesLeft < stored))
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+
+        /* (next call this EAGAIN may turn into an EOF or error.) */
+    else if (frames < max)
+        sample->flags |= SOUND_SAMPLEFLAG_EAGAIN;
+
+    return frames * fmt->sample_frame_size;
+} /* read_sample_fmt_convert */
+
+
 /*
  * Sound_Decode() lands here for uncompressed WAVs...
  */
@@ -209,10 +344,14 @@ static Uint32 read_sample_fmt_normal(Sound_Sample *sample)
     Uint32 retval;
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     wav_t *w = (wav_t *) internal->decoder_private;
-    Uint32 max = (internal->buffer_size < (Uint32) w->bytesLeft) ?
+    Uint32 max = (internal->buffer_size < w->bytesLeft) ?
                     internal->buffer_size : (Uint32) w->bytesLeft;
 
-    SDL_assert(max > 0);
+    if (max == 0)  /* seeked right to the end. */
+    {
+        sample->flags |= SOUND_SAMPLEFLAG_EOF;
+        return 0;
+    } /* if */
 
         /*
          * We don't actually do any decoding, so we read the wav data
@@ -237,14 +376,18 @@ static Uint32 read_sample_fmt_normal(Sound_Sample *sample)
 } /* read_sample_fmt_normal */
 
 
-static int seek_sample_fmt_normal(Sound_Sample *sample, Uint32 ms)
+static int seek_sample_fmt_normal(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     wav_t *w = (wav_t *) internal->decoder_private;
     fmt_t *fmt = w->fmt;
-    int offset = __Sound_convertMsToBytePos(&sample->actual, ms);
-    int pos = (int) (fmt->data_starting_offset + offset);
-    int rc = SDL_RWseek(internal->rw, pos, SEEK_SET);
+    const Uint64 offset = frame * fmt->stored_frame_size;
+    Sint64 pos;
+    Sint64 rc;
+
+    BAIL_IF_MACRO(offset > fmt->total_bytes, ERR_PAST_EOF, 0);
+    pos = fmt->data_starting_offset + (Sint64) offset;
+    rc = SDL_RWseek(internal->rw, pos, SEEK_SET);
     BAIL_IF_MACRO(rc != pos, ERR_IO_ERROR, 0);
     w->bytesLeft = fmt->total_bytes - offset;
     return 1;  /* success. */
@@ -261,8 +404,9 @@ static int rewind_sample_fmt_normal(Sound_Sample *sample)
 static int read_fmt_normal(SDL_RWops *rw, fmt_t *fmt)
 {
     /* (don't need to read more from the RWops...) */
+    BAIL_IF_MACRO(fmt->stored_frame_size == 0, "WAV: Unsupported sample size.", 0);
     fmt->free = NULL;
-    fmt->read_sample = read_sample_fmt_normal;
+    fmt->read_sample = fmt->convert ? read_sample_fmt_convert : read_sample_fmt_normal;
     fmt->rewind_sample = rewind_sample_fmt_normal;
     fmt->seek_sample = seek_sample_fmt_normal;
     return 1;
@@ -279,45 +423,25 @@ static int read_fmt_normal(SDL_RWops *rw, fmt_t *fmt)
 #define SMALLEST_ADPCM_DELTA       16
 
 
-static SDL_INLINE int read_adpcm_block_headers(Sound_Sample *sample)
-{
-    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    SDL_RWops *rw = internal->rw;
-    wav_t *w = (wav_t *) internal->decoder_private;
-    fmt_t *fmt = w->fmt;
-    ADPCMBLOCKHEADER *headers = fmt->fmt.adpcm.blockheaders;
-    int i;
-    int max = fmt->wChannels;
-
-    if (w->bytesLeft < fmt->wBlockAlign)
-    {
-        sample->flags |= SOUND_SAMPLEFLAG_EOF;
-        return 0;
-    } /* if */
-
-    w->bytesLeft -= fmt->wBlockAlign;
-
-    for (i = 0; i < max; i++)
-        BAIL_IF_MACRO(!read_uint8(rw, &headers[i].bPredictor), NULL, 0);
-
-    for (i = 0; i < max; i++)
-        BAIL_IF_MACRO(!read_le16(rw, &headers[i].iDelta), NULL, 0);
-
-    for (i = 0; i < max; i++)
-        BAIL_IF_MACRO(!read_le16s(rw, &headers[i].iSamp1), NULL, 0);
-
-    for (i = 0; i < max; i++)
-        BAIL_IF_MACRO(!read_le16s(rw, &headers[i].iSamp2), NULL, 0);
+/*
+ * MS-ADPCM is decoded a whole wBlockAlign block at a time: one SDL_RWread()
+ *  pulls the block into fmt->fmt.adpcm.block, and decode_adpcm_block()
+ *  turns it into wSamplesPerBlock sample frames. When the caller's buffer
+ *  has room for the entire block, we decode straight into it; otherwise
+ *  the block is decoded into fmt->fmt.adpcm.decoded and handed out from
+ *  there over as many reads as it takes.
+ */
 
-    fmt->fmt.adpcm.samples_left_in_block = fmt->fmt.adpcm.wSamplesPerBlock;
-    fmt->fmt.adpcm.nibble_state = 0;
-    return 1;
-} /* read_adpcm_block_headers */
+static SDL_INLINE Sint16 adpcm_le16(const Uint8 *ptr)
+{
+    return (Sint16) (((Uint16) ptr[0]) | (((Uint16) ptr[1]) << 8));
+} /* adpcm_le16 */
 
 
-static SDL_INLINE void do_adpcm_nibble(Uint8 nib,
-                                       ADPCMBLOCKHEADER *header,
-                                       Sint32 lPredSamp)
+static SDL_INLINE Sint16 do_adpcm_nibble(Uint8 nib,
+                                         ADPCMBLOCKHEADER *header,
+                                         const Sint32 iCoef1,
+                                         const Sint32 iCoef2)
 {
 	static const Sint32 max_audioval = ((1<<(16-1))-1);
 	static const Sint32 min_audioval = -(1<<(16-1));
@@ -327,6 +451,9 @@ static SDL_INLINE void do_adpcm_nibble(Uint8 nib,
 		768, 614, 512, 409, 307, 230, 230, 230
 	};
 
+    const Sint32 lPredSamp = ((header->iSamp1 * iCoef1) +
+                              (header->iSamp2 * iCoef2)) /
+                               FIXED_POINT_COEF_BASE;
     Sint32 lNewSamp;
     Sint32 delta;
 
@@ -350,64 +477,140 @@ static SDL_INLINE void do_adpcm_nibble(Uint8 nib,
     header->iDelta = delta;
 	header->iSamp2 = header->iSamp1;
 	header->iSamp1 = lNewSamp;
+    return header->iSamp1;
 } /* do_adpcm_nibble */
 
 
-static SDL_INLINE int decode_adpcm_sample_frame(Sound_Sample *sample)
+/* Mono: each byte holds two consecutive sample frames, high nibble first. */
+static void decode_adpcm_block_mono(const Uint8 *src, Sint16 *dst,
+                                    Uint32 frames, ADPCMBLOCKHEADER *header,
+                                    const ADPCMCOEFSET *coef)
 {
-    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    wav_t *w = (wav_t *) internal->decoder_private;
-    fmt_t *fmt = w->fmt;
-    ADPCMBLOCKHEADER *headers = fmt->fmt.adpcm.blockheaders;
-    SDL_RWops *rw = internal->rw;
-    int i;
-    int max = fmt->wChannels;
-    Uint8 nib = fmt->fmt.adpcm.nibble;
+    const Sint32 iCoef1 = coef->iCoef1;
+    const Sint32 iCoef2 = coef->iCoef2;
+    ADPCMBLOCKHEADER h = *header;  /* keep the state in registers. */
 
-    for (i = 0; i < max; i++)
+    while (frames >= 2)
     {
-        Sint16 iCoef1 = fmt->fmt.adpcm.aCoef[headers[i].bPredictor].iCoef1;
-        Sint16 iCoef2 = fmt->fmt.adpcm.aCoef[headers[i].bPredictor].iCoef2;
-        Sint32 lPredSamp = ((headers[i].iSamp1 * iCoef1) +
-                            (headers[i].iSamp2 * iCoef2)) / 
-                             FIXED_POINT_COEF_BASE;
+        const Uint8 nib = *(src++);
+        *(dst++) = do_adpcm_nibble(nib >> 4, &h, iCoef1, iCoef2);
+        *(dst++) = do_adpcm_nibble(nib & 0x0F, &h, iCoef1, iCoef2);
+        frames -= 2;
+    } /* while */
 
-        if (fmt->fmt.adpcm.nibble_state == 0)
-        {
-            BAIL_IF_MACRO(!read_uint8(rw, &nib), NULL, 0);
-            fmt->fmt.adpcm.nibble_state = 1;
-            do_adpcm_nibble(nib >> 4, &headers[i], lPredSamp);
-        } /* if */
-        else
-        {
-            fmt->fmt.adpcm.nibble_state = 0;
-            do_adpcm_nibble(nib & 0x0F, &headers[i], lPredSamp);
-        } /* else */
-    } /* for */
+    if (frames)
+        *dst = do_adpcm_nibble(*src >> 4, &h, iCoef1, iCoef2);
+} /* decode_adpcm_block_mono */
 
-    fmt->fmt.adpcm.nibble = nib;
-    return 1;
-} /* decode_adpcm_sample_frame */
+
+/* Stereo: each byte is one sample frame; left in the high nibble. */
+static void decode_adpcm_block_stereo(const Uint8 *src, Sint16 *dst,
+                                      Uint32 frames, ADPCMBLOCKHEADER *headers,
+                                      const ADPCMCOEFSET *aCoef)
+{
+    const Sint32 lCoef1 = aCoef[headers[0].bPredictor].iCoef1;
+    const Sint32 lCoef2 = aCoef[headers[0].bPredictor].iCoef2;
+    const Sint32 rCoef1 = aCoef[headers[1].bPredictor].iCoef1;
+    const Sint32 rCoef2 = aCoef[headers[1].bPredictor].iCoef2;
+    ADPCMBLOCKHEADER l = headers[0];
+    ADPCMBLOCKHEADER r = headers[1];
+
+    while (frames--)
+    {
+        const Uint8 nib = *(src++);
+        *(dst++) = do_adpcm_nibble(nib >> 4, &l, lCoef1, lCoef2);
+        *(dst++) = do_adpcm_nibble(nib & 0x0F, &r, rCoef1, rCoef2);
+    } /* while */
+} /* decode_adpcm_block_stereo */
 
 
-static SDL_INLINE void put_adpcm_sample_frame1(void *_buf, fmt_t *fmt)
+/* Everything else: nibbles run through the channels in order. */
+static void decode_adpcm_block_generic(const Uint8 *src, Sint16 *dst,
+                                       Uint32 frames, const int channels,
+                                       ADPCMBLOCKHEADER *headers,
+                                       const ADPCMCOEFSET *aCoef)
 {
-    Uint16 *buf = (Uint16 *) _buf;
-    ADPCMBLOCKHEADER *headers = fmt->fmt.adpcm.blockheaders;
+    Uint32 nibble = 0;
     int i;
-    for (i = 0; i < fmt->wChannels; i++)
-        *(buf++) = headers[i].iSamp1;
-} /* put_adpcm_sample_frame1 */
+
+    while (frames--)
+    {
+        for (i = 0; i < channels; i++, nibble++)
+        {
+            const ADPCMCOEFSET *coef = &aCoef[headers[i].bPredictor];
+            const Uint8 byte = src[nibble >> 1];
+            const Uint8 nib = (nibble & 1) ? (byte & 0x0F) : (byte >> 4);
+            *(dst++) = do_adpcm_nibble(nib, &headers[i],
+                                       coef->iCoef1, coef->iCoef2);
+        } /* for */
+    } /* while */
+} /* decode_adpcm_block_generic */
 
 
-static SDL_INLINE void put_adpcm_sample_frame2(void *_buf, fmt_t *fmt)
+/*
+ * Decode the block sitting in fmt->fmt.adpcm.block into (dst), which must
+ *  have room for wSamplesPerBlock sample frames. (dst) is untouched if the
+ *  block is bogus.
+ */
+static int decode_adpcm_block(fmt_t *fmt, Sint16 *dst)
 {
-    Uint16 *buf = (Uint16 *) _buf;
     ADPCMBLOCKHEADER *headers = fmt->fmt.adpcm.blockheaders;
+    const ADPCMCOEFSET *aCoef = fmt->fmt.adpcm.aCoef;
+    const Uint8 *src = fmt->fmt.adpcm.block;
+    const Uint32 frames = fmt->fmt.adpcm.wSamplesPerBlock - 2;
+    const int max = fmt->wChannels;
     int i;
-    for (i = 0; i < fmt->wChannels; i++)
-        *(buf++) = headers[i].iSamp2;
-} /* put_adpcm_sample_frame2 */
+
+    for (i = 0; i < max; i++, src++)
+    {
+        headers[i].bPredictor = *src;
+        BAIL_IF_MACRO(headers[i].bPredictor >= fmt->fmt.adpcm.wNumCoef,
+                      "WAV: Invalid ADPCM predictor", 0);
+    } /* for */
+
+    for (i = 0; i < max; i++, src += 2)
+        headers[i].iDelta = (Uint16) adpcm_le16(src);
+
+    for (i = 0; i < max; i++, src += 2)
+        headers[i].iSamp1 = adpcm_le16(src);
+
+    for (i = 0; i < max; i++, src += 2)
+        headers[i].iSamp2 = adpcm_le16(src);
+
+    /* the first two sample frames come straight from the header. */
+    for (i = 0; i < max; i++)
+    {
+        dst[i] = headers[i].iSamp2;
+        dst[max + i] = headers[i].iSamp1;
+    } /* for */
+
+    dst += max * 2;
+    if (max == 1)
+    {
+        decode_adpcm_block_mono(src, dst, frames, headers,
+                                aCoef + headers[0].bPredictor);
+    } /* if */
+    else if (max == 2)
+        decode_adpcm_block_stereo(src, dst, frames, headers, aCoef);
+    else
+        decode_adpcm_block_generic(src, dst, frames, max, headers, aCoef);
+
+    return 1;
+} /* decode_adpcm_block */
+
+
+/* Pull the next whole block off the RWops into fmt->fmt.adpcm.block. */
+static SDL_INLINE int read_adpcm_block(Sound_Sample *sample)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    wav_t *w = (wav_t *) internal->decoder_private;
+    fmt_t *fmt = w->fmt;
+    const size_t rc = SDL_RWread(internal->rw, fmt->fmt.adpcm.block,
+                                 fmt->wBlockAlign, 1);
+    BAIL_IF_MACRO(rc != 1, ERR_IO_ERROR, 0);
+    w->bytesLeft -= fmt->wBlockAlign;
+    return 1;
+} /* read_adpcm_block */
 
 
 /*
@@ -418,44 +621,60 @@ static Uint32 read_sample_fmt_adpcm(Sound_Sample *sample)
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     wav_t *w = (wav_t *) internal->decoder_private;
     fmt_t *fmt = w->fmt;
+    const Uint32 spb = fmt->fmt.adpcm.wSamplesPerBlock;
+    const Uint32 framesize = fmt->sample_frame_size;
+    Uint8 *buf = (Uint8 *) internal->buffer;
     Uint32 bw = 0;
 
-    while (bw < internal->buffer_size)
+    while (1)
     {
-        /* write ongoing sample frame before reading more data... */
-        switch (fmt->fmt.adpcm.samples_left_in_block)
+        const Uint32 avail = (internal->buffer_size - bw) / framesize;
+        Uint32 left = fmt->fmt.adpcm.samples_left_in_block;
+
+        if (avail == 0)
+            break;
+
+        if (left > 0)  /* hand out what's left of a partially-read block. */
         {
-            case 0:  /* need to read a new block... */
-                if (!read_adpcm_block_headers(sample))
-                {
-                    if ((sample->flags & SOUND_SAMPLEFLAG_EOF) == 0)
-                        sample->flags |= SOUND_SAMPLEFLAG_ERROR;
-                    return bw;
-                } /* if */
-
-                /* only write first sample frame for now. */
-                put_adpcm_sample_frame2((Uint8 *) internal->buffer + bw, fmt);
-                fmt->fmt.adpcm.samples_left_in_block--;
-                bw += fmt->sample_frame_size;
-                break;
+            const Uint32 cpy = (left < avail) ? left : avail;
+            const Sint16 *src = fmt->fmt.adpcm.decoded +
+                                ((spb - left) * fmt->wChannels);
+            SDL_memcpy(buf + bw, src, cpy * framesize);
+            fmt->fmt.adpcm.samples_left_in_block -= cpy;
+            bw += cpy * framesize;
+            continue;
+        } /* if */
 
-            case 1:  /* output last sample frame of block... */
-                put_adpcm_sample_frame1((Uint8 *) internal->buffer + bw, fmt);
-                fmt->fmt.adpcm.samples_left_in_block--;
-                bw += fmt->sample_frame_size;
-                break;
+        if (w->bytesLeft < fmt->wBlockAlign)
+        {
+            sample->flags |= SOUND_SAMPLEFLAG_EOF;
+            break;
+        } /* if */
 
-            default: /* output latest sample frame and read a new one... */
-                put_adpcm_sample_frame1((Uint8 *) internal->buffer + bw, fmt);
-                fmt->fmt.adpcm.samples_left_in_block--;
-                bw += fmt->sample_frame_size;
-
-                if (!decode_adpcm_sample_frame(sample))
-                {
-                    sample->flags |= SOUND_SAMPLEFLAG_ERROR;
-                    return bw;
-                } /* if */
-        } /* switch */
+        if (!read_adpcm_block(sample))
+        {
+            sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+            break;
+        } /* if */
+
+        if (avail >= spb)  /* whole block fits; decode right into place. */
+        {
+            if (!decode_adpcm_block(fmt, (Sint16 *) (buf + bw)))
+            {
+                sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+                break;
+            } /* if */
+            bw += spb * framesize;
+        } /* if */
+        else
+        {
+            if (!decode_adpcm_block(fmt, fmt->fmt.adpcm.decoded))
+            {
+                sample->flags |= SOUND_SAMPLEFLAG_ERROR;
+                break;
+            } /* if */
+            fmt->fmt.adpcm.samples_left_in_block = spb;
+        } /* else */
     } /* while */
 
     return bw;
@@ -468,10 +687,16 @@ static Uint32 read_sample_fmt_adpcm(Sound_Sample *sample)
 static void free_fmt_adpcm(fmt_t *fmt)
 {
     if (fmt->fmt.adpcm.aCoef != NULL)
-        SDL_free(fmt->fmt.adpcm.aCoef);
+        __Sound_free(fmt->fmt.adpcm.aCoef);
 
     if (fmt->fmt.adpcm.blockheaders != NULL)
-        SDL_free(fmt->fmt.adpcm.blockheaders);
+        __Sound_free(fmt->fmt.adpcm.blockheaders);
+
+    if (fmt->fmt.adpcm.block != NULL)
+        __Sound_free(fmt->fmt.adpcm.block);
+
+    if (fmt->fmt.adpcm.decoded != NULL)
+        __Sound_free(fmt->fmt.adpcm.decoded);
 } /* free_fmt_adpcm */
 
 
@@ -484,46 +709,44 @@ static int rewind_sample_fmt_adpcm(Sound_Sample *sample)
 } /* rewind_sample_fmt_adpcm */
 
 
-static int seek_sample_fmt_adpcm(Sound_Sample *sample, Uint32 ms)
+static int seek_sample_fmt_adpcm(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     wav_t *w = (wav_t *) internal->decoder_private;
     fmt_t *fmt = w->fmt;
     Uint32 origsampsleft = fmt->fmt.adpcm.samples_left_in_block;
-    int origpos = SDL_RWtell(internal->rw);
-    int offset = __Sound_convertMsToBytePos(&sample->actual, ms);
-    int bpb = (fmt->fmt.adpcm.wSamplesPerBlock * fmt->sample_frame_size);
-    int skipsize = (offset / bpb) * fmt->wBlockAlign;
-    int pos = skipsize + fmt->data_starting_offset;
-    int rc = SDL_RWseek(internal->rw, pos, SEEK_SET);
+    Uint64 origbytesleft = w->bytesLeft;
+    Sint64 origpos = SDL_RWtell(internal->rw);
+    const Uint32 spb = fmt->fmt.adpcm.wSamplesPerBlock;
+    const Uint64 block = frame / spb;
+    const Uint32 skip = (Uint32) (frame % spb);  /* frames into the block. */
+    const Uint64 skipsize = block * fmt->wBlockAlign;
+    Sint64 pos;
+    Sint64 rc;
+
+    BAIL_IF_MACRO(skipsize > fmt->total_bytes, ERR_PAST_EOF, 0);
+    BAIL_IF_MACRO((skip > 0) && (skipsize + fmt->wBlockAlign > fmt->total_bytes),
+                  ERR_PAST_EOF, 0);
+    pos = fmt->data_starting_offset + (Sint64) skipsize;
+    rc = SDL_RWseek(internal->rw, pos, SEEK_SET);
     BAIL_IF_MACRO(rc != pos, ERR_IO_ERROR, 0);
+    w->bytesLeft = fmt->total_bytes - skipsize;
+    fmt->fmt.adpcm.samples_left_in_block = 0;
 
-    /* The offset we need is in this block, so we need to decode to there. */
-    skipsize += (offset % bpb);
-    rc = (offset % bpb);  /* bytes into this block we need to decode */
-    if (!read_adpcm_block_headers(sample))
+    if (skip == 0)
+        return 1;  /* start of a block; read() will pick up from here. */
+
+    /* The frame we need is in this block: decode it, skip to the frame. */
+    if ( (!read_adpcm_block(sample)) ||
+         (!decode_adpcm_block(fmt, fmt->fmt.adpcm.decoded)) )
     {
         SDL_RWseek(internal->rw, origpos, SEEK_SET);  /* try to make sane. */
+        fmt->fmt.adpcm.samples_left_in_block = origsampsleft;
+        w->bytesLeft = origbytesleft;
         return 0;
     } /* if */
 
-    /* first sample frame of block is a freebie. :) */
-    fmt->fmt.adpcm.samples_left_in_block--;
-    rc -= fmt->sample_frame_size;
-    while (rc > 0)
-    {
-        if (!decode_adpcm_sample_frame(sample))
-        {
-            SDL_RWseek(internal->rw, origpos, SEEK_SET);
-            fmt->fmt.adpcm.samples_left_in_block = origsampsleft;
-            return 0;
-        } /* if */
-
-        fmt->fmt.adpcm.samples_left_in_block--;
-        rc -= fmt->sample_frame_size;
-    } /* while */
-
-    w->bytesLeft = fmt->total_bytes - skipsize;
+    fmt->fmt.adpcm.samples_left_in_block = spb - skip;
     return 1;  /* success. */
 } /* seek_sample_fmt_adpcm */
 
@@ -550,7 +773,7 @@ static int read_fmt_adpcm(SDL_RWops *rw, fmt_t *fmt)
     /* fmt->free() is always called, so these malloc()s will be cleaned up. */
 
     i = sizeof (ADPCMCOEFSET) * fmt->fmt.adpcm.wNumCoef;
-    fmt->fmt.adpcm.aCoef = (ADPCMCOEFSET *) SDL_malloc(i);
+    fmt->fmt.adpcm.aCoef = (ADPCMCOEFSET *) __Sound_malloc(i);
     BAIL_IF_MACRO(fmt->fmt.adpcm.aCoef == NULL, ERR_OUT_OF_MEMORY, 0);
 
     for (i = 0; i < fmt->fmt.adpcm.wNumCoef; i++)
@@ -559,10 +782,26 @@ static int read_fmt_adpcm(SDL_RWops *rw, fmt_t *fmt)
         BAIL_IF_MACRO(!read_le16s(rw, &fmt->fmt.adpcm.aCoef[i].iCoef2), NULL, 0);
     } /* for */
 
+    /* every block must hold its headers and all of its nibbles. */
+    BAIL_IF_MACRO(fmt->wChannels == 0, "WAV: Invalid channel count", 0);
+    BAIL_IF_MACRO(fmt->fmt.adpcm.wSamplesPerBlock < 2,
+                  "WAV: Invalid ADPCM block size", 0);
+    i = (7 * fmt->wChannels) +
+        ((((size_t) fmt->fmt.adpcm.wSamplesPerBlock - 2) *
+           fmt->wChannels + 1) / 2);
+    BAIL_IF_MACRO(fmt->wBlockAlign < i, "WAV: Invalid ADPCM block size", 0);
+
     i = sizeof (ADPCMBLOCKHEADER) * fmt->wChannels;
-    fmt->fmt.adpcm.blockheaders = (ADPCMBLOCKHEADER *) SDL_malloc(i);
+    fmt->fmt.adpcm.blockheaders = (ADPCMBLOCKHEADER *) __Sound_malloc(i);
     BAIL_IF_MACRO(fmt->fmt.adpcm.blockheaders == NULL, ERR_OUT_OF_MEMORY, 0);
 
+    fmt->fmt.adpcm.block = (Uint8 *) __Sound_malloc(fmt->wBlockAlign);
+    BAIL_IF_MACRO(fmt->fmt.adpcm.block == NULL, ERR_OUT_OF_MEMORY, 0);
+
+    i = sizeof (Sint16) * fmt->fmt.adpcm.wSamplesPerBlock * fmt->wChannels;
+    fmt->fmt.adpcm.decoded = (Sint16 *) __Sound_malloc(i);
+    BAIL_IF_MACRO(fmt->fmt.adpcm.decoded == NULL, ERR_OUT_OF_MEMORY, 0);
+
     return 1;
 } /* read_fmt_adpcm */
 
@@ -593,6 +832,10 @@ static int read_fmt(SDL_RWops *rw, fmt_t *fmt)
             SNDDBG(("WAV: Appears to be uncompressed audio.\n"));
             return read_fmt_normal(rw, fmt);
 
+        case FMT_IEEE_FLOAT:
+            SNDDBG(("WAV: Appears to be floating point audio.\n"));
+            return read_fmt_normal(rw, fmt);
+
         case FMT_ADPCM:
             SNDDBG(("WAV: Appears to be ADPCM compressed audio.\n"));
             return read_fmt_adpcm(rw, fmt);
@@ -615,9 +858,9 @@ static int read_fmt(SDL_RWops *rw, fmt_t *fmt)
  */
 static int find_chunk(SDL_RWops *rw, Uint32 id)
 {
-    Sint32 siz = 0;
+    Uint32 siz = 0;
     Uint32 _id = 0;
-    Uint32 pos = SDL_RWtell(rw);
+    Sint64 pos = SDL_RWtell(rw);
 
     while (1)
     {
@@ -626,8 +869,7 @@ static int find_chunk(SDL_RWops *rw, Uint32 id)
             return 1;
 
             /* skip ahead and see what next chunk is... */
-        BAIL_IF_MACRO(!read_le32s(rw, &siz), NULL, 0);
-        SDL_assert(siz >= 0);
+        BAIL_IF_MACRO(!read_le32(rw, &siz), NULL, 0);
         pos += (sizeof (Uint32) * 2) + siz;
         if (siz > 0)
             BAIL_IF_MACRO(SDL_RWseek(rw, pos, SEEK_SET) != pos, NULL, 0);
@@ -641,25 +883,63 @@ static int WAV_open_internal(Sound_Sample *sample, const char *ext, fmt_t *fmt)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     SDL_RWops *rw = internal->rw;
+    const Uint32 riff = SDL_ReadLE32(rw);
+    Uint64 ds64_data_size = 0;
     data_t d;
     wav_t *w;
 
-    BAIL_IF_MACRO(SDL_ReadLE32(rw) != riffID, "WAV: Not a RIFF file.", 0);
+    BAIL_IF_MACRO((riff != riffID) && (riff != rf64ID) && (riff != bw64ID),
+                  "WAV: Not a RIFF file.", 0);
     SDL_ReadLE32(rw);  /* throw the length away; we get this info later. */
     BAIL_IF_MACRO(SDL_ReadLE32(rw) != waveID, "WAV: Not a WAVE file.", 0);
+    if (riff != riffID)
+    {
+        BAIL_IF_MACRO(!read_ds64_chunk(rw, &ds64_data_size),
+                      "WAV: Can't read ds64 chunk.", 0);
+    } /* if */
     BAIL_IF_MACRO(!find_chunk(rw, fmtID), "WAV: No format chunk.", 0);
     BAIL_IF_MACRO(!read_fmt_chunk(rw, fmt), "WAV: Can't read format chunk.", 0);
 
-    /* !!! FIXME: need float32 format stuff, since it's not just wBitsPerSample. */
-
+    BAIL_IF_MACRO(fmt->wChannels == 0, "WAV: Invalid channel count", 0);
+    BAIL_IF_MACRO(fmt->wChannels > 255, "WAV: Too many channels", 0);
+    BAIL_IF_MACRO(fmt->dwSamplesPerSec == 0, "WAV: Invalid sample rate", 0);
     sample->actual.channels = (Uint8) fmt->wChannels;
     sample->actual.rate = fmt->dwSamplesPerSec;
-    if (fmt->wBitsPerSample == 4)
+    fmt->stored_frame_size = (fmt->wBitsPerSample / 8) * fmt->wChannels;
+
+    /*
+     * Float32 goes out as-is. SDL has nothing for 24-bit or float64, so we
+     *  unpack those as we read: 24-bit to float32 if that's what the app
+     *  asked for, so it needs no more conversion, and to Sint32 otherwise.
+     */
+    if (fmt->wFormatTag == FMT_IEEE_FLOAT)
+    {
+        sample->actual.format = AUDIO_F32SYS;
+        if (fmt->wBitsPerSample == 32)
+            sample->actual.format = AUDIO_F32LSB;
+        else if (fmt->wBitsPerSample == 64)
+            fmt->convert = __Sound_GetConverter(SOUND_AUDIO_F64LSB, 1, AUDIO_F32SYS, 1);
+        else
+        {
+            SNDDBG(("WAV: %d bit float!?\n", (int) fmt->wBitsPerSample));
+            BAIL_MACRO("WAV: Unsupported sample size.", 0);
+        } /* else */
+    } /* if */
+    else if (fmt->wBitsPerSample == 4)
         sample->actual.format = AUDIO_S16SYS;
     else if (fmt->wBitsPerSample == 8)
         sample->actual.format = AUDIO_U8;
     else if (fmt->wBitsPerSample == 16)
         sample->actual.format = AUDIO_S16LSB;
+    else if (fmt->wBitsPerSample == 24)
+    {
+        if (sample->desired.format == AUDIO_F32SYS)
+            sample->actual.format = AUDIO_F32SYS;
+        else
+            sample->actual.format = AUDIO_S32SYS;
+        fmt->convert = __Sound_GetConverter(SOUND_AUDIO_S24LSB, 1,
+                                            sample->actual.format, 1);
+    } /* else if */
     else if (fmt->wBitsPerSample == 32)
         sample->actual.format = AUDIO_S32LSB;
     else
@@ -673,18 +953,33 @@ static int WAV_open_internal(Sound_Sample *sample, const char *ext, fmt_t *fmt)
     BAIL_IF_MACRO(!find_chunk(rw, dataID), "WAV: No data chunk.", 0);
     BAIL_IF_MACRO(!read_data_chunk(rw, &d), "WAV: Can't read data chunk.", 0);
 
-    w = (wav_t *) SDL_malloc(sizeof(wav_t));
+    w = (wav_t *) __Sound_malloc(sizeof(wav_t));
     BAIL_IF_MACRO(w == NULL, ERR_OUT_OF_MEMORY, 0);
     w->fmt = fmt;
-    fmt->total_bytes = w->bytesLeft = d.chunkSize;
+    fmt->total_bytes = d.chunkSize;
+    if ((riff != riffID) && (d.chunkSize == 0xFFFFFFFF))
+        fmt->total_bytes = ds64_data_size;
+    w->bytesLeft = fmt->total_bytes;
     fmt->data_starting_offset = SDL_RWtell(rw);
     fmt->sample_frame_size = ( ((sample->actual.format & 0xFF) / 8) *
                                sample->actual.channels );
     internal->decoder_private = (void *) w;
 
-    internal->total_time = (fmt->total_bytes / fmt->dwAvgBytesPerSec) * 1000;
-    internal->total_time += (fmt->total_bytes % fmt->dwAvgBytesPerSec)
-                              *  1000 / fmt->dwAvgBytesPerSec;
+    if (fmt->wFormatTag == FMT_ADPCM)  /* we only ever decode whole blocks. */
+    {
+        internal->total_frames = ((Sint64) (fmt->total_bytes / fmt->wBlockAlign)) *
+                                 fmt->fmt.adpcm.wSamplesPerBlock;
+    } /* if */
+    else
+    {
+        internal->total_frames = fmt->total_bytes / fmt->stored_frame_size;
+    } /* else */
+    internal->segmentable = 1;
+
+        /* from the frames, not dwAvgBytesPerSec, which is only a guess for ADPCM. */
+    internal->total_time = (Sint32) ((internal->total_frames / sample->actual.rate) * 1000);
+    internal->total_time += (Sint32) (((internal->total_frames % sample->actual.rate)
+                                      * 1000) / sample->actual.rate);
 
     sample->flags = SOUND_SAMPLEFLAG_NONE;
     if (fmt->seek_sample != NULL)
@@ -699,7 +994,7 @@ static int WAV_open(Sound_Sample *sample, const char *ext)
 {
     int rc;
 
-    fmt_t *fmt = (fmt_t *) SDL_calloc(1, sizeof (fmt_t));
+    fmt_t *fmt = (fmt_t *) __Sound_calloc(1, sizeof (fmt_t));
     BAIL_IF_MACRO(fmt == NULL, ERR_OUT_OF_MEMORY, 0);
 
     rc = WAV_open_internal(sample, ext, fmt);
@@ -707,7 +1002,7 @@ static int WAV_open(Sound_Sample *sample, const char *ext)
     {
         if (fmt->free != NULL)
             fmt->free(fmt);
-        SDL_free(fmt);
+        __Sound_free(fmt);
     } /* if */
 
     return rc;
@@ -722,8 +1017,8 @@ static void WAV_close(Sound_Sample *sample)
     if (w->fmt->free != NULL)
         w->fmt->free(w->fmt);
 
-    SDL_free(w->fmt);
-    SDL_free(w);
+    __Sound_free(w->fmt);
+    __Sound_free(w);
 } /* WAV_close */
 
 
@@ -740,18 +1035,24 @@ static int WAV_rewind(Sound_Sample *sample)
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     wav_t *w = (wav_t *) internal->decoder_private;
     fmt_t *fmt = w->fmt;
-    int rc = SDL_RWseek(internal->rw, fmt->data_starting_offset, SEEK_SET);
+    const Sint64 rc = SDL_RWseek(internal->rw, fmt->data_starting_offset, SEEK_SET);
     BAIL_IF_MACRO(rc != fmt->data_starting_offset, ERR_IO_ERROR, 0);
     w->bytesLeft = fmt->total_bytes;
     return fmt->rewind_sample(sample);
 } /* WAV_rewind */
 
 
-static int WAV_seek(Sound_Sample *sample, Uint32 ms)
+static int WAV_seek_frames(Sound_Sample *sample, Uint64 frame)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
     wav_t *w = (wav_t *) internal->decoder_private;
-    return w->fmt->seek_sample(sample, ms);
+    return w->fmt->seek_sample(sample, frame);
+} /* WAV_seek_frames */
+
+
+static int WAV_seek(Sound_Sample *sample, Uint32 ms)
+{
+    return WAV_seek_frames(sample, __Sound_convertMsToFrames(&sample->actual, ms));
 } /* WAV_seek */
 
 
@@ -771,7 +1072,11 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_WAV =
     WAV_close,      /*  close() method */
     WAV_read,       /*   read() method */
     WAV_rewind,     /* rewind() method */
-    WAV_seek        /*   seek() method */
+    WAV_seek,       /*   seek() method */
+    WAV_seek_frames, /* seek_frames() method */
+    NULL,           /*   tell() method */
+    NULL,           /* duration() method */
+    NULL            /*  index() method */
 };
 
 #endif /* SOUND_SUPPORTS_WAV */
@@ -2417,176 +2417,130 @@ static DRFLAC_INLINE drflac_bool32 drflac__read_rice_parts__param_equals_zero(dr
 }
 
 
-static drflac_bool32 drflac__decode_samples_with_residual__rice__simple(drflac_bs* bs, drflac_uint32 bitsPerSample, drflac_uint32 count, drflac_uint8 riceParam, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pSamplesOut)
-{
-    drflac_assert(bs != NULL);
-    drflac_assert(count > 0);
-    drflac_assert(pSamplesOut != NULL);
+// Reads one Rice code, with the cache and bit position in *pCache and *pConsumedBits rather than in the bit stream itself, so
+// that a caller reading a run of them can keep both in registers. The unary part is a count-leading-zeros, and the stop bit
+// and binary part are then taken together and the cache moved past the whole code with a single shift; the stop bit is
+// masked off afterwards. Running off the end of the L1 cache, in either part, is handled in place by reloading it.
+static DRFLAC_INLINE drflac_bool32 drflac__read_rice_code(drflac_bs* bs, drflac_cache_t* pCache, drflac_uint32* pConsumedBits, drflac_uint8 riceParam, drflac_uint32* pValueOut)
+{
+    const drflac_uint32 riceParamPlus1 = riceParam + 1;
+    const drflac_uint32 riceParamPlus1Shift = DRFLAC_CACHE_L1_SELECTION_SHIFT(bs, riceParamPlus1);
+    const drflac_uint32 riceParamPlus1MaxConsumedBits = DRFLAC_CACHE_L1_SIZE_BITS(bs) - riceParamPlus1;
+
+    drflac_cache_t cache = *pCache;
+    drflac_uint32 consumedBits = *pConsumedBits;
+    drflac_uint32 zeroCounter = 0;
+    drflac_uint32 riceParamPart;
 
-    static drflac_uint32 t[2] = {0x00000000, 0xFFFFFFFF};
-
-    drflac_uint32 zeroCountPart0;
-    drflac_uint32 zeroCountPart1;
-    drflac_uint32 zeroCountPart2;
-    drflac_uint32 zeroCountPart3;
-    drflac_uint32 riceParamPart0;
-    drflac_uint32 riceParamPart1;
-    drflac_uint32 riceParamPart2;
-    drflac_uint32 riceParamPart3;
-    drflac_uint32 i4 = 0;
-    drflac_uint32 count4 = count >> 2;
-    while (i4 < count4) {
-        // Rice extraction.
-        if (!drflac__read_rice_parts(bs, riceParam, &zeroCountPart0, &riceParamPart0) ||
-            !drflac__read_rice_parts(bs, riceParam, &zeroCountPart1, &riceParamPart1) ||
-            !drflac__read_rice_parts(bs, riceParam, &zeroCountPart2, &riceParamPart2) ||
-            !drflac__read_rice_parts(bs, riceParam, &zeroCountPart3, &riceParamPart3)) {
+    // The unary part. The consumed bits of the cache are always zero, so an empty cache looks the same as a run of zeros.
+    while (cache == 0) {
+        zeroCounter += DRFLAC_CACHE_L1_SIZE_BITS(bs) - consumedBits;
+        bs->cache = cache;
+        bs->consumedBits = consumedBits;
+        if (!drflac__reload_cache(bs)) {
             return DRFLAC_FALSE;
         }
+        cache = bs->cache;
+        consumedBits = bs->consumedBits;
+    }
 
-        riceParamPart0 |= (zeroCountPart0 << riceParam);
-        riceParamPart1 |= (zeroCountPart1 << riceParam);
-        riceParamPart2 |= (zeroCountPart2 << riceParam);
-        riceParamPart3 |= (zeroCountPart3 << riceParam);
-
-        riceParamPart0  = (riceParamPart0 >> 1) ^ t[riceParamPart0 & 0x01];
-        riceParamPart1  = (riceParamPart1 >> 1) ^ t[riceParamPart1 & 0x01];
-        riceParamPart2  = (riceParamPart2 >> 1) ^ t[riceParamPart2 & 0x01];
-        riceParamPart3  = (riceParamPart3 >> 1) ^ t[riceParamPart3 & 0x01];
+    drflac_uint32 lzcount = drflac__clz(cache);
+    zeroCounter += lzcount;
 
-        if (bitsPerSample > 16) {
-            pSamplesOut[0] = riceParamPart0 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 0);
-            pSamplesOut[1] = riceParamPart1 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 1);
-            pSamplesOut[2] = riceParamPart2 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 2);
-            pSamplesOut[3] = riceParamPart3 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 3);
+    // The stop bit and the binary part.
+    if (consumedBits + lzcount < riceParamPlus1MaxConsumedBits) {
+        riceParamPart = (drflac_uint32)((cache << lzcount) >> riceParamPlus1Shift);
+        cache <<= lzcount + riceParamPlus1;
+        consumedBits += lzcount + riceParamPlus1;
+    } else {
+        cache <<= lzcount;
+        consumedBits += lzcount;
+        if (consumedBits <= riceParamPlus1MaxConsumedBits) {
+            // It ends right at the end of the cache.
+            riceParamPart = (drflac_uint32)(cache >> riceParamPlus1Shift);
+            cache <<= riceParamPlus1;
+            consumedBits += riceParamPlus1;
         } else {
-            pSamplesOut[0] = riceParamPart0 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 0);
-            pSamplesOut[1] = riceParamPart1 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 1);
-            pSamplesOut[2] = riceParamPart2 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 2);
-            pSamplesOut[3] = riceParamPart3 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 3);
-        }
+            // It straddles the end of the cache. Take what's left, then the rest from the next line.
+            drflac_uint32 bitCountHi = DRFLAC_CACHE_L1_SIZE_BITS(bs) - consumedBits;
+            drflac_uint32 bitCountLo = riceParamPlus1 - bitCountHi;
+            riceParamPart = (drflac_uint32)(cache >> DRFLAC_CACHE_L1_SELECTION_SHIFT(bs, bitCountHi));
 
-        i4 += 1;
-        pSamplesOut += 4;
-    }
-
-    drflac_uint32 i = i4 << 2;
-    while (i < count) {
-        // Rice extraction.
-        if (!drflac__read_rice_parts(bs, riceParam, &zeroCountPart0, &riceParamPart0)) {
-            return DRFLAC_FALSE;
-        }
+            bs->cache = cache;
+            bs->consumedBits = consumedBits;
+            if (!drflac__reload_cache(bs)) {
+                return DRFLAC_FALSE;
+            }
+            cache = bs->cache;
+            consumedBits = bs->consumedBits;
 
-        // Rice reconstruction.
-        riceParamPart0 |= (zeroCountPart0 << riceParam);
-        riceParamPart0  = (riceParamPart0 >> 1) ^ t[riceParamPart0 & 0x01];
-        //riceParamPart0  = (riceParamPart0 >> 1) ^ (~(riceParamPart0 & 0x01) + 1);
+            if (bitCountLo > DRFLAC_CACHE_L1_SIZE_BITS(bs) - consumedBits) {
+                return DRFLAC_FALSE;    // Ran out of data.
+            }
 
-        // Sample reconstruction.
-        if (bitsPerSample > 16) {
-            pSamplesOut[0] = riceParamPart0 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 0);
-        } else {
-            pSamplesOut[0] = riceParamPart0 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 0);
+            riceParamPart = (riceParamPart << bitCountLo) | (drflac_uint32)(cache >> DRFLAC_CACHE_L1_SELECTION_SHIFT(bs, bitCountLo));
+            cache <<= bitCountLo;
+            consumedBits += bitCountLo;
         }
-
-        i += 1;
-        pSamplesOut += 1;
     }
 
+    riceParamPart = (riceParamPart & (((drflac_uint32)1 << riceParam) - 1)) | (zeroCounter << riceParam);
+    *pValueOut = (riceParamPart >> 1) ^ (~(riceParamPart & 0x01) + 1);
+    *pCache = cache;
+    *pConsumedBits = consumedBits;
     return DRFLAC_TRUE;
 }
 
-static drflac_bool32 drflac__decode_samples_with_residual__rice__param_equals_zero(drflac_bs* bs, drflac_uint32 bitsPerSample, drflac_uint32 count, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pSamplesOut)
+// Decodes <count> Rice-coded residuals. If <coefficients> is NULL they're stored as they are, and the caller adds the
+// prediction afterwards. Otherwise it's added here as each sample comes out, which lets the bit reading and the prediction
+// overlap.
+static drflac_bool32 drflac__decode_samples_with_residual__rice(drflac_bs* bs, drflac_uint32 bitsPerSample, drflac_uint32 count, drflac_uint8 riceParam, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pSamplesOut)
 {
     drflac_assert(bs != NULL);
     drflac_assert(count > 0);
+    drflac_assert(riceParam < 31);
     drflac_assert(pSamplesOut != NULL);
 
-    static drflac_uint32 t[2] = {0x00000000, 0xFFFFFFFF};
-
-    drflac_uint32 zeroCountPart0;
-    drflac_uint32 zeroCountPart1;
-    drflac_uint32 zeroCountPart2;
-    drflac_uint32 zeroCountPart3;
-    drflac_uint32 riceParamPart0;
-    drflac_uint32 riceParamPart1;
-    drflac_uint32 riceParamPart2;
-    drflac_uint32 riceParamPart3;
-    drflac_uint32 i4 = 0;
-    drflac_uint32 count4 = count >> 2;
-    while (i4 < count4) {
-        // Rice extraction.
-        if (!drflac__read_rice_parts__param_equals_zero(bs, &zeroCountPart0, &riceParamPart0) ||
-            !drflac__read_rice_parts__param_equals_zero(bs, &zeroCountPart1, &riceParamPart1) ||
-            !drflac__read_rice_parts__param_equals_zero(bs, &zeroCountPart2, &riceParamPart2) ||
-            !drflac__read_rice_parts__param_equals_zero(bs, &zeroCountPart3, &riceParamPart3)) {
-            return DRFLAC_FALSE;
-        }
-
-        riceParamPart0 |= zeroCountPart0;
-        riceParamPart1 |= zeroCountPart1;
-        riceParamPart2 |= zeroCountPart2;
-        riceParamPart3 |= zeroCountPart3;
-
-        riceParamPart0  = (riceParamPart0 >> 1) ^ t[riceParamPart0 & 0x01];
-        riceParamPart1  = (riceParamPart1 >> 1) ^ t[riceParamPart1 & 0x01];
-        riceParamPart2  = (riceParamPart2 >> 1) ^ t[riceParamPart2 & 0x01];
-        riceParamPart3  = (riceParamPart3 >> 1) ^ t[riceParamPart3 & 0x01];
+    drflac_cache_t cache = bs->cache;
+    drflac_uint32 consumedBits = bs->consumedBits;
+    drflac_uint32 residual;
 
-        if (bitsPerSample > 16) {
-            pSamplesOut[0] = riceParamPart0 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 0);
-            pSamplesOut[1] = riceParamPart1 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 1);
-            pSamplesOut[2] = riceParamPart2 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 2);
-            pSamplesOut[3] = riceParamPart3 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 3);
-        } else {
-            pSamplesOut[0] = riceParamPart0 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 0);
-            pSamplesOut[1] = riceParamPart1 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 1);
-            pSamplesOut[2] = riceParamPart2 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 2);
-            pSamplesOut[3] = riceParamPart3 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 3);
+    if (coefficients == NULL) {
+        for (drflac_uint32 i = 0; i < count; ++i) {
+            if (!drflac__read_rice_code(bs, &cache, &consumedBits, riceParam, &residual)) {
+                return DRFLAC_FALSE;
+            }
+            pSamplesOut[i] = (drflac_int32)residual;
         }
-
-        i4 += 1;
-        pSamplesOut += 4;
-    }
-
-    drflac_uint32 i = i4 << 2;
-    while (i < count) {
-        // Rice extraction.
-        if (!drflac__read_rice_parts__param_equals_zero(bs, &zeroCountPart0, &riceParamPart0)) {
-            return DRFLAC_FALSE;
+    } else if (bitsPerSample > 16) {
+        for (drflac_uint32 i = 0; i < count; ++i) {
+            if (!drflac__read_rice_code(bs, &cache, &consumedBits, riceParam, &residual)) {
+                return DRFLAC_FALSE;
+            }
+            pSamplesOut[i] = (drflac_int32)(residual + (drflac_uint32)drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + i));
         }
-
-        // Rice reconstruction.
-        riceParamPart0 |= zeroCountPart0;
-        riceParamPart0  = (riceParamPart0 >> 1) ^ t[riceParamPart0 & 0x01];
-
-        // Sample reconstruction.
-        if (bitsPerSample > 16) {
-            pSamplesOut[0] = riceParamPart0 + drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + 0);
-        } else {
-            pSamplesOut[0] = riceParamPart0 + drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + 0);
+    } else if (riceParam == 0) {
+        // Mostly low bit depths and quiet passages. Worth its own loop, with the shifts for the binary part known up front.
+        for (drflac_uint32 i = 0; i < count; ++i) {
+            if (!drflac__read_rice_code(bs, &cache, &consumedBits, 0, &residual)) {
+                return DRFLAC_FALSE;
+            }
+            pSamplesOut[i] = (drflac_int32)(residual + (drflac_uint32)drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + i));
+        }
+    } else {
+        for (drflac_uint32 i = 0; i < count; ++i) {
+            if (!drflac__read_rice_code(bs, &cache, &consumedBits, riceParam, &residual)) {
+                return DRFLAC_FALSE;
+            }
+            pSamplesOut[i] = (drflac_int32)(residual + (drflac_uint32)drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + i));
         }
-
-        i += 1;
-        pSamplesOut += 1;
     }
 
+    bs->cache = cache;
+    bs->consumedBits = consumedBits;
     return DRFLAC_TRUE;
 }
 
-static drflac_bool32 drflac__decode_samples_with_residual__rice(drflac_bs* bs, drflac_uint32 bitsPerSample, drflac_uint32 count, drflac_uint8 riceParam, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pSamplesOut)
-{
-#if 0
-    return drflac__decode_samples_with_residual__rice__reference(bs, bitsPerSample, count, riceParam, order, shift, coefficients, pSamplesOut);
-#else
-    if (riceParam != 0) {
-        return drflac__decode_samples_with_residual__rice__simple(bs, bitsPerSample, count, riceParam, order, shift, coefficients, pSamplesOut);
-    } else {
-        return drflac__decode_samples_with_residual__rice__param_equals_zero(bs, bitsPerSample, count, order, shift, coefficients, pSamplesOut);
-    }
-#endif
-}
-
 // Reads and seeks past a string of residual values as Rice codes. The decoder should be sitting on the first bit of the Rice codes.
 static drflac_bool32 drflac__read_and_seek_residual__rice(drflac_bs* bs, drflac_uint32 count, drflac_uint8 riceParam)
 {
@@ -2629,7 +2583,9 @@ static drflac_bool32 drflac__decode_samples_with_residual__unencoded(drflac_bs*
             pSamplesOut[i] = 0;
         }
 
-        if (bitsPerSample > 16) {
+        if (coefficients == NULL) {
+            continue;   // <-- The caller adds the prediction.
+        } else if (bitsPerSample > 16) {
             pSamplesOut[i] += drflac__calculate_prediction_64(order, shift, coefficients, pSamplesOut + i);
         } else {
             pSamplesOut[i] += drflac__calculate_prediction_32(order, shift, coefficients, pSamplesOut + i);
@@ -2640,6 +2596,14 @@ static drflac_bool32 drflac__decode_samples_with_residual__unencoded(drflac_bs*
 }
 
 
+#ifdef __SDL_SOUND_INTERNAL__
+// SDL_sound: SDL_sound_flac.c has faster ways (SIMD ones, mostly) of adding the prediction to a whole subframe's worth of
+// residuals at once. This returns one for the given subframe, or NULL to have it done sample by sample as usual. Either way
+// the results are identical.
+typedef void (* drflac_restore_lpc_proc)(drflac_uint32 count, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pSamples);
+static drflac_restore_lpc_proc drflac__get_restore_lpc_proc(drflac_uint32 bitsPerSample, drflac_uint32 order, drflac_int32 shift);
+#endif
+
 // Reads and decodes the residual for the sub-frame the decoder is currently sitting on. This function should be called
 // when the decoder is sitting at the very start of the RESIDUAL block. The first <order> residuals will be ignored. The
 // <blockSize> and <order> parameters are used to determine how many residual values need to be decoded.
@@ -2658,8 +2622,17 @@ static drflac_bool32 drflac__decode_samples_with_residual(drflac_bs* bs, drflac_
         return DRFLAC_FALSE;    // Unknown or unsupported residual coding method.
     }
 
+    // If there's a faster way of adding the prediction, the residuals are all decoded first and it's added in one pass at the end.
+    const drflac_int32* pPredictionCoefficients = coefficients;
+#ifdef __SDL_SOUND_INTERNAL__
+    drflac_restore_lpc_proc restoreLPC = drflac__get_restore_lpc_proc(bitsPerSample, order, shift);
+    if (restoreLPC != NULL) {
+        pPredictionCoefficients = NULL;
+    }
+#endif
+
     // Ignore the first <order> values.
-    pDecodedSamples += order;
+    drflac_int32* pSamples = pDecodedSamples + order;
 
 
     drflac_uint8 partitionOrder;
@@ -2699,7 +2672,7 @@ static drflac_bool32 drflac__decode_samples_with_residual(drflac_bs* bs, drflac_
         }
 
         if (riceParam != 0xFF) {
-            if (!drflac__decode_samples_with_residual__rice(bs, bitsPerSample, samplesInPartition, riceParam, order, shift, coefficients, pDecodedSamples)) {
+            if (!drflac__decode_samples_with_residual__rice(bs, bitsPerSample, samplesInPartition, riceParam, order, shift, pPredictionCoefficients, pSamples)) {
                 return DRFLAC_FALSE;
             }
         } else {
@@ -2708,12 +2681,12 @@ static drflac_bool32 drflac__decode_samples_with_residual(drflac_bs* bs, drflac_
                 return DRFLAC_FALSE;
             }
 
-            if (!drflac__decode_samples_with_residual__unencoded(bs, bitsPerSample, samplesInPartition, unencodedBitsPerSample, order, shift, coefficients, pDecodedSamples)) {
+            if (!drflac__decode_samples_with_residual__unencoded(bs, bitsPerSample, samplesInPartition, unencodedBitsPerSample, order, shift, pPredictionCoefficients, pSamples)) {
                 return DRFLAC_FALSE;
             }
         }
 
-        pDecodedSamples += samplesInPartition;
+        pSamples += samplesInPartition;
 
 
         if (partitionsRemaining == 1) {
@@ -2727,6 +2700,12 @@ static drflac_bool32 drflac__decode_samples_with_residual(drflac_bs* bs, drflac_
         }
     }
 
+#ifdef __SDL_SOUND_INTERNAL__
+    if (restoreLPC != NULL) {
+        restoreLPC(blockSize, order, shift, coefficients, pDecodedSamples);
+    }
+#endif
+
     return DRFLAC_TRUE;
 }
 
@@ -15,6 +15,23 @@
 #pragma GCC visibility push(hidden)
 #endif
 
+/* allocate through SDL_sound, so Sound_SetAllocator() covers us, too. */
+extern void *__Sound_malloc(size_t size);
+extern void *__Sound_calloc(size_t nmemb, size_t size);
+extern void *__Sound_realloc(void *ptr, size_t size);
+extern void __Sound_free(void *ptr);
+extern char *__Sound_strdup(const char *str);
+#undef SDL_malloc
+#undef SDL_calloc
+#undef SDL_realloc
+#undef SDL_free
+#undef SDL_strdup
+#define SDL_malloc __Sound_malloc
+#define SDL_calloc __Sound_calloc
+#define SDL_realloc __Sound_realloc
+#define SDL_free __Sound_free
+#define SDL_strdup __Sound_strdup
+
 #ifdef _WIN32
 
 #ifdef _MSC_VER
@@ -270,6 +270,13 @@ extern stb_vorbis * stb_vorbis_open_file_section(FILE *f, int close_handle_on_cl
 #ifdef __SDL_SOUND_INTERNAL__
 extern stb_vorbis * stb_vorbis_open_rwops_section(SDL_RWops *rwops, int close_on_free, int *error, const stb_vorbis_alloc *alloc, unsigned int length);
 extern stb_vorbis * stb_vorbis_open_rwops(SDL_RWops *rwops, int close_on_free, int *error, const stb_vorbis_alloc *alloc);
+
+extern int stb_vorbis_index_pages(stb_vorbis *f, unsigned int max_bytes);
+// SDL_sound: every page decoded is remembered (offset and granule position),
+// and seeks start from the nearest ones instead of bisecting the file. This
+// reads up to about 'max_bytes' more of the stream's page headers, past what's
+// been indexed so far, without disturbing decoding. Returns 1 if there's more
+// to index, 0 once the whole stream is (or it can't get any further).
 #endif
 
 extern int stb_vorbis_seek_frame(stb_vorbis *f, unsigned int sample_number);
@@ -782,6 +789,11 @@ struct stb_vorbis
    SDL_RWops *rwops;
    uint32 rwops_start;
    int close_on_free;
+
+   ProbedPage *page_index;   // audio pages with a granule position, by offset
+   int page_index_count, page_index_capacity;
+   uint32 page_index_end;    // every page before this offset has been seen
+   int page_index_done;      // ...and that's all of them
 #endif
 
    uint8 *stream;
@@ -1460,6 +1472,52 @@ static int capture_pattern(vorb *f)
 #define PAGEFLAG_first_page         2
 #define PAGEFLAG_last_page          4
 
+#ifdef __SDL_SOUND_INTERNAL__
+// SDL_sound: remember an audio page for seeking. the index stays sorted by
+// offset; page_index_end only moves past pages seen one after another.
+static void index_page(vorb *f, uint32 page_start, uint32 page_end, uint32 loc0, uint32 loc1, int last_page)
+{
+   int lo = 0, hi = f->page_index_count;
+
+   if (f->first_audio_page_offset == 0 || page_start < f->first_audio_page_offset)
+      return; // still reading the headers
+
+   // seeking only deals in 32-bit sample numbers, and ~0 means "none"
+   if (loc1 == 0 && loc0 != ~0U) {
+      while (lo < hi) {
+         int mid = (lo + hi) / 2;
+         if (f->page_index[mid].page_start < page_start)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+      if (lo == f->page_index_count || f->page_index[lo].page_start != page_start) {
+         if (f->page_index_count == f->page_index_capacity) {
+            int n = f->page_index_capacity ? f->page_index_capacity * 2 : 256;
+            ProbedPage *p = (ProbedPage *) realloc(f->page_index, n * sizeof (ProbedPage));
+            if (p == NULL) {
+               f->page_index_done = TRUE; // stop growing; seeks search the rest
+               return;
+            }
+            f->page_index = p;
+            f->page_index_capacity = n;
+         }
+         memmove(f->page_index + lo + 1, f->page_index + lo, (f->page_index_count - lo) * sizeof (ProbedPage));
+         f->page_index[lo].page_start = page_start;
+         f->page_index[lo].page_end = page_end;
+         f->page_index[lo].last_decoded_sample = loc0;
+         ++f->page_index_count;
+      }
+   }
+
+   if (page_start == f->page_index_end) {
+      f->page_index_end = page_end;
+      if (last_page)
+         f->page_index_done = TRUE;
+   }
+}
+#endif
+
 static int start_page_no_capturepattern(vorb *f)
 {
    uint32 loc0,loc1,n;
@@ -1483,6 +1541,16 @@ static int start_page_no_capturepattern(vorb *f)
    f->segment_count = get8(f);
    if (!getn(f, f->segments, f->segment_count))
       return error(f, VORBIS_unexpected_eof);
+   #ifdef __SDL_SOUND_INTERNAL__
+   if (!IS_PUSH_MODE(f) && !f->page_index_done) {
+      int i;
+      uint32 len = 27 + f->segment_count;
+      uint32 page_start = stb_vorbis_get_file_offset(f) - len;
+      for (i=0; i < f->segment_count; ++i)
+         len += f->segments[i];
+      index_page(f, page_start, page_start + len, loc0, loc1, f->page_flag & PAGEFLAG_last_page);
+   }
+   #endif
    // assume we _don't_ know any the sample position of any segments
    f->end_seg_with_known_loc = -2;
    if (loc0 != ~0U || loc1 != ~0U) {
@@ -4179,6 +4247,9 @@ static int start_decoder(vorb *f)
    }
 
    f->first_audio_page_offset = stb_vorbis_get_file_offset(f);
+   #ifdef __SDL_SOUND_INTERNAL__
+   f->page_index_end = f->first_audio_page_offset;
+   #endif
 
    return TRUE;
 }
@@ -4235,6 +4306,7 @@ static void vorbis_deinit(stb_vorbis *p)
       setup_free(p, p->bit_reverse[i]);
    }
    #ifdef __SDL_SOUND_INTERNAL__
+   free(p->page_index);
    if (p->close_on_free) SDL_RWclose(p->rwops);
    #endif
    #ifndef STB_VORBIS_NO_STDIO
@@ -4707,6 +4779,25 @@ static int seek_to_sample_coarse(stb_vorbis *f, uint32 sample_number)
       return 0;
    }
 
+   #ifdef __SDL_SOUND_INTERNAL__
+   // SDL_sound: start from the nearest pages we've already seen on either
+   // side of the target. if they're neighbours, there's nothing to search.
+   if (f->page_index_count) {
+      int lo = 0, hi = f->page_index_count;
+      while (lo < hi) {  // find the first page past the target
+         int mid = (lo + hi) / 2;
+         if (f->page_index[mid].last_decoded_sample <= sample_number)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+      if (lo > 0 && f->page_index[lo-1].page_start > left.page_start && f->page_index[lo-1].page_end <= right.page_start)
+         left = f->page_index[lo-1];
+      if (lo < f->page_index_count && f->page_index[lo].page_start >= left.page_end && f->page_index[lo].page_start < right.page_start)
+         right = f->page_index[lo];
+   }
+   #endif
+
    while (left.page_end != right.page_start) {
       assert(left.page_end < right.page_start);
       // search range in bytes
@@ -4989,6 +5080,46 @@ float stb_vorbis_stream_length_in_seconds(stb_vorbis *f)
    return stb_vorbis_stream_length_in_samples(f) / (float) f->sample_rate;
 }
 
+#ifdef __SDL_SOUND_INTERNAL__
+int stb_vorbis_index_pages(stb_vorbis *f, unsigned int max_bytes)
+{
+   uint8 header[27], lacing[255];
+   uint32 restore_offset, stop;
+   int restore_eof;
+
+   if (IS_PUSH_MODE(f)) return error(f, VORBIS_invalid_api_mixing);
+   if (f->page_index_done) return 0;
+
+   // only the page headers get read; decoding carries on where it was
+   restore_offset = stb_vorbis_get_file_offset(f);
+   restore_eof = f->eof;
+   stop = f->page_index_end + max_bytes;
+   if (stop < f->page_index_end) stop = 0xffffffff;
+
+   while (!f->page_index_done && f->page_index_end < stop) {
+      uint32 page_start = f->page_index_end, len = 0;
+      uint32 loc0, loc1;
+      int i;
+
+      set_file_offset(f, page_start);
+      if (!getn(f, header, 27) || memcmp(header, ogg_page_header, 4) != 0 ||
+          (header[26] && !getn(f, lacing, header[26]))) {
+         f->page_index_done = TRUE; // end of the data, or garbage; stop here
+         break;
+      }
+      for (i=0; i < header[26]; ++i)
+         len += lacing[i];
+      loc0 = header[6] + (header[7] << 8) + (header[8] << 16) + ((uint32) header[9] << 24);
+      loc1 = header[10] + (header[11] << 8) + (header[12] << 16) + ((uint32) header[13] << 24);
+      index_page(f, page_start, page_start + 27 + header[26] + len, loc0, loc1, header[5] & PAGEFLAG_last_page);
+   }
+
+   set_file_offset(f, restore_offset);
+   f->eof = restore_eof;
+   return !f->page_index_done;
+}
+#endif
+
 
 
 int stb_vorbis_get_frame_float(stb_vorbis *f, int *channels, float ***output)